@@ -94,9 +94,11 @@ LOCAL_SRC_FILES := \
     stream/src/StreamHaptics.cpp \
     device/src/Headphone.cpp \
     device/src/USBAudio.cpp \
+    device/src/UsbCapabilityCache.cpp \
     device/src/Device.cpp \
     device/src/Speaker.cpp \
     device/src/Bluetooth.cpp \
+    device/src/BtCodecPluginCache.cpp \
     device/src/SpeakerMic.cpp \
     device/src/HeadsetMic.cpp \
     device/src/HdmiIn.cpp \
@@ -119,20 +121,31 @@ LOCAL_SRC_FILES := \
     session/src/SessionAlsaPcm.cpp \
     session/src/SessionAgm.cpp \
     session/src/SessionAlsaUtils.cpp \
+    session/src/MixerCtlCache.cpp \
+    session/src/MixerTransaction.cpp \
+    session/src/SessionPool.cpp \
     session/src/SessionAlsaCompress.cpp \
     session/src/SessionAlsaVoice.cpp \
     session/src/SoundTriggerEngine.cpp \
     session/src/SoundTriggerEngineCapi.cpp \
+    session/src/SecondStageExecutor.cpp \
     session/src/SoundTriggerEngineGsl.cpp \
     session/src/ContextDetectionEngine.cpp \
     context_manager/src/ContextManager.cpp \
     session/src/ACDEngine.cpp \
+    resource_manager/src/ActiveStreamRegistry.cpp \
+    resource_manager/src/FrontEndPool.cpp \
     resource_manager/src/ResourceManager.cpp \
     resource_manager/src/SndCardMonitor.cpp \
+    resource_manager/src/SsrRecoveryScheduler.cpp \
     utils/src/SoundTriggerPlatformInfo.cpp \
     utils/src/ACDPlatformInfo.cpp \
     utils/src/VoiceUIPlatformInfo.cpp \
     utils/src/PalRingBuffer.cpp \
+    utils/src/PalXmlSnapshot.cpp \
+    utils/src/PalInitGraph.cpp \
+    utils/src/PalTrace.cpp \
+    utils/src/PalDumpWriter.cpp \
     utils/src/SignalHandler.cpp \
     utils/src/AudioHapticsInterface.cpp \
     utils/src/MetadataParser.cpp \
@@ -135,15 +135,15 @@ int32_t pal_init(void)
         goto exit;
     }
 #ifndef CARD_STATE_UNSUPPORTED
-    ret = ri->initSndMonitor();
+    ret = ri->runInitStage("snd_monitor", [&ri] { return ri->initSndMonitor(); });
     if (ret != 0) {
         PAL_ERR(LOG_TAG, "snd monitor init failed");
         goto exit;
     }
 #endif
-    ri->init();
+    ri->runInitStage("rm_init", [] { return ResourceManager::init(); });
 
-    ret = ri->initContextManager();
+    ret = ri->runInitStage("context_manager", [&ri] { return ri->initContextManager(); });
     if (ret != 0) {
         PAL_ERR(LOG_TAG, "ContextManager init failed, error:%d", ret);
         goto exit;
@@ -224,6 +224,7 @@ int32_t pal_stream_open(struct pal_stream_attributes *attributes,
 
     PAL_INFO(LOG_TAG, "Enter, stream type:%d", attributes->type);
     kpiEnqueue(__func__, true);
+    rm->loadStreamPlugins(attributes->type);
 #ifdef SOC_PERIPHERAL_PROT
     if (ResourceManager::isTZSecureZone) {
         PAL_DBG(LOG_TAG, "In secure zone, so stop the usecase");
@@ -144,8 +144,8 @@ protected:
     struct pal_media_config    codecConfig;
     codec_format_t             codecFormat;
     void                       *codecInfo;
-    void                       *pluginHandler;
     bt_codec_t                 *pluginCodec;
+    codec_format_t             lastCodecFormat;
     bool                       isAbrEnabled;
     bool                       isConfigured;
     bool                       isLC3MonoModeOn;
@@ -160,12 +160,15 @@ protected:
     std::mutex                 mAbrMutex;
     int                        totalActiveSessionRequests;
     codec_version_t            codecVersion;
+    /* codec params are built here and copied out by checkAndUpdateCustomPayload */
+    PayloadArena               paramArena;
 
     int32_t getPCMId();
     int checkAndUpdateCustomPayload(uint8_t **paramData, size_t *paramSize);
-    int getPluginPayload(void **handle, bt_codec_t **btCodec,
+    int getPluginPayload(bt_codec_t **btCodec,
                          bt_enc_payload_t **out_buf,
                          codec_type codecType);
+    void prefetchPlugins(codec_format_t defaultFormat);
     int configureCOPModule(int32_t pcmId, const char *backendName, uint32_t tagId, uint32_t streamMapDir, bool isFbpayload);
     int configureRATModule(int32_t pcmId, const char *backendName, uint32_t tagId, bool isFbpayload);
     int configurePCMConverterModule(int32_t pcmId, const char *backendName, uint32_t tagId, bool isFbpayload);
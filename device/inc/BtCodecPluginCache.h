@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef BT_CODEC_PLUGIN_CACHE_H
+#define BT_CODEC_PLUGIN_CACHE_H
+
+#include <stdint.h>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <bt_intf.h>
+
+#define BT_PLUGIN_CACHE_MAX_PAYLOADS 8
+
+/*
+ * BT codec plugin libraries stay loaded once they were used, the device
+ * start path no longer pays for a dlopen/dlclose per session.
+ *
+ * Packed payloads are kept as well. An opened plugin is cached together
+ * with the payload it packed, keyed by codec format, direction and the
+ * bytes of the BT stack codec config it was packed from. Only configs
+ * without pointers are cached (see codecInfoSize()), AAC encoder and LC3
+ * configs reference memory of the BT stack and are packed every time.
+ * At most BT_PLUGIN_CACHE_MAX_PAYLOADS unused payloads are kept, the least
+ * recently used one is closed first.
+ */
+class BtCodecPluginCache
+{
+public:
+    /* returns an opened plugin with its payload, release() it when done */
+    static int acquire(const std::string &libPath, uint32_t codecFormat,
+                       codec_type codecType, void *codecInfo,
+                       bt_codec_t **codec, bt_enc_payload_t **payload);
+    static void release(bt_codec_t *codec);
+    /* loads a plugin library ahead of the first session that needs it */
+    static int prefetch(const std::string &libPath);
+    static void deinit();
+private:
+    struct library {
+        void *handle;
+        open_fn_t open;
+    };
+    struct entry {
+        std::string libPath;
+        uint32_t codecFormat;
+        codec_type codecType;
+        std::vector<uint8_t> codecInfo;  /* empty when not cacheable */
+        bt_codec_t *codec;
+        bt_enc_payload_t *payload;
+        uint32_t refs;
+    };
+    static int loadLibrary_l(const std::string &libPath, open_fn_t *openFn);
+    static size_t codecInfoSize(uint32_t codecFormat, codec_type codecType);
+    static void trim_l();
+
+    static std::mutex cacheMutex;
+    static std::map<std::string, struct library> libraries;
+    static std::list<struct entry> entries;     /* most recently used first */
+};
+
+#endif //BT_CODEC_PLUGIN_CACHE_H
@@ -70,6 +70,7 @@
 #include "ResourceManager.h"
 #include <system/audio.h>
 #include <media_fmt_api_basic.h>
+#include <memory>
 
 #ifndef ARRAY_SIZE
 #define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
@@ -86,6 +87,7 @@
 #define MAX_FRAME_BUFFER_NAME_SIZE      80
 #define MAX_CHAR_PER_INT                13
 #define MAX_HDMI_CHANNEL_CNT 8
+#define MAX_EDID_SINK_CAPS   4
 
 #define EXT_DISPLAY_PLUG_STATUS_NOTIFY_ENABLE      0x30
 #define EXT_DISPLAY_PLUG_STATUS_NOTIFY_CONNECT     0x01
@@ -124,6 +126,24 @@ typedef struct edidAudioInfo {
     unsigned int  channelMask;
 } edidAudioInfo;
 
+/*
+ * Everything the stream start path needs from a sink, derived once per
+ * EDID. Sinks are keyed by a hash of the SAD and speaker allocation bytes,
+ * a sink which reconnects with the same EDID reuses its object.
+ */
+typedef struct edidSinkCaps {
+    uint32_t edidHash;
+    edidAudioInfo info;
+    unsigned char srMask;       /* sample rates of all SAD blocks */
+    unsigned char bpsMask;      /* bits per sample of all LPCM blocks */
+    int maxChannels;
+    int highestSR;
+    int highestBps;
+    /* indexed by channel count */
+    int channelAllocation[MAX_CHANNELS_SUPPORTED + 1];
+    uint8_t channelMapLpass[MAX_CHANNELS_SUPPORTED + 1][MAX_CHANNELS_SUPPORTED];
+} edidSinkCaps;
+
 class DisplayPort : public Device
 {
     uint32_t dp_controller;
@@ -165,6 +185,10 @@ public:
     static void updateChannelMask(edidAudioInfo* info);
     static void dumpEdidData(edidAudioInfo *info);
     static bool getSinkCaps(edidAudioInfo* info, char *edidData);
+    static std::shared_ptr<edidSinkCaps> getSinkCapsByEdid(char *edidData);
+    static unsigned char getSRMask(edidAudioInfo* info);
+    static unsigned char getBpsMask(edidAudioInfo* info);
+    std::shared_ptr<edidSinkCaps> getCurrentSinkCaps();
     static int getDeviceChannelAllocation(int num_channels);
     bool isSupportedSR(edidAudioInfo* info, int sr);
     int getMaxChannel();
@@ -69,6 +69,7 @@
 #include "sp_rx.h"
 #include "cps_data_router.h"
 #include <tinyalsa/asoundlib.h>
+#include <atomic>
 #include <mutex>
 #include <condition_variable>
 #include <thread>
@@ -135,7 +136,7 @@ class SpeakerProtection : public Device
 {
 protected :
     bool spkrProtEnable;
-    bool threadExit;
+    static bool threadExit;
     bool triggerCal;
     int minIdleTime;
     static speaker_prot_cal_state spkrCalState;
@@ -144,6 +145,9 @@ protected :
     static bool isSpkrInUse;
     static bool calThrdCreated;
     static bool isDynamicCalTriggered;
+    static bool calPreempted;
+    static std::atomic<uint32_t> pendingStarts;  /* playback starts waiting for the speaker */
+    static uint32_t maxPreemptUs;
     static struct timespec spkrLastTimeUsed;
     static struct mixer *virtMixer;
     static struct mixer *hwMixer;
@@ -166,13 +170,17 @@ private :
 public:
     static std::thread mCalThread;
     static std::condition_variable cv;
+    static std::condition_variable schedCv;
     static std::mutex cvMutex;
     std::mutex deviceMutex;
     static std::mutex calibrationMutex;
     void spkrCalibrationThread();
     int getSpeakerTemperature(int spkr_pos);
-    void spkrCalibrateWait();
+    bool spkrCalibrateWait();
+    void spkrCalSchedule(bool dynamic);
     int spkrStartCalibration();
+    int spkrSaveCalibration();
+    bool isSpeakerTempInRange();
     void speakerProtectionInit();
     void speakerProtectionDeinit();
     void getSpeakerTemperatureList();
@@ -194,6 +202,7 @@ public:
     int speakerProtectionDynamicCal();
     void updateSPcustomPayload();
     static int32_t spkrProtSetR0T0Value(vi_r0t0_cfg_t r0t0Array[]);
+    static bool spkrProtGetR0T0Value(vi_r0t0_cfg_t r0t0Array[], int numCh, bool *expired);
     static void handleSPCallback (uint64_t hdl, uint32_t event_id, void *event_data,
                                   uint32_t event_size);
     void updateCpsCustomPayload(int miid);
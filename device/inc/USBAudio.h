@@ -68,6 +68,7 @@
 #include "ResourceManager.h"
 #include "PalAudioRoute.h"
 #include "SessionAlsaUtils.h"
+#include "UsbCapabilityCache.h"
 #include <tinyalsa/asoundlib.h>
 #include <vector>
 #include <system/audio.h>
@@ -96,6 +97,13 @@ typedef enum usb_usecase_type{
     USB_PLAYBACK,
 } usb_usecase_type_t;
 
+/* outcome of readBestConfig for one request */
+struct usb_best_config {
+    uint32_t bit_width;
+    uint32_t sample_rate;
+    struct pal_channel_info ch_info;
+};
+
 // one card supports multiple devices
 class USBDeviceConfig {
 protected:
@@ -117,6 +125,8 @@ public:
     unsigned long getInterval();
     unsigned int getDefaultRate();
     int getSampleRates(int type, char *rates_str);
+    void setSampleRates(usb_usecase_type_t type, const uint32_t *rates, uint32_t num_rates);
+    const std::vector<unsigned int> &getRates() { return rates_; }
     bool isRateSupported(int requested_rate);
     int getBestRate(int requested_rate, int candidate_rate, unsigned int *best_rate);
     void usb_find_sample_rate_candidate(int base, int requested_rate,
@@ -137,12 +147,24 @@ protected:
     std::multimap<uint32_t, std::shared_ptr<USBDeviceConfig>> format_list_map;
     std::vector <std::shared_ptr<USBDeviceConfig>> usb_device_config_list_;
     unsigned int usb_supported_sample_rates_mask_[2] = {0};
+    /* keyed by bestConfigKey(), filled as requests come in */
+    std::map<uint64_t, struct usb_best_config> best_config_map_;
+    std::string usbid_;
+    /* per usb_usecase_type_t, capabilities came from UsbCapabilityCache */
+    bool fromCache_[2] = {false, false};
     void usb_info_dump(char* read_buf, int type);
+    void addDeviceConfig(std::shared_ptr<USBDeviceConfig> usb_device_info);
+    int loadCapability(usb_usecase_type_t type,
+                       const std::vector<struct usb_cap_altset> &altsets, bool jack_status);
+    static uint64_t bestConfigKey(bool is_playback, bool uhqa, uint32_t bit_width,
+                                  uint32_t sample_rate, uint32_t channels);
 public:
     USBCardConfig(struct pal_usb_device_address address);
     bool isConfigCached(struct pal_usb_device_address addr);
     void setEndian(int endian);
-    int getCapability(usb_usecase_type_t type, struct pal_usb_device_address addr);
+    int getCapability(usb_usecase_type_t type, struct pal_usb_device_address addr,
+                      const std::string &usbid);
+    int refreshCapability(usb_usecase_type_t type);
     int getMaxBitWidth(bool is_playback);
     int getMaxChannels(bool is_playback);
     unsigned int getFormatByBitWidth(int bitwidth);
@@ -177,8 +199,9 @@ public:
     int init(pal_param_device_connection_t device_conn);
     int deinit(pal_param_device_connection_t device_conn);
     int getDefaultConfig(pal_param_device_capability_t capability);
-    void setVendorIdCkv(struct pal_usb_device_address addr);
+    void setVendorIdCkv(const std::string &usbid);
     static int getVendorIdCkv();
+    static std::string readUsbId(int card);
     static bool isUsbConnected(struct pal_usb_device_address addr);
     static bool isUsbAlive(int card);
     int selectBestConfig(struct pal_device *dattr,
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef USB_CAPABILITY_CACHE_H
+#define USB_CAPABILITY_CACHE_H
+
+#include <stdint.h>
+#include <list>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifndef USB_CAP_CACHE_PATH
+#define USB_CAP_CACHE_PATH "/data/vendor/audio/usb_caps.bin"
+#endif
+#define USB_CAP_CACHE_MAGIC 0x50414355 /* "UCAP" */
+#define USB_CAP_CACHE_VERSION 2
+#define USB_CAP_CACHE_MAX_ENTRIES 32
+#define USB_CAP_USBID_SIZE 16
+#define USB_CAP_MAX_RATES 16
+#define USB_CAP_MAX_ALTSETS 64
+
+/* one parsed Altset of /proc/asound/cardN/stream0 */
+struct usb_cap_altset {
+    uint32_t bit_width;
+    uint32_t channels;
+    uint64_t interval_us;
+    int32_t endian;
+    uint32_t num_rates;
+    uint32_t rates[USB_CAP_MAX_RATES];  /* in the order they were parsed */
+};
+
+struct usb_cap_cache_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t num_entries;
+    uint32_t payload_size;
+    uint32_t payload_crc;
+};
+
+/* size and CRC32 of the stream0 text the altsets were parsed from */
+struct usb_cap_fingerprint {
+    uint32_t size;
+    uint32_t crc;
+};
+
+struct usb_cap_entry_header {
+    char usbid[USB_CAP_USBID_SIZE];
+    uint32_t type;              /* usb_usecase_type_t */
+    struct usb_cap_fingerprint fp;
+    uint32_t num_altsets;
+};
+
+/*
+ * Capabilities of USB audio devices keyed by the vendor:product id from
+ * /proc/asound/cardN/usbid and the direction. The altsets are kept in a
+ * file so a device seen before skips parsing after a reboot as well.
+ *
+ * stream0 is still read on every connection, an entry is only used while
+ * the fingerprint of that text matches the one it was parsed from. Two
+ * devices sharing an id, or a firmware update changing the descriptors,
+ * therefore parse again. The running status block is left out of the
+ * fingerprint since it changes with the stream state, not the device.
+ *
+ * At most USB_CAP_CACHE_MAX_ENTRIES entries are kept, the least recently
+ * used is dropped first. Jack status is not part of it, it is read on
+ * connection.
+ */
+class UsbCapabilityCache
+{
+public:
+    static struct usb_cap_fingerprint fingerprint(const char *stream0, size_t size);
+    static int lookup(const std::string &usbid, uint32_t type,
+                      const struct usb_cap_fingerprint &fp,
+                      std::vector<struct usb_cap_altset> *altsets);
+    static void store(const std::string &usbid, uint32_t type,
+                      const struct usb_cap_fingerprint &fp,
+                      const std::vector<struct usb_cap_altset> &altsets);
+    /* drop an entry whose altsets turned out not to fit the device */
+    static void invalidate(const std::string &usbid, uint32_t type);
+private:
+    struct entry {
+        std::string usbid;
+        uint32_t type;
+        struct usb_cap_fingerprint fp;
+        std::vector<struct usb_cap_altset> altsets;
+    };
+    static void load_l();
+    static int save_l();
+    static std::list<struct entry>::iterator find_l(const std::string &usbid, uint32_t type);
+
+    static std::mutex cacheMutex;
+    static bool loaded;
+    static std::list<struct entry> entries;    /* most recently used first */
+};
+
+#endif //USB_CAPABILITY_CACHE_H
@@ -41,6 +41,7 @@
 #include "SessionAlsaUtils.h"
 #include "Device.h"
 #include "kvh2xml.h"
+#include "BtCodecPluginCache.h"
 #include <dlfcn.h>
 #include <unistd.h>
 #ifndef PAL_CUTILS_UNSUPPORTED
@@ -63,6 +64,7 @@ Bluetooth::Bluetooth(struct pal_device *device, std::shared_ptr<ResourceManager>
     : Device(device, Rm),
       codecFormat(CODEC_TYPE_INVALID),
       codecInfo(NULL),
+      lastCodecFormat(CODEC_TYPE_INVALID),
       isAbrEnabled(false),
       isConfigured(false),
       isLC3MonoModeOn(false),
@@ -87,7 +89,7 @@ int Bluetooth::updateDeviceMetadata()
     struct mixer_ctl *ctrl = NULL;
 
     if (ResourceManager::isXPANEnabled) {
-        ctrl = mixer_get_ctl_by_name(hwMixerHandle,
+        ctrl = MixerCtlCache::getCtl(hwMixerHandle,
                                      MIXER_SET_CODEC_TYPE);
         if (!ctrl) {
             PAL_ERR(LOG_TAG, "ERROR %s mixer control not identified",
@@ -182,14 +184,11 @@ bool Bluetooth::isPlaceholderEncoder()
     }
 }
 
-int Bluetooth::getPluginPayload(void **libHandle, bt_codec_t **btCodec,
+int Bluetooth::getPluginPayload(bt_codec_t **btCodec,
               bt_enc_payload_t **out_buf, codec_type codecType)
 {
     std::string lib_path;
-    open_fn_t plugin_open_fn = NULL;
     int status = 0;
-    bt_codec_t *codec = NULL;
-    void *handle = NULL;
 
     lib_path = rm->getBtCodecLib(codecFormat, (codecType == ENC ? "enc" : "dec"));
     if (lib_path.empty()) {
@@ -197,42 +196,27 @@ int Bluetooth::getPluginPayload(void **libHandle, bt_codec_t **btCodec,
         return -ENOSYS;
     }
 
-    handle = dlopen(lib_path.c_str(), RTLD_NOW);
-    if (handle == NULL) {
-        PAL_ERR(LOG_TAG, "failed to dlopen lib %s. Error: %s", lib_path.c_str(), dlerror());
-        return -EINVAL;
-    }
-
-    plugin_open_fn = (open_fn_t)dlsym(handle, "plugin_open");
-    if (!plugin_open_fn) {
-        PAL_ERR(LOG_TAG, "dlsym to open fn failed, err = '%s'", dlerror());
-        status = -EINVAL;
-        goto error;
-    }
+    status = BtCodecPluginCache::acquire(lib_path, codecFormat, codecType,
+                                         codecInfo, btCodec, out_buf);
+    if (!status)
+        lastCodecFormat = codecFormat;
 
-    status = plugin_open_fn(&codec, codecFormat, codecType);
-    if (status) {
-        PAL_ERR(LOG_TAG, "failed to open plugin %d", status);
-        goto error;
-    }
+    return status;
+}
 
-    status = codec->plugin_populate_payload(codec, codecInfo, (void **)out_buf);
-    if (status != 0) {
-        PAL_ERR(LOG_TAG, "fail to pack the encoder config %d", status);
-        goto error;
-    }
-    *btCodec = codec;
-    *libHandle = handle;
-    goto done;
+/* load the plugins of the codec this device used last before it starts */
+void Bluetooth::prefetchPlugins(codec_format_t defaultFormat)
+{
+    codec_format_t format = lastCodecFormat;
 
-error:
-    if (codec)
-        codec->close_plugin(codec);
+    if (format == CODEC_TYPE_INVALID)
+        format = defaultFormat;
+    if (format == CODEC_TYPE_INVALID)
+        return;
 
-    if (handle)
-        dlclose(handle);
-done:
-    return status;
+    PAL_DBG(LOG_TAG, "prefetch plugins of codec 0x%x", format);
+    BtCodecPluginCache::prefetch(rm->getBtCodecLib(format, "enc"));
+    BtCodecPluginCache::prefetch(rm->getBtCodecLib(format, "dec"));
 }
 
 int Bluetooth::checkAndUpdateCustomPayload(uint8_t **paramData, size_t *paramSize)
@@ -243,7 +227,10 @@ int Bluetooth::checkAndUpdateCustomPayload(uint8_t **paramData, size_t *paramSiz
         return ret;
 
     ret = updateCustomPayload(*paramData, *paramSize);
-    free(*paramData);
+    if (paramArena.owns(*paramData))
+        paramArena.reset();
+    else
+        free(*paramData);
     *paramData = NULL;
     *paramSize = 0;
     return 0;
@@ -478,7 +465,7 @@ int Bluetooth::configureGraphModules()
     /* Retrieve plugin library from resource manager.
      * Map to interested symbols.
      */
-    status = getPluginPayload(&pluginHandler, &pluginCodec, &out_buf, codecType);
+    status = getPluginPayload(&pluginCodec, &out_buf, codecType);
     if (status) {
         PAL_ERR(LOG_TAG, "failed to payload from plugin");
         goto error;
@@ -510,7 +497,7 @@ int Bluetooth::configureGraphModules()
     if (isPlaceholderEncoder()) {
         PAL_DBG(LOG_TAG, "Resetting placeholder module");
         builder->payloadCustomParam(&paramData, &paramSize, NULL, 0,
-                                    miid, PARAM_ID_RESET_PLACEHOLDER_MODULE);
+                                    miid, PARAM_ID_RESET_PLACEHOLDER_MODULE, &paramArena);
         status = checkAndUpdateCustomPayload(&paramData, &paramSize);
         if (status) {
             PAL_ERR(LOG_TAG, "Invalid reset placeholder param size");
@@ -523,7 +510,8 @@ int Bluetooth::configureGraphModules()
     for (i = 0; i < num_payloads; i++) {
         custom_block_t *blk = out_buf->blocks[i];
         builder->payloadCustomParam(&paramData, &paramSize,
-                  (uint32_t *)blk->payload, blk->payload_sz, miid, blk->param_id);
+                  (uint32_t *)blk->payload, blk->payload_sz, miid, blk->param_id,
+                  &paramArena);
         status = checkAndUpdateCustomPayload(&paramData, &paramSize);
         if (status) {
             PAL_ERR(LOG_TAG, "Failed to populateAPMHeader");
@@ -806,7 +794,6 @@ void Bluetooth::startAbr()
     std::ostringstream disconnectCtrlName;
     unsigned int flags;
     uint32_t tagId = 0, miid = 0, streamMapDir = 0;
-    void *pluginLibHandle = NULL;
     bt_codec_t *codec = NULL;
     bt_enc_payload_t *out_buf = NULL;
     custom_block_t *blk = NULL;
@@ -907,7 +894,7 @@ void Bluetooth::startAbr()
     }
 
     connectCtrlName << "PCM" << fbpcmDevIds.at(0) << " connect";
-    connectCtrl = mixer_get_ctl_by_name(virtualMixerHandle, connectCtrlName.str().data());
+    connectCtrl = MixerCtlCache::getCtl(virtualMixerHandle, connectCtrlName.str().data());
     if (!connectCtrl) {
         PAL_ERR(LOG_TAG, "invalid mixer control: %s", connectCtrlName.str().data());
         goto free_fe;
@@ -922,7 +909,7 @@ void Bluetooth::startAbr()
 
     // Notify ABR usecase information to BT driver to distinguish
     // between SCO and feedback usecase
-    btSetFeedbackChannelCtrl = mixer_get_ctl_by_name(hwMixerHandle,
+    btSetFeedbackChannelCtrl = MixerCtlCache::getCtl(hwMixerHandle,
                                         MIXER_SET_FEEDBACK_CHANNEL);
     if (!btSetFeedbackChannelCtrl) {
         PAL_ERR(LOG_TAG, "ERROR %s mixer control not identified",
@@ -975,7 +962,7 @@ void Bluetooth::startAbr()
             break;
         }
 
-        ret = getPluginPayload(&pluginLibHandle, &codec, &out_buf, (codecType == DEC ? ENC : DEC));
+        ret = getPluginPayload(&codec, &out_buf, (codecType == DEC ? ENC : DEC));
         if (ret) {
             PAL_ERR(LOG_TAG, "getPluginPayload failed");
             goto disconnect_fe;
@@ -984,6 +971,7 @@ void Bluetooth::startAbr()
         /* SWB Encoder/Decoder has only 1 param, read block 0 */
         if (out_buf->num_blks != 1) {
             PAL_ERR(LOG_TAG, "incorrect block size %d", out_buf->num_blks);
+            BtCodecPluginCache::release(codec);
             goto disconnect_fe;
         }
         fbDev->codecConfig.sample_rate = out_buf->sample_rate;
@@ -993,10 +981,10 @@ void Bluetooth::startAbr()
 
         blk = out_buf->blocks[0];
         builder->payloadCustomParam(&paramData, &paramSize,
-                  (uint32_t *)blk->payload, blk->payload_sz, miid, blk->param_id);
+                  (uint32_t *)blk->payload, blk->payload_sz, miid, blk->param_id,
+                  &fbDev->paramArena);
 
-        codec->close_plugin(codec);
-        dlclose(pluginLibHandle);
+        BtCodecPluginCache::release(codec);
 
         if (!paramData) {
             PAL_ERR(LOG_TAG, "Failed to populateAPMHeader");
@@ -1111,7 +1099,7 @@ err_pcm_open:
     fbPcm = NULL;
 disconnect_fe:
     disconnectCtrlName << "PCM" << fbpcmDevIds.at(0) << " disconnect";
-    disconnectCtrl = mixer_get_ctl_by_name(virtualMixerHandle, disconnectCtrlName.str().data());
+    disconnectCtrl = MixerCtlCache::getCtl(virtualMixerHandle, disconnectCtrlName.str().data());
     if(disconnectCtrl != NULL){
        mixer_ctl_set_enum_by_string(disconnectCtrl, backEndName.c_str());
     }
@@ -1170,7 +1158,7 @@ void Bluetooth::stopAbr()
     fbPcm = NULL;
 
     // Reset BT driver mixer control for ABR usecase
-    btSetFeedbackChannelCtrl = mixer_get_ctl_by_name(hwMixerHandle,
+    btSetFeedbackChannelCtrl = MixerCtlCache::getCtl(hwMixerHandle,
                                         MIXER_SET_FEEDBACK_CHANNEL);
     if (!btSetFeedbackChannelCtrl) {
         PAL_ERR(LOG_TAG, "%s mixer control not identified",
@@ -1288,7 +1276,6 @@ BtA2dp::BtA2dp(struct pal_device *device, std::shared_ptr<ResourceManager> Rm)
 {
     a2dpRole = ((device->id == PAL_DEVICE_IN_BLUETOOTH_A2DP) || (device->id == PAL_DEVICE_IN_BLUETOOTH_BLE)) ? SINK : SOURCE;
     codecType = ((device->id == PAL_DEVICE_IN_BLUETOOTH_A2DP) || (device->id == PAL_DEVICE_IN_BLUETOOTH_BLE)) ? DEC : ENC;
-    pluginHandler = NULL;
     pluginCodec = NULL;
 
     param_bt_a2dp.reconfig = false;
@@ -1844,13 +1831,9 @@ int BtA2dp::stopPlayback()
         }
 
         if (pluginCodec) {
-            pluginCodec->close_plugin(pluginCodec);
+            BtCodecPluginCache::release(pluginCodec);
             pluginCodec = NULL;
         }
-        if (pluginHandler) {
-            dlclose(pluginHandler);
-            pluginHandler = NULL;
-        }
     }
 
     PAL_DBG(LOG_TAG, "Stop A2DP playback, total active sessions :%d",
@@ -2036,13 +2019,9 @@ int BtA2dp::stopCapture()
         param_bt_a2dp.latency = 0;
 
         if (pluginCodec) {
-            pluginCodec->close_plugin(pluginCodec);
+            BtCodecPluginCache::release(pluginCodec);
             pluginCodec = NULL;
         }
-        if (pluginHandler) {
-            dlclose(pluginHandler);
-            pluginHandler = NULL;
-        }
     }
     PAL_DBG(LOG_TAG, "Stop A2DP capture, total active sessions :%d",
             totalActiveSessionRequests);
@@ -2077,6 +2056,14 @@ int32_t BtA2dp::setDeviceParameter(uint32_t param_id, void *param)
                 a2dpState = A2DP_STATE_CONNECTED;
 #endif
             }
+            /* SBC and LC3 are mandatory, the likely codec of a new sink */
+            if (deviceAttr.id == PAL_DEVICE_OUT_BLUETOOTH_A2DP)
+                prefetchPlugins(CODEC_TYPE_SBC);
+            else if (deviceAttr.id == PAL_DEVICE_OUT_BLUETOOTH_BLE ||
+                     deviceAttr.id == PAL_DEVICE_IN_BLUETOOTH_BLE)
+                prefetchPlugins(CODEC_TYPE_LC3);
+            else
+                prefetchPlugins(CODEC_TYPE_INVALID);
         } else {
             if (a2dpRole == SOURCE) {
                 status = close_audio_source();
@@ -2505,7 +2492,6 @@ BtSco::BtSco(struct pal_device *device, std::shared_ptr<ResourceManager> Rm)
     : Bluetooth(device, Rm)
 {
     codecType = (device->id == PAL_DEVICE_OUT_BLUETOOTH_SCO) ? ENC : DEC;
-    pluginHandler = NULL;
     pluginCodec = NULL;
 }
 
@@ -2791,13 +2777,9 @@ int BtSco::stop()
         stopAbr();
 
     if (pluginCodec) {
-        pluginCodec->close_plugin(pluginCodec);
+        BtCodecPluginCache::release(pluginCodec);
         pluginCodec = NULL;
     }
-    if (pluginHandler) {
-        dlclose(pluginHandler);
-        pluginHandler = NULL;
-    }
 
     Device::stop_l();
     if (isAbrEnabled == false)
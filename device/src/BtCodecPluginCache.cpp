@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#define LOG_TAG "PAL: BtCodecPluginCache"
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <string.h>
+#include "BtCodecPluginCache.h"
+#include "PalCommon.h"
+#include <bt_aptx.h>
+#include <bt_bundle.h>
+
+std::mutex BtCodecPluginCache::cacheMutex;
+std::map<std::string, struct BtCodecPluginCache::library> BtCodecPluginCache::libraries;
+std::list<struct BtCodecPluginCache::entry> BtCodecPluginCache::entries;
+
+/* size of a codec config the payload depends on only, 0 if it has pointers */
+size_t BtCodecPluginCache::codecInfoSize(uint32_t codecFormat, codec_type codecType)
+{
+    switch (codecFormat) {
+        case CODEC_TYPE_SBC:
+            return codecType == ENC ? sizeof(audio_sbc_encoder_config_t) :
+                                      sizeof(audio_sbc_decoder_config_t);
+        case CODEC_TYPE_AAC:
+            return codecType == ENC ? 0 : sizeof(audio_aac_decoder_config_t);
+        case CODEC_TYPE_CELT:
+            return sizeof(audio_celt_encoder_config_t);
+        case CODEC_TYPE_LDAC:
+            return sizeof(audio_ldac_encoder_config_t);
+        case CODEC_TYPE_APTX:
+            return sizeof(audio_aptx_encoder_config_t);
+        case CODEC_TYPE_APTX_HD:
+            return sizeof(audio_aptx_hd_encoder_config_t);
+        case CODEC_TYPE_APTX_DUAL_MONO:
+            return sizeof(audio_aptx_dual_mono_config_t);
+        case CODEC_TYPE_APTX_AD:
+            return sizeof(audio_aptx_ad_encoder_config_t);
+        case CODEC_TYPE_APTX_AD_SPEECH:
+            return sizeof(uint32_t);
+        default:
+            return 0;
+    }
+}
+
+int BtCodecPluginCache::loadLibrary_l(const std::string &libPath, open_fn_t *openFn)
+{
+    struct library lib = {nullptr, nullptr};
+
+    auto it = libraries.find(libPath);
+    if (it != libraries.end()) {
+        *openFn = it->second.open;
+        return 0;
+    }
+
+    lib.handle = dlopen(libPath.c_str(), RTLD_NOW);
+    if (!lib.handle) {
+        PAL_ERR(LOG_TAG, "failed to dlopen lib %s. Error: %s", libPath.c_str(), dlerror());
+        return -EINVAL;
+    }
+
+    lib.open = (open_fn_t)dlsym(lib.handle, "plugin_open");
+    if (!lib.open) {
+        PAL_ERR(LOG_TAG, "dlsym to open fn failed, err = '%s'", dlerror());
+        dlclose(lib.handle);
+        return -EINVAL;
+    }
+
+    PAL_DBG(LOG_TAG, "loaded %s", libPath.c_str());
+    libraries[libPath] = lib;
+    *openFn = lib.open;
+    return 0;
+}
+
+int BtCodecPluginCache::prefetch(const std::string &libPath)
+{
+    open_fn_t openFn = nullptr;
+
+    if (libPath.empty())
+        return -EINVAL;
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    return loadLibrary_l(libPath, &openFn);
+}
+
+int BtCodecPluginCache::acquire(const std::string &libPath, uint32_t codecFormat,
+                                codec_type codecType, void *codecInfo,
+                                bt_codec_t **codec, bt_enc_payload_t **payload)
+{
+    int status = 0;
+    open_fn_t openFn = nullptr;
+    size_t infoSize = codecInfo ? codecInfoSize(codecFormat, codecType) : 0;
+    struct entry e;
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    if (infoSize) {
+        for (auto it = entries.begin(); it != entries.end(); it++) {
+            if (it->codecInfo.empty() || it->codecFormat != codecFormat ||
+                it->codecType != codecType || it->libPath != libPath ||
+                memcmp(it->codecInfo.data(), codecInfo, infoSize))
+                continue;
+            it->refs++;
+            *codec = it->codec;
+            *payload = it->payload;
+            entries.splice(entries.begin(), entries, it);
+            PAL_DBG(LOG_TAG, "payload of codec 0x%x reused", codecFormat);
+            return 0;
+        }
+    }
+
+    status = loadLibrary_l(libPath, &openFn);
+    if (status)
+        return status;
+
+    e.codec = nullptr;
+    e.payload = nullptr;
+    status = openFn(&e.codec, codecFormat, codecType);
+    if (status) {
+        PAL_ERR(LOG_TAG, "failed to open plugin %d", status);
+        return status;
+    }
+
+    status = e.codec->plugin_populate_payload(e.codec, codecInfo, (void **)&e.payload);
+    if (status != 0) {
+        PAL_ERR(LOG_TAG, "fail to pack the encoder config %d", status);
+        e.codec->close_plugin(e.codec);
+        return status;
+    }
+
+    e.libPath = libPath;
+    e.codecFormat = codecFormat;
+    e.codecType = codecType;
+    if (infoSize)
+        e.codecInfo.assign((uint8_t *)codecInfo, (uint8_t *)codecInfo + infoSize);
+    e.refs = 1;
+    *codec = e.codec;
+    *payload = e.payload;
+    entries.push_front(std::move(e));
+    trim_l();
+    return 0;
+}
+
+void BtCodecPluginCache::release(bt_codec_t *codec)
+{
+    if (!codec)
+        return;
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    for (auto it = entries.begin(); it != entries.end(); it++) {
+        if (it->codec != codec)
+            continue;
+        if (it->refs)
+            it->refs--;
+        if (!it->refs && it->codecInfo.empty()) {
+            it->codec->close_plugin(it->codec);
+            entries.erase(it);
+        }
+        trim_l();
+        return;
+    }
+    PAL_ERR(LOG_TAG, "codec %p is not from the cache", codec);
+}
+
+void BtCodecPluginCache::trim_l()
+{
+    uint32_t idle = 0;
+
+    for (auto it = entries.begin(); it != entries.end();) {
+        if (it->refs || ++idle <= BT_PLUGIN_CACHE_MAX_PAYLOADS) {
+            it++;
+            continue;
+        }
+        it->codec->close_plugin(it->codec);
+        it = entries.erase(it);
+    }
+}
+
+void BtCodecPluginCache::deinit()
+{
+    std::lock_guard<std::mutex> lock(cacheMutex);
+
+    for (auto &e : entries) {
+        if (e.refs)
+            PAL_ERR(LOG_TAG, "codec 0x%x still in use", e.codecFormat);
+        e.codec->close_plugin(e.codec);
+    }
+    entries.clear();
+    for (auto &lib : libraries)
+        dlclose(lib.second.handle);
+    libraries.clear();
+}
@@ -73,6 +73,7 @@
 #include "USBAudio.h"
 #include "SpeakerMic.h"
 #include "Stream.h"
+#include "PalTrace.h"
 #include "HeadsetMic.h"
 #include "HandsetMic.h"
 #include "HdmiIn.h"
@@ -472,6 +473,7 @@ int Device::deinit(pal_param_device_connection_t device_conn __unused)
 int Device::open()
 {
     int status = 0;
+    PAL_TRACE_SPAN_ARG("Device::open", this->deviceAttr.id);
 
     mDeviceMutex.lock();
     mPALDeviceName = rm->getPALDeviceName(this->deviceAttr.id);
@@ -519,6 +521,8 @@ exit:
 int Device::close()
 {
     int status = 0;
+    PAL_TRACE_SPAN_ARG("Device::close", this->deviceAttr.id);
+
     mDeviceMutex.lock();
     PAL_INFO(LOG_TAG, "Enter. deviceCount %d for device id %d (%s)", deviceCount,
             this->deviceAttr.id, mPALDeviceName.c_str());
@@ -548,6 +552,7 @@ int Device::prepare()
 int Device::start()
 {
     int status = 0;
+    PAL_TRACE_SPAN_ARG("Device::start", this->deviceAttr.id);
 
     mDeviceMutex.lock();
     status = start_l();
@@ -614,6 +619,7 @@ exit :
 int Device::stop()
 {
     int status = 0;
+    PAL_TRACE_SPAN_ARG("Device::stop", this->deviceAttr.id);
 
     mDeviceMutex.lock();
     status = stop_l();
@@ -677,7 +683,7 @@ int32_t Device::configureDeviceClockSrc(char const *mixerStrClockSrc, const uint
     /* Hw mixer control registration is optional in case
      * clock source selection is not required
      */
-    clockSrcCtrl = mixer_get_ctl_by_name(hwMixerHandle, mixerStrClockSrc);
+    clockSrcCtrl = MixerCtlCache::getCtl(hwMixerHandle, mixerStrClockSrc);
     if (!clockSrcCtrl) {
         PAL_DBG(LOG_TAG, "%s hw mixer control not identified", mixerStrClockSrc);
         goto exit;
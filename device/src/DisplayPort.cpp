@@ -33,12 +33,15 @@
  */
 
 #define LOG_TAG "PAL: DisplayPort"
+#include <list>
+#include <mutex>
 #include "DisplayPort.h"
 #include "SessionAlsaUtils.h"
 #include "ResourceManager.h"
 #include "PayloadBuilder.h"
 #include "Device.h"
 #include "kvh2xml.h"
+#include "PalXmlSnapshot.h"
 
 enum {
     EXT_DISPLAY_TYPE_NONE,
@@ -60,11 +63,15 @@ enum {
 #define DISCONNECT      "Disconnect"
 
 static struct extDispState {
-    void *edidInfo = NULL;
+    std::shared_ptr<edidSinkCaps> sinkCaps = nullptr;
     bool valid = false;
     int type = EXT_DISPLAY_TYPE_NONE;
 } extDisp[MAX_CONTROLLERS][MAX_STREAMS_PER_CONTROLLER];
 
+static std::mutex sinkCapsMutex;
+/* most recently connected first */
+static std::list<std::shared_ptr<edidSinkCaps>> sinkCapsList;
+
 std::shared_ptr<Device> DisplayPort::objRx = nullptr;
 std::shared_ptr<Device> DisplayPort::objTx = nullptr;
 
@@ -154,6 +161,8 @@ int DisplayPort::getDeviceAttributes(struct pal_device *dattr, Stream* streamHan
 {
     int status = 0;
     int channel_allocation = 0;
+    int channels = deviceAttr.config.ch_info.channels;
+    std::shared_ptr<edidSinkCaps> caps = getCurrentSinkCaps();
     (void)streamHandle;
 
     if (!dattr) {
@@ -163,7 +172,13 @@ int DisplayPort::getDeviceAttributes(struct pal_device *dattr, Stream* streamHan
     }
     ar_mem_cpy(dattr, sizeof(struct pal_device), &deviceAttr, sizeof(struct pal_device));
 
-    channel_allocation = getDeviceChannelAllocation(deviceAttr.config.ch_info.channels);
+    if (caps && channels <= MAX_CHANNELS_SUPPORTED) {
+        memcpy(&dattr->config.ch_info.ch_map[0], caps->channelMapLpass[channels],
+               MAX_CHANNELS_SUPPORTED);
+        return status;
+    }
+
+    channel_allocation = getDeviceChannelAllocation(channels);
 
     retrieveChannelMapLpass(channel_allocation, &dattr->config.ch_info.ch_map[0],
             PAL_MAX_CHANNELS_SUPPORTED);
@@ -204,6 +219,7 @@ int DisplayPort::configureDpEndpoint()
     std::shared_ptr<Device> dev = nullptr;
     std::vector<Stream*> activestreams;
     uint32_t miid = 0;
+    std::shared_ptr<edidSinkCaps> caps = getCurrentSinkCaps();
 
     rm->getBackendName(deviceAttr.id, backEndName);
     dev = Device::getInstance(&deviceAttr, rm);
@@ -220,7 +236,10 @@ int DisplayPort::configureDpEndpoint()
         PAL_ERR(LOG_TAG, "Failed to get tag info %x, status = %d", DEVICE_HW_ENDPOINT_RX, status);
         goto exit;
     }
-    cfg.channel_allocation = getDeviceChannelAllocation(deviceAttr.config.ch_info.channels);
+    if (caps && deviceAttr.config.ch_info.channels <= MAX_CHANNELS_SUPPORTED)
+        cfg.channel_allocation = caps->channelAllocation[deviceAttr.config.ch_info.channels];
+    else
+        cfg.channel_allocation = getDeviceChannelAllocation(deviceAttr.config.ch_info.channels);
     cfg.mst_idx = dp_stream;
     cfg.dptx_idx = dp_controller;
     builder->payloadDpAudioConfig(&payload, &payloadSize, miid, &cfg);
@@ -359,7 +378,7 @@ int DisplayPort::updateAudioAckState(int node_value, int controller, int stream)
                  "%s%d %s", ctl_prefix, ctl_index, ctl_suffix);
 
     PAL_DBG(LOG_TAG, "mixer ctl name: %s", mixer_ctl_name);
-    ctl = mixer_get_ctl_by_name(mixer, mixer_ctl_name);
+    ctl = MixerCtlCache::getCtl(mixer, mixer_ctl_name);
     /* If no mixer command support, fall back to sysfs node approach */
     if (!ctl) {
         PAL_DBG(LOG_TAG, "could not get ctl for mixer cmd(%s), use sysfs node instead\n",
@@ -423,7 +442,9 @@ int DisplayPort::init(pal_param_device_connection_t device_conn)
 int DisplayPort::deinit(pal_param_device_connection_t device_conn __unused)
 {
     updateAudioAckState(EXT_DISPLAY_PLUG_STATUS_NOTIFY_DISCONNECT, dp_controller, dp_stream);
-    //To-Do : Have to invalidate the cahed EDID
+    /* the next connection may be another sink, its EDID is read again */
+    if (getDisplayPortCtlIndex(dp_controller, dp_stream) >= 0)
+        extDisp[dp_controller][dp_stream].valid = false;
     return 0;
 }
 
@@ -447,10 +468,7 @@ void DisplayPort::resetEdidInfo() {
         for (j = 0; j < MAX_STREAMS_PER_CONTROLLER; ++j) {
             struct extDispState *state = &extDisp[i][j];
             state->type = EXT_DISPLAY_TYPE_NONE;
-            if (state->edidInfo) {
-                free(state->edidInfo);
-                state->edidInfo = NULL;
-            }
+            state->sinkCaps = nullptr;
             state->valid = false;
         }
     }
@@ -510,7 +528,7 @@ int32_t DisplayPort::setExtDisplayDevice(struct audio_mixer *mixer, int controll
 
     PAL_DBG(LOG_TAG," mixer: %pK mixer ctl name: %s", mixer, mixerCtlName);
 
-    ctl = mixer_get_ctl_by_name(mixer, mixerCtlName);
+    ctl = MixerCtlCache::getCtl(mixer, mixerCtlName);
     if (!ctl) {
         PAL_ERR(LOG_TAG,"Could not get ctl for mixer cmd - %s", mixerCtlName);
         return -EINVAL;
@@ -555,7 +573,7 @@ int32_t DisplayPort::getExtDispType(struct audio_mixer *mixer, int controller, i
 
         PAL_VERBOSE(LOG_TAG,"mixer ctl name: %s", mixerCtlName);
 
-        ctl = mixer_get_ctl_by_name(mixer, mixerCtlName);
+        ctl = MixerCtlCache::getCtl(mixer, mixerCtlName);
         if (!ctl) {
             PAL_ERR(LOG_TAG,"Could not get ctl for mixer cmd - %s", mixerCtlName);
             return -EINVAL;
@@ -589,6 +607,7 @@ int DisplayPort::getEdidInfo(struct audio_mixer *mixer, int controller, int stre
     const char *ctlNamePrefix = "Display Port";
     const char *ctlNameSuffix = "EDID";
     char mixerCtlName[MIXER_PATH_MAX_LENGTH] = {0};
+    std::shared_ptr<edidSinkCaps> caps = nullptr;
 
     ctlIndex = getDisplayPortCtlIndex(controller, stream);
     if (-EINVAL == ctlIndex) {
@@ -624,13 +643,9 @@ int DisplayPort::getEdidInfo(struct audio_mixer *mixer, int controller, int stre
             return -EINVAL;
     }
 
-    if (state->edidInfo == NULL)
-        state->edidInfo =
-            (struct edidAudioInfo *)calloc(1, sizeof(struct edidAudioInfo));
-
     PAL_VERBOSE(LOG_TAG," mixer ctl name: %s", mixerCtlName);
 
-    ctl = mixer_get_ctl_by_name(mixer, mixerCtlName);
+    ctl = MixerCtlCache::getCtl(mixer, mixerCtlName);
     if (!ctl) {
         PAL_ERR(LOG_TAG," Could not get ctl for mixer cmd - %s", mixerCtlName);
         goto fail;
@@ -654,18 +669,17 @@ int DisplayPort::getEdidInfo(struct audio_mixer *mixer, int controller, int stre
 
     PAL_VERBOSE(LOG_TAG," received edid data: count %d", edidData[0]);
 
-    if (!getSinkCaps((struct edidAudioInfo *)state->edidInfo, edidData)) {
+    caps = getSinkCapsByEdid(edidData);
+    if (!caps) {
         PAL_ERR(LOG_TAG," Failed to get extn disp sink capabilities");
         goto fail;
     }
+    state->sinkCaps = caps;
     state->valid = true;
     return 0;
 fail:
-    if (state->edidInfo) {
-        free(state->edidInfo);
-        state->edidInfo = NULL;
-        state->valid = false;
-    }
+    state->sinkCaps = nullptr;
+    state->valid = false;
     PAL_ERR(LOG_TAG," return -EINVAL");
     return -EINVAL;
 }
@@ -1673,24 +1687,98 @@ bool DisplayPort::getSinkCaps(edidAudioInfo* info, char *edidData)
     return true;
 }
 
-bool DisplayPort::isSupportedSR(edidAudioInfo* info, int sr)
+unsigned char DisplayPort::getSRMask(edidAudioInfo* info)
 {
-    int i = 0;
-    struct extDispState *state = NULL;
+    unsigned char srMask = 0;
+
+    if (!info)
+        return 0;
+    for (int i = 0; i < info->audioBlocks && i < MAX_EDID_BLOCKS; i++)
+        srMask |= info->audioBlocksArray[i].samplingFreqBitmask;
+    return srMask;
+}
+
+unsigned char DisplayPort::getBpsMask(edidAudioInfo* info)
+{
+    unsigned char bpsMask = 0;
+
+    if (!info)
+        return 0;
+    for (int i = 0; i < info->audioBlocks && i < MAX_EDID_BLOCKS; i++)
+        bpsMask |= info->audioBlocksArray[i].bitsPerSampleBitmask;
+    return bpsMask;
+}
 
-    state = &extDisp[dp_controller][dp_stream];
-    if (state && state->edidInfo)
-    {
-        info = (edidAudioInfo*) state->edidInfo;
+std::shared_ptr<edidSinkCaps> DisplayPort::getSinkCapsByEdid(char *edidData)
+{
+    std::shared_ptr<edidSinkCaps> caps = nullptr;
+    edidAudioInfo *info = NULL;
+    uint32_t hash = PalXmlSnapshot::crc32((const uint8_t *)edidData,
+                                          (uint8_t)edidData[0] + 1);
+    int ch = 0;
+
+    std::lock_guard<std::mutex> lock(sinkCapsMutex);
+    for (auto it = sinkCapsList.begin(); it != sinkCapsList.end(); it++) {
+        if ((*it)->edidHash != hash)
+            continue;
+        caps = *it;
+        sinkCapsList.splice(sinkCapsList.begin(), sinkCapsList, it);
+        PAL_DBG(LOG_TAG," reusing sink caps of edid 0x%x", hash);
+        return caps;
+    }
+
+    caps = std::make_shared<edidSinkCaps>();
+    info = &caps->info;
+    if (!getSinkCaps(info, edidData))
+        return nullptr;
+
+    caps->edidHash = hash;
+    caps->srMask = getSRMask(info);
+    caps->bpsMask = getBpsMask(info);
+
+    caps->maxChannels = 2;
+    for (int i = 0; i < info->audioBlocks && i < MAX_EDID_BLOCKS; i++) {
+        if (info->audioBlocksArray[i].formatId == LPCM &&
+            caps->maxChannels < info->audioBlocksArray[i].channels)
+            caps->maxChannels = info->audioBlocksArray[i].channels;
+    }
+
+    caps->highestSR = getHighestEdidSF(caps->srMask);
+    if (caps->highestSR == 0) {
+        PAL_ERR(LOG_TAG,"Unable to get Highest SR. Setting default SR");
+        caps->highestSR = SAMPLINGRATE_48K;
     }
-    if (info != NULL && sr != 0) {
-        for (i = 0; i < info->audioBlocks && i < MAX_EDID_BLOCKS; i++) {
-        if (isSampleRateSupported(info->audioBlocksArray[i].samplingFreqBitmask,
-                    sr)) {
-                PAL_DBG(LOG_TAG," Returns true for sample rate [%d]", sr);
-                return true;
-            }
-        }
+    caps->highestBps = isSupportedBps(caps->bpsMask, 24) ? 24 : BITWIDTH_16;
+
+    for (ch = 0; ch <= MAX_CHANNELS_SUPPORTED; ch++) {
+        caps->channelAllocation[ch] = getDeviceChannelAllocation(ch);
+        retrieveChannelMapLpass(caps->channelAllocation[ch], caps->channelMapLpass[ch],
+                                MAX_CHANNELS_SUPPORTED);
+    }
+
+    sinkCapsList.push_front(caps);
+    if (sinkCapsList.size() > MAX_EDID_SINK_CAPS)
+        sinkCapsList.pop_back();
+    PAL_INFO(LOG_TAG," edid 0x%x: max ch %d, highest sr %d, highest bps %d", hash,
+             caps->maxChannels, caps->highestSR, caps->highestBps);
+    return caps;
+}
+
+std::shared_ptr<edidSinkCaps> DisplayPort::getCurrentSinkCaps()
+{
+    if (getDisplayPortCtlIndex(dp_controller, dp_stream) < 0)
+        return nullptr;
+    return extDisp[dp_controller][dp_stream].sinkCaps;
+}
+
+bool DisplayPort::isSupportedSR(edidAudioInfo* info, int sr)
+{
+    std::shared_ptr<edidSinkCaps> caps = getCurrentSinkCaps();
+    unsigned char srMask = caps ? caps->srMask : getSRMask(info);
+
+    if (sr != 0 && isSampleRateSupported(srMask, sr)) {
+        PAL_DBG(LOG_TAG," Returns true for sample rate [%d]", sr);
+        return true;
     }
     PAL_ERR(LOG_TAG," Returns false for sample rate [%d]", sr);
     return false;
@@ -1698,28 +1786,9 @@ bool DisplayPort::isSupportedSR(edidAudioInfo* info, int sr)
 
 int DisplayPort::getMaxChannel()
 {
-    int i = 0;
-    struct extDispState *state = NULL;
-    int max_channel = 2;
-    edidAudioInfo *info = NULL;
-
-    state = &extDisp[dp_controller][dp_stream];
-    if (state && state->edidInfo)
-    {
-        info = (edidAudioInfo*) state->edidInfo;
-    }
+    std::shared_ptr<edidSinkCaps> caps = getCurrentSinkCaps();
 
-    if (info != NULL) {
-        for (i = 0; i < info->audioBlocks && i < MAX_EDID_BLOCKS; i++) {
-            if (info->audioBlocksArray[i].formatId == LPCM) {
-                if (max_channel < info->audioBlocksArray[i].channels) {
-                    max_channel = info->audioBlocksArray[i].channels;
-                    PAL_DBG(LOG_TAG," Max channels updated to [%d]", max_channel);
-                }
-            }
-        }
-    }
-    return max_channel;
+    return caps ? caps->maxChannels : 2;
 }
 
 bool DisplayPort::isSupportedBps(edidAudioInfo* info, int bps)
@@ -1746,69 +1815,20 @@ bool DisplayPort::isSupportedBps(edidAudioInfo* info, int bps)
 
 int DisplayPort::getHighestSupportedSR()
 {
-    int sr = 0;
-    int highestSR = 0;
-    int i;
-    struct extDispState *state = NULL;
-    edidAudioInfo *info = NULL;
-
-    state = &extDisp[dp_controller][dp_stream];
-    if (state && state->edidInfo)
-    {
-        info = (edidAudioInfo*) state->edidInfo;
-    }
+    std::shared_ptr<edidSinkCaps> caps = getCurrentSinkCaps();
 
-    if (info != NULL) {
-        for (i = 0; i < info->audioBlocks && i < MAX_EDID_BLOCKS; i++) {
-          sr = getHighestEdidSF(info->audioBlocksArray[i].samplingFreqBitmask);
-          if (sr > highestSR)
-            highestSR = sr;
-        }
-    }
-    else {
+    if (!caps) {
         PAL_ERR(LOG_TAG," info is NULL");
-        highestSR = SAMPLINGRATE_48K;
+        return SAMPLINGRATE_48K;
     }
 
-    if (highestSR == 0) {
-        PAL_ERR(LOG_TAG,"Unable to get Highest SR. Setting default SR");
-        highestSR = SAMPLINGRATE_48K;
-    }
-
-    PAL_VERBOSE(LOG_TAG," returns [%d] for highest supported sr", highestSR);
-    return highestSR;
+    PAL_VERBOSE(LOG_TAG," returns [%d] for highest supported sr", caps->highestSR);
+    return caps->highestSR;
 }
 
 int DisplayPort::getHighestSupportedBps()
 {
-    int bpsMask = 0;
-    int highestBps = 0;
-    int i;
-    struct extDispState *state = NULL;
-    edidAudioInfo *info = NULL;
-
-    state = &extDisp[dp_controller][dp_stream];
-    if (state && state->edidInfo)
-    {
-        info = (edidAudioInfo*) state->edidInfo;
-    }
+    std::shared_ptr<edidSinkCaps> caps = getCurrentSinkCaps();
 
-    if (info != NULL) {
-        for (i = 0; i < info->audioBlocks && i < MAX_EDID_BLOCKS; i++) {
-            bpsMask = info->audioBlocksArray[i].bitsPerSampleBitmask;
-            if (isSupportedBps(bpsMask, 24)) {
-                highestBps = 24;
-                break;
-            }
-            else if (isSupportedBps(bpsMask, BITWIDTH_16))
-                if (highestBps < BITWIDTH_16)
-                    highestBps = BITWIDTH_16;
-        }
-    }
-
-    if (highestBps == 0) {
-        PAL_ERR(LOG_TAG, "None of the supported BPS is highest");
-        highestBps = 16;
-    }
-    return highestBps;
+    return caps ? caps->highestBps : BITWIDTH_16;
 }
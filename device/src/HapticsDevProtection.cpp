@@ -218,7 +218,7 @@ int HapticsDevProtection::getDevTemperature(int haptics_dev_pos)
 
     PAL_DBG(LOG_TAG, "audio_mixer %pK", hwMixer);
 
-    ctl = mixer_get_ctl_by_name(hwMixer, mixer_ctl_name.c_str());
+    ctl = MixerCtlCache::getCtl(hwMixer, mixer_ctl_name.c_str());
     if (!ctl) {
         PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", mixer_ctl_name.c_str());
         status = -EINVAL;
@@ -255,7 +255,7 @@ void HapticsDevProtection::disconnectFeandBe(std::vector<int> pcmDevIds,
     }
 
     disconnectCtrlNameBe<< backEndName << " metadata";
-    beMetaDataMixerCtrl = mixer_get_ctl_by_name(virtMixer, disconnectCtrlNameBe.str().data());
+    beMetaDataMixerCtrl = MixerCtlCache::getCtl(virtMixer, disconnectCtrlNameBe.str().data());
     if (!beMetaDataMixerCtrl) {
         ret = -EINVAL;
         PAL_ERR(LOG_TAG, "Error: %d, invalid mixer control %s", ret, backEndName.c_str());
@@ -273,7 +273,7 @@ void HapticsDevProtection::disconnectFeandBe(std::vector<int> pcmDevIds,
     }
 
     disconnectCtrlName << "PCM" << pcmDevIds.at(0) << " disconnect";
-    disconnectCtrl = mixer_get_ctl_by_name(virtMixer, disconnectCtrlName.str().data());
+    disconnectCtrl = MixerCtlCache::getCtl(virtMixer, disconnectCtrlName.str().data());
     if (!disconnectCtrl) {
         ret = -EINVAL;
         PAL_ERR(LOG_TAG, "Error: %d, invalid mixer control: %s", ret, disconnectCtrlName.str().data());
@@ -425,7 +425,7 @@ int HapticsDevProtection::HapticsDevStartCalibration()
     }
 
     connectCtrlNameBeVI<< backEndNameTx << " metadata";
-    beMetaDataMixerCtrl = mixer_get_ctl_by_name(virtMixer, connectCtrlNameBeVI.str().data());
+    beMetaDataMixerCtrl = MixerCtlCache::getCtl(virtMixer, connectCtrlNameBeVI.str().data());
     if (!beMetaDataMixerCtrl) {
         PAL_ERR(LOG_TAG, "invalid mixer control for VI : %s", backEndNameTx.c_str());
         ret = -EINVAL;
@@ -461,7 +461,7 @@ int HapticsDevProtection::HapticsDevStartCalibration()
     }
 
     connectCtrlName << "PCM" << pcmDevIdsTx.at(0) << " connect";
-    connectCtrl = mixer_get_ctl_by_name(virtMixer, connectCtrlName.str().data());
+    connectCtrl = MixerCtlCache::getCtl(virtMixer, connectCtrlName.str().data());
     if (!connectCtrl) {
         PAL_ERR(LOG_TAG, "invalid mixer control: %s", connectCtrlName.str().data());
         goto free_fe;
@@ -690,7 +690,7 @@ int HapticsDevProtection::HapticsDevStartCalibration()
 
     connectCtrlNameBe<< backEndNameRx << " metadata";
 
-    beMetaDataMixerCtrl = mixer_get_ctl_by_name(virtMixer, connectCtrlNameBe.str().data());
+    beMetaDataMixerCtrl = MixerCtlCache::getCtl(virtMixer, connectCtrlNameBe.str().data());
     if (!beMetaDataMixerCtrl) {
         PAL_ERR(LOG_TAG, "invalid mixer control: %s", backEndNameRx.c_str());
         ret = -EINVAL;
@@ -727,7 +727,7 @@ int HapticsDevProtection::HapticsDevStartCalibration()
     }
 
     connectCtrlNameRx << "PCM" << pcmDevIdsRx.at(0) << " connect";
-    connectCtrl = mixer_get_ctl_by_name(virtMixer, connectCtrlNameRx.str().data());
+    connectCtrl = MixerCtlCache::getCtl(virtMixer, connectCtrlNameRx.str().data());
     if (!connectCtrl) {
         PAL_ERR(LOG_TAG, "invalid mixer control: %s", connectCtrlNameRx.str().data());
         ret = -ENOSYS;
@@ -1266,7 +1266,7 @@ int32_t HapticsDevProtection::HapticsDevProtProcessingMode(bool flag)
             goto exit;
         }
         connectCtrlNameBeVI<< backEndName << " metadata";
-        beMetaDataMixerCtrl = mixer_get_ctl_by_name(virtMixer,
+        beMetaDataMixerCtrl = MixerCtlCache::getCtl(virtMixer,
                                     connectCtrlNameBeVI.str().data());
         if (!beMetaDataMixerCtrl) {
             PAL_ERR(LOG_TAG, "invalid mixer control for VI : %s", backEndName.c_str());
@@ -1304,7 +1304,7 @@ int32_t HapticsDevProtection::HapticsDevProtProcessingMode(bool flag)
         }
 
         connectCtrlName << "PCM" << pcmDevIdTx.at(0) << " connect";
-        connectCtrl = mixer_get_ctl_by_name(virtMixer, connectCtrlName.str().data());
+        connectCtrl = MixerCtlCache::getCtl(virtMixer, connectCtrlName.str().data());
         if (!connectCtrl) {
             PAL_ERR(LOG_TAG, "invalid mixer control: %s", connectCtrlName.str().data());
             goto free_fe;
@@ -1684,7 +1684,7 @@ int32_t HapticsDevProtection::getAndsetPersistentParameter(bool flag)
         goto exit;
     }
 
-    ctl = mixer_get_ctl_by_name(virtMixer, cntrlName.str().data());
+    ctl = MixerCtlCache::getCtl(virtMixer, cntrlName.str().data());
     if (!ctl) {
         status = -ENOENT;
         PAL_ERR(LOG_TAG, "Error: %d Invalid mixer control: %s\n", status,cntrlName.str().data());
@@ -69,8 +69,12 @@
 #include "ResourceManager.h"
 #include "SessionAlsaUtils.h"
 #include "kvh2xml.h"
+#include "PalXmlSnapshot.h"
+#include "PalTrace.h"
 #include <agm/agm_api.h>
+#include <sys/stat.h>
 
+#include<algorithm>
 #include<fstream>
 #include<sstream>
 
@@ -94,6 +98,17 @@
 #define TZ_TEMP_MIN_THRESHOLD    (-30)
 #define TZ_TEMP_MAX_THRESHOLD    (80)
 
+#define SPKR_CAL_FILE_MAGIC 0x4c414353 /* "SCAL" */
+#define SPKR_CAL_FILE_VERSION 1
+#define SPKR_CAL_MAX_CH 8
+/* older results are still applied but the speaker is calibrated again */
+#ifndef SPKR_CAL_VALID_SEC
+#define SPKR_CAL_VALID_SEC (60 * 60 * 24 * 30)
+#endif
+
+/* one period of the calibration RX path */
+#define SPKR_CAL_PREEMPT_BUDGET_US (DEFAULT_PERIOD_SIZE * 1000000LL / SAMPLINGRATE_48K)
+
 /*Set safe temp value to 40C*/
 #define SAFE_SPKR_TEMP 40
 #define SAFE_SPKR_TEMP_Q6 (SAFE_SPKR_TEMP * (1 << 6))
@@ -117,14 +132,32 @@
 
 #define MAX_RETRY 3
 
+struct spkr_cal_file_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t num_ch;
+    uint32_t payload_crc;
+    int64_t cal_time;           /* CLOCK_REALTIME seconds */
+};
+
+struct spkr_cal_file_record {
+    int32_t r0_cali_q24;
+    int32_t t0_cali_q6;
+};
+
 std::thread SpeakerProtection::mCalThread;
 std::condition_variable SpeakerProtection::cv;
+std::condition_variable SpeakerProtection::schedCv;
 std::mutex SpeakerProtection::cvMutex;
 std::mutex SpeakerProtection::calibrationMutex;
 
+bool SpeakerProtection::threadExit;
 bool SpeakerProtection::isSpkrInUse;
 bool SpeakerProtection::calThrdCreated;
 bool SpeakerProtection::isDynamicCalTriggered = false;
+bool SpeakerProtection::calPreempted = false;
+std::atomic<uint32_t> SpeakerProtection::pendingStarts(0);
+uint32_t SpeakerProtection::maxPreemptUs = 0;
 struct timespec SpeakerProtection::spkrLastTimeUsed;
 struct mixer *SpeakerProtection::virtMixer;
 struct mixer *SpeakerProtection::hwMixer;
@@ -195,6 +228,7 @@ void SpeakerProtection::spkrProtSetSpkrStatus(bool enable)
 {
     PAL_DBG(LOG_TAG, "Enter");
 
+    std::lock_guard<std::mutex> lock(cvMutex);
     if (enable)
         isSpkrInUse = true;
     else {
@@ -202,16 +236,19 @@ void SpeakerProtection::spkrProtSetSpkrStatus(bool enable)
         clock_gettime(CLOCK_BOOTTIME, &spkrLastTimeUsed);
         PAL_INFO(LOG_TAG, "Speaker used last time %ld", spkrLastTimeUsed.tv_sec);
     }
+    // The scheduler waits for the idle time to start over
+    schedCv.notify_all();
 
     PAL_DBG(LOG_TAG, "Exit");
 }
 
-/* Wait function for WAKEUP_MIN_IDLE_CHECK  */
-void SpeakerProtection::spkrCalibrateWait()
+/* Wait function for WAKEUP_MIN_IDLE_CHECK, false if the speaker got used */
+bool SpeakerProtection::spkrCalibrateWait()
 {
     std::unique_lock<std::mutex> lock(cvMutex);
-    cv.wait_for(lock,
-            std::chrono::milliseconds(WAKEUP_MIN_IDLE_CHECK));
+    schedCv.wait_for(lock, std::chrono::milliseconds(WAKEUP_MIN_IDLE_CHECK),
+                     [] { return isSpkrInUse || threadExit; });
+    return !isSpkrInUse && !threadExit;
 }
 
 // Callback from DSP for Ressistance value
@@ -266,7 +303,7 @@ void SpeakerProtection::handleSPCallback (uint64_t hdl __unused, uint32_t event_
     case EVENT_ID_SPv5_SPEAKER_DIAGNOSTICS:
         struct mixer_ctl *ctl;
 
-        ctl = mixer_get_ctl_by_name(hwMixer, SPKR_LEFT_WSA_DC_DET);
+        ctl = MixerCtlCache::getCtl(hwMixer, SPKR_LEFT_WSA_DC_DET);
         diag_data = (param_id_sp_vi_spkr_diag_getpkt_param_t *) event_data;
         if (diag_data->num_ch == 1) {
                 PAL_DBG(LOG_TAG, "Calibration state %d", diag_data->spkr_cond[0]);
@@ -275,7 +312,7 @@ void SpeakerProtection::handleSPCallback (uint64_t hdl __unused, uint32_t event_
                     PAL_ERR(LOG_TAG, "OVERTEMP detected on Spkr Right");
 
                 if (diag_data->spkr_cond[0] == SPKR_DC) {
-                    ctl = mixer_get_ctl_by_name(hwMixer, SPKR_RIGHT_WSA_DC_DET);
+                    ctl = MixerCtlCache::getCtl(hwMixer, SPKR_RIGHT_WSA_DC_DET);
                     if (!ctl) {
                          PAL_ERR(LOG_TAG, "invalid mixer control for DC : %s", SPKR_RIGHT_WSA_DC_DET);
                          return;
@@ -291,7 +328,7 @@ void SpeakerProtection::handleSPCallback (uint64_t hdl __unused, uint32_t event_
                      PAL_ERR(LOG_TAG, "OVERTEMP detected on Spkr Left");
 
                  if (diag_data->spkr_cond[0] == SPKR_DC) {
-                     ctl = mixer_get_ctl_by_name(hwMixer, SPKR_LEFT_WSA_DC_DET);
+                     ctl = MixerCtlCache::getCtl(hwMixer, SPKR_LEFT_WSA_DC_DET);
                      if (!ctl) {
                          PAL_ERR(LOG_TAG, "invalid mixer control for DC : %s", SPKR_LEFT_WSA_DC_DET);
                          goto spkr_right;
@@ -304,7 +341,7 @@ spkr_right:
                      PAL_ERR(LOG_TAG, "OVERTEMP detected on Spkr Right");
 
                  if (diag_data->spkr_cond[1] == SPKR_DC) {
-                     ctl = mixer_get_ctl_by_name(hwMixer, SPKR_RIGHT_WSA_DC_DET);
+                     ctl = MixerCtlCache::getCtl(hwMixer, SPKR_RIGHT_WSA_DC_DET);
                      if (!ctl) {
                          PAL_ERR(LOG_TAG, "invalid mixer control for DC : %s", SPKR_RIGHT_WSA_DC_DET);
                          return;
@@ -329,7 +366,7 @@ int SpeakerProtection::getCpsDevNumber(std::string mixer_name)
     PAL_DBG(LOG_TAG, "Mixer control %s", mixer_name.c_str());
     PAL_DBG(LOG_TAG, "audio_hw_mixer %pK", hwMixer);
 
-    ctl = mixer_get_ctl_by_name(hwMixer, mixer_name.c_str());
+    ctl = MixerCtlCache::getCtl(hwMixer, mixer_name.c_str());
     if (!ctl) {
         PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", mixer_name.c_str());
         status = -ENOENT;
@@ -360,7 +397,7 @@ int SpeakerProtection::getSpeakerTemperature(int spkr_pos)
 
     PAL_DBG(LOG_TAG, "audio_mixer %pK", hwMixer);
 
-    ctl = mixer_get_ctl_by_name(hwMixer, mixer_ctl_name.c_str());
+    ctl = MixerCtlCache::getCtl(hwMixer, mixer_ctl_name.c_str());
     if (!ctl) {
         PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", mixer_ctl_name.c_str());
         status = -EINVAL;
@@ -397,7 +434,7 @@ void SpeakerProtection::disconnectFeandBe(std::vector<int> pcmDevIds,
     }
 
     disconnectCtrlNameBe<< backEndName << " metadata";
-    beMetaDataMixerCtrl = mixer_get_ctl_by_name(virtMixer, disconnectCtrlNameBe.str().data());
+    beMetaDataMixerCtrl = MixerCtlCache::getCtl(virtMixer, disconnectCtrlNameBe.str().data());
     if (!beMetaDataMixerCtrl) {
         ret = -EINVAL;
         PAL_ERR(LOG_TAG, "Error: %d, invalid mixer control %s", ret, backEndName.c_str());
@@ -405,7 +442,7 @@ void SpeakerProtection::disconnectFeandBe(std::vector<int> pcmDevIds,
     }
 
     disconnectCtrlName << "PCM" << pcmDevIds.at(0) << " disconnect";
-    disconnectCtrl = mixer_get_ctl_by_name(virtMixer, disconnectCtrlName.str().data());
+    disconnectCtrl = MixerCtlCache::getCtl(virtMixer, disconnectCtrlName.str().data());
     if (!disconnectCtrl) {
         ret = -EINVAL;
         PAL_ERR(LOG_TAG, "Error: %d, invalid mixer control: %s", ret, disconnectCtrlName.str().data());
@@ -433,7 +470,6 @@ exit:
 
 int SpeakerProtection::spkrStartCalibration()
 {
-    FILE *fp;
     struct pal_device device, deviceRx;
     struct pal_channel_info ch_info;
     struct pal_device_info deviceRxSpkr;
@@ -444,8 +480,7 @@ int SpeakerProtection::spkrStartCalibration()
     struct agm_event_reg_cfg event_cfg;
     struct agmMetaData deviceMetaData(nullptr, 0);
     struct mixer_ctl *beMetaDataMixerCtrl = nullptr;
-    int ret = 0, status = 0, dir = 0, i = 0, flags = 0, payload_size = 0;
-    int retryCount = 0;
+    int ret = 0, status = 0, dir = 0, flags = 0, payload_size = 0;
     uint32_t miid = 0;
     char mSndDeviceName_rx[128] = {0};
     char mSndDeviceName_vi[128] = {0};
@@ -471,6 +506,13 @@ int SpeakerProtection::spkrStartCalibration()
 
     std::unique_lock<std::mutex> calLock(calibrationMutex);
 
+    if (isSpkrInUse || pendingStarts) {
+        PAL_DBG(LOG_TAG, "Speaker in use, calibration deferred");
+        return -EBUSY;
+    }
+    mDspCallbackRcvd = false;
+    calibrationCallbackStatus = 0;
+
     memset(&device, 0, sizeof(device));
     memset(&deviceRx, 0, sizeof(deviceRx));
     memset(&sAttr, 0, sizeof(sAttr));
@@ -568,7 +610,7 @@ int SpeakerProtection::spkrStartCalibration()
     }
 
     connectCtrlNameBeVI<< backEndNameTx << " metadata";
-    beMetaDataMixerCtrl = mixer_get_ctl_by_name(virtMixer, connectCtrlNameBeVI.str().data());
+    beMetaDataMixerCtrl = MixerCtlCache::getCtl(virtMixer, connectCtrlNameBeVI.str().data());
     if (!beMetaDataMixerCtrl) {
         PAL_ERR(LOG_TAG, "invalid mixer control for VI : %s", backEndNameTx.c_str());
         ret = -EINVAL;
@@ -604,7 +646,7 @@ int SpeakerProtection::spkrStartCalibration()
     }
 
     connectCtrlName << "PCM" << pcmDevIdsTx.at(0) << " connect";
-    connectCtrl = mixer_get_ctl_by_name(virtMixer, connectCtrlName.str().data());
+    connectCtrl = MixerCtlCache::getCtl(virtMixer, connectCtrlName.str().data());
     if (!connectCtrl) {
         PAL_ERR(LOG_TAG, "invalid mixer control: %s", connectCtrlName.str().data());
         goto free_fe;
@@ -835,7 +877,7 @@ int SpeakerProtection::spkrStartCalibration()
 
     connectCtrlNameBe<< backEndNameRx << " metadata";
 
-    beMetaDataMixerCtrl = mixer_get_ctl_by_name(virtMixer, connectCtrlNameBe.str().data());
+    beMetaDataMixerCtrl = MixerCtlCache::getCtl(virtMixer, connectCtrlNameBe.str().data());
     if (!beMetaDataMixerCtrl) {
         PAL_ERR(LOG_TAG, "invalid mixer control: %s", backEndNameRx.c_str());
         ret = -EINVAL;
@@ -872,7 +914,7 @@ int SpeakerProtection::spkrStartCalibration()
     }
 
     connectCtrlNameRx << "PCM" << pcmDevIdsRx.at(0) << " connect";
-    connectCtrl = mixer_get_ctl_by_name(virtMixer, connectCtrlNameRx.str().data());
+    connectCtrl = MixerCtlCache::getCtl(virtMixer, connectCtrlNameRx.str().data());
     if (!connectCtrl) {
         PAL_ERR(LOG_TAG, "invalid mixer control: %s", connectCtrlNameRx.str().data());
         ret = -ENOSYS;
@@ -968,8 +1010,8 @@ int SpeakerProtection::spkrStartCalibration()
 
     PAL_DBG(LOG_TAG, "Waiting for the event from DSP or PAL");
 
-    // TODO: Make this to wait in While loop
-    cv.wait(calLock);
+    // A playback start gets the speaker back as soon as it asks for it
+    cv.wait(calLock, [] { return mDspCallbackRcvd || pendingStarts || threadExit; });
 
     // Store the R0T0 values
     if (mDspCallbackRcvd) {
@@ -1012,47 +1054,6 @@ err_pcm_open :
         disableDevice(audioRoute, mSndDeviceName_rx);
         rxPcm = NULL;
     }
-    // Store r0, t0
-    if (calibrationCallbackStatus == CALIBRATION_STATUS_SUCCESS && dspEventReceived) {
-retry:
-        PAL_DBG(LOG_TAG, "Getting temperature of speakers");
-        getSpeakerTemperatureList();
-
-        for (i = 0; i < numberOfChannels; i++) {
-            if ((spkerTempList[i] != -EINVAL) &&
-                (spkerTempList[i] < TZ_TEMP_MIN_THRESHOLD ||
-                 spkerTempList[i] > TZ_TEMP_MAX_THRESHOLD)) {
-                PAL_ERR(LOG_TAG, "Temperature out of range. Retry");
-                spkrCalibrateWait();
-                if (retryCount < MAX_RETRY) {
-                    retryCount++;
-                    goto retry;
-                }
-                else
-                    continue;
-            }
-        }
-        for (i = 0; i < numberOfChannels; i++) {
-            // Converting to Q6 format
-            spkerTempList[i] = (spkerTempList[i]*(1<<6));
-        }
-        PAL_DBG(LOG_TAG, "Calibration is done");
-        fp = fopen(PAL_SP_TEMP_PATH, "wb");
-        if (!fp) {
-            PAL_ERR(LOG_TAG, "Unable to open file for write");
-        } else {
-            PAL_DBG(LOG_TAG, "Write the R0T0 value to file");
-            for (i = 0; i < numberOfChannels; i++) {
-                fwrite(&callback_data->cali_param[i].r0_cali_q24,
-                            sizeof(callback_data->cali_param[i].r0_cali_q24), 1, fp);
-                fwrite(&spkerTempList[i], sizeof(int16_t), 1, fp);
-            }
-            spkrCalState = SPKR_CALIBRATED;
-            free(callback_data);
-            fclose(fp);
-        }
-    }
-
 free_fe:
     if (pcmDevIdsRx.size() != 0) {
         if (isRxFeandBeConnected) {
@@ -1076,8 +1077,13 @@ exit:
         // the lock is unlocked due to processing mode. It will be waiting
         // for the unlock. So notify it.
         PAL_DBG(LOG_TAG, "Unlocked due to processing mode");
+        if (spkrCalState == SPKR_CALIB_IN_PROGRESS && pendingStarts)
+            calPreempted = true;
         spkrCalState = SPKR_NOT_CALIBRATED;
         clock_gettime(CLOCK_BOOTTIME, &spkrLastTimeUsed);
+    } else if (spkrCalState == SPKR_CALIB_IN_PROGRESS) {
+        // Graphs are closed, the result is stored without holding the speaker
+        spkrCalState = SPKR_NOT_CALIBRATED;
     }
     cv.notify_all();
 
@@ -1090,10 +1096,188 @@ exit:
        delete builder;
        builder = NULL;
     }
+    calLock.unlock();
+
+    // Store r0, t0
+    if (calibrationCallbackStatus == CALIBRATION_STATUS_SUCCESS && dspEventReceived)
+        ret = spkrSaveCalibration();
+
     PAL_DBG(LOG_TAG, "Exiting");
     return ret;
 }
 
+/*
+ * Reads the speaker temperatures for the R0 values reported by the DSP and
+ * stores both. The calibration graphs are closed already and the lock is
+ * not held, temperature retries give up as soon as the speaker is used.
+ */
+int SpeakerProtection::spkrSaveCalibration()
+{
+    vi_r0t0_cfg_t r0t0Array[numberOfChannels];
+    int i, ret = 0, retryCount = 0;
+
+    if (!callback_data)
+        return -ENOMEM;
+
+    PAL_DBG(LOG_TAG, "Getting temperature of speakers");
+    while (!isSpeakerTempInRange() && retryCount < MAX_RETRY) {
+        PAL_ERR(LOG_TAG, "Temperature out of range. Retry");
+        retryCount++;
+        if (!spkrCalibrateWait()) {
+            PAL_DBG(LOG_TAG, "Speaker in use, calibration result dropped");
+            ret = -EBUSY;
+            goto exit;
+        }
+    }
+
+    for (i = 0; i < numberOfChannels; i++) {
+        r0t0Array[i].r0_cali_q24 = callback_data->cali_param[i].r0_cali_q24;
+        // Converting to Q6 format
+        r0t0Array[i].t0_cali_q6 = spkerTempList[i] * (1 << 6);
+    }
+    PAL_DBG(LOG_TAG, "Calibration is done");
+    ret = spkrProtSetR0T0Value(r0t0Array);
+    if (!ret) {
+        std::lock_guard<std::mutex> calLock(calibrationMutex);
+        spkrCalState = SPKR_CALIBRATED;
+    }
+
+exit:
+    free(callback_data);
+    callback_data = NULL;
+    return ret;
+}
+
+/* Reads the speaker temperatures, false if one is out of the calibration range */
+bool SpeakerProtection::isSpeakerTempInRange()
+{
+    getSpeakerTemperatureList();
+
+    for (int i = 0; i < numberOfChannels; i++) {
+        if ((spkerTempList[i] != -EINVAL) &&
+            (spkerTempList[i] < TZ_TEMP_MIN_THRESHOLD ||
+             spkerTempList[i] > TZ_TEMP_MAX_THRESHOLD)) {
+            PAL_DBG(LOG_TAG, "Temperature %d of speaker %d out of range",
+                    spkerTempList[i], i + 1);
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Persists the calibration of numberOfChannels speakers */
+int32_t SpeakerProtection::spkrProtSetR0T0Value(vi_r0t0_cfg_t r0t0Array[])
+{
+    struct spkr_cal_file_header hdr;
+    std::vector<struct spkr_cal_file_record> rec(numberOfChannels);
+    std::string tmpFile = std::string(PAL_SP_TEMP_PATH) + ".tmp";
+    struct timespec now;
+    FILE *fp = NULL;
+    int32_t ret = 0;
+
+    for (int i = 0; i < numberOfChannels; i++) {
+        rec[i].r0_cali_q24 = r0t0Array[i].r0_cali_q24;
+        rec[i].t0_cali_q6 = r0t0Array[i].t0_cali_q6;
+    }
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = SPKR_CAL_FILE_MAGIC;
+    hdr.version = SPKR_CAL_FILE_VERSION;
+    hdr.num_ch = numberOfChannels;
+    hdr.cal_time = now.tv_sec;
+    hdr.payload_crc = PalXmlSnapshot::crc32((uint8_t *)rec.data(),
+                                            rec.size() * sizeof(rec[0]));
+
+    fp = fopen(tmpFile.c_str(), "wb");
+    if (!fp) {
+        ret = -errno;
+        PAL_ERR(LOG_TAG, "Unable to open file for write, ret %d", ret);
+        return ret;
+    }
+    PAL_DBG(LOG_TAG, "Write the R0T0 value to file");
+    if (fwrite(&hdr, sizeof(hdr), 1, fp) != 1 ||
+        fwrite(rec.data(), sizeof(rec[0]), rec.size(), fp) != rec.size()) {
+        ret = -EIO;
+        PAL_ERR(LOG_TAG, "failed to write %s", tmpFile.c_str());
+    }
+    if (fclose(fp) && !ret)
+        ret = -EIO;
+
+    // rename so a crash while writing never leaves a truncated cal file
+    if (!ret && rename(tmpFile.c_str(), PAL_SP_TEMP_PATH))
+        ret = -errno;
+    if (ret)
+        unlink(tmpFile.c_str());
+    return ret;
+}
+
+/*
+ * Reads the stored calibration of numCh speakers. Files written before the
+ * header was added hold bare r0/t0 pairs and are dated by their mtime.
+ * expired is set once the result is older than SPKR_CAL_VALID_SEC, it still
+ * protects the speaker better than the safe values until it is replaced.
+ */
+bool SpeakerProtection::spkrProtGetR0T0Value(vi_r0t0_cfg_t r0t0Array[], int numCh,
+                                             bool *expired)
+{
+    struct spkr_cal_file_header hdr;
+    std::vector<struct spkr_cal_file_record> rec;
+    struct timespec now;
+    struct stat st;
+    int64_t calTime = 0;
+    int32_t r0 = 0;
+    int16_t t0 = 0;
+    bool ret = false;
+    FILE *fp = fopen(PAL_SP_TEMP_PATH, "rb");
+
+    if (!fp)
+        return false;
+
+    if (numCh <= 0 || numCh > SPKR_CAL_MAX_CH || fstat(fileno(fp), &st))
+        goto exit;
+
+    if (fread(&hdr, sizeof(hdr), 1, fp) == 1 && hdr.magic == SPKR_CAL_FILE_MAGIC) {
+        if (hdr.version != SPKR_CAL_FILE_VERSION || hdr.num_ch < (uint32_t)numCh ||
+            hdr.num_ch > SPKR_CAL_MAX_CH) {
+            PAL_ERR(LOG_TAG, "invalid cal file header, %u channels", hdr.num_ch);
+            goto exit;
+        }
+        rec.resize(hdr.num_ch);
+        if (fread(rec.data(), sizeof(rec[0]), rec.size(), fp) != rec.size() ||
+            PalXmlSnapshot::crc32((uint8_t *)rec.data(), rec.size() * sizeof(rec[0])) !=
+            hdr.payload_crc) {
+            PAL_ERR(LOG_TAG, "corrupted cal file");
+            goto exit;
+        }
+        for (int i = 0; i < numCh; i++) {
+            r0t0Array[i].r0_cali_q24 = rec[i].r0_cali_q24;
+            r0t0Array[i].t0_cali_q6 = rec[i].t0_cali_q6;
+        }
+        calTime = hdr.cal_time;
+    } else {
+        rewind(fp);
+        for (int i = 0; i < numCh; i++) {
+            if (fread(&r0, sizeof(r0), 1, fp) != 1 || fread(&t0, sizeof(t0), 1, fp) != 1) {
+                PAL_ERR(LOG_TAG, "cal file too short for %d speakers", numCh);
+                goto exit;
+            }
+            r0t0Array[i].r0_cali_q24 = r0;
+            r0t0Array[i].t0_cali_q6 = t0;
+        }
+        calTime = st.st_mtime;
+    }
+    ret = true;
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    if (expired)
+        *expired = now.tv_sec - calTime > SPKR_CAL_VALID_SEC;
+
+exit:
+    fclose(fp);
+    return ret;
+}
+
 /**
   * This function sets the temperature of each speakers.
   * Currently values are supported like:
@@ -1114,80 +1298,79 @@ void SpeakerProtection::getSpeakerTemperatureList()
     PAL_DBG(LOG_TAG, "Exit Speaker Get Temperature List");
 }
 
+/*
+ * Calibration scheduler. It sleeps until the speaker was idle for
+ * minIdleTime and is woken up early by speaker status changes, dynamic
+ * calibration requests and exit. Calibration starts only when the speaker
+ * temperatures are in range, they are checked again every
+ * WAKEUP_MIN_IDLE_CHECK otherwise.
+ */
 void SpeakerProtection::spkrCalibrationThread()
 {
     unsigned long sec = 0;
-    bool proceed = false;
-    int i;
+    std::unique_lock<std::mutex> lock(cvMutex);
 
     while (!threadExit) {
-        PAL_DBG(LOG_TAG, "Inside calibration while loop");
-        proceed = false;
         if (isSpeakerInUse(&sec)) {
-            PAL_DBG(LOG_TAG, "Speaker in use. Wait for proper time");
-            spkrCalibrateWait();
-            PAL_DBG(LOG_TAG, "Waiting done");
+            PAL_DBG(LOG_TAG, "Speaker in use. Wait for it to be released");
+            schedCv.wait(lock);
             continue;
         }
-        else {
-            PAL_DBG(LOG_TAG, "Speaker not in use");
-            if (isDynamicCalTriggered) {
-                PAL_DBG(LOG_TAG, "Dynamic Calibration triggered");
-            }
-            else if (sec < minIdleTime) {
-                PAL_DBG(LOG_TAG, "Speaker not idle for minimum time. %lu", sec);
-                spkrCalibrateWait();
-                PAL_DBG(LOG_TAG, "Waited for speaker to be idle for min time");
-                continue;
-            }
-            proceed = true;
-        }
-        // Check whether speaker was in use in the meantime when temperature
-        // was being read.
-        proceed = false;
-        if (isSpeakerInUse(&sec)) {
-            PAL_DBG(LOG_TAG, "Speaker in use. Wait for proper time");
-            spkrCalibrateWait();
-            PAL_DBG(LOG_TAG, "Waiting done");
+        if (isDynamicCalTriggered) {
+            PAL_DBG(LOG_TAG, "Dynamic Calibration triggered");
+        } else if (sec < (unsigned long)minIdleTime) {
+            PAL_DBG(LOG_TAG, "Speaker not idle for minimum time. %lu", sec);
+            schedCv.wait_for(lock, std::chrono::seconds(minIdleTime - sec));
             continue;
         }
-        else {
-            PAL_DBG(LOG_TAG, "Speaker not in use");
-            if (isDynamicCalTriggered) {
-                PAL_DBG(LOG_TAG, "Dynamic calibration triggered");
-            }
-            else if (sec < minIdleTime) {
-                PAL_DBG(LOG_TAG, "Speaker not idle for minimum time. %lu", sec);
-                spkrCalibrateWait();
-                PAL_DBG(LOG_TAG, "Waited for speaker to be idle for min time");
-                continue;
-            }
-            proceed = true;
-        }
+        lock.unlock();
 
-        if (proceed) {
-            // Start calibrating the speakers.
-            PAL_DBG(LOG_TAG, "Speaker not in use, start calibration");
-            spkrStartCalibration();
-            if (spkrCalState == SPKR_CALIBRATED) {
-                threadExit = true;
-            }
-        }
-        else {
+        if (!isSpeakerTempInRange()) {
+            PAL_DBG(LOG_TAG, "Speaker temperature out of range, check again later");
+            lock.lock();
+            schedCv.wait_for(lock, std::chrono::milliseconds(WAKEUP_MIN_IDLE_CHECK));
             continue;
         }
+
+        // Start calibrating the speakers.
+        PAL_DBG(LOG_TAG, "Speaker not in use, start calibration");
+        spkrStartCalibration();
+        lock.lock();
+        if (spkrCalState == SPKR_CALIBRATED)
+            break;
     }
     isDynamicCalTriggered = false;
     calThrdCreated = false;
     PAL_DBG(LOG_TAG, "Calibration done, exiting the thread");
 }
 
+/* Starts the calibration scheduler, or wakes it up when it is running */
+void SpeakerProtection::spkrCalSchedule(bool dynamic)
+{
+    std::lock_guard<std::mutex> lock(cvMutex);
+
+    if (dynamic)
+        isDynamicCalTriggered = true;
+    if (calThrdCreated) {
+        PAL_DBG(LOG_TAG, "Calibration already scheduled, dynamic %d", dynamic);
+        schedCv.notify_all();
+        return;
+    }
+    // A previous scheduler has returned already, join does not block
+    if (mCalThread.joinable())
+        mCalThread.join();
+    threadExit = false;
+    calThrdCreated = true;
+    mCalThread = std::thread(&SpeakerProtection::spkrCalibrationThread, this);
+}
+
 SpeakerProtection::SpeakerProtection(struct pal_device *device,
                         std::shared_ptr<ResourceManager> Rm):Device(device, Rm)
 {
     int status = 0;
     struct pal_device_info devinfo = {};
-    FILE *fp = NULL;
+    std::vector<vi_r0t0_cfg_t> r0t0Array;
+    bool expired = false;
 
     spkerTempList = NULL;
 
@@ -1202,9 +1385,6 @@ SpeakerProtection::SpeakerProtection(struct pal_device *device,
     memset(&mDeviceAttr, 0, sizeof(struct pal_device));
     memcpy(&mDeviceAttr, device, sizeof(struct pal_device));
 
-    threadExit = false;
-    calThrdCreated = false;
-
     triggerCal = false;
     spkrCalState = SPKR_NOT_CALIBRATED;
     spkrProcessingState = SPKR_PROCESSING_IN_IDLE;
@@ -1246,16 +1426,14 @@ SpeakerProtection::SpeakerProtection(struct pal_device *device,
         goto exit;
     }
 
-    fp = fopen(PAL_SP_TEMP_PATH, "rb");
-    if (fp) {
+    r0t0Array.resize(numberOfChannels);
+    if (spkrProtGetR0T0Value(r0t0Array.data(), numberOfChannels, &expired) && !expired) {
         PAL_DBG(LOG_TAG, "Cal File exists. Reading from it");
         spkrCalState = SPKR_CALIBRATED;
     }
     else {
-        PAL_DBG(LOG_TAG, "Calibration Not done");
-        mCalThread = std::thread(&SpeakerProtection::spkrCalibrationThread,
-                            this);
-        calThrdCreated = true;
+        PAL_DBG(LOG_TAG, "Calibration Not done or expired");
+        spkrCalSchedule(false);
     }
 exit:
     PAL_DBG(LOG_TAG, "exit. calThrdCreated :%d", calThrdCreated);
@@ -1263,6 +1441,18 @@ exit:
 
 SpeakerProtection::~SpeakerProtection()
 {
+    {
+        std::lock_guard<std::mutex> lock(cvMutex);
+        threadExit = true;
+        schedCv.notify_all();
+    }
+    {
+        std::lock_guard<std::mutex> calLock(calibrationMutex);
+        cv.notify_all();
+    }
+    if (mCalThread.joinable())
+        mCalThread.join();
+
     if (spkerTempList)
         delete[] spkerTempList;
 
@@ -1429,7 +1619,6 @@ int32_t SpeakerProtection::spkrProtProcessingMode(bool flag)
     struct vi_r0t0_cfg_t r0t0Array[numberOfChannels];
     struct agmMetaData deviceMetaData(nullptr, 0);
     struct mixer_ctl *beMetaDataMixerCtrl = nullptr;
-    FILE *fp;
     std::string backEndName, backEndNameRx, backEndNameCPS;
     std::vector <std::pair<int, int>> keyVector;
     std::vector <std::pair<int, int>> calVector;
@@ -1450,11 +1639,17 @@ int32_t SpeakerProtection::spkrProtProcessingMode(bool flag)
     Session *session = NULL;
     std::vector<Stream*> activeStreams;
     PayloadBuilder* builder = new PayloadBuilder();
-    std::unique_lock<std::mutex> lock(calibrationMutex);
+    std::unique_lock<std::mutex> lock(calibrationMutex, std::defer_lock);
+    std::chrono::steady_clock::time_point preemptBegin = std::chrono::steady_clock::now();
+    uint32_t preemptUs = 0;
     struct agm_event_reg_cfg event_cfg;
     session_callback sessionCb;
 
     PAL_DBG(LOG_TAG, "Flag %d", flag);
+    // Counted before taking the lock so a calibration being set up backs off
+    if (flag)
+        pendingStarts++;
+    lock.lock();
     deviceMutex.lock();
 
     sessionCb = handleSPCallback;
@@ -1464,13 +1659,27 @@ int32_t SpeakerProtection::spkrProtProcessingMode(bool flag)
             // Close the Graphs
             cv.notify_all();
             // Wait for cleanup
-            cv.wait(lock);
+            cv.wait(lock, [] { return spkrCalState != SPKR_CALIB_IN_PROGRESS; });
             spkrCalState = SPKR_NOT_CALIBRATED;
             txPcm = NULL;
             rxPcm = NULL;
             cpsPcm = NULL;
             PAL_DBG(LOG_TAG, "Stopped calibration mode");
         }
+        pendingStarts--;
+        if (calPreempted) {
+            calPreempted = false;
+            preemptUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - preemptBegin).count();
+            maxPreemptUs = std::max(maxPreemptUs, preemptUs);
+            PalTrace::instant("spkrCalPreempt", preemptUs);
+            if (preemptUs > SPKR_CAL_PREEMPT_BUDGET_US)
+                PAL_ERR(LOG_TAG, "calibration preempted in %u us, over one period (%lld us)",
+                        preemptUs, SPKR_CAL_PREEMPT_BUDGET_US);
+            else
+                PAL_INFO(LOG_TAG, "calibration preempted in %u us, max %u us",
+                         preemptUs, maxPreemptUs);
+        }
         numberOfRequest++;
         if (numberOfRequest > 1) {
             // R0T0 already set, we don't need to process the request
@@ -1599,7 +1808,7 @@ int32_t SpeakerProtection::spkrProtProcessingMode(bool flag)
             goto exit;
         }
         connectCtrlNameBeVI<< backEndName << " metadata";
-        beMetaDataMixerCtrl = mixer_get_ctl_by_name(virtMixer,
+        beMetaDataMixerCtrl = MixerCtlCache::getCtl(virtMixer,
                                     connectCtrlNameBeVI.str().data());
         if (!beMetaDataMixerCtrl) {
             PAL_ERR(LOG_TAG, "invalid mixer control for VI : %s", backEndName.c_str());
@@ -1637,7 +1846,7 @@ int32_t SpeakerProtection::spkrProtProcessingMode(bool flag)
         }
 
         connectCtrlName << "PCM" << pcmDevIdTx.at(0) << " connect";
-        connectCtrl = mixer_get_ctl_by_name(virtMixer, connectCtrlName.str().data());
+        connectCtrl = MixerCtlCache::getCtl(virtMixer, connectCtrlName.str().data());
         if (!connectCtrl) {
             PAL_ERR(LOG_TAG, "invalid mixer control: %s", connectCtrlName.str().data());
             goto free_fe;
@@ -1807,17 +2016,7 @@ int32_t SpeakerProtection::spkrProtProcessingMode(bool flag)
 
         // Setting the R0T0 values
         PAL_DBG(LOG_TAG, "Read R0T0 from file");
-        fp = fopen(PAL_SP_TEMP_PATH, "rb");
-        if (fp) {
-            for (int i = 0; i < vi_device.channels; i++) {
-                fread(&r0t0Array[i].r0_cali_q24,
-                      sizeof(r0t0Array[i].r0_cali_q24), 1, fp);
-                fread(&r0t0Array[i].t0_cali_q6,
-                      sizeof(r0t0Array[i].t0_cali_q6), 1, fp);
-            }
-            fclose(fp);
-        }
-        else {
+        if (!spkrProtGetR0T0Value(r0t0Array, vi_device.channels, NULL)) {
             PAL_DBG(LOG_TAG, "Speaker not calibrated. Send safe value");
             for (int i = 0; i < vi_device.channels; i++) {
                 r0t0Array[i].r0_cali_q24 = MIN_RESISTANCE_SPKR_Q24;
@@ -2055,7 +2254,7 @@ cps_dev_setup:
             goto err_pcm_open;
         }
         connectCtrlNameBeCPS<< backEndNameCPS << " metadata";
-        beMetaDataMixerCtrl = mixer_get_ctl_by_name(virtMixer,
+        beMetaDataMixerCtrl = MixerCtlCache::getCtl(virtMixer,
                                     connectCtrlNameBeCPS.str().data());
         if (!beMetaDataMixerCtrl) {
             PAL_ERR(LOG_TAG, "invalid mixer control for CPS : %s", backEndNameCPS.c_str());
@@ -2093,7 +2292,7 @@ cps_dev_setup:
         }
 
         connectCtrlNameCPS << "PCM" << pcmDevIdCPS.at(0) << " connect";
-        connectCtrl2 = mixer_get_ctl_by_name(virtMixer, connectCtrlNameCPS.str().data());
+        connectCtrl2 = MixerCtlCache::getCtl(virtMixer, connectCtrlNameCPS.str().data());
 
         if (!connectCtrl2) {
             PAL_ERR(LOG_TAG, "invalid mixer control: %s", connectCtrlNameCPS.str().data());
@@ -2357,24 +2556,12 @@ int SpeakerProtection::speakerProtectionDynamicCal()
 
     PAL_DBG(LOG_TAG, "Enter");
 
-    if (calThrdCreated) {
-        PAL_DBG(LOG_TAG, "Calibration already triggered Thread State %d",
-                        calThrdCreated);
-        return ret;
+    {
+        std::lock_guard<std::mutex> calLock(calibrationMutex);
+        if (spkrCalState != SPKR_CALIB_IN_PROGRESS)
+            spkrCalState = SPKR_NOT_CALIBRATED;
     }
-
-    threadExit = false;
-    spkrCalState = SPKR_NOT_CALIBRATED;
-
-    calibrationCallbackStatus = 0;
-    mDspCallbackRcvd = false;
-
-    calThrdCreated = true;
-    isDynamicCalTriggered = true;
-
-    std::thread dynamicCalThread(&SpeakerProtection::spkrCalibrationThread, this);
-
-    dynamicCalThread.detach();
+    spkrCalSchedule(true);
 
     PAL_DBG(LOG_TAG, "Exit");
 
@@ -2455,7 +2642,7 @@ int32_t SpeakerProtection::getFTMParameter(void **param)
         goto exit;
     }
 
-    ctl = mixer_get_ctl_by_name(virtMixer, cntrlName.str().data());
+    ctl = MixerCtlCache::getCtl(virtMixer, cntrlName.str().data());
     if (!ctl) {
         status = -ENOENT;
         PAL_ERR(LOG_TAG, "Error: %d Invalid mixer control: %s\n", status,cntrlName.str().data());
@@ -2623,19 +2810,13 @@ int32_t SpeakerProtection::getCalibrationData(void **param)
     memset(dr0, 0, sizeof(double) * numberOfChannels);
     memset(dt0, 0, sizeof(double) * numberOfChannels);
 
-    FILE *fp = fopen(PAL_SP_TEMP_PATH, "rb");
-    if (fp) {
+    if (spkrProtGetR0T0Value(r0t0Array, numberOfChannels, NULL)) {
         for (i = 0; i < numberOfChannels; i++) {
-            fread(&r0t0Array[i].r0_cali_q24,
-                    sizeof(r0t0Array[i].r0_cali_q24), 1, fp);
-            fread(&r0t0Array[i].t0_cali_q6,
-                    sizeof(r0t0Array[i].t0_cali_q6), 1, fp);
             // Convert to readable format
             dr0[i] = ((double)r0t0Array[i].r0_cali_q24)/(1 << 24);
             dt0[i] = ((double)r0t0Array[i].t0_cali_q6)/(1 << 6);
         }
         PAL_DBG(LOG_TAG, "R0= %lf, %lf, T0= %lf, %lf", dr0[0], dr0[1], dt0[0], dt0[1]);
-        fclose(fp);
     }
     else {
         status = -EINVAL;
@@ -2689,7 +2870,6 @@ void SpeakerFeedback::updateVIcustomPayload()
     std::vector<Stream*> activeStreams;
     uint32_t miid = 0, ret = 0;
     struct vi_r0t0_cfg_t r0t0Array[numSpeaker];
-    FILE *fp = NULL;
     param_id_sp_th_vi_r0t0_cfg_t *spR0T0confg;
     param_id_sp_vi_op_mode_cfg_t modeConfg;
     param_id_sp_vi_channel_map_cfg_t viChannelMapConfg;
@@ -2748,15 +2928,8 @@ void SpeakerFeedback::updateVIcustomPayload()
         }
     }
 
-    fp = fopen(PAL_SP_TEMP_PATH, "rb");
-    if (fp) {
+    if (SpeakerProtection::spkrProtGetR0T0Value(r0t0Array, numSpeaker, NULL)) {
         PAL_DBG(LOG_TAG, "Speaker calibrated. Send calibrated value");
-        for (int i = 0; i < numSpeaker; i++) {
-            fread(&r0t0Array[i].r0_cali_q24,
-                    sizeof(r0t0Array[i].r0_cali_q24), 1, fp);
-            fread(&r0t0Array[i].t0_cali_q6,
-                    sizeof(r0t0Array[i].t0_cali_q6), 1, fp);
-        }
     }
     else {
         PAL_DBG(LOG_TAG, "Speaker not calibrated. Send safe value");
@@ -66,6 +66,7 @@
 
 #include <cstdio>
 #include <cmath>
+#include <algorithm>
 #include "USBAudio.h"
 #include "ResourceManager.h"
 #include "PayloadBuilder.h"
@@ -250,6 +251,7 @@ int USB::init(pal_param_device_connection_t device_conn)
 {
     typename std::vector<std::shared_ptr<USBCardConfig>>::iterator iter;
     int ret = 0;
+    std::string usbid;
 
     for (iter = usb_card_config_list_.begin();
          iter != usb_card_config_list_.end(); iter++) {
@@ -264,15 +266,16 @@ int USB::init(pal_param_device_connection_t device_conn)
             PAL_ERR(LOG_TAG, "failed to create new usb_card_config object.");
             return -EINVAL;
         }
+        usbid = readUsbId(device_conn.device_config.usb_addr.card_id);
         if (isUSBOutDevice(device_conn.id))
-            ret = sp->getCapability(USB_PLAYBACK, device_conn.device_config.usb_addr);
+            ret = sp->getCapability(USB_PLAYBACK, device_conn.device_config.usb_addr, usbid);
         else
-            ret = sp->getCapability(USB_CAPTURE, device_conn.device_config.usb_addr);
+            ret = sp->getCapability(USB_CAPTURE, device_conn.device_config.usb_addr, usbid);
 
         if (ret == 0)
             usb_card_config_list_.push_back(sp);
 
-        setVendorIdCkv(device_conn.device_config.usb_addr);
+        setVendorIdCkv(usbid);
     } else {
         PAL_INFO(LOG_TAG, "usb info has been cached.");
     }
@@ -325,19 +328,25 @@ bool USB::isUSBOutDevice(pal_device_id_t pal_dev_id) {
 
 int USB::usb_vendor_id_ckv_ = 0;
 
-void USB::setVendorIdCkv(struct pal_usb_device_address addr) {
-    std::vector<std::string>::iterator it;
-    std::shared_ptr<ResourceManager> rm = ResourceManager::getInstance();
-    std::string vendor_id_usb;
-    usb_vendor_id_ckv_ = 0;    //reset value to 0 to load default
-    std::ifstream in("/proc/asound/card"+std::to_string(addr.card_id)+"/usbid");
+std::string USB::readUsbId(int card)
+{
+    std::string usbid;
+    std::ifstream in("/proc/asound/card"+std::to_string(card)+"/usbid");
 
     if(in.good()) {
-        if (getline(in, vendor_id_usb)) {
-            PAL_DBG(LOG_TAG, "USB_Vendor_ID of connected usb device is %s", vendor_id_usb.c_str());
+        if (getline(in, usbid)) {
+            PAL_DBG(LOG_TAG, "USB_Vendor_ID of connected usb device is %s", usbid.c_str());
         }
     }
 
+    return usbid;
+}
+
+void USB::setVendorIdCkv(const std::string &vendor_id_usb) {
+    std::vector<std::string>::iterator it;
+    std::shared_ptr<ResourceManager> rm = ResourceManager::getInstance();
+    usb_vendor_id_ckv_ = 0;    //reset value to 0 to load default
+
     if (vendor_id_usb.empty())
         goto done;
 
@@ -412,15 +421,25 @@ int USB::selectBestConfig(struct pal_device *dattr,
                           bool is_playback, struct pal_device_info *devinfo)
 {
     typename std::vector<std::shared_ptr<USBCardConfig>>::iterator iter;
-
+    struct pal_media_config config;
     int status = 0;
 
     for (iter = usb_card_config_list_.begin();
             iter != usb_card_config_list_.end(); iter++) {
         if ((*iter)->isConfigCached(dattr->address)) {
             PAL_ERR(LOG_TAG, "usb device is found.");
+            config = dattr->config;
             status = (*iter)->readBestConfig(&dattr->config, sattr, is_playback,
                                    devinfo, rm->isUHQAEnabled);
+            if (status == -ENOENT && !(*iter)->refreshCapability(
+                    is_playback ? USB_PLAYBACK : USB_CAPTURE)) {
+                dattr->config = config;
+                status = (*iter)->readBestConfig(&dattr->config, sattr, is_playback,
+                                       devinfo, rm->isUHQAEnabled);
+            }
+            /* no candidate keeps the requested config, as it always did */
+            if (status == -ENOENT)
+                status = 0;
             break;
         }
     }
@@ -470,8 +489,41 @@ void USBCardConfig::usb_info_dump(char* read_buf, int type) {
     }
 }
 
+void USBCardConfig::addDeviceConfig(std::shared_ptr<USBDeviceConfig> usb_device_info)
+{
+    usb_device_config_list_.push_back(usb_device_info);
+    format_list_map.insert(std::pair<int, std::shared_ptr<USBDeviceConfig>>(
+                           usb_device_info->getBitWidth(), usb_device_info));
+}
+
+int USBCardConfig::loadCapability(usb_usecase_type_t type,
+                                  const std::vector<struct usb_cap_altset> &altsets,
+                                  bool jack_status)
+{
+    for (auto &alt : altsets) {
+        std::shared_ptr<USBDeviceConfig> usb_device_info(new USBDeviceConfig());
+        if (!usb_device_info) {
+            PAL_ERR(LOG_TAG, "error unable to create usb device config object");
+            return -ENOMEM;
+        }
+        usb_device_info->setType(type);
+        usb_device_info->setBitWidth(alt.bit_width);
+        setEndian(alt.endian);
+        usb_device_info->setChannels(alt.channels);
+        usb_device_info->setSampleRates(type, alt.rates, alt.num_rates);
+        usb_device_info->setInterval(alt.interval_us);
+        usb_device_info->setJackStatus(jack_status);
+        addDeviceConfig(usb_device_info);
+    }
+    PAL_INFO(LOG_TAG, "%zu %s altsets loaded from cache", altsets.size(),
+             (type == USB_PLAYBACK) ? PLAYBACK_PROFILE_STR : CAPTURE_PROFILE_STR);
+
+    return 0;
+}
+
 int USBCardConfig::getCapability(usb_usecase_type_t type,
-                                        struct pal_usb_device_address addr) {
+                                 struct pal_usb_device_address addr,
+                                 const std::string &usbid) {
     int32_t size = 0;
     FILE *fd = NULL;
     int32_t channels_no;
@@ -490,6 +542,10 @@ int USBCardConfig::getCapability(usb_usecase_type_t type,
     size_t num_read = 0;
     const char* suffix;
     bool jack_status;
+    std::vector<struct usb_cap_altset> altsets;
+    struct usb_cap_altset alt;
+    struct usb_cap_fingerprint fp = {0, 0};
+    bool cacheable = !usbid.empty();
     //std::shared_ptr<USBDeviceConfig> usb_device_info = nullptr;
 
     bool check = false;
@@ -498,6 +554,11 @@ int USBCardConfig::getCapability(usb_usecase_type_t type,
     PAL_INFO(LOG_TAG, "for %s", (type == USB_PLAYBACK) ?
           PLAYBACK_PROFILE_STR : CAPTURE_PROFILE_STR);
 
+    usbid_ = usbid;
+    fromCache_[type] = false;
+    /* jack status is per card and direction, not per altset */
+    suffix = (type == USB_PLAYBACK) ? USB_OUT_JACK_SUFFIX : USB_IN_JACK_SUFFIX;
+
     ret = snprintf(path, sizeof(path), "/proc/asound/card%u/stream0",
              addr.card_id);
     if(ret < 0) {
@@ -526,6 +587,18 @@ int USBCardConfig::getCapability(usb_usecase_type_t type,
     }
     read_buf[num_read] = '\0';
 
+    /* the cache only saves the parsing, stream0 is read to check it still applies */
+    if (cacheable) {
+        fp = UsbCapabilityCache::fingerprint(read_buf, num_read);
+        if (!UsbCapabilityCache::lookup(usbid, type, fp, &altsets)) {
+            jack_status = getJackConnectionStatus(addr.card_id, suffix);
+            PAL_DBG(LOG_TAG, "jack_status %d", jack_status);
+            ret = loadCapability(type, altsets, jack_status);
+            fromCache_[type] = (ret == 0);
+            goto done;
+        }
+    }
+
     str_start = strstr(read_buf, ((type == USB_PLAYBACK) ?
                        PLAYBACK_PROFILE_STR : CAPTURE_PROFILE_STR));
     if (str_start == NULL) {
@@ -542,6 +615,9 @@ int USBCardConfig::getCapability(usb_usecase_type_t type,
     if (str_end > str_start)
         check = true;
 
+    jack_status = getJackConnectionStatus(addr.card_id, suffix);
+    PAL_DBG(LOG_TAG, "jack_status %d", jack_status);
+
     while (str_start != NULL) {
         str_start = strstr(str_start, "Altset ");
         if ((str_start == NULL) || (check  && (str_start >= str_end))) {
@@ -639,19 +715,31 @@ int USBCardConfig::getCapability(usb_usecase_type_t type,
                 PAL_INFO(LOG_TAG, "error unable to get service interval, assume default");
             }
         }
-        /* jack status parsing */
-        suffix = (type == USB_PLAYBACK) ? USB_OUT_JACK_SUFFIX : USB_IN_JACK_SUFFIX;
-        jack_status = getJackConnectionStatus(addr.card_id, suffix);
-        PAL_DBG(LOG_TAG, "jack_status %d", jack_status);
         usb_device_info->setJackStatus(jack_status);
 
         /* Add to list if every field is valid */
-        usb_device_config_list_.push_back(usb_device_info);
-        format_list_map.insert( std::pair<int, std::shared_ptr<USBDeviceConfig>>(usb_device_info->getBitWidth(),usb_device_info));
+        addDeviceConfig(usb_device_info);
+
+        const std::vector<unsigned int> &rates = usb_device_info->getRates();
+        if (rates.size() > USB_CAP_MAX_RATES) {
+            cacheable = false;
+            continue;
+        }
+        memset(&alt, 0, sizeof(alt));
+        alt.bit_width = usb_device_info->getBitWidth();
+        alt.channels = usb_device_info->getChannels();
+        alt.interval_us = usb_device_info->getInterval();
+        alt.endian = endian_;
+        alt.num_rates = rates.size();
+        std::copy(rates.begin(), rates.end(), alt.rates);
+        altsets.push_back(alt);
     }
 
      usb_info_dump(read_buf, type);
 
+    if (ret == 0 && cacheable && !altsets.empty())
+        UsbCapabilityCache::store(usbid, type, fp, altsets);
+
 done:
     if (fd)
         fclose(fd);
@@ -662,6 +750,35 @@ done:
     return ret;
 }
 
+/*
+ * Drop the cached capabilities of one direction and parse stream0 again,
+ * for when the cached altsets give no usable config. Fails if they were
+ * parsed from stream0 already.
+ */
+int USBCardConfig::refreshCapability(usb_usecase_type_t type)
+{
+    if (!fromCache_[type])
+        return -EINVAL;
+
+    PAL_INFO(LOG_TAG, "no config from cached %s capabilities, parse again",
+             (type == USB_PLAYBACK) ? PLAYBACK_PROFILE_STR : CAPTURE_PROFILE_STR);
+    UsbCapabilityCache::invalidate(usbid_, type);
+    usb_device_config_list_.erase(std::remove_if(usb_device_config_list_.begin(),
+        usb_device_config_list_.end(),
+        [type](const std::shared_ptr<USBDeviceConfig> &cfg) {
+            return cfg->getType() == (unsigned int)type;
+        }), usb_device_config_list_.end());
+    for (auto it = format_list_map.begin(); it != format_list_map.end();) {
+        if (it->second->getType() == (unsigned int)type)
+            it = format_list_map.erase(it);
+        else
+            it++;
+    }
+    best_config_map_.clear();
+
+    return getCapability(type, address_, usbid_);
+}
+
 USBCardConfig::USBCardConfig(struct pal_usb_device_address address) {
     address_ = address;
 }
@@ -851,6 +968,13 @@ int USBCardConfig::readSupportedConfig(struct dynamic_media_config *config, bool
     return 0;
 }
 
+uint64_t USBCardConfig::bestConfigKey(bool is_playback, bool uhqa, uint32_t bit_width,
+                                      uint32_t sample_rate, uint32_t channels)
+{
+    return ((uint64_t)sample_rate << 32) | ((uint64_t)(bit_width & 0xff) << 24) |
+           ((uint64_t)(channels & 0xffff) << 8) | (uhqa ? 2 : 0) | (is_playback ? 1 : 0);
+}
+
 int USBCardConfig::readBestConfig(struct pal_media_config *config,
                                 struct pal_stream_attributes *sattr, bool is_playback,
                                 struct pal_device_info *devinfo, bool uhqa)
@@ -870,6 +994,8 @@ int USBCardConfig::readBestConfig(struct pal_media_config *config,
 
     int target_sample_rate = devinfo->samplerate == 0 ?
                            config->sample_rate : devinfo->samplerate;
+    uint64_t key = 0;
+    std::map<uint64_t, struct usb_best_config>::iterator best;
 
     if (is_playback) {
         PAL_INFO(LOG_TAG, "USB output uhqa = %d", uhqa);
@@ -879,6 +1005,18 @@ int USBCardConfig::readBestConfig(struct pal_media_config *config,
         media_config = sattr->in_media_config;
     }
 
+    key = bestConfigKey(is_playback, uhqa, target_bit_width, target_sample_rate,
+                        media_config.ch_info.channels);
+    best = best_config_map_.find(key);
+    if (best != best_config_map_.end()) {
+        config->bit_width = best->second.bit_width;
+        config->sample_rate = best->second.sample_rate;
+        config->ch_info = best->second.ch_info;
+        PAL_INFO(LOG_TAG, "best config bw %d sr %d ch %d", config->bit_width,
+                 config->sample_rate, config->ch_info.channels);
+        return 0;
+    }
+
     if (!format_list_map.empty()) {
         if (format_list_map.count(target_bit_width) == 0) {
             /* if bit width does not match, use highest width. */
@@ -953,13 +1091,16 @@ int USBCardConfig::readBestConfig(struct pal_media_config *config,
                 candidate_config = candidate_list[candidate_sr];
             }
 UpdateBestCh:
-            if (candidate_config)
+            if (candidate_config) {
                 candidate_config->updateBestChInfo(&media_config.ch_info, &config->ch_info);
+                best_config_map_[key] = {config->bit_width, config->sample_rate,
+                                         config->ch_info};
+            }
         }
     } else {
         PAL_ERR(LOG_TAG, "format_list_map is empty!");
     }
-    return 0;
+    return candidate_config ? 0 : -ENOENT;
 }
 
 const unsigned int USBDeviceConfig::supported_sample_rates_[] =
@@ -1147,6 +1288,18 @@ int USBDeviceConfig::getSampleRates(int type, char *rates_str) {
     return 0;
 }
 
+void USBDeviceConfig::setSampleRates(usb_usecase_type_t type, const uint32_t *rates,
+                                     uint32_t num_rates)
+{
+    rates_.assign(rates, rates + num_rates);
+    for (unsigned int rate : rates_) {
+        for (unsigned int i = 0; i < MAX_SAMPLE_RATE_SIZE; i++) {
+            if (supported_sample_rates_[i] == rate)
+                supported_sample_rates_mask_[type] |= (1<<i);
+        }
+    }
+}
+
 int USBDeviceConfig::getServiceInterval(const char *interval_str_start)
 {
     unsigned long interval = 0;
@@ -0,0 +1,257 @@
+/*
+ * Copyright (c) 2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#define LOG_TAG "PAL: UsbCapabilityCache"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "UsbCapabilityCache.h"
+#include "PalXmlSnapshot.h"
+#include "PalCommon.h"
+
+std::mutex UsbCapabilityCache::cacheMutex;
+bool UsbCapabilityCache::loaded = false;
+std::list<struct UsbCapabilityCache::entry> UsbCapabilityCache::entries;
+
+#define USB_STATUS_STR "Status:"
+
+std::list<struct UsbCapabilityCache::entry>::iterator UsbCapabilityCache::find_l(
+    const std::string &usbid, uint32_t type)
+{
+    for (auto it = entries.begin(); it != entries.end(); it++) {
+        if (it->type == type && it->usbid == usbid)
+            return it;
+    }
+    return entries.end();
+}
+
+/*
+ * CRC32 over stream0 without the "Status:" block of each direction, i.e. the
+ * Status line and the deeper indented lines which follow it.
+ */
+struct usb_cap_fingerprint UsbCapabilityCache::fingerprint(const char *stream0, size_t size)
+{
+    struct usb_cap_fingerprint fp = {0, 0};
+    std::vector<uint8_t> text;
+    size_t pos = 0;
+    size_t end = 0;
+    size_t indent = 0;
+    size_t statusIndent = 0;
+    bool inStatus = false;
+
+    text.reserve(size);
+    while (pos < size) {
+        end = pos;
+        while (end < size && stream0[end] != '\n')
+            end++;
+        if (end < size)
+            end++;
+
+        indent = 0;
+        while (pos + indent < end && stream0[pos + indent] == ' ')
+            indent++;
+        if (inStatus && indent <= statusIndent)
+            inStatus = false;
+        if (!inStatus && end - pos - indent >= strlen(USB_STATUS_STR) &&
+            !strncmp(stream0 + pos + indent, USB_STATUS_STR, strlen(USB_STATUS_STR))) {
+            inStatus = true;
+            statusIndent = indent;
+        }
+        if (!inStatus)
+            text.insert(text.end(), (const uint8_t *)stream0 + pos,
+                        (const uint8_t *)stream0 + end);
+        pos = end;
+    }
+
+    fp.size = text.size();
+    fp.crc = PalXmlSnapshot::crc32(text.data(), text.size());
+    return fp;
+}
+
+void UsbCapabilityCache::load_l()
+{
+    struct usb_cap_cache_header hdr;
+    struct usb_cap_entry_header ehdr;
+    struct entry e;
+    std::vector<uint8_t> payload;
+    FILE *file = NULL;
+    size_t offset = 0;
+
+    loaded = true;
+    file = fopen(USB_CAP_CACHE_PATH, "rb");
+    if (!file) {
+        PAL_DBG(LOG_TAG, "no usb capability cache %s", USB_CAP_CACHE_PATH);
+        return;
+    }
+
+    if (fread(&hdr, sizeof(hdr), 1, file) != 1 || hdr.magic != USB_CAP_CACHE_MAGIC ||
+        hdr.version != USB_CAP_CACHE_VERSION || hdr.num_entries > USB_CAP_CACHE_MAX_ENTRIES ||
+        hdr.payload_size > USB_CAP_CACHE_MAX_ENTRIES * (sizeof(ehdr) +
+                           USB_CAP_MAX_ALTSETS * sizeof(struct usb_cap_altset))) {
+        PAL_ERR(LOG_TAG, "invalid usb capability cache header");
+        goto exit;
+    }
+
+    payload.resize(hdr.payload_size);
+    if ((hdr.payload_size && fread(payload.data(), hdr.payload_size, 1, file) != 1) ||
+        PalXmlSnapshot::crc32(payload.data(), payload.size()) != hdr.payload_crc) {
+        PAL_ERR(LOG_TAG, "corrupted usb capability cache");
+        goto exit;
+    }
+
+    for (uint32_t i = 0; i < hdr.num_entries; i++) {
+        if (payload.size() - offset < sizeof(ehdr))
+            goto corrupted;
+        memcpy(&ehdr, payload.data() + offset, sizeof(ehdr));
+        offset += sizeof(ehdr);
+        if (ehdr.num_altsets > USB_CAP_MAX_ALTSETS ||
+            (payload.size() - offset) / sizeof(struct usb_cap_altset) < ehdr.num_altsets)
+            goto corrupted;
+
+        e.usbid.assign(ehdr.usbid, strnlen(ehdr.usbid, sizeof(ehdr.usbid)));
+        e.type = ehdr.type;
+        e.fp = ehdr.fp;
+        e.altsets.resize(ehdr.num_altsets);
+        memcpy(e.altsets.data(), payload.data() + offset,
+               ehdr.num_altsets * sizeof(struct usb_cap_altset));
+        offset += ehdr.num_altsets * sizeof(struct usb_cap_altset);
+        for (auto &alt : e.altsets) {
+            if (alt.num_rates > USB_CAP_MAX_RATES)
+                goto corrupted;
+        }
+        entries.push_back(e);
+    }
+    PAL_INFO(LOG_TAG, "loaded %zu usb capability entries", entries.size());
+    goto exit;
+
+corrupted:
+    PAL_ERR(LOG_TAG, "corrupted usb capability entry at %zu", offset);
+    entries.clear();
+exit:
+    fclose(file);
+}
+
+int UsbCapabilityCache::save_l()
+{
+    struct usb_cap_cache_header hdr;
+    struct usb_cap_entry_header ehdr;
+    std::vector<uint8_t> payload;
+    std::string tmpFile = std::string(USB_CAP_CACHE_PATH) + ".tmp";
+    FILE *file = NULL;
+    int ret = 0;
+
+    for (auto &e : entries) {
+        memset(&ehdr, 0, sizeof(ehdr));
+        strlcpy(ehdr.usbid, e.usbid.c_str(), sizeof(ehdr.usbid));
+        ehdr.type = e.type;
+        ehdr.fp = e.fp;
+        ehdr.num_altsets = e.altsets.size();
+        payload.insert(payload.end(), (uint8_t *)&ehdr, (uint8_t *)&ehdr + sizeof(ehdr));
+        payload.insert(payload.end(), (uint8_t *)e.altsets.data(),
+                       (uint8_t *)(e.altsets.data() + e.altsets.size()));
+    }
+
+    hdr.magic = USB_CAP_CACHE_MAGIC;
+    hdr.version = USB_CAP_CACHE_VERSION;
+    hdr.num_entries = entries.size();
+    hdr.payload_size = payload.size();
+    hdr.payload_crc = PalXmlSnapshot::crc32(payload.data(), payload.size());
+
+    file = fopen(tmpFile.c_str(), "wb");
+    if (!file) {
+        ret = -errno;
+        PAL_DBG(LOG_TAG, "cannot create %s ret %d", tmpFile.c_str(), ret);
+        return ret;
+    }
+    if (fwrite(&hdr, sizeof(hdr), 1, file) != 1 ||
+        (payload.size() && fwrite(payload.data(), payload.size(), 1, file) != 1)) {
+        ret = -EIO;
+        PAL_ERR(LOG_TAG, "failed to write %s", tmpFile.c_str());
+    }
+    if (fclose(file) && !ret)
+        ret = -EIO;
+
+    /* rename so a crash while writing never leaves a truncated cache */
+    if (!ret && rename(tmpFile.c_str(), USB_CAP_CACHE_PATH))
+        ret = -errno;
+    if (ret)
+        unlink(tmpFile.c_str());
+    return ret;
+}
+
+int UsbCapabilityCache::lookup(const std::string &usbid, uint32_t type,
+                               const struct usb_cap_fingerprint &fp,
+                               std::vector<struct usb_cap_altset> *altsets)
+{
+    std::lock_guard<std::mutex> lock(cacheMutex);
+
+    if (!loaded)
+        load_l();
+
+    auto it = find_l(usbid, type);
+    if (it == entries.end())
+        return -ENOENT;
+    if (it->fp.size != fp.size || it->fp.crc != fp.crc) {
+        PAL_INFO(LOG_TAG, "usb %s type %u changed, parse again", usbid.c_str(), type);
+        return -ESTALE;
+    }
+
+    *altsets = it->altsets;
+    entries.splice(entries.begin(), entries, it);
+    PAL_DBG(LOG_TAG, "usb %s type %u, %zu altsets from cache", usbid.c_str(), type,
+            altsets->size());
+    return 0;
+}
+
+void UsbCapabilityCache::store(const std::string &usbid, uint32_t type,
+                               const struct usb_cap_fingerprint &fp,
+                               const std::vector<struct usb_cap_altset> &altsets)
+{
+    struct entry e;
+    int ret = 0;
+
+    if (usbid.empty() || usbid.size() >= USB_CAP_USBID_SIZE ||
+        altsets.empty() || altsets.size() > USB_CAP_MAX_ALTSETS)
+        return;
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    if (!loaded)
+        load_l();
+
+    auto it = find_l(usbid, type);
+    if (it != entries.end())
+        entries.erase(it);
+
+    e.usbid = usbid;
+    e.type = type;
+    e.fp = fp;
+    e.altsets = altsets;
+    entries.push_front(std::move(e));
+    while (entries.size() > USB_CAP_CACHE_MAX_ENTRIES)
+        entries.pop_back();
+
+    ret = save_l();
+    PAL_INFO(LOG_TAG, "usb %s type %u, %zu altsets cached, ret %d", usbid.c_str(), type,
+             altsets.size(), ret);
+}
+
+void UsbCapabilityCache::invalidate(const std::string &usbid, uint32_t type)
+{
+    int ret = 0;
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    if (!loaded)
+        load_l();
+
+    auto it = find_l(usbid, type);
+    if (it == entries.end())
+        return;
+
+    entries.erase(it);
+    ret = save_l();
+    PAL_INFO(LOG_TAG, "usb %s type %u dropped, ret %d", usbid.c_str(), type, ret);
+}
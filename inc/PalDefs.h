@@ -734,8 +734,26 @@ typedef enum {
 /* type of global callback events. */
 typedef enum {
     PAL_SND_CARD_STATE,
+    PAL_SSR_STREAM_RECOVERED,  /* event_data: struct pal_ssr_stream_recovery */
+    PAL_SSR_RECOVERY_DONE,     /* event_data: struct pal_ssr_recovery_done */
 } pal_global_callback_event_t;
 
+/* sent for every stream restored after the sound card came back online */
+struct pal_ssr_stream_recovery {
+    pal_stream_type_t type;
+    int32_t status;         /* result of the stream ssr up handling */
+    uint32_t priority;      /* 0 is restored first */
+    uint32_t handler_us;    /* time spent restoring the stream */
+    uint32_t recovery_us;   /* time from card online to stream restored */
+};
+
+/* sent once all streams were restored */
+struct pal_ssr_recovery_done {
+    uint32_t num_streams;
+    uint32_t num_failed;
+    uint32_t total_us;
+};
+
 struct pal_stream_info {
     int64_t version;                    /** version of structure*/
     int64_t size;                       /** size of structure*/
@@ -1048,6 +1066,12 @@ typedef enum {
     PAL_PARAM_ID_LATENCY_MODE = 73,
     PAL_PARAM_ID_PROXY_RECORD_SESSION = 74,
     PAL_PARAM_ID_ULTRASOUND_SET_GAIN = 75,
+    PAL_PARAM_ID_INIT_STAGE_TIMING = 76,
+    PAL_PARAM_ID_KPI_TRACE = 77,
+    PAL_PARAM_ID_FE_POOL_STATS = 78,
+    PAL_PARAM_ID_SND_CARD_TRANSITIONS = 79,
+    PAL_PARAM_ID_KV_CACHE_STATS = 80,
+    PAL_PARAM_ID_MIXER_CTL_CACHE_STATS = 81,
 } pal_param_id_type_t;
 
 /** HDMI/DP */
@@ -1289,6 +1313,130 @@ typedef struct pal_param_latency_mode {
     uint32_t        modes[PAL_MAX_LATENCY_MODES]; /* list of supported modes or use mode[0] for set latency mode */
 } pal_param_latency_mode_t;
 
+#define PAL_MAX_INIT_STAGES 16
+#define PAL_INIT_STAGE_NAME_LEN 32
+
+struct pal_init_stage_timing {
+    char     name[PAL_INIT_STAGE_NAME_LEN];
+    int32_t  status;
+    uint32_t start_us;    /* offset from the start of ResourceManager creation */
+    uint32_t duration_us;
+};
+
+/* Payload For ID: PAL_PARAM_ID_INIT_STAGE_TIMING
+ * Description   : Get the duration of each pal_init stage, stages which are
+ *                 loaded on first use are reported once they have run. The
+ *                 caller provides the buffer, stages beyond
+ *                 PAL_MAX_INIT_STAGES are left out
+*/
+typedef struct pal_param_init_stage_timing {
+    uint32_t num_stages;
+    uint32_t total_us;
+    struct pal_init_stage_timing stages[PAL_MAX_INIT_STAGES];
+} pal_param_init_stage_timing_t;
+
+#define PAL_MAX_SND_CARD_TRANSITIONS 16
+
+/* timestamps are CLOCK_MONOTONIC, 0 when the step did not happen yet */
+struct pal_snd_card_transition {
+    uint32_t state;         /* card_status_t */
+    uint32_t seq;           /* counts every transition since boot */
+    uint64_t detect_ns;     /* card state node reported the change */
+    uint64_t dispatch_ns;   /* ssr handling picked it up */
+    uint64_t handled_ns;    /* streams were brought down or restored */
+};
+
+/* Payload For ID: PAL_PARAM_ID_SND_CARD_TRANSITIONS
+ * Description   : Get the last sound card state transitions, oldest first.
+ *                 The caller provides the buffer
+*/
+typedef struct pal_param_snd_card_transitions {
+    uint32_t num_transitions;
+    uint32_t total;         /* transitions seen since boot */
+    uint64_t ready_ns;      /* card state node became available */
+    struct pal_snd_card_transition transitions[PAL_MAX_SND_CARD_TRANSITIONS];
+} pal_param_snd_card_transitions_t;
+
+#define PAL_KPI_TRACE_NAME_LEN 128
+
+typedef enum {
+    PAL_KPI_TRACE_STOP = 0,
+    PAL_KPI_TRACE_START,
+    PAL_KPI_TRACE_DUMP,     /* write the trace, tracing keeps running */
+} pal_kpi_trace_cmd_t;
+
+/* Payload For ID: PAL_PARAM_ID_KPI_TRACE
+ * Description   : Start/stop span tracing of stream open, start, device
+ *                 switch, SSR and sound trigger detection, or dump it as a
+ *                 Chrome JSON trace to file_name in /data/vendor/audio
+ *                 (pal_trace.json if empty). Names with '/' or ".." are
+ *                 rejected.
+*/
+typedef struct pal_param_kpi_trace {
+    uint32_t cmd;
+    char     file_name[PAL_KPI_TRACE_NAME_LEN];
+} pal_param_kpi_trace_t;
+
+/** Front end id classes of resourcemanager xml, see PAL_PARAM_ID_FE_POOL_STATS */
+typedef enum {
+    PAL_FE_POOL_PCM_PLAYBACK = 0,
+    PAL_FE_POOL_PCM_RECORD,
+    PAL_FE_POOL_PCM_HOSTLESS_RX,
+    PAL_FE_POOL_PCM_HOSTLESS_TX,
+    PAL_FE_POOL_COMPRESS_PLAYBACK,
+    PAL_FE_POOL_COMPRESS_RECORD,
+    PAL_FE_POOL_VOICE1_RX,
+    PAL_FE_POOL_VOICE1_TX,
+    PAL_FE_POOL_VOICE2_RX,
+    PAL_FE_POOL_VOICE2_TX,
+    PAL_FE_POOL_INCALL_RECORD,
+    PAL_FE_POOL_INCALL_MUSIC,
+    PAL_FE_POOL_CONTEXT_PROXY,
+    PAL_FE_POOL_EXT_EC_TX,
+    PAL_FE_POOL_NON_TUNNEL,
+    PAL_FE_POOL_MAX,
+} pal_fe_pool_t;
+
+struct pal_fe_pool_stats {
+    uint32_t capacity;      /* front ends of this class */
+    uint32_t in_use;
+    uint32_t high_water;    /* most front ends in use at once */
+    uint32_t exhausted;     /* allocations failed for lack of a free front end */
+};
+
+/* Payload For ID: PAL_PARAM_ID_FE_POOL_STATS
+ * Description   : Get the usage of each front end class, indexed by
+ *                 pal_fe_pool_t. Voice front ends are shared by all
+ *                 streams of a VSID, in_use counts their users. The
+ *                 caller provides the buffer
+*/
+typedef struct pal_param_fe_pool_stats {
+    uint32_t num_pools;
+    struct pal_fe_pool_stats pools[PAL_FE_POOL_MAX];
+} pal_param_fe_pool_stats_t;
+
+/* Payload For ID: PAL_PARAM_ID_KV_CACHE_STATS
+ * Description   : Get the lookups of stream, device and devicepp graph key
+ *                 vectors served from the cache and the ones which had to
+ *                 walk the usecase KV tables. The caller provides the buffer
+*/
+typedef struct pal_param_kv_cache_stats {
+    uint64_t hits;
+    uint64_t misses;
+} pal_param_kv_cache_stats_t;
+
+/* Payload For ID: PAL_PARAM_ID_MIXER_CTL_CACHE_STATS
+ * Description   : Get the mixer control lookups served from the resolved
+ *                 control cache and the ones which had to search the mixer
+ *                 by name. The caller provides the buffer
+*/
+typedef struct pal_param_mixer_ctl_cache_stats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t invalidations; /* cache drops on sound card state changes */
+    uint64_t entries;       /* controls cached right now */
+} pal_param_mixer_ctl_cache_stats_t;
+
 typedef struct pal_param_upd_event_detection {
     bool     register_status;
 } pal_param_upd_event_detection_t;
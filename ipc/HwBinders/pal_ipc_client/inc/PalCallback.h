@@ -34,6 +34,7 @@
 #pragma once
 
 #include <vendor/qti/hardware/pal/1.0/IPALCallback.h>
+#include <vendor/qti/hardware/pal/1.1/types.h>
 #include <hidl/MQDescriptor.h>
 #include <hidl/Status.h>
 #include <fmq/EventFlag.h>
@@ -68,6 +69,9 @@ using PalMessageQueueFlagBits = ::vendor::qti::hardware::pal::V1_0::PalMessageQu
 using PalReadWriteDoneResult = ::vendor::qti::hardware::pal::V1_0::PalReadWriteDoneResult;
 using PalReadWriteDoneCommand = ::vendor::qti::hardware::pal::V1_0::PalReadWriteDoneCommand;
 using PalCallbackBuffer = ::vendor::qti::hardware::pal::V1_0::PalCallbackBuffer;
+using PalStreamIoCommand = ::vendor::qti::hardware::pal::V1_1::PalStreamIoCommand;
+using PalStreamIoRequest = ::vendor::qti::hardware::pal::V1_1::PalStreamIoRequest;
+using PalStreamIoStatus = ::vendor::qti::hardware::pal::V1_1::PalStreamIoStatus;
 using IPALCallback = ::vendor::qti::hardware::pal::V1_0::IPALCallback;
 using android::hardware::hidl_handle;
 using android::hardware::hidl_memory;
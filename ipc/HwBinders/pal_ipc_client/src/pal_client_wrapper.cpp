@@ -33,18 +33,23 @@
 
 #define LOG_TAG "pal_client_wrapper"
 #include <vendor/qti/hardware/pal/1.0/IPAL.h>
+#include <vendor/qti/hardware/pal/1.1/IPAL.h>
 #include <android/hidl/allocator/1.0/IAllocator.h>
 #include <android/hidl/memory/1.0/IMemory.h>
 #include <hidlmemory/mapping.h>
 #include <hidl/MQDescriptor.h>
 #include <hidl/Status.h>
 #include <log/log.h>
+#include <atomic>
+#include <chrono>
+#include <map>
 #include "PalApi.h"
 #include "inc/PalCallback.h"
 
 using android::hardware::Return;
 using android::hardware::hidl_vec;
 using vendor::qti::hardware::pal::V1_0::IPAL;
+using IPAL_V1_1 = vendor::qti::hardware::pal::V1_1::IPAL;
 
 using vendor::qti::hardware::pal::V1_0::implementation::PalCallback;
 using android::sp;
@@ -160,6 +165,202 @@ bool DataTransferThread::threadLoop() {
     return false;
 }
 
+#define STREAM_IO_BUFFER_COUNT 2
+/* a status wait gives up after this, the stream then goes back to binder */
+#define STREAM_IO_TIMEOUT_NS 5000000000LL
+#define STREAM_IO_WAIT_SLICE_NS 100000000LL
+
+/*
+ * Client end of the shared memory data path of a stream, see
+ * ipc_pal_stream_prepare_mq. Buffers are copied once into the data queue
+ * and the server thread is woken through the event flag, so a period costs
+ * no binder transaction and no hidl_vec allocation.
+ */
+class StreamIo {
+   public:
+    typedef MessageQueue<uint8_t, kSynchronizedReadWrite> DataMQ;
+    typedef MessageQueue<PalStreamIoRequest, kSynchronizedReadWrite> IoCommandMQ;
+    typedef MessageQueue<PalStreamIoStatus, kSynchronizedReadWrite> IoStatusMQ;
+
+    ~StreamIo() {
+        if (mEfGroup)
+            EventFlag::deleteEventFlag(&mEfGroup);
+    }
+    int32_t prepare(android::sp<IPAL> pal_client, PalStreamHandle streamHandle,
+                    uint32_t bufferSize);
+    bool fits(size_t size) const { return !mBroken && size && size <= mBufferSize; }
+    ssize_t write(struct pal_buffer *buf);
+    ssize_t read(struct pal_buffer *buf);
+
+   private:
+    int32_t transact(const PalStreamIoRequest &req, PalStreamIoStatus *status);
+
+    std::mutex mLock;
+    std::unique_ptr<DataMQ> mDataMQ = nullptr;
+    std::unique_ptr<IoCommandMQ> mCommandMQ = nullptr;
+    std::unique_ptr<IoStatusMQ> mStatusMQ = nullptr;
+    EventFlag* mEfGroup = nullptr;
+    uint32_t mBufferSize = 0;
+    /* a request timed out, its status may still arrive so the queues are out of step */
+    std::atomic<bool> mBroken{false};
+};
+
+/* data path per stream, nullptr when the stream moves its buffers over binder */
+std::map<PalStreamHandle, std::shared_ptr<StreamIo>> gStreamIo;
+std::mutex gStreamIoLock;
+
+int32_t StreamIo::prepare(android::sp<IPAL> pal_client, PalStreamHandle streamHandle,
+                          uint32_t bufferSize)
+{
+    int32_t ret = -EINVAL;
+    /* the shared memory data path needs a 1.1 server */
+    android::sp<IPAL_V1_1> pal_client_v1_1 = IPAL_V1_1::castFrom(pal_client);
+
+    if (!pal_client_v1_1)
+        return -ENOSYS;
+
+    auto transStatus = pal_client_v1_1->ipc_pal_stream_prepare_mq(streamHandle, bufferSize,
+                                    STREAM_IO_BUFFER_COUNT,
+            [&](int32_t ret_, const DataMQ::Descriptor& dataMQ,
+                const IoCommandMQ::Descriptor& commandMQ,
+                const IoStatusMQ::Descriptor& statusMQ)
+                {
+                    ret = ret_;
+                    if (!ret) {
+                        mDataMQ.reset(new DataMQ(dataMQ));
+                        mCommandMQ.reset(new IoCommandMQ(commandMQ));
+                        mStatusMQ.reset(new IoStatusMQ(statusMQ));
+                    }
+                });
+    if (!transStatus.isOk()) {
+        ALOGE("%s: IPC call failed.", __func__);
+        return -EINVAL;
+    }
+    if (ret)
+        return ret;
+    if (!mDataMQ->isValid() || !mCommandMQ->isValid() || !mStatusMQ->isValid() ||
+            EventFlag::createEventFlag(mDataMQ->getEventFlagWord(), &mEfGroup) != android::OK) {
+        ALOGE("%s: invalid message queues for stream %llx", __func__,
+              (unsigned long long)streamHandle);
+        return -EINVAL;
+    }
+    mBufferSize = bufferSize;
+    return 0;
+}
+
+int32_t StreamIo::transact(const PalStreamIoRequest &req, PalStreamIoStatus *status)
+{
+    uint32_t efState = 0;
+    auto deadline = std::chrono::steady_clock::now() +
+                    std::chrono::nanoseconds(STREAM_IO_TIMEOUT_NS);
+    status_t ret;
+
+    if (!mCommandMQ->write(&req)) {
+        ALOGE("%s: command message queue write failed", __func__);
+        return -EAGAIN;
+    }
+    mEfGroup->wake(static_cast<uint32_t>(PalMessageQueueFlagBits::NOT_EMPTY));
+    /*
+     * wait in slices so a dead server or a stream closed underneath us does
+     * not hang the audio thread, the caller then falls back to binder
+     */
+    while (!mStatusMQ->read(status)) {
+        if (pal_server_died) {
+            ret = -ENODEV;
+        } else if (std::chrono::steady_clock::now() >= deadline) {
+            ret = -ETIMEDOUT;
+        } else {
+            ret = mEfGroup->wait(static_cast<uint32_t>(PalMessageQueueFlagBits::NOT_FULL),
+                                 &efState, STREAM_IO_WAIT_SLICE_NS);
+            if (!ret || ret == -ETIMEDOUT || ret == -EAGAIN || ret == -EINTR)
+                continue;
+        }
+        ALOGE("%s: no status for stream io request: %s", __func__, strerror(-ret));
+        mBroken = true;
+        return ret;
+    }
+    return 0;
+}
+
+ssize_t StreamIo::write(struct pal_buffer *buf)
+{
+    PalStreamIoRequest req = {};
+    PalStreamIoStatus status = {};
+    int32_t ret;
+
+    std::lock_guard<std::mutex> lock(mLock);
+    req.cmd = PalStreamIoCommand::WRITE;
+    req.size = buf->size;
+    req.offset = buf->offset;
+    req.flags = buf->flags;
+    req.frame_index = buf->frame_index;
+    if (buf->ts) {
+        req.timeStamp.tvSec = buf->ts->tv_sec;
+        req.timeStamp.tvNSec = buf->ts->tv_nsec;
+    }
+    if (!mDataMQ->write((const uint8_t *)buf->buffer, buf->size)) {
+        ALOGE("%s: data message queue write of %zu bytes failed", __func__, buf->size);
+        return -EAGAIN;
+    }
+    ret = transact(req, &status);
+    return ret ? ret : status.ret;
+}
+
+ssize_t StreamIo::read(struct pal_buffer *buf)
+{
+    PalStreamIoRequest req = {};
+    PalStreamIoStatus status = {};
+    int32_t ret;
+
+    std::lock_guard<std::mutex> lock(mLock);
+    req.cmd = PalStreamIoCommand::READ;
+    req.size = buf->size;
+    ret = transact(req, &status);
+    if (ret)
+        return ret;
+    if (status.ret > 0) {
+        if (!mDataMQ->read((uint8_t *)buf->buffer, status.size)) {
+            ALOGE("%s: data message queue read of %u bytes failed", __func__, status.size);
+            return -EIO;
+        }
+        if (buf->ts) {
+            buf->ts->tv_sec = status.timeStamp.tvSec;
+            buf->ts->tv_nsec = status.timeStamp.tvNSec;
+        }
+        buf->flags = status.flags;
+    }
+    return status.ret;
+}
+
+/*
+ * Data path of a stream, prepared by its first buffer which also sizes the
+ * queue. Buffers in external allocations keep going over binder, the server
+ * tracks their fds for the read/write done callbacks.
+ */
+static std::shared_ptr<StreamIo> getStreamIo(android::sp<IPAL> pal_client,
+                                             pal_stream_handle_t *stream_handle,
+                                             struct pal_buffer *buf)
+{
+    PalStreamHandle handle = (PalStreamHandle)stream_handle;
+
+    if (buf->alloc_info.alloc_size || !buf->buffer || !buf->size)
+        return nullptr;
+
+    std::lock_guard<std::mutex> guard(gStreamIoLock);
+    auto it = gStreamIo.find(handle);
+    if (it == gStreamIo.end()) {
+        auto io = std::make_shared<StreamIo>();
+        if (io->prepare(pal_client, handle, buf->size)) {
+            ALOGW("%s: stream %p keeps binder data path", __func__, stream_handle);
+            io = nullptr;
+        }
+        it = gStreamIo.emplace(handle, io).first;
+    }
+    if (it->second && !it->second->fits(buf->size))
+        return nullptr;
+    return it->second;
+}
+
 void server_death_notifier::serviceDied(uint64_t cookie,
                    const android::wp<::android::hidl::base::V1_0::IBase>& who)
 {
@@ -461,6 +662,10 @@ int32_t pal_stream_close(pal_stream_handle_t *stream_handle)
         if (pal_client == nullptr)
             return -EINVAL;
 
+        {
+            std::lock_guard<std::mutex> guard(gStreamIoLock);
+            gStreamIo.erase((PalStreamHandle)stream_handle);
+        }
         return pal_client->ipc_pal_stream_close((PalStreamHandle)stream_handle);
     }
     return -EINVAL;
@@ -624,6 +829,10 @@ ssize_t pal_stream_write(pal_stream_handle_t *stream_handle, struct pal_buffer *
         if (!pal_client)
             return ret;
 
+        auto streamIo = getStreamIo(pal_client, stream_handle, buf);
+        if (streamIo)
+            return streamIo->write(buf);
+
         hidl_vec<PalBuffer> buf_hidl;
         buf_hidl.resize(sizeof(struct pal_buffer));
         PalBuffer *palBuff = buf_hidl.data();
@@ -673,6 +882,10 @@ ssize_t pal_stream_read(pal_stream_handle_t *stream_handle, struct pal_buffer *b
         if (!pal_client)
             return ret;
 
+        auto streamIo = getStreamIo(pal_client, stream_handle, buf);
+        if (streamIo)
+            return streamIo->read(buf);
+
         hidl_vec<PalBuffer> buf_hidl;
         buf_hidl.resize(sizeof(struct pal_buffer));
         PalBuffer *palBuff = buf_hidl.data();
@@ -26,6 +26,7 @@ LOCAL_SHARED_LIBRARIES := \
     libhardware \
     libbase \
     vendor.qti.hardware.pal@1.0 \
+    vendor.qti.hardware.pal@1.1 \
     libar-pal \
     android.hidl.allocator@1.0 \
     android.hidl.memory@1.0 \
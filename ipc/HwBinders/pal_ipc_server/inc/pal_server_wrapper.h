@@ -37,6 +37,7 @@
 
 #include <vendor/qti/hardware/pal/1.0/IPALCallback.h>
 #include <vendor/qti/hardware/pal/1.0/IPAL.h>
+#include <vendor/qti/hardware/pal/1.1/IPAL.h>
 #include <android/hidl/allocator/1.0/IAllocator.h>
 #include <android/hidl/memory/1.0/IMemory.h>
 #include <hidlmemory/mapping.h>
@@ -47,6 +48,8 @@
 #include <utils/Thread.h>
 #include <utils/RefBase.h>
 #include <mutex>
+#include <atomic>
+#include <vector>
 #include "PalApi.h"
 #include<log/log.h>
 
@@ -66,6 +69,10 @@ using ::android::hardware::hidl_vec;
 using ::android::hardware::Return;
 using ::android::hardware::Void;
 using IPALCallback = ::vendor::qti::hardware::pal::V1_0::IPALCallback;
+using IPAL_V1_1 = ::vendor::qti::hardware::pal::V1_1::IPAL;
+using PalStreamIoCommand = ::vendor::qti::hardware::pal::V1_1::PalStreamIoCommand;
+using PalStreamIoRequest = ::vendor::qti::hardware::pal::V1_1::PalStreamIoRequest;
+using PalStreamIoStatus = ::vendor::qti::hardware::pal::V1_1::PalStreamIoStatus;
 using ::android::sp;
 using ::android::hardware::MessageQueue;
 using ::android::hardware::EventFlag;
@@ -74,6 +81,42 @@ using ::android::status_t;
 
 class PalClientDeathRecipient;
 
+/*
+ * Shared memory data path of one stream. The client writes a buffer to the
+ * data queue and a PalStreamIoRequest to the command queue, then wakes this
+ * thread, which hands the queue memory to pal_stream_write (or reads into
+ * it for pal_stream_read) and posts a PalStreamIoStatus. No binder call and
+ * no server side copy, unless the buffer wraps around the end of the queue.
+ */
+class StreamIoThread : public Thread {
+    public:
+    typedef MessageQueue<uint8_t, kSynchronizedReadWrite> DataMQ;
+    typedef MessageQueue<PalStreamIoRequest, kSynchronizedReadWrite> IoCommandMQ;
+    typedef MessageQueue<PalStreamIoStatus, kSynchronizedReadWrite> IoStatusMQ;
+
+    StreamIoThread(uint64_t streamHandle, const struct pal_media_config *outConfig);
+    ~StreamIoThread();
+    int32_t init(uint32_t bufferSize, uint32_t bufferCount);
+    void stop();
+    const DataMQ::Descriptor *getDataDesc() const { return mDataMQ->getDesc(); }
+    const IoCommandMQ::Descriptor *getCommandDesc() const { return mCommandMQ->getDesc(); }
+    const IoStatusMQ::Descriptor *getStatusDesc() const { return mStatusMQ->getDesc(); }
+
+    private:
+    bool threadLoop() override;
+    void doWrite(const PalStreamIoRequest &req, PalStreamIoStatus *status);
+    void doRead(const PalStreamIoRequest &req, PalStreamIoStatus *status);
+
+    uint64_t mStreamHandle;
+    struct pal_media_config mOutConfig;
+    std::unique_ptr<DataMQ> mDataMQ = nullptr;
+    std::unique_ptr<IoCommandMQ> mCommandMQ = nullptr;
+    std::unique_ptr<IoStatusMQ> mStatusMQ = nullptr;
+    EventFlag* mEfGroup = nullptr;
+    std::atomic<bool> mStop = false;
+    /* used only for a buffer which wraps around the end of the data queue */
+    std::vector<uint8_t> mBounce;
+};
 
 class SrvrClbk : public ::android::RefBase {
     public :
@@ -88,6 +131,7 @@ class SrvrClbk : public ::android::RefBase {
     std::unique_ptr<DataMQ> mDataMQ = nullptr;
     std::unique_ptr<CommandMQ> mCommandMQ = nullptr;
     EventFlag* mEfGroup = nullptr;
+    sp<StreamIoThread> mIoThread = nullptr;
 
     SrvrClbk()
     {
@@ -113,6 +157,8 @@ class SrvrClbk : public ::android::RefBase {
     ~SrvrClbk()
     {
         ALOGV("%s:%d",__func__,__LINE__);
+        if (mIoThread)
+            mIoThread->stop();
         if (mEfGroup) {
             EventFlag::deleteEventFlag(&mEfGroup);
         }
@@ -130,7 +176,7 @@ struct client_info {
     std::mutex mActiveSessionsLock;
 };
 
-struct PAL : public IPAL /*, public android::hardware::hidl_death_recipient*/{
+struct PAL : public IPAL_V1_1 /*, public android::hardware::hidl_death_recipient*/{
     public:
     std::mutex mClientLock;
     PAL()
@@ -218,6 +264,9 @@ struct PAL : public IPAL /*, public android::hardware::hidl_death_recipient*/{
     Return<void>ipc_pal_stream_get_tags_with_module_info(const uint64_t streamHandle,
                                      uint32_t size,
                                      ipc_pal_stream_get_tags_with_module_info_cb _hidl_cb) override;
+    Return<void>ipc_pal_stream_prepare_mq(const uint64_t streamHandle,
+                                     uint32_t bufferSize, uint32_t bufferCount,
+                                     ipc_pal_stream_prepare_mq_cb _hidl_cb) override;
     sp<PalClientDeathRecipient> mDeathRecipient;
     std::vector<std::shared_ptr<client_info>> mPalClients;
 private:
@@ -35,6 +35,7 @@
 #include "inc/pal_server_wrapper.h"
 #include "MetadataParser.h"
 #include <hwbinder/IPCThreadState.h>
+#include <algorithm>
 
 #define MAX_CACHE_SIZE 64
 
@@ -103,33 +104,47 @@ void PalClientDeathRecipient::serviceDied(uint64_t cookie,
     std::lock_guard<std::mutex> guard(mLock);
     ALOGD("%s : client died pid : %d", __func__, cookie);
     int pid = (int) cookie;
-    std::lock_guard<std::mutex> lock(mPalInstance->mClientLock);
-    auto &clients = mPalInstance->mPalClients;
-    for (auto itr = clients.begin(); itr != clients.end(); itr++) {
-        auto client = *itr;
-        if (client->pid == pid) {
-            {
-                std::lock_guard<std::mutex> lock(client->mActiveSessionsLock);
-                for (auto sItr = client->mActiveSessions.begin();
-                          sItr != client->mActiveSessions.end(); sItr++) {
-                   ALOGD("Closing the session %p", sItr->session_handle);
-                   ALOGV("hdle %x binder %p", sItr->session_handle, sItr->callback_binder.get());
-                   sItr->callback_binder->client_died = true;
-                   pal_stream_stop((pal_stream_handle_t *)sItr->session_handle);
-                   pal_stream_close((pal_stream_handle_t *)sItr->session_handle);
-                   /*close the dupped fds in PAL server context*/
-                   for (int i = 0; i < sItr->callback_binder->sharedMemFdList.size(); i++) {
-                       close(sItr->callback_binder->sharedMemFdList[i].second);
-                   }
-                   sItr->callback_binder->sharedMemFdList.clear();
-                   sItr->callback_binder.clear();
+    std::vector<session_info> sessions;
+    {
+        std::lock_guard<std::mutex> lock(mPalInstance->mClientLock);
+        auto &clients = mPalInstance->mPalClients;
+        for (auto itr = clients.begin(); itr != clients.end(); itr++) {
+            auto client = *itr;
+            if (client->pid == pid) {
+                {
+                    std::lock_guard<std::mutex> lock(client->mActiveSessionsLock);
+                    for (auto &session : client->mActiveSessions)
+                        session.callback_binder->client_died = true;
+                    sessions.swap(client->mActiveSessions);
                 }
-                client->mActiveSessions.clear();
+                itr = clients.erase(itr);
+                break;
             }
-            itr = clients.erase(itr);
-            break;
         }
     }
+
+    /*
+     * Streams are closed without the client locks held, every other IPC call
+     * waits on them. The stream is stopped before its I/O thread is joined,
+     * a write blocked on a paused stream only returns once it is stopped.
+     */
+    for (auto &session : sessions) {
+        sp<StreamIoThread> ioThread = session.callback_binder->mIoThread;
+
+        ALOGD("Closing the session %p", session.session_handle);
+        ALOGV("hdle %x binder %p", session.session_handle, session.callback_binder.get());
+        session.callback_binder->mIoThread.clear();
+        pal_stream_stop((pal_stream_handle_t *)session.session_handle);
+        if (ioThread)
+            ioThread->stop();
+        pal_stream_close((pal_stream_handle_t *)session.session_handle);
+        /*close the dupped fds in PAL server context*/
+        for (int i = 0; i < session.callback_binder->sharedMemFdList.size(); i++) {
+            close(session.callback_binder->sharedMemFdList[i].second);
+        }
+        session.callback_binder->sharedMemFdList.clear();
+        session.callback_binder.clear();
+    }
 }
 
 void PAL::add_input_and_dup_fd(const uint64_t streamHandle, int input_fd, int dup_fd)
@@ -451,6 +466,149 @@ static void print_attr(struct pal_stream_attributes *attr)
    print_media_config(&attr->out_media_config);
 }
 
+StreamIoThread::StreamIoThread(uint64_t streamHandle, const struct pal_media_config *outConfig)
+    : Thread(false),
+      mStreamHandle(streamHandle)
+{
+    memcpy(&mOutConfig, outConfig, sizeof(mOutConfig));
+}
+
+StreamIoThread::~StreamIoThread()
+{
+    stop();
+    if (mEfGroup) {
+        EventFlag::deleteEventFlag(&mEfGroup);
+    }
+}
+
+int32_t StreamIoThread::init(uint32_t bufferSize, uint32_t bufferCount)
+{
+    status_t status;
+
+    mDataMQ.reset(new DataMQ((size_t)bufferSize * bufferCount, true /* EventFlag */));
+    mCommandMQ.reset(new IoCommandMQ(bufferCount));
+    mStatusMQ.reset(new IoStatusMQ(bufferCount));
+    if (!mDataMQ->isValid() || !mCommandMQ->isValid() || !mStatusMQ->isValid()) {
+        ALOGE("%s: message queue creation failed, size %u count %u", __func__,
+              bufferSize, bufferCount);
+        return -ENOMEM;
+    }
+    status = EventFlag::createEventFlag(mDataMQ->getEventFlagWord(), &mEfGroup);
+    if (status != android::OK || !mEfGroup) {
+        ALOGE("%s: failed creating event flag: %s", __func__, strerror(-status));
+        return -EINVAL;
+    }
+    status = run("pal_stream_io", android::PRIORITY_URGENT_AUDIO);
+    if (status != android::OK) {
+        ALOGE("%s: failed to start io thread: %s", __func__, strerror(-status));
+        return -EINVAL;
+    }
+    return 0;
+}
+
+void StreamIoThread::stop()
+{
+    if (mStop.exchange(true))
+        return;
+    if (mEfGroup)
+        mEfGroup->wake(static_cast<uint32_t>(PalMessageQueueFlagBits::NOT_EMPTY));
+    if (getTid() != -1)
+        join();
+}
+
+void StreamIoThread::doWrite(const PalStreamIoRequest &req, PalStreamIoStatus *status)
+{
+    struct pal_buffer buf = {0};
+    DataMQ::MemTransaction tx;
+    timespec ts;
+
+    if (req.size > mDataMQ->availableToRead() || !mDataMQ->beginRead(req.size, &tx)) {
+        ALOGE("%s: data queue holds %zu bytes, expected %u", __func__,
+              mDataMQ->availableToRead(), req.size);
+        status->ret = -EINVAL;
+        return;
+    }
+    if (tx.getFirstRegion().getLength() >= req.size) {
+        buf.buffer = tx.getFirstRegion().getAddress();
+    } else {
+        mBounce.resize(req.size);
+        tx.copyFrom(mBounce.data(), 0, req.size);
+        buf.buffer = mBounce.data();
+    }
+    buf.size = req.size;
+    buf.offset = req.offset;
+    ts.tv_sec = req.timeStamp.tvSec;
+    ts.tv_nsec = req.timeStamp.tvNSec;
+    buf.ts = &ts;
+    buf.flags = req.flags;
+    buf.frame_index = req.frame_index;
+    buf.metadata_size = MetadataParser::WRITE_METADATA_MAX_SIZE();
+    std::vector<uint8_t> bufMetadata(buf.metadata_size, 0);
+    buf.metadata = bufMetadata.data();
+    auto metadataParser = std::make_unique<MetadataParser>();
+    metadataParser->fillMetaData(buf.metadata, buf.frame_index, buf.size, &mOutConfig);
+
+    status->ret = pal_stream_write((pal_stream_handle_t *)mStreamHandle, &buf);
+    mDataMQ->commitRead(req.size);
+}
+
+void StreamIoThread::doRead(const PalStreamIoRequest &req, PalStreamIoStatus *status)
+{
+    struct pal_buffer buf = {0};
+    DataMQ::MemTransaction tx;
+    timespec ts = {0};
+    bool direct;
+
+    if (req.size > mDataMQ->availableToWrite() || !mDataMQ->beginWrite(req.size, &tx)) {
+        ALOGE("%s: data queue has room for %zu bytes, requested %u", __func__,
+              mDataMQ->availableToWrite(), req.size);
+        status->ret = -EINVAL;
+        return;
+    }
+    direct = tx.getFirstRegion().getLength() >= req.size;
+    if (!direct)
+        mBounce.resize(req.size);
+    buf.buffer = direct ? tx.getFirstRegion().getAddress() : mBounce.data();
+    buf.size = req.size;
+    buf.ts = &ts;
+    buf.metadata_size = MetadataParser::READ_METADATA_MAX_SIZE();
+
+    status->ret = pal_stream_read((pal_stream_handle_t *)mStreamHandle, &buf);
+    if (status->ret > 0) {
+        /* a short read leaves the rest of the reserved region stale */
+        status->size = (uint32_t)std::min((uint32_t)status->ret, req.size);
+        status->flags = buf.flags;
+        status->timeStamp.tvSec = ts.tv_sec;
+        status->timeStamp.tvNSec = ts.tv_nsec;
+        if (!direct)
+            tx.copyTo(mBounce.data(), 0, status->size);
+        mDataMQ->commitWrite(status->size);
+    }
+}
+
+bool StreamIoThread::threadLoop()
+{
+    while (!mStop.load(std::memory_order_acquire)) {
+        uint32_t efState = 0;
+        mEfGroup->wait(static_cast<uint32_t>(PalMessageQueueFlagBits::NOT_EMPTY), &efState);
+        if (!(efState & static_cast<uint32_t>(PalMessageQueueFlagBits::NOT_EMPTY)))
+            continue;  // Nothing to do.
+
+        PalStreamIoRequest req;
+        while (!mStop.load(std::memory_order_acquire) && mCommandMQ->read(&req)) {
+            PalStreamIoStatus status = {};
+            if (req.cmd == PalStreamIoCommand::WRITE)
+                doWrite(req, &status);
+            else
+                doRead(req, &status);
+            if (!mStatusMQ->write(&status))
+                ALOGE("%s: status message queue write failed", __func__);
+            mEfGroup->wake(static_cast<uint32_t>(PalMessageQueueFlagBits::NOT_FULL));
+        }
+    }
+    return false;
+}
+
 bool PAL::isValidstreamHandle(const uint64_t streamHandle) {
     int pid = ::android::hardware::IPCThreadState::self()->getCallingPid();
 
@@ -645,6 +803,7 @@ exit:
 Return<int32_t> PAL::ipc_pal_stream_close(const uint64_t streamHandle)
 {
     int pid = ::android::hardware::IPCThreadState::self()->getCallingPid();
+    sp<StreamIoThread> ioThread;
 
     if (!isValidstreamHandle(streamHandle)) {
         ALOGE("%s: Invalid streamHandle: %pK", __func__, streamHandle);
@@ -660,6 +819,9 @@ Return<int32_t> PAL::ipc_pal_stream_close(const uint64_t streamHandle)
                 auto sItr = client->mActiveSessions.begin();
                 for (; sItr != client->mActiveSessions.end(); sItr++) {
                     if (sItr->session_handle == streamHandle) {
+                        /* joined below, once the client locks are dropped */
+                        ioThread = sItr->callback_binder->mIoThread;
+                        sItr->callback_binder->mIoThread.clear();
                         /*close the shared mem fds dupped in PAL server context*/
                         for (int i=0; i < sItr->callback_binder->sharedMemFdList.size(); i++) {
                              close(sItr->callback_binder->sharedMemFdList[i].second);
@@ -686,6 +848,11 @@ Return<int32_t> PAL::ipc_pal_stream_close(const uint64_t streamHandle)
     }
     mClientLock.unlock();
 
+    if (ioThread) {
+        /* a write blocked on a paused stream only returns once it is stopped */
+        pal_stream_stop((pal_stream_handle_t *)streamHandle);
+        ioThread->stop();
+    }
     Return<int32_t> status = pal_stream_close((pal_stream_handle_t *)streamHandle);
 
     return status;
@@ -1292,6 +1459,66 @@ Return<void>PAL::ipc_pal_stream_get_tags_with_module_info(PalStreamHandle stream
 }
 
 
+Return<void>PAL::ipc_pal_stream_prepare_mq(const uint64_t streamHandle,
+                               uint32_t bufferSize, uint32_t bufferCount,
+                               ipc_pal_stream_prepare_mq_cb _hidl_cb)
+{
+    int pid = ::android::hardware::IPCThreadState::self()->getCallingPid();
+    sp<SrvrClbk> session;
+    sp<StreamIoThread> ioThread;
+    int32_t ret = -EINVAL;
+
+    auto sendError = [&_hidl_cb](int32_t error) {
+        _hidl_cb(error, StreamIoThread::DataMQ::Descriptor(),
+                 StreamIoThread::IoCommandMQ::Descriptor(),
+                 StreamIoThread::IoStatusMQ::Descriptor());
+    };
+
+    if (!bufferSize || !bufferCount) {
+        ALOGE("%s: invalid buffer size %u count %u", __func__, bufferSize, bufferCount);
+        sendError(-EINVAL);
+        return Void();
+    }
+
+    mClientLock.lock();
+    for (auto& client: mPalClients) {
+        if (client->pid != pid)
+            continue;
+        std::lock_guard<std::mutex> lock(client->mActiveSessionsLock);
+        for (auto& s: client->mActiveSessions) {
+            if (s.session_handle == streamHandle) {
+                session = s.callback_binder;
+                break;
+            }
+        }
+        break;
+    }
+    mClientLock.unlock();
+
+    if (session == nullptr) {
+        ALOGE("%s: Invalid streamHandle: %pK", __func__, streamHandle);
+        sendError(-EINVAL);
+        return Void();
+    }
+    if (session->mIoThread != nullptr) {
+        ALOGE("%s: data queues already prepared for %pK", __func__, streamHandle);
+        sendError(-EALREADY);
+        return Void();
+    }
+
+    ioThread = new StreamIoThread(streamHandle, &session->session_attr.out_media_config);
+    ret = ioThread->init(bufferSize, bufferCount);
+    if (ret) {
+        sendError(ret);
+        return Void();
+    }
+    session->mIoThread = ioThread;
+    ALOGD("%s: stream %pK data queue of %u x %u bytes", __func__, streamHandle,
+          bufferCount, bufferSize);
+    _hidl_cb(0, *ioThread->getDataDesc(), *ioThread->getCommandDesc(),
+             *ioThread->getStatusDesc());
+    return Void();
+}
 
 IPAL* HIDL_FETCH_IPAL(const char* /* name */) {
     ALOGV("%s");
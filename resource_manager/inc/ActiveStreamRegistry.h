@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef ACTIVE_STREAM_REGISTRY_H
+#define ACTIVE_STREAM_REGISTRY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <unordered_map>
+#include "PalDefs.h"
+
+class Stream;
+
+/*
+ * Index of the streams registered with the resource manager. Handle
+ * validation is a hash lookup, and every stream is linked into the list of
+ * its bucket (a pal_stream_type_t) through a node owned by the registry,
+ * so adding and removing a stream is O(1) and walking a bucket neither
+ * copies nor allocates. Buckets keep registration order. Not thread safe,
+ * callers hold mActiveStreamMutex like for the lists it replaces.
+ */
+class ActiveStreamRegistry
+{
+private:
+    struct node {
+        Stream *s;
+        uint32_t bucket;
+        struct node *prev;
+        struct node *next;
+    };
+public:
+    class iterator {
+    public:
+        iterator(struct node *n) : n(n) {}
+        Stream *operator*() const { return n->s; }
+        iterator &operator++() { n = n->next; return *this; }
+        bool operator==(const iterator &other) const { return n == other.n; }
+        bool operator!=(const iterator &other) const { return n != other.n; }
+    private:
+        struct node *n;
+    };
+    class range {
+    public:
+        range(struct node *head) : head(head) {}
+        iterator begin() const { return iterator(head); }
+        iterator end() const { return iterator(nullptr); }
+    private:
+        struct node *head;
+    };
+
+    ActiveStreamRegistry();
+    int add(Stream *s, uint32_t bucket);
+    int remove(Stream *s);
+    bool contains(const void *handle) const;
+    size_t count(uint32_t bucket) const;
+    size_t size() const { return nodes.size(); }
+    /* streams of one bucket in registration order, e.g. for (Stream *s : bucket(type)) */
+    range bucket(uint32_t bucket) const;
+private:
+    struct list {
+        struct node *head;
+        struct node *tail;
+        size_t count;
+    };
+    /* node addresses are stable, unordered_map never moves its elements */
+    std::unordered_map<const void *, struct node> nodes;
+    struct list buckets[PAL_STREAM_MAX];
+};
+
+#endif //ACTIVE_STREAM_REGISTRY_H
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef FRONT_END_POOL_H
+#define FRONT_END_POOL_H
+
+#include <stdint.h>
+#include <atomic>
+#include <unordered_map>
+#include <vector>
+#include "PalDefs.h"
+
+#define FE_POOL_MAX_IDS 128
+#define FE_POOL_WORD_BITS 64
+#define FE_POOL_WORDS (FE_POOL_MAX_IDS / FE_POOL_WORD_BITS)
+
+/*
+ * Front end ids of one class (pcm playback, compress record, ...). Ids are
+ * kept sorted and a set bit in freeMask marks a free slot, allocate() takes
+ * the highest free id with a compare-exchange and release() sets the bit
+ * back, both O(1) and without a lock. The ids themselves are only written
+ * by init() and clear() while the resource manager is created/destroyed.
+ *
+ * The old per-class lists also started at the highest id but put a freed
+ * id at the back, so the most recently freed one was reused first. The
+ * pool always takes the highest free id instead.
+ *
+ * A shared pool never hands out its ids exclusively: allocate() always
+ * returns the highest id, as voice front ends are bound to the VSID and
+ * used by every stream of that call.
+ */
+class FrontEndPool
+{
+public:
+    FrontEndPool();
+    void init(std::vector<int> feIds, bool isShared = false);
+    void clear();
+    /* front end id, or -ENOSPC when the class is exhausted */
+    int allocate();
+    int release(int feId);
+    uint32_t size() const { return ids.size(); }
+    void getStats(struct pal_fe_pool_stats *stats) const;
+private:
+    void noteAllocated();
+
+    std::atomic<uint64_t> freeMask[FE_POOL_WORDS];
+    std::vector<int> ids;                   /* ascending, slot i is ids[i] */
+    std::unordered_map<int, uint32_t> slots;
+    bool shared;
+    std::atomic<uint32_t> inUse;
+    std::atomic<uint32_t> highWater;
+    std::atomic<uint32_t> exhausted;
+};
+
+#endif //FRONT_END_POOL_H
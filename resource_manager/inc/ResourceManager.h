@@ -62,6 +62,9 @@
 #include "SoundTriggerPlatformInfo.h"
 #include "SignalHandler.h"
 #include "MemLogBuilder.h"
+#include "PalInitGraph.h"
+#include "ActiveStreamRegistry.h"
+#include "FrontEndPool.h"
 
 typedef enum {
     RX_HOSTLESS = 1,
@@ -91,6 +94,9 @@ typedef enum {
 #define AUDIO_PARAMETER_KEY_HAPTICS_PRIORITY "haptics_priority"
 #define AUDIO_PARAMETER_KEY_WSA_HAPTICS "haptics_through_wsa"
 #define AUDIO_PARAMETER_KEY_DUMMY_DEV_ENABLE "dummy_dev_enable"
+#define AUDIO_PARAMETER_KEY_PARALLEL_DEVICE_SWITCH "parallel_device_switch"
+#define AUDIO_PARAMETER_KEY_GRAPH_KEEP_ALIVE_TTL "graph_keep_alive_ttl_ms"
+#define AUDIO_PARAMETER_KEY_DEBUG_DUMP_MAX_FILES "debug_dump_max_files"
 #define MAX_PCM_NAME_SIZE 50
 #define MAX_STREAM_INSTANCES (sizeof(uint64_t) << 3)
 #define MIN_USECASE_PRIORITY 0xFFFFFFFF
@@ -220,7 +226,6 @@ struct xml_userdata {
     group_dev_config_idx_t group_dev_idx;
     resource_xml_tags_t tag;
     bool inCustomConfig;
-    XML_Parser parser;
 };
 
 typedef enum {
@@ -478,8 +483,8 @@ private:
     void getHigherPriorityActiveStreams(const int inComingStreamPriority,
                                         std::vector<Stream*> &activestreams,
                                         std::vector<T> sourcestreams);
-    const std::vector<int> allocateVoiceFrontEndIds(std::vector<int> listAllPcmVoiceFrontEnds,
-                                  const int howMany);
+    pal_fe_pool_t getFrontEndPool(const struct pal_stream_attributes &sAttr,
+                                  int lDirection) const;
     int getDeviceDefaultCapability(pal_param_device_capability_t capability);
 
     int handleScreenStatusChange(pal_param_screen_state_t screen_state);
@@ -490,6 +495,7 @@ private:
     int32_t streamDevConnect(std::vector <std::tuple<Stream *, struct pal_device *>> streamDevConnectList);
     int32_t streamDevDisconnect_l(std::vector <std::tuple<Stream *, uint32_t>> streamDevDisconnectList);
     int32_t streamDevConnect_l(std::vector <std::tuple<Stream *, struct pal_device *>> streamDevConnectList);
+    void waitForMuteDrain(std::vector <Stream *> &mutedStreams, uint32_t maxLatencyMs);
     void ssrHandlingLoop(std::shared_ptr<ResourceManager> rm);
     int updateECDeviceMap(std::shared_ptr<Device> rx_dev,
                         std::shared_ptr<Device> tx_dev,
@@ -510,23 +516,11 @@ private:
     bool checkDeviceSwitchForHaptics(struct pal_device *inDevAttr, struct pal_device *curDevAttr);
 protected:
     std::list <Stream*> mActiveStreams;
-    std::list <StreamPCM*> active_streams_ll;
-    std::list <StreamPCM*> active_streams_ulla;
-    std::list <StreamPCM*> active_streams_ull;
-    std::list <StreamPCM*> active_streams_db;
-    std::list <StreamPCM*> active_streams_sa;
-    std::list <StreamPCM*> active_streams_po;
-    std::list <StreamPCM*> active_streams_proxy;
-    std::list <StreamPCM*> active_streams_haptics;
-    std::list <StreamPCM*> active_streams_raw;
-    std::list <StreamPCM*> active_streams_voice_rec;
-    std::list <StreamInCall*> active_streams_incall_record;
-    std::list <StreamNonTunnel*> active_streams_non_tunnel;
-    std::list <StreamInCall*> active_streams_incall_music;
-    std::list <StreamCompress*> active_streams_comp;
+    /* every registered stream, by handle and by type */
+    ActiveStreamRegistry mStreamRegistry;
+    /* typed lists for the stream classes RM drives directly */
     std::list <StreamSoundTrigger*> active_streams_st;
     std::list <StreamACD*> active_streams_acd;
-    std::list <StreamUltraSound*> active_streams_ultrasound;
     std::list <StreamSensorPCMData*> active_streams_sensor_pcm_data;
     std::list <StreamContextProxy*> active_streams_context_proxy;
     std::list <StreamCommonProxy*> active_streams_afs;
@@ -548,7 +542,6 @@ protected:
     static std::mutex mGraphMutex;
     static std::mutex mActiveStreamMutex;
     static std::mutex mSleepMonitorMutex;
-    static std::mutex mListFrontEndsMutex;
     static int snd_virt_card;
     static int snd_hw_card;
 
@@ -564,22 +557,7 @@ protected:
     static std::vector<std::pair<int32_t, int32_t>> devicePcmId;
     static std::vector<std::pair<int32_t, std::string>> deviceLinkName;
     static std::vector<int> listAllFrontEndIds;
-    static std::vector<int> listAllPcmPlaybackFrontEnds;
-    static std::vector<int> listAllPcmRecordFrontEnds;
-    static std::vector<int> listAllPcmHostlessRxFrontEnds;
-    static std::vector<int> listAllNonTunnelSessionIds;
-    static std::vector<int> listAllPcmHostlessTxFrontEnds;
-    static std::vector<int> listAllCompressPlaybackFrontEnds;
-    static std::vector<int> listAllCompressRecordFrontEnds;
-    static std::vector<int> listFreeFrontEndIds;
-    static std::vector<int> listAllPcmVoice1RxFrontEnds;
-    static std::vector<int> listAllPcmVoice1TxFrontEnds;
-    static std::vector<int> listAllPcmVoice2RxFrontEnds;
-    static std::vector<int> listAllPcmVoice2TxFrontEnds;
-    static std::vector<int> listAllPcmExtEcTxFrontEnds;
-    static std::vector<int> listAllPcmInCallRecordFrontEnds;
-    static std::vector<int> listAllPcmInCallMusicFrontEnds;
-    static std::vector<int> listAllPcmContextProxyFrontEnds;
+    static FrontEndPool fePools[PAL_FE_POOL_MAX];
     static std::vector<std::pair<int32_t, std::string>> listAllBackEndIds;
     static std::vector<std::pair<int32_t, std::string>> sndDeviceNameLUT;
     static std::vector<deviceCap> devInfo;
@@ -657,6 +635,7 @@ public:
     static bool isXPANEnabled;
     static bool isCRSCallEnabled;
     static bool isDummyDevEnabled;
+    static bool isParallelDevSwitchEnabled;
     static bool isProxyRecordActive;
     static std::mutex mChargerBoostMutex;
     /* Variable to store which speaker side is being used for call audio.
@@ -719,6 +698,13 @@ public:
     adm_request_focus_v2_1_t  admRequestFocus_v2_1Fn = NULL;
     void *admData = NULL;
     void *admLibHdl = NULL;
+    /* ADM, charger listener, voiceui dmgr and AFS are loaded on first use */
+    std::once_flag admLibOnce;
+    std::once_flag streamPluginsOnce;
+    std::once_flag vuiDmgrOnce;
+    PalInitGraph initGraph;
+    int runInitStage(const std::string &name, PalInitGraph::stage_fn_t fn);
+    void loadStreamPlugins(pal_stream_type_t type);
     static void *cl_lib_handle;
     static cl_init_t cl_init;
     static cl_deinit_t cl_deinit;
@@ -759,6 +745,7 @@ public:
     int getMaxVoiceVol();
     void getChannelMap(uint8_t *channel_map, int channels);
     pal_audio_fmt_t getAudioFmt(uint32_t bitWidth);
+    static uint32_t getRegistryBucket(pal_stream_type_t type);
     int registerStream(Stream *s);
     int deregisterStream(Stream *s);
     int isActiveStream(pal_stream_handle_t *handle);
@@ -792,6 +779,7 @@ public:
                                 char* file_name_extn_wo_variant);
     int init_audio();
     void loadAdmLib();
+    void openAdmLib();
     static int init();
     static void deinit();
     static std::shared_ptr<ResourceManager> getInstance();
@@ -981,6 +969,9 @@ public:
     static int setHapticsDrivenParam(struct str_parms *parms,char *value, int len);
     static void setXPANEnableParam(struct str_parms *parms,char *value, int len);
     static void setDummyDevEnableParam(struct str_parms *parms,char *value, int len);
+    static void setParallelDevSwitchParam(struct str_parms *parms,char *value, int len);
+    static void setGraphKeepAliveParam(struct str_parms *parms,char *value, int len);
+    static void setDebugDumpMaxFilesParam(struct str_parms *parms,char *value, int len);
     static bool isLpiLoggingEnabled();
     static void processConfigParams(const XML_Char **attr);
     static bool isValidDevId(int deviceId);
@@ -1041,6 +1032,8 @@ public:
     int getStreamInstanceID(Stream *str);
     int resetStreamInstanceID(Stream *str);
     int resetStreamInstanceID(Stream *str, uint32_t sInstanceID);
+    /* for instances owned by a parked graph rather than a stream */
+    void releaseStreamInstanceID(pal_stream_type_t type, uint32_t sInstanceID);
     static void setGaplessMode(const XML_Char **attr);
     static int initWakeLocks(void);
     static void deInitWakeLocks(void);
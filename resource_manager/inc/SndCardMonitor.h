@@ -30,6 +30,8 @@
 #ifndef SNDCARD_MONITOR_H
 #define SNDCARD_MONITOR_H
 #include <list>
+#include <mutex>
+#include <thread>
 #include "PalDefs.h"
 
 typedef struct {
@@ -38,15 +40,39 @@ typedef struct {
     card_status_t status;
 } sndcard_t;
 
+/*
+ * The card state node and the ALSA control nodes show up while the audio
+ * kernel modules load. Neither sysfs nor procfs raise inotify events, the
+ * wait for them is woken by nodes created in /dev/snd instead and falls
+ * back to a short, growing poll timeout.
+ *
+ * Every state change read from the card state node is kept with the time
+ * it was seen, picked up and handled by the ssr handling loop.
+ */
 class SndCardMonitor
 {
 private :
     std::thread mThread;
     void monitorThreadLoop();
+    static void noteTransition(card_status_t state);
+
+    static std::mutex transitionMutex;
+    static pal_param_snd_card_transitions_t transitions;   /* ring indexed by seq */
 
 public :
     SndCardMonitor(int sndNum);
     ~SndCardMonitor();
+
+    /* inotify fd watching node creation in /dev/snd, < 0 on failure */
+    static int openSndNodeWatch();
+    /*
+     * Waits up to timeoutMs for a node to be created in /dev/snd. exitFd is
+     * polled as well, returns -EINTR when it was signalled.
+     */
+    static int waitSndNodes(int watchFd, int exitFd, int timeoutMs);
+    static void noteDispatched(card_status_t state);
+    static void noteHandled(card_status_t state);
+    static void getTransitions(pal_param_snd_card_transitions_t *out);
 };
 
 #endif
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef SSR_RECOVERY_SCHEDULER_H
+#define SSR_RECOVERY_SCHEDULER_H
+
+#include <stdint.h>
+#include <functional>
+#include <mutex>
+#include <vector>
+#include "PalDefs.h"
+
+#define SSR_RECOVERY_MAX_WORKERS 4
+
+class Stream;
+
+/* restore order after ssr, lower classes first */
+typedef enum {
+    SSR_RECOVERY_VOICE = 0,     /* restored before anything else starts */
+    SSR_RECOVERY_LOW_LATENCY,
+    SSR_RECOVERY_PLAYBACK,
+    SSR_RECOVERY_CAPTURE,
+    SSR_RECOVERY_DETECTION,     /* sound trigger, ACD, ... one at a time */
+} ssr_recovery_class_t;
+
+/*
+ * Runs the ssr up handling of the active streams on up to
+ * SSR_RECOVERY_MAX_WORKERS threads, highest priority first. Voice streams
+ * are restored before any other stream starts so a call does not compete
+ * with the rest for the DSP. Detection streams share engines and capture
+ * profiles and used to rely on the active stream lock for ordering, they
+ * are still restored one after the other.
+ *
+ * Each handler runs with handlerLock held by its worker. The ssr up
+ * handlers drop the active stream lock around start(), which is where
+ * the streams actually overlap, so the caller must not hold handlerLock
+ * during run: a std::mutex has to be unlocked by the thread that owns it.
+ *
+ * report is called on the calling thread as streams complete.
+ */
+class SsrRecoveryScheduler
+{
+public:
+    typedef std::function<int32_t(Stream *)> handler_t;
+    typedef std::function<void(Stream *, struct pal_ssr_stream_recovery *)> report_t;
+
+    static void run(const std::vector<Stream *> &streams, std::mutex *handlerLock,
+                    handler_t handler, report_t report,
+                    struct pal_ssr_recovery_done *done);
+    static ssr_recovery_class_t getClass(Stream *s);
+};
+
+#endif //SSR_RECOVERY_SCHEDULER_H
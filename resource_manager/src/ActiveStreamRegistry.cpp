@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#define LOG_TAG "PAL: ActiveStreamRegistry"
+
+#include <errno.h>
+#include <string.h>
+#include "ActiveStreamRegistry.h"
+#include "PalCommon.h"
+
+ActiveStreamRegistry::ActiveStreamRegistry()
+{
+    memset(buckets, 0, sizeof(buckets));
+}
+
+int ActiveStreamRegistry::add(Stream *s, uint32_t bucket)
+{
+    struct node *n = NULL;
+    struct list *l = NULL;
+
+    if (!s || bucket >= PAL_STREAM_MAX) {
+        PAL_ERR(LOG_TAG, "invalid stream %pK or bucket %u", s, bucket);
+        return -EINVAL;
+    }
+    auto res = nodes.emplace(s, node{s, bucket, NULL, NULL});
+    if (!res.second) {
+        PAL_ERR(LOG_TAG, "stream %pK already registered", s);
+        return -EEXIST;
+    }
+
+    n = &res.first->second;
+    l = &buckets[bucket];
+    n->prev = l->tail;
+    if (l->tail)
+        l->tail->next = n;
+    else
+        l->head = n;
+    l->tail = n;
+    l->count++;
+    return 0;
+}
+
+int ActiveStreamRegistry::remove(Stream *s)
+{
+    auto it = nodes.find(s);
+    struct node *n = NULL;
+    struct list *l = NULL;
+
+    if (it == nodes.end())
+        return -ENOENT;
+
+    n = &it->second;
+    l = &buckets[n->bucket];
+    if (n->prev)
+        n->prev->next = n->next;
+    else
+        l->head = n->next;
+    if (n->next)
+        n->next->prev = n->prev;
+    else
+        l->tail = n->prev;
+    l->count--;
+    nodes.erase(it);
+    return 0;
+}
+
+bool ActiveStreamRegistry::contains(const void *handle) const
+{
+    return handle && nodes.find(handle) != nodes.end();
+}
+
+size_t ActiveStreamRegistry::count(uint32_t bucket) const
+{
+    if (bucket >= PAL_STREAM_MAX)
+        return 0;
+    return buckets[bucket].count;
+}
+
+ActiveStreamRegistry::range ActiveStreamRegistry::bucket(uint32_t bucket) const
+{
+    if (bucket >= PAL_STREAM_MAX)
+        return range(NULL);
+    return range(buckets[bucket].head);
+}
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#define LOG_TAG "PAL: FrontEndPool"
+
+#include <errno.h>
+#include <algorithm>
+#include "FrontEndPool.h"
+#include "PalCommon.h"
+
+FrontEndPool::FrontEndPool() : shared(false), inUse(0), highWater(0), exhausted(0)
+{
+    for (int w = 0; w < FE_POOL_WORDS; w++)
+        freeMask[w].store(0);
+}
+
+void FrontEndPool::init(std::vector<int> feIds, bool isShared)
+{
+    clear();
+    std::sort(feIds.begin(), feIds.end());
+    feIds.erase(std::unique(feIds.begin(), feIds.end()), feIds.end());
+    if (feIds.size() > FE_POOL_MAX_IDS) {
+        PAL_ERR(LOG_TAG, "%zu front ends configured, only %d are used",
+                feIds.size(), FE_POOL_MAX_IDS);
+        /* keep the highest ids, they are the ones handed out first */
+        feIds.erase(feIds.begin(), feIds.end() - FE_POOL_MAX_IDS);
+    }
+
+    ids = feIds;
+    shared = isShared;
+    for (uint32_t i = 0; i < ids.size(); i++) {
+        slots[ids[i]] = i;
+        freeMask[i / FE_POOL_WORD_BITS].fetch_or(1ULL << (i % FE_POOL_WORD_BITS));
+    }
+}
+
+void FrontEndPool::clear()
+{
+    for (int w = 0; w < FE_POOL_WORDS; w++)
+        freeMask[w].store(0);
+    ids.clear();
+    slots.clear();
+    inUse.store(0);
+    highWater.store(0);
+    exhausted.store(0);
+}
+
+void FrontEndPool::noteAllocated()
+{
+    uint32_t n = inUse.fetch_add(1, std::memory_order_relaxed) + 1;
+    uint32_t hwm = highWater.load(std::memory_order_relaxed);
+
+    while (n > hwm &&
+           !highWater.compare_exchange_weak(hwm, n, std::memory_order_relaxed))
+        ;
+}
+
+int FrontEndPool::allocate()
+{
+    uint64_t mask = 0;
+    int bit = 0;
+
+    if (shared && !ids.empty()) {
+        noteAllocated();
+        return ids.back();
+    }
+
+    for (int w = FE_POOL_WORDS - 1; w >= 0; w--) {
+        mask = freeMask[w].load(std::memory_order_acquire);
+        while (mask) {
+            bit = FE_POOL_WORD_BITS - 1 - __builtin_clzll(mask);
+            if (freeMask[w].compare_exchange_weak(mask, mask & ~(1ULL << bit),
+                                                  std::memory_order_acq_rel,
+                                                  std::memory_order_acquire)) {
+                noteAllocated();
+                return ids[w * FE_POOL_WORD_BITS + bit];
+            }
+        }
+    }
+
+    exhausted.fetch_add(1, std::memory_order_relaxed);
+    return -ENOSPC;
+}
+
+int FrontEndPool::release(int feId)
+{
+    uint32_t slot = 0;
+    uint64_t bit = 0;
+    uint32_t n = 0;
+
+    auto it = slots.find(feId);
+    if (it == slots.end()) {
+        PAL_ERR(LOG_TAG, "front end %d is not in this pool", feId);
+        return -EINVAL;
+    }
+
+    if (!shared) {
+        slot = it->second;
+        bit = 1ULL << (slot % FE_POOL_WORD_BITS);
+        if (freeMask[slot / FE_POOL_WORD_BITS].fetch_or(bit, std::memory_order_acq_rel) & bit) {
+            PAL_ERR(LOG_TAG, "front end %d freed twice", feId);
+            return -EALREADY;
+        }
+    }
+
+    n = inUse.load(std::memory_order_relaxed);
+    while (n && !inUse.compare_exchange_weak(n, n - 1, std::memory_order_relaxed))
+        ;
+    return 0;
+}
+
+void FrontEndPool::getStats(struct pal_fe_pool_stats *stats) const
+{
+    stats->capacity = ids.size();
+    stats->in_use = inUse.load(std::memory_order_relaxed);
+    stats->high_water = highWater.load(std::memory_order_relaxed);
+    stats->exhausted = exhausted.load(std::memory_order_relaxed);
+}
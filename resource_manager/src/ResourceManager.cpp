@@ -75,9 +75,17 @@
 #include "UltrasoundDevice.h"
 #include "ECRefDevice.h"
 #include "HapticsDev.h"
+#include "MixerCtlCache.h"
+#include "MixerTransaction.h"
+#include "SessionPool.h"
+#include "PalTrace.h"
+#include "PalDumpWriter.h"
+#include "BtCodecPluginCache.h"
+#include "SsrRecoveryScheduler.h"
 #include "HapticsDevProtection.h"
 #include "AudioHapticsInterface.h"
 #include "VUIInterfaceProxy.h"
+#include "PalXmlSnapshot.h"
 #include "kvh2xml.h"
 
 #ifndef PAL_CUTILS_UNSUPPORTED
@@ -117,6 +125,7 @@
 #define RMNGR_XMLFILE_BASE_STRING_NAME "resourcemanager"
 
 #define MAX_RETRY_CNT 20
+#define MIXER_OPEN_RETRY_MS 1000
 #define LOWLATENCY_PCM_DEVICE 15
 #define DEEP_BUFFER_PCM_DEVICE 0
 #define DEVICE_NAME_MAX_SIZE 128
@@ -460,24 +469,8 @@ std::mutex ResourceManager::mChargerBoostMutex;
 std::mutex ResourceManager::mGraphMutex;
 std::mutex ResourceManager::mActiveStreamMutex;
 std::mutex ResourceManager::mSleepMonitorMutex;
-std::mutex ResourceManager::mListFrontEndsMutex;
 std::vector <int> ResourceManager::listAllFrontEndIds = {0};
-std::vector <int> ResourceManager::listFreeFrontEndIds = {0};
-std::vector <int> ResourceManager::listAllPcmPlaybackFrontEnds = {0};
-std::vector <int> ResourceManager::listAllPcmRecordFrontEnds = {0};
-std::vector <int> ResourceManager::listAllPcmHostlessRxFrontEnds = {0};
-std::vector <int> ResourceManager::listAllPcmHostlessTxFrontEnds = {0};
-std::vector <int> ResourceManager::listAllPcmExtEcTxFrontEnds = {0};
-std::vector <int> ResourceManager::listAllCompressPlaybackFrontEnds = {0};
-std::vector <int> ResourceManager::listAllCompressRecordFrontEnds = {0};
-std::vector <int> ResourceManager::listAllPcmVoice1RxFrontEnds = {0};
-std::vector <int> ResourceManager::listAllPcmVoice1TxFrontEnds = {0};
-std::vector <int> ResourceManager::listAllPcmVoice2RxFrontEnds = {0};
-std::vector <int> ResourceManager::listAllPcmVoice2TxFrontEnds = {0};
-std::vector <int> ResourceManager::listAllPcmInCallRecordFrontEnds = {0};
-std::vector <int> ResourceManager::listAllPcmInCallMusicFrontEnds = {0};
-std::vector <int> ResourceManager::listAllNonTunnelSessionIds = {0};
-std::vector <int> ResourceManager::listAllPcmContextProxyFrontEnds = {0};
+FrontEndPool ResourceManager::fePools[PAL_FE_POOL_MAX];
 std::vector <std::string> ResourceManager::usb_vendor_uuid_list = {""};
 struct audio_mixer* ResourceManager::audio_virt_mixer = NULL;
 struct audio_mixer* ResourceManager::audio_hw_mixer = NULL;
@@ -542,6 +535,7 @@ bool ResourceManager::isUPDVirtualPortEnabled = false;
 bool ResourceManager::isUpdSetCustomGainEnabled = false;
 bool ResourceManager::isXPANEnabled = false;
 bool ResourceManager::isDummyDevEnabled = false;
+bool ResourceManager::isParallelDevSwitchEnabled = false;
 bool ResourceManager::isProxyRecordActive = false;
 int ResourceManager::max_voice_vol = -1;     /* Variable to store max volume index for voice call */
 bool ResourceManager::isSignalHandlerEnabled = false;
@@ -696,7 +690,7 @@ int32_t ResourceManager::secureZoneEventCb(const uint32_t peripheral,
 
     PAL_INFO(LOG_TAG,"Received Notification from TZ... secureState: %d", secureState);
 
-    ctl = mixer_get_ctl_by_name(audio_hw_mixer, "VOTE Against Sleep");
+    ctl = MixerCtlCache::getCtl(audio_hw_mixer, "VOTE Against Sleep");
     if (!ctl) {
        PAL_ERR(LOG_TAG, "Invalid mixer control: VOTE Against Sleep");
        return -ENOENT;
@@ -870,24 +864,66 @@ ResourceManager::ResourceManager()
         PAL_ERR(LOG_TAG, "error in initializing KPI queue %d", ret);
     }
 #endif
-    ret = ResourceManager::XmlParser(SNDPARSER);
-    if (ret) {
-        PAL_ERR(LOG_TAG, "error in snd xml parsing ret %d", ret);
-    }
+    /*
+     * The card, audio route and resource manager xml form a chain, the
+     * usecase kv xml and wake lock nodes do not depend on it and are
+     * brought up in parallel. Stages report errors by status,
+     * the exceptions are raised here once every worker has been joined.
+     */
+    initGraph.addStage("snd_card_xml", [] {
+        int status = ResourceManager::XmlParser(SNDPARSER);
+        if (status)
+            PAL_ERR(LOG_TAG, "error in snd xml parsing ret %d", status);
+        return 0;
+    });
+    initGraph.addStage("audio_route", [this] {
+        int status = init_audio();
+        if (status)
+            PAL_ERR(LOG_TAG, "error in init audio route and audio mixer ret %d", status);
+        return status;
+    }, {"snd_card_xml"});
+    initGraph.addStage("rm_xml", [this] {
+        int status = 0;
+
+        cardState = CARD_STATUS_ONLINE;
+        status = ResourceManager::XmlParser(rmngr_xml_file);
+        if (status == -ENOENT) // try resourcemanager xml without variant name
+            status = ResourceManager::XmlParser(rmngr_xml_file_wo_variant);
+        if (status)
+            PAL_ERR(LOG_TAG, "error in resource xml parsing ret %d", status);
+        return status;
+    }, {"audio_route"});
+    initGraph.addStage("usecase_kv_xml", [] {
+        int status = PayloadBuilder::init();
+        if (status)
+            PAL_ERR(LOG_TAG, "Failed to parse usecase manager xml ret %d", status);
+        else
+            PAL_INFO(LOG_TAG, "usecase manager xml parsing successful");
+        return status;
+    });
+    initGraph.addStage("haptics_xml", [] {
+        int status = 0;
 
-    ret = ResourceManager::init_audio();
-    if (ret) {
-        PAL_ERR(LOG_TAG, "error in init audio route and audio mixer ret %d", ret);
-        throw std::runtime_error("error in init audio route and audio mixer");
-    }
+        if (!ResourceManager::isHapticsthroughWSA)
+            return 0;
+        status = AudioHapticsInterface::init();
+        if (status)
+            PAL_ERR(LOG_TAG, "Failed to parse hapticsconfig xml ret %d", status);
+        else
+            PAL_INFO(LOG_TAG, "hapticsconfig xml parsing successful");
+        return status;
+    }, {"rm_xml"});
+    initGraph.addStage("wake_locks", [] {
+        ResourceManager::initWakeLocks();
+        return 0;
+    });
 
-    cardState = CARD_STATUS_ONLINE;
-    ret = ResourceManager::XmlParser(rmngr_xml_file);
-    if (ret == -ENOENT) // try resourcemanager xml without variant name
-        ret = ResourceManager::XmlParser(rmngr_xml_file_wo_variant);
+    ret = initGraph.run();
     if (ret) {
-        PAL_ERR(LOG_TAG, "error in resource xml parsing ret %d", ret);
-        throw std::runtime_error("error in resource xml parsing");
+        std::string stage = initGraph.getFailedStage();
+
+        PAL_ERR(LOG_TAG, "init stage %s failed ret %d", stage.c_str(), ret);
+        throw std::runtime_error("error in init stage " + stage);
     }
 
     if (IsVirtualPortForUPDEnabled()) {
@@ -924,23 +960,8 @@ ResourceManager::ResourceManager()
     if (sleepmon_fd_ == -1)
         PAL_ERR(LOG_TAG, "Failed to open ADSP sleep monitor file");
 #endif
+    std::vector<int> feIds[PAL_FE_POOL_MAX];
     listAllFrontEndIds.clear();
-    listFreeFrontEndIds.clear();
-    listAllPcmPlaybackFrontEnds.clear();
-    listAllPcmRecordFrontEnds.clear();
-    listAllPcmHostlessRxFrontEnds.clear();
-    listAllNonTunnelSessionIds.clear();
-    listAllPcmHostlessTxFrontEnds.clear();
-    listAllCompressPlaybackFrontEnds.clear();
-    listAllCompressRecordFrontEnds.clear();
-    listAllPcmVoice1RxFrontEnds.clear();
-    listAllPcmVoice1TxFrontEnds.clear();
-    listAllPcmVoice2RxFrontEnds.clear();
-    listAllPcmVoice2TxFrontEnds.clear();
-    listAllPcmInCallRecordFrontEnds.clear();
-    listAllPcmInCallMusicFrontEnds.clear();
-    listAllPcmContextProxyFrontEnds.clear();
-    listAllPcmExtEcTxFrontEnds.clear();
     memset(stream_instances, 0, PAL_STREAM_MAX * sizeof(uint64_t));
     memset(in_stream_instances, 0, PAL_STREAM_MAX * sizeof(uint64_t));
 
@@ -948,43 +969,43 @@ ResourceManager::ResourceManager()
 
         if (devInfo[i].type == PCM) {
             if (devInfo[i].sess_mode == HOSTLESS && devInfo[i].playback == 1) {
-                listAllPcmHostlessRxFrontEnds.push_back(devInfo[i].deviceId);
+                feIds[PAL_FE_POOL_PCM_HOSTLESS_RX].push_back(devInfo[i].deviceId);
             } else if (devInfo[i].sess_mode == HOSTLESS && devInfo[i].record == 1) {
-                listAllPcmHostlessTxFrontEnds.push_back(devInfo[i].deviceId);
+                feIds[PAL_FE_POOL_PCM_HOSTLESS_TX].push_back(devInfo[i].deviceId);
             } else if (devInfo[i].playback == 1 && devInfo[i].sess_mode == DEFAULT) {
-                listAllPcmPlaybackFrontEnds.push_back(devInfo[i].deviceId);
+                feIds[PAL_FE_POOL_PCM_PLAYBACK].push_back(devInfo[i].deviceId);
             } else if (devInfo[i].record == 1 && devInfo[i].sess_mode == DEFAULT) {
-                listAllPcmRecordFrontEnds.push_back(devInfo[i].deviceId);
+                feIds[PAL_FE_POOL_PCM_RECORD].push_back(devInfo[i].deviceId);
             } else if (devInfo[i].sess_mode == NON_TUNNEL && devInfo[i].record == 1) {
-                listAllPcmInCallRecordFrontEnds.push_back(devInfo[i].deviceId);
+                feIds[PAL_FE_POOL_INCALL_RECORD].push_back(devInfo[i].deviceId);
             } else if (devInfo[i].sess_mode == NON_TUNNEL && devInfo[i].playback == 1) {
-                listAllPcmInCallMusicFrontEnds.push_back(devInfo[i].deviceId);
+                feIds[PAL_FE_POOL_INCALL_MUSIC].push_back(devInfo[i].deviceId);
             } else if (devInfo[i].sess_mode == NO_CONFIG && devInfo[i].record == 1) {
-                listAllPcmContextProxyFrontEnds.push_back(devInfo[i].deviceId);
+                feIds[PAL_FE_POOL_CONTEXT_PROXY].push_back(devInfo[i].deviceId);
             }
         } else if (devInfo[i].type == COMPRESS) {
             if (devInfo[i].playback == 1) {
-                listAllCompressPlaybackFrontEnds.push_back(devInfo[i].deviceId);
+                feIds[PAL_FE_POOL_COMPRESS_PLAYBACK].push_back(devInfo[i].deviceId);
             } else if (devInfo[i].record == 1) {
-                listAllCompressRecordFrontEnds.push_back(devInfo[i].deviceId);
+                feIds[PAL_FE_POOL_COMPRESS_RECORD].push_back(devInfo[i].deviceId);
             }
         } else if (devInfo[i].type == VOICE1) {
             if (devInfo[i].sess_mode == HOSTLESS && devInfo[i].playback == 1) {
-                listAllPcmVoice1RxFrontEnds.push_back(devInfo[i].deviceId);
+                feIds[PAL_FE_POOL_VOICE1_RX].push_back(devInfo[i].deviceId);
             }
             if (devInfo[i].sess_mode == HOSTLESS && devInfo[i].record == 1) {
-                listAllPcmVoice1TxFrontEnds.push_back(devInfo[i].deviceId);
+                feIds[PAL_FE_POOL_VOICE1_TX].push_back(devInfo[i].deviceId);
             }
         } else if (devInfo[i].type == VOICE2) {
             if (devInfo[i].sess_mode == HOSTLESS && devInfo[i].playback == 1) {
-                listAllPcmVoice2RxFrontEnds.push_back(devInfo[i].deviceId);
+                feIds[PAL_FE_POOL_VOICE2_RX].push_back(devInfo[i].deviceId);
             }
             if (devInfo[i].sess_mode == HOSTLESS && devInfo[i].record == 1) {
-                listAllPcmVoice2TxFrontEnds.push_back(devInfo[i].deviceId);
+                feIds[PAL_FE_POOL_VOICE2_TX].push_back(devInfo[i].deviceId);
             }
         } else if (devInfo[i].type == ExtEC) {
             if (devInfo[i].sess_mode == HOSTLESS && devInfo[i].record == 1) {
-                listAllPcmExtEcTxFrontEnds.push_back(devInfo[i].deviceId);
+                feIds[PAL_FE_POOL_EXT_EC_TX].push_back(devInfo[i].deviceId);
             }
         }
         /*We create a master list of all the frontends*/
@@ -999,13 +1020,12 @@ ResourceManager::ResourceManager()
      sort(listAllFrontEndIds.rbegin(), listAllFrontEndIds.rend());
      int maxDeviceIdInUse = listAllFrontEndIds.at(0);
      for (int i = 0; i < max_nt_sessions; i++)
-          listAllNonTunnelSessionIds.push_back(maxDeviceIdInUse + i);
+          feIds[PAL_FE_POOL_NON_TUNNEL].push_back(maxDeviceIdInUse + i);
 
-    // Get AGM service handle
-    ret = agm_register_service_crash_callback(&agmServiceCrashHandler,
-                                               (uint64_t)this);
-    if (ret) {
-        PAL_ERR(LOG_TAG, "AGM service not up%d", ret);
+    for (int i = 0; i < PAL_FE_POOL_MAX; i++) {
+        /* voice front ends belong to the VSID, see FrontEndPool */
+        fePools[i].init(feIds[i], i == PAL_FE_POOL_VOICE1_RX || i == PAL_FE_POOL_VOICE1_TX ||
+                        i == PAL_FE_POOL_VOICE2_RX || i == PAL_FE_POOL_VOICE2_TX);
     }
 
     auto encodeMap = std::make_shared<std::unordered_map<uint32_t, bool>>();
@@ -1013,24 +1033,6 @@ ResourceManager::ResourceManager()
     mNTStreamInstancesList[NT_PATH_ENCODE] = encodeMap;
     mNTStreamInstancesList[NT_PATH_DECODE] = decodeMap;
 
-    ResourceManager::loadAdmLib();
-    ResourceManager::initWakeLocks();
-    ret = PayloadBuilder::init();
-    if (ret) {
-        throw std::runtime_error("Failed to parse usecase manager xml");
-    } else {
-        PAL_INFO(LOG_TAG, "usecase manager xml parsing successful");
-    }
-
-    if (ResourceManager::isHapticsthroughWSA) {
-        ret = AudioHapticsInterface::init();
-        if (ret) {
-            throw std::runtime_error("Failed to parse hapticsconfig xml");
-        } else {
-            PAL_INFO(LOG_TAG, "hapticsconfig xml parsing successful");
-        }
-    }
-
     PAL_DBG(LOG_TAG, "Creating ContextManager");
     ctxMgr = new ContextManager();
     if (!ctxMgr) {
@@ -1075,19 +1077,8 @@ ResourceManager::~ResourceManager()
     deviceTag.clear();
 
     listAllFrontEndIds.clear();
-    listAllPcmPlaybackFrontEnds.clear();
-    listAllPcmRecordFrontEnds.clear();
-    listAllPcmHostlessRxFrontEnds.clear();
-    listAllPcmHostlessTxFrontEnds.clear();
-    listAllCompressPlaybackFrontEnds.clear();
-    listAllCompressRecordFrontEnds.clear();
-    listFreeFrontEndIds.clear();
-    listAllPcmVoice1RxFrontEnds.clear();
-    listAllPcmVoice1TxFrontEnds.clear();
-    listAllPcmVoice2RxFrontEnds.clear();
-    listAllPcmVoice2TxFrontEnds.clear();
-    listAllNonTunnelSessionIds.clear();
-    listAllPcmExtEcTxFrontEnds.clear();
+    for (int i = 0; i < PAL_FE_POOL_MAX; i++)
+        fePools[i].clear();
     usb_vendor_uuid_list.clear();
     devInfo.clear();
     deviceInfo.clear();
@@ -1209,6 +1200,16 @@ void ResourceManager::loadSocPeripheralLib()
 #endif
 
 void ResourceManager::loadAdmLib()
+{
+    std::call_once(admLibOnce, [this] {
+        runInitStage("adm_lib", [this] {
+            openAdmLib();
+            return 0;
+        });
+    });
+}
+
+void ResourceManager::openAdmLib()
 {
     if (access(ADM_LIBRARY_PATH, R_OK) == 0) {
         admLibHdl = dlopen(ADM_LIBRARY_PATH, RTLD_NOW);
@@ -1352,6 +1353,8 @@ void ResourceManager::ssrHandlingLoop(std::shared_ptr<ResourceManager> rm)
     uint32_t eventData;
     pal_global_callback_event_t event;
     pal_stream_type_t type;
+    std::vector<Stream *> recovering;
+    struct pal_ssr_recovery_done recoveryDone;
 
     PAL_VERBOSE(LOG_TAG,"ssr Handling thread started");
 
@@ -1366,10 +1369,17 @@ void ResourceManager::ssrHandlingLoop(std::shared_ptr<ResourceManager> rm)
                                state, prevState, rm->mActiveStreams.size());
             if (state == CARD_STATUS_NONE)
                 break;
+            SndCardMonitor::noteDispatched(state);
 
             mActiveStreamMutex.lock();
             rm->cardState = state;
             if (state != prevState) {
+                /* controls are resolved again against the restarted card */
+                MixerCtlCache::invalidate();
+                MixerTransaction::invalidate();
+                /* parked graphs do not survive the restart */
+                if (PAL_CARD_STATUS_DOWN(state))
+                    SessionPool::flush();
                 if (rm->globalCb) {
                     PAL_DBG(LOG_TAG, "Notifying client about sound card state %d global cb %pK",
                                       rm->cardState, rm->globalCb);
@@ -1401,6 +1411,7 @@ void ResourceManager::ssrHandlingLoop(std::shared_ptr<ResourceManager> rm)
             } else if (state == prevState) {
                 PAL_INFO(LOG_TAG, "%d state already handled", state);
             } else if (PAL_CARD_STATUS_DOWN(state)) {
+                PAL_TRACE_SPAN_ARG("ssr_down", rm->mActiveStreams.size());
                 for (auto str: rm->mActiveStreams) {
                     ret = increaseStreamUserCounter(str);
                     if (0 != ret) {
@@ -1433,6 +1444,7 @@ void ResourceManager::ssrHandlingLoop(std::shared_ptr<ResourceManager> rm)
                 }
                 prevState = state;
             } else if (PAL_CARD_STATUS_UP(state)) {
+                PAL_TRACE_SPAN_ARG("ssr_up", rm->mActiveStreams.size());
                 if (isContextManagerEnabled) {
                     mActiveStreamMutex.unlock();
                     ret = ctxMgr->ssrUpHandler();
@@ -1443,27 +1455,48 @@ void ResourceManager::ssrHandlingLoop(std::shared_ptr<ResourceManager> rm)
                 }
 
                 SoundTriggerCaptureProfile = GetCaptureProfileByPriority(nullptr);
+                /*
+                 * user counters are only touched on this thread and keep
+                 * the streams alive while the active stream lock is
+                 * dropped for the run. The workers take it around each
+                 * handler, so the handlers still enter and leave with it
+                 * held by their own thread.
+                 */
+                recovering.clear();
                 for (auto str: rm->mActiveStreams) {
                     ret = increaseStreamUserCounter(str);
                     if (0 != ret) {
                         PAL_ERR(LOG_TAG, "Error incrementing the stream counter for the stream handle: %pK", str);
                         continue;
                     }
-                    ret = str->ssrUpHandler();
-                    if (0 != ret) {
-                        PAL_ERR(LOG_TAG, "Ssr up handling failed for %pK ret %d",
-                                          str, ret);
-                    }
+                    recovering.push_back(str);
+                }
+                mActiveStreamMutex.unlock();
+                SsrRecoveryScheduler::run(recovering, &mActiveStreamMutex,
+                    [](Stream *str) { return str->ssrUpHandler(); },
+                    [this, &rm](Stream *str, struct pal_ssr_stream_recovery *rec) {
+                        if (0 != rec->status) {
+                            PAL_ERR(LOG_TAG, "Ssr up handling failed for %pK ret %d",
+                                              str, rec->status);
+                        }
+                        if (rm->globalCb)
+                            rm->globalCb(PAL_SSR_STREAM_RECOVERED, (uint32_t *)rec, cookie);
+                    }, &recoveryDone);
+                mActiveStreamMutex.lock();
+                for (auto str: recovering) {
                     ret = decreaseStreamUserCounter(str);
                     if (0 != ret) {
                         PAL_ERR(LOG_TAG, "Error decrementing the stream counter for the stream handle: %pK", str);
                     }
                 }
+                if (rm->globalCb)
+                    rm->globalCb(PAL_SSR_RECOVERY_DONE, (uint32_t *)&recoveryDone, cookie);
                 prevState = state;
             } else {
                 PAL_ERR(LOG_TAG, "Invalid state. state %d", state);
             }
             mActiveStreamMutex.unlock();
+            SndCardMonitor::noteHandled(state);
             lock.lock();
         }
     }
@@ -1509,6 +1542,7 @@ int ResourceManager::init_audio()
 {
     int retry = 0;
     int status = 0;
+    int snd_watch_fd = -1;
     bool snd_card_found = false;
 
     char *snd_card_name = NULL;
@@ -1518,8 +1552,18 @@ int ResourceManager::init_audio()
     char file_name_extn[XML_PATH_EXTN_MAX_SIZE] = {0};
     char file_name_extn_wo_variant[XML_PATH_EXTN_MAX_SIZE] = {0};
 
+    /*
+     * node creations wake the wait early, so the budget is time and not a
+     * retry count: unrelated nodes showing up during boot would use it up
+     */
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() +
+        std::chrono::milliseconds(MAX_RETRY_CNT * MIXER_OPEN_RETRY_MS);
+    int64_t waitMs = 0;
+
     PAL_DBG(LOG_TAG, "Enter.");
 
+    /* wakes the retry wait as soon as the card registers its nodes */
+    snd_watch_fd = SndCardMonitor::openSndNodeWatch();
     do {
         /* Look for only default codec sound card */
         /* Ignore USB sound card if detected */
@@ -1569,10 +1613,19 @@ int ResourceManager::init_audio()
         }
 
         if (!snd_card_found) {
+            waitMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                         deadline - std::chrono::steady_clock::now()).count();
+            if (waitMs <= 0)
+                break;
             PAL_INFO(LOG_TAG, "No audio mixer, retry %d", retry++);
-            sleep(1);
+            SndCardMonitor::waitSndNodes(snd_watch_fd, -1,
+                                         (int)std::min<int64_t>(waitMs, MIXER_OPEN_RETRY_MS));
         }
-    } while (!snd_card_found && retry <= MAX_RETRY_CNT);
+    } while (!snd_card_found);
+    if (snd_watch_fd >= 0) {
+        close(snd_watch_fd);
+        snd_watch_fd = -1;
+    }
 
     if (snd_hw_card >= MAX_SND_CARD || !audio_hw_mixer) {
         PAL_ERR(LOG_TAG, "audio mixer open failure");
@@ -1635,6 +1688,8 @@ exit:
         free(snd_card_name);
         snd_card_name = NULL;
     }
+    if (snd_watch_fd >= 0)
+        close(snd_watch_fd);
 
     return status;
 }
@@ -1987,6 +2042,7 @@ void ResourceManager::deInitContextManager()
 
 int ResourceManager::init()
 {
+    int status = 0;
     std::shared_ptr<Device> dev = nullptr;
     std::shared_ptr<HapticsDev> Hapdev = nullptr;
 
@@ -1995,9 +2051,16 @@ int ResourceManager::init()
 
     mixerEventTread = std::thread(mixerEventWaitThreadLoop, rm);
 
-    //Initialize audio_charger_listener
-    if (rm && isChargeConcurrencyEnabled)
-        rm->chargerListenerFeatureInit();
+    /*
+     * Initialize audio_charger_listener here rather than on first use, a
+     * charger connected before any stream is opened must still be seen.
+     */
+    if (isChargeConcurrencyEnabled) {
+        runInitStage("charger_listener", [this] {
+            chargerListenerFeatureInit();
+            return 0;
+        });
+    }
 
     // Get the speaker instance and activate speaker protection
     dattr.id = PAL_DEVICE_OUT_SPEAKER;
@@ -2018,15 +2081,51 @@ int ResourceManager::init()
            PAL_INFO(LOG_TAG, "HapticsDev instance not created");
     }
 
-    PAL_INFO(LOG_TAG, "Initialize voiceui dmgr");
-    voiceuiDmgrManagerInit();
-
-    PAL_INFO(LOG_TAG, "Initialize Audio Feature Stats");
-    AudioFeatureStatsInit();
+    /*
+     * Get AGM service handle. The crash handler can fire as soon as it is
+     * registered, so this waits until the resource manager is fully up.
+     */
+    status = agm_register_service_crash_callback(&agmServiceCrashHandler,
+                                                 (uint64_t)rm.get());
+    if (status)
+        PAL_ERR(LOG_TAG, "AGM service not up%d", status);
 
     return 0;
 }
 
+int ResourceManager::runInitStage(const std::string &name, PalInitGraph::stage_fn_t fn)
+{
+    return initGraph.runInline(name, fn);
+}
+
+/*
+ * Plugins which only serve streams are loaded when the first stream is
+ * opened, outside of any resource manager lock as their callbacks re-enter
+ * PAL. Anything tracking state from boot, like the charger listener, is
+ * initialized in init().
+ */
+void ResourceManager::loadStreamPlugins(pal_stream_type_t type)
+{
+    std::call_once(streamPluginsOnce, [this] {
+        PAL_INFO(LOG_TAG, "Initialize Audio Feature Stats");
+        runInitStage("feature_stats", [] {
+            AudioFeatureStatsInit();
+            return 0;
+        });
+    });
+
+    if (type != PAL_STREAM_VOICE_UI)
+        return;
+
+    std::call_once(vuiDmgrOnce, [this] {
+        PAL_INFO(LOG_TAG, "Initialize voiceui dmgr");
+        runInitStage("voiceui_dmgr", [] {
+            voiceuiDmgrManagerInit();
+            return 0;
+        });
+    });
+}
+
 bool ResourceManager::isLpiLoggingEnabled()
 {
     char value[256] = {0};
@@ -3214,35 +3313,35 @@ bool ResourceManager::isStreamSupported(struct pal_stream_attributes *attributes
         case PAL_STREAM_VOIP:
         case PAL_STREAM_VOIP_RX:
         case PAL_STREAM_VOIP_TX:
-            cur_sessions = active_streams_ll.size();
+            cur_sessions = mStreamRegistry.count(PAL_STREAM_LOW_LATENCY);
             max_sessions = MAX_SESSIONS_LOW_LATENCY;
             break;
         case PAL_STREAM_ULTRA_LOW_LATENCY:
-            cur_sessions = active_streams_ull.size();
+            cur_sessions = mStreamRegistry.count(PAL_STREAM_ULTRA_LOW_LATENCY);
             max_sessions = MAX_SESSIONS_ULTRA_LOW_LATENCY;
             break;
         case PAL_STREAM_DEEP_BUFFER:
-            cur_sessions = active_streams_db.size();
+            cur_sessions = mStreamRegistry.count(PAL_STREAM_DEEP_BUFFER);
             max_sessions = MAX_SESSIONS_DEEP_BUFFER;
             break;
         case PAL_STREAM_SPATIAL_AUDIO:
-            cur_sessions = active_streams_sa.size();
+            cur_sessions = mStreamRegistry.count(PAL_STREAM_SPATIAL_AUDIO);
             max_sessions = MAX_SESSIONS_SPATIAL_AUDIO;
             break;
         case PAL_STREAM_COMPRESSED:
-            cur_sessions = active_streams_comp.size();
+            cur_sessions = mStreamRegistry.count(PAL_STREAM_COMPRESSED);
             max_sessions = MAX_SESSIONS_COMPRESSED;
             break;
         case PAL_STREAM_GENERIC:
-            cur_sessions = active_streams_ulla.size();
+            cur_sessions = mStreamRegistry.count(PAL_STREAM_GENERIC);
             max_sessions = MAX_SESSIONS_GENERIC;
             break;
         case PAL_STREAM_RAW:
-            cur_sessions = active_streams_raw.size();
+            cur_sessions = mStreamRegistry.count(PAL_STREAM_RAW);
             max_sessions = MAX_SESSIONS_RAW;
             break;
         case PAL_STREAM_VOICE_RECOGNITION:
-            cur_sessions = active_streams_voice_rec.size();
+            cur_sessions = mStreamRegistry.count(PAL_STREAM_VOICE_RECOGNITION);
             max_sessions = MAX_SESSIONS_VOICE_RECOGNITION;
             break;
         case PAL_STREAM_LOOPBACK:
@@ -3256,29 +3355,29 @@ bool ResourceManager::isStreamSupported(struct pal_stream_attributes *attributes
             max_sessions = MAX_SESSIONS_ACD;
             break;
         case PAL_STREAM_PCM_OFFLOAD:
-            cur_sessions = active_streams_po.size();
+            cur_sessions = mStreamRegistry.count(PAL_STREAM_PCM_OFFLOAD);
             max_sessions = MAX_SESSIONS_PCM_OFFLOAD;
             break;
         case PAL_STREAM_PROXY:
-            cur_sessions = active_streams_proxy.size();
+            cur_sessions = mStreamRegistry.count(PAL_STREAM_PROXY);
             max_sessions = MAX_SESSIONS_PROXY;
             break;
          case PAL_STREAM_VOICE_CALL:
             break;
         case PAL_STREAM_VOICE_CALL_MUSIC:
-            cur_sessions = active_streams_incall_music.size();
+            cur_sessions = mStreamRegistry.count(PAL_STREAM_VOICE_CALL_MUSIC);
             max_sessions = MAX_SESSIONS_INCALL_MUSIC;
             break;
         case PAL_STREAM_VOICE_CALL_RECORD:
-            cur_sessions = active_streams_incall_record.size();
+            cur_sessions = mStreamRegistry.count(PAL_STREAM_VOICE_CALL_RECORD);
             max_sessions = MAX_SESSIONS_INCALL_RECORD;
             break;
         case PAL_STREAM_NON_TUNNEL:
-            cur_sessions = active_streams_non_tunnel.size();
+            cur_sessions = mStreamRegistry.count(PAL_STREAM_NON_TUNNEL);
             max_sessions = max_nt_sessions;
             break;
         case PAL_STREAM_HAPTICS:
-            cur_sessions = active_streams_haptics.size();
+            cur_sessions = mStreamRegistry.count(PAL_STREAM_HAPTICS);
             max_sessions = MAX_SESSIONS_HAPTICS;
             break;
         case PAL_STREAM_CONTEXT_PROXY:
@@ -3286,7 +3385,7 @@ bool ResourceManager::isStreamSupported(struct pal_stream_attributes *attributes
         case PAL_STREAM_COMMON_PROXY:
             return true;
         case PAL_STREAM_ULTRASOUND:
-            cur_sessions = active_streams_ultrasound.size();
+            cur_sessions = mStreamRegistry.count(PAL_STREAM_ULTRASOUND);
             max_sessions = MAX_SESSIONS_ULTRASOUND;
             break;
         default:
@@ -3295,7 +3394,7 @@ bool ResourceManager::isStreamSupported(struct pal_stream_attributes *attributes
     }
     if (cur_sessions == max_sessions && type != PAL_STREAM_VOICE_CALL) {
         if (type == PAL_STREAM_VOICE_RECOGNITION &&
-            active_streams_db.size() < MAX_SESSIONS_DEEP_BUFFER) {
+            mStreamRegistry.count(PAL_STREAM_DEEP_BUFFER) < MAX_SESSIONS_DEEP_BUFFER) {
                 attributes->type = PAL_STREAM_DEEP_BUFFER;
                 type = PAL_STREAM_DEEP_BUFFER;
         } else {
@@ -3483,6 +3582,21 @@ int registerstream(T s, std::list<T> &streams)
     return ret;
 }
 
+/* streams sharing a session limit share a bucket, as they shared a list */
+uint32_t ResourceManager::getRegistryBucket(pal_stream_type_t type)
+{
+    switch (type) {
+        case PAL_STREAM_VOIP_RX:
+        case PAL_STREAM_VOIP_TX:
+        case PAL_STREAM_VOICE_CALL:
+            return PAL_STREAM_LOW_LATENCY;
+        case PAL_STREAM_LOOPBACK:
+            return PAL_STREAM_PCM_OFFLOAD;
+        default:
+            return type;
+    }
+}
+
 int ResourceManager::registerStream(Stream *s)
 {
     int ret = 0;
@@ -3502,84 +3616,29 @@ int ResourceManager::registerStream(Stream *s)
         case PAL_STREAM_VOIP_RX:
         case PAL_STREAM_VOIP_TX:
         case PAL_STREAM_VOICE_CALL:
-        {
-            StreamPCM* sPCM = dynamic_cast<StreamPCM*>(s);
-            ret = registerstream(sPCM, active_streams_ll);
-            break;
-        }
         case PAL_STREAM_PCM_OFFLOAD:
         case PAL_STREAM_LOOPBACK:
-        {
-            StreamPCM* sPCM = dynamic_cast<StreamPCM*>(s);
-            ret = registerstream(sPCM, active_streams_po);
-            break;
-        }
         case PAL_STREAM_DEEP_BUFFER:
-        {
-            StreamPCM* sDB = dynamic_cast<StreamPCM*>(s);
-            ret = registerstream(sDB, active_streams_db);
-            break;
-        }
         case PAL_STREAM_SPATIAL_AUDIO:
-        {
-            StreamPCM* sSA = dynamic_cast<StreamPCM*>(s);
-            ret = registerstream(sSA, active_streams_sa);
-            break;
-        }
         case PAL_STREAM_COMPRESSED:
-        {
-            StreamCompress* sComp = dynamic_cast<StreamCompress*>(s);
-            ret = registerstream(sComp, active_streams_comp);
-            break;
-        }
         case PAL_STREAM_GENERIC:
-        {
-            StreamPCM* sULLA = dynamic_cast<StreamPCM*>(s);
-            ret = registerstream(sULLA, active_streams_ulla);
-            break;
-        }
-        case PAL_STREAM_VOICE_UI:
-        {
-            if (active_streams_st.size() == 0)
-                onVUIStreamRegistered();
-            StreamSoundTrigger* sST = dynamic_cast<StreamSoundTrigger*>(s);
-            ret = registerstream(sST, active_streams_st);
-            break;
-        }
         case PAL_STREAM_ULTRA_LOW_LATENCY:
-        {
-            StreamPCM* sULL = dynamic_cast<StreamPCM*>(s);
-            ret = registerstream(sULL, active_streams_ull);
-            break;
-        }
         case PAL_STREAM_PROXY:
-        {
-            StreamPCM* sProxy = dynamic_cast<StreamPCM*>(s);
-            ret = registerstream(sProxy, active_streams_proxy);
-            break;
-        }
         case PAL_STREAM_VOICE_CALL_MUSIC:
-        {
-            StreamInCall* sPCM = dynamic_cast<StreamInCall*>(s);
-            ret = registerstream(sPCM, active_streams_incall_music);
-            break;
-        }
         case PAL_STREAM_VOICE_CALL_RECORD:
-        {
-            StreamInCall* sPCM = dynamic_cast<StreamInCall*>(s);
-            ret = registerstream(sPCM, active_streams_incall_record);
-            break;
-        }
         case PAL_STREAM_NON_TUNNEL:
-        {
-            StreamNonTunnel* sNonTunnel = dynamic_cast<StreamNonTunnel*>(s);
-            ret = registerstream(sNonTunnel, active_streams_non_tunnel);
-            break;
-        }
         case PAL_STREAM_HAPTICS:
+        case PAL_STREAM_ULTRASOUND:
+        case PAL_STREAM_RAW:
+        case PAL_STREAM_VOICE_RECOGNITION:
+            ret = mStreamRegistry.add(s, getRegistryBucket(type));
+            break;
+        case PAL_STREAM_VOICE_UI:
         {
-            StreamPCM* sHap = dynamic_cast<StreamPCM*>(s);
-            ret = registerstream(sHap, active_streams_haptics);
+            if (active_streams_st.size() == 0)
+                onVUIStreamRegistered();
+            StreamSoundTrigger* sST = dynamic_cast<StreamSoundTrigger*>(s);
+            ret = registerstream(sST, active_streams_st);
             break;
         }
         case PAL_STREAM_ACD:
@@ -3588,18 +3647,6 @@ int ResourceManager::registerStream(Stream *s)
             ret = registerstream(sAcd, active_streams_acd);
             break;
         }
-        case PAL_STREAM_ULTRASOUND:
-        {
-            StreamUltraSound* sUPD = dynamic_cast<StreamUltraSound*>(s);
-            ret = registerstream(sUPD, active_streams_ultrasound);
-            break;
-        }
-        case PAL_STREAM_RAW:
-        {
-            StreamPCM* sRaw = dynamic_cast<StreamPCM*>(s);
-            ret = registerstream(sRaw, active_streams_raw);
-            break;
-        }
         case PAL_STREAM_SENSOR_PCM_DATA:
         {
             StreamSensorPCMData* sPCM = dynamic_cast<StreamSensorPCMData*>(s);
@@ -3612,12 +3659,6 @@ int ResourceManager::registerStream(Stream *s)
             ret = registerstream(sCtxt, active_streams_context_proxy);
             break;
         }
-        case PAL_STREAM_VOICE_RECOGNITION:
-        {
-            StreamPCM* sVR = dynamic_cast<StreamPCM*>(s);
-            ret = registerstream(sVR, active_streams_voice_rec);
-            break;
-        }
         case PAL_STREAM_COMMON_PROXY:
         {
             StreamCommonProxy* sAFS = dynamic_cast<StreamCommonProxy*>(s);
@@ -3630,6 +3671,9 @@ int ResourceManager::registerStream(Stream *s)
             PAL_ERR(LOG_TAG, "Invalid stream type = %d ret %d", type, ret);
             break;
     }
+    /* typed streams are indexed as well, for handle checks and generic queries */
+    if (!ret && !mStreamRegistry.contains(s))
+        ret = mStreamRegistry.add(s, getRegistryBucket(type));
     mActiveStreams.push_back(s);
 
 #if 0
@@ -3685,46 +3729,6 @@ int ResourceManager::deregisterStream(Stream *s)
     PAL_INFO(LOG_TAG, "stream type %d", type);
     mActiveStreamMutex.lock();
     switch (type) {
-        case PAL_STREAM_LOW_LATENCY:
-        case PAL_STREAM_VOIP_RX:
-        case PAL_STREAM_VOIP_TX:
-        case PAL_STREAM_VOICE_CALL:
-        {
-            StreamPCM* sPCM = dynamic_cast<StreamPCM*>(s);
-            ret = deregisterstream(sPCM, active_streams_ll);
-            break;
-        }
-        case PAL_STREAM_PCM_OFFLOAD:
-        case PAL_STREAM_LOOPBACK:
-        {
-            StreamPCM* sPCM = dynamic_cast<StreamPCM*>(s);
-            ret = deregisterstream(sPCM, active_streams_po);
-            break;
-        }
-        case PAL_STREAM_DEEP_BUFFER:
-        {
-            StreamPCM* sDB = dynamic_cast<StreamPCM*>(s);
-            ret = deregisterstream(sDB, active_streams_db);
-            break;
-        }
-        case PAL_STREAM_SPATIAL_AUDIO:
-        {
-            StreamPCM* sSA = dynamic_cast<StreamPCM*>(s);
-            ret = deregisterstream(sSA, active_streams_sa);
-            break;
-        }
-        case PAL_STREAM_COMPRESSED:
-        {
-            StreamCompress* sComp = dynamic_cast<StreamCompress*>(s);
-            ret = deregisterstream(sComp, active_streams_comp);
-            break;
-        }
-        case PAL_STREAM_GENERIC:
-        {
-            StreamPCM* sULLA = dynamic_cast<StreamPCM*>(s);
-            ret = deregisterstream(sULLA, active_streams_ulla);
-            break;
-        }
         case PAL_STREAM_VOICE_UI:
         {
             StreamSoundTrigger* sST = dynamic_cast<StreamSoundTrigger*>(s);
@@ -3735,60 +3739,12 @@ int ResourceManager::deregisterStream(Stream *s)
             }
             break;
         }
-        case PAL_STREAM_ULTRA_LOW_LATENCY:
-        {
-            StreamPCM* sULL = dynamic_cast<StreamPCM*>(s);
-            ret = deregisterstream(sULL, active_streams_ull);
-            break;
-        }
-        case PAL_STREAM_PROXY:
-        {
-            StreamPCM* sProxy = dynamic_cast<StreamPCM*>(s);
-            ret = deregisterstream(sProxy, active_streams_proxy);
-            break;
-        }
-        case PAL_STREAM_VOICE_CALL_MUSIC:
-        {
-            StreamInCall* sPCM = dynamic_cast<StreamInCall*>(s);
-            ret = deregisterstream(sPCM, active_streams_incall_music);
-            break;
-        }
-        case PAL_STREAM_VOICE_CALL_RECORD:
-        {
-            StreamInCall* sPCM = dynamic_cast<StreamInCall*>(s);
-            ret = deregisterstream(sPCM, active_streams_incall_record);
-            break;
-        }
-        case PAL_STREAM_NON_TUNNEL:
-        {
-            StreamNonTunnel* sNonTunnel = dynamic_cast<StreamNonTunnel*>(s);
-            ret = deregisterstream(sNonTunnel, active_streams_non_tunnel);
-            break;
-        }
-        case PAL_STREAM_HAPTICS:
-        {
-            StreamPCM* sHap = dynamic_cast<StreamPCM*>(s);
-            ret = deregisterstream(sHap, active_streams_haptics);
-            break;
-        }
         case PAL_STREAM_ACD:
         {
             StreamACD* sAcd = dynamic_cast<StreamACD*>(s);
             ret = deregisterstream(sAcd, active_streams_acd);
             break;
         }
-        case PAL_STREAM_ULTRASOUND:
-        {
-            StreamUltraSound* sUPD = dynamic_cast<StreamUltraSound*>(s);
-            ret = deregisterstream(sUPD, active_streams_ultrasound);
-            break;
-        }
-        case PAL_STREAM_RAW:
-        {
-            StreamPCM* sRaw = dynamic_cast<StreamPCM*>(s);
-            ret = deregisterstream(sRaw, active_streams_raw);
-            break;
-        }
         case PAL_STREAM_SENSOR_PCM_DATA:
         {
             StreamSensorPCMData* sPCM = dynamic_cast<StreamSensorPCMData*>(s);
@@ -3801,24 +3757,17 @@ int ResourceManager::deregisterStream(Stream *s)
             ret = deregisterstream(sCtxt, active_streams_context_proxy);
             break;
         }
-        case PAL_STREAM_VOICE_RECOGNITION:
-        {
-            StreamPCM* sVR = dynamic_cast<StreamPCM*>(s);
-            ret = deregisterstream(sVR, active_streams_voice_rec);
-            break;
-        }
         case PAL_STREAM_COMMON_PROXY:
         {
             StreamCommonProxy* sAFS = dynamic_cast<StreamCommonProxy*>(s);
             ret = deregisterstream(sAFS, active_streams_afs);
             break;
         }
-
         default:
-            ret = -EINVAL;
-            PAL_ERR(LOG_TAG, "Invalid stream type = %d ret %d", type, ret);
             break;
     }
+    if (mStreamRegistry.remove(s) && !ret)
+        ret = -ENOENT;
 
     deregisterstream(s, mActiveStreams);
 
@@ -3831,29 +3780,8 @@ exit:
     return ret;
 }
 
-template <class T>
-bool isStreamActive(T s, std::list<T> &streams)
-{
-    bool ret = false;
-
-    PAL_DBG(LOG_TAG, "Enter.");
-    typename std::list<T>::iterator iter =
-        std::find(streams.begin(), streams.end(), s);
-    if (iter != streams.end()) {
-        ret = true;
-    }
-
-    PAL_DBG(LOG_TAG, "Exit, ret %d", ret);
-    return ret;
-}
-
 int ResourceManager::isActiveStream(pal_stream_handle_t *handle) {
-    for (auto &s : mActiveStreams) {
-        if (handle == reinterpret_cast<uint64_t *>(s)) {
-            return true;
-        }
-    }
-    return false;
+    return mStreamRegistry.contains(handle);
 }
 
 int ResourceManager::initStreamUserCounter(Stream *s)
@@ -4318,7 +4246,7 @@ int ResourceManager::checkandEnableECForRXStream_l(std::shared_ptr<Device> rx_de
     tx_streams_list = getConcurrentTxStream_l(rx_stream, rx_dev);
     for (auto tx_stream: tx_streams_list) {
         tx_devices.clear();
-        if (!tx_stream || !isStreamActive(tx_stream, mActiveStreams)) {
+        if (!tx_stream || !mStreamRegistry.contains(tx_stream)) {
             PAL_ERR(LOG_TAG, "TX Stream Empty or is not active\n");
             continue;
         }
@@ -5256,7 +5184,7 @@ int ResourceManager::handleMixerEvent(struct mixer *mixer, char *mixer_str) {
     std::map<int, std::pair<session_callback, uint64_t>>::iterator it;
 
     PAL_DBG(LOG_TAG, "Enter");
-    ctl = mixer_get_ctl_by_name(mixer, mixer_str);
+    ctl = MixerCtlCache::getCtl(mixer, mixer_str);
     if (!ctl) {
         PAL_ERR(LOG_TAG, "Invalid mixer control: %s", mixer_str);
         status = -EINVAL;
@@ -5361,7 +5289,7 @@ int ResourceManager::HandleDetectionStreamAction(pal_stream_type_t type, int32_t
 
     PAL_DBG(LOG_TAG, "Enter");
     for (auto& str: mActiveStreams) {
-        if (!isStreamActive(str, mActiveStreams))
+        if (!mStreamRegistry.contains(str))
             continue;
 
         str->getStreamAttributes(&st_attr);
@@ -6069,31 +5997,27 @@ void ResourceManager::getHigherPriorityActiveStreams(const int inComingStreamPri
 #endif
 
 
-template <class T>
-void getActiveStreams(std::shared_ptr<Device> d, std::vector<Stream*> &activestreams,
-                      std::list<T> sourcestreams)
-{
-    for (typename std::list<T>::iterator iter = sourcestreams.begin();
-                 iter != sourcestreams.end(); iter++) {
-        std::vector <std::shared_ptr<Device>> devices;
-
-        if (NULL != *iter) {
-            (*iter)->getAssociatedDevices(devices);
-            if (d == NULL) {
-                 if((*iter)->isAlive() && !devices.empty())
-                    activestreams.push_back(*iter);
-            } else {
-                typename std::vector<std::shared_ptr<Device>>::iterator result =
-                         std::find(devices.begin(), devices.end(), d);
-                if ((result != devices.end()) && (*iter)->isAlive())
-                    activestreams.push_back(*iter);
-            }
-        } else {
-            // remove element from the list if it's a NULL pointer
-            sourcestreams.erase(iter);
-        }
-    }
-}
+/* buckets in the order the per type lists used to be merged */
+static const pal_stream_type_t activeStreamBuckets[] = {
+    PAL_STREAM_LOW_LATENCY,
+    PAL_STREAM_ULTRA_LOW_LATENCY,
+    PAL_STREAM_GENERIC,
+    PAL_STREAM_DEEP_BUFFER,
+    PAL_STREAM_SPATIAL_AUDIO,
+    PAL_STREAM_RAW,
+    PAL_STREAM_COMPRESSED,
+    PAL_STREAM_VOICE_UI,
+    PAL_STREAM_ACD,
+    PAL_STREAM_PCM_OFFLOAD,
+    PAL_STREAM_PROXY,
+    PAL_STREAM_VOICE_CALL_RECORD,
+    PAL_STREAM_NON_TUNNEL,
+    PAL_STREAM_VOICE_CALL_MUSIC,
+    PAL_STREAM_HAPTICS,
+    PAL_STREAM_ULTRASOUND,
+    PAL_STREAM_SENSOR_PCM_DATA,
+    PAL_STREAM_VOICE_RECOGNITION,
+};
 
 int ResourceManager::getActiveStream_l(std::vector<Stream*> &activestreams,
                                        std::shared_ptr<Device> d)
@@ -6102,25 +6026,12 @@ int ResourceManager::getActiveStream_l(std::vector<Stream*> &activestreams,
 
     activestreams.clear();
 
-    // merge all types of active streams into activestreams
-    getActiveStreams(d, activestreams, active_streams_ll);
-    getActiveStreams(d, activestreams, active_streams_ull);
-    getActiveStreams(d, activestreams, active_streams_ulla);
-    getActiveStreams(d, activestreams, active_streams_db);
-    getActiveStreams(d, activestreams, active_streams_sa);
-    getActiveStreams(d, activestreams, active_streams_raw);
-    getActiveStreams(d, activestreams, active_streams_comp);
-    getActiveStreams(d, activestreams, active_streams_st);
-    getActiveStreams(d, activestreams, active_streams_acd);
-    getActiveStreams(d, activestreams, active_streams_po);
-    getActiveStreams(d, activestreams, active_streams_proxy);
-    getActiveStreams(d, activestreams, active_streams_incall_record);
-    getActiveStreams(d, activestreams, active_streams_non_tunnel);
-    getActiveStreams(d, activestreams, active_streams_incall_music);
-    getActiveStreams(d, activestreams, active_streams_haptics);
-    getActiveStreams(d, activestreams, active_streams_ultrasound);
-    getActiveStreams(d, activestreams, active_streams_sensor_pcm_data);
-    getActiveStreams(d, activestreams, active_streams_voice_rec);
+    for (auto type : activeStreamBuckets) {
+        for (Stream *s : mStreamRegistry.bucket(type)) {
+            if (s->isAlive() && s->isDeviceAssociated(d))
+                activestreams.push_back(s);
+        }
+    }
 
     if (activestreams.empty()) {
         ret = -ENOENT;
@@ -6146,29 +6057,6 @@ int ResourceManager::getActiveStream(std::vector<Stream*> &activestreams,
     return ret;
 }
 
-template <class T>
-void getOrphanStreams(std::vector<Stream*> &orphanstreams,
-                      std::vector<Stream*> &retrystreams,
-                      std::list<T> sourcestreams)
-{
-    for (typename std::list<T>::iterator iter = sourcestreams.begin();
-                 iter != sourcestreams.end(); iter++) {
-        std::vector <std::shared_ptr<Device>> devices;
-
-        if (NULL != *iter) {
-            (*iter)->getAssociatedDevices(devices);
-            if (devices.empty())
-                orphanstreams.push_back(*iter);
-
-            if ((*iter)->suspendedDevIds.size() > 0)
-                retrystreams.push_back(*iter);
-        } else {
-            // remove element from the list if it's a NULL pointer
-            sourcestreams.erase(iter);
-        }
-    }
-}
-
 int ResourceManager::getOrphanStream_l(std::vector<Stream*> &orphanstreams,
                                        std::vector<Stream*> &retrystreams)
 {
@@ -6177,21 +6065,18 @@ int ResourceManager::getOrphanStream_l(std::vector<Stream*> &orphanstreams,
     orphanstreams.clear();
     retrystreams.clear();
 
-    getOrphanStreams(orphanstreams, retrystreams, active_streams_ll);
-    getOrphanStreams(orphanstreams, retrystreams, active_streams_ull);
-    getOrphanStreams(orphanstreams, retrystreams, active_streams_ulla);
-    getOrphanStreams(orphanstreams, retrystreams, active_streams_db);
-    getOrphanStreams(orphanstreams, retrystreams, active_streams_sa);
-    getOrphanStreams(orphanstreams, retrystreams, active_streams_comp);
-    getOrphanStreams(orphanstreams, retrystreams, active_streams_st);
-    getOrphanStreams(orphanstreams, retrystreams, active_streams_acd);
-    getOrphanStreams(orphanstreams, retrystreams, active_streams_po);
-    getOrphanStreams(orphanstreams, retrystreams, active_streams_proxy);
-    getOrphanStreams(orphanstreams, retrystreams, active_streams_incall_record);
-    getOrphanStreams(orphanstreams, retrystreams, active_streams_non_tunnel);
-    getOrphanStreams(orphanstreams, retrystreams, active_streams_incall_music);
-    getOrphanStreams(orphanstreams, retrystreams, active_streams_haptics);
-    getOrphanStreams(orphanstreams, retrystreams, active_streams_ultrasound);
+    for (auto type : activeStreamBuckets) {
+        /* raw, sensor pcm data and voice recognition streams are not retried */
+        if (type == PAL_STREAM_RAW || type == PAL_STREAM_SENSOR_PCM_DATA ||
+            type == PAL_STREAM_VOICE_RECOGNITION)
+            continue;
+        for (Stream *s : mStreamRegistry.bucket(type)) {
+            if (!s->isDeviceAssociated(nullptr))
+                orphanstreams.push_back(s);
+            if (s->suspendedDevIds.size() > 0)
+                retrystreams.push_back(s);
+        }
+    }
 
     if (orphanstreams.empty() && retrystreams.empty()) {
         ret = -ENOENT;
@@ -6763,7 +6648,10 @@ void ResourceManager::deinit()
 {
     card_status_t state = CARD_STATUS_NONE;
 
+    SessionPool::deinit();
     mixerClosed = true;
+    MixerCtlCache::invalidate();
+    MixerTransaction::invalidate();
     mixer_close(audio_virt_mixer);
     mixer_close(audio_hw_mixer);
     if (audio_route) {
@@ -6796,6 +6684,8 @@ void ResourceManager::deinit()
         socPerithread.join();
     }
 #endif
+    PalDumpWriter::deinit();
+    BtCodecPluginCache::deinit();
     rm = nullptr;
 }
 
@@ -6896,24 +6786,15 @@ int ResourceManager::getNumFEs(const pal_stream_type_t sType) const
 const std::vector<int> ResourceManager::allocateFrontEndExtEcIds()
 {
     std::vector<int> f;
-    f.clear();
-    const int howMany = 1;
-    int id = 0;
-    std::vector<int>::iterator it;
-    if (howMany > listAllPcmExtEcTxFrontEnds.size()) {
-        PAL_ERR(LOG_TAG, "allocateFrontEndExtEcIds: requested for %d external ec front ends, have only %zu error",
-                        howMany, listAllPcmExtEcTxFrontEnds.size());
+    int id = fePools[PAL_FE_POOL_EXT_EC_TX].allocate();
+
+    if (id < 0) {
+        PAL_ERR(LOG_TAG, "allocateFrontEndExtEcIds: no free external ec front end, have %u",
+                fePools[PAL_FE_POOL_EXT_EC_TX].size());
         return f;
     }
-    id = (listAllPcmExtEcTxFrontEnds.size() - 1);
-    it =  (listAllPcmExtEcTxFrontEnds.begin() + id);
-    for (int i = 0; i < howMany; i++) {
-        f.push_back(listAllPcmExtEcTxFrontEnds.at(id));
-        listAllPcmExtEcTxFrontEnds.erase(it);
-        PAL_INFO(LOG_TAG, "allocateFrontEndExtEcIds: front end %d", f[i]);
-        it -= 1;
-        id -= 1;
-    }
+    f.push_back(id);
+    PAL_INFO(LOG_TAG, "allocateFrontEndExtEcIds: front end %d", id);
     return f;
 }
 
@@ -6921,46 +6802,20 @@ void ResourceManager::freeFrontEndEcTxIds(const std::vector<int> frontend)
 {
     for (int i = 0; i < frontend.size(); i++) {
         PAL_INFO(LOG_TAG, "freeing ext ec dev %d\n", frontend.at(i));
-        listAllPcmExtEcTxFrontEnds.push_back(frontend.at(i));
+        fePools[PAL_FE_POOL_EXT_EC_TX].release(frontend.at(i));
     }
     return;
 }
 
-template <typename T>
-void removeDuplicates(std::vector<T> &vec)
+/* front end class of a stream, PAL_FE_POOL_MAX if it has none */
+pal_fe_pool_t ResourceManager::getFrontEndPool(const struct pal_stream_attributes &sAttr,
+                                               int lDirection) const
 {
-    std::sort(vec.begin(), vec.end());
-    vec.erase(std::unique(vec.begin(), vec.end()), vec.end());
-    return;
-}
+    bool voice1 = false;
 
-const std::vector<int> ResourceManager::allocateFrontEndIds(const struct pal_stream_attributes &sAttr, int lDirection)
-{
-    //TODO: lock resource manager
-    std::vector<int> f;
-    f.clear();
-    const int howMany = getNumFEs(sAttr.type);
-    int id = 0;
-    std::vector<int>::iterator it;
-
-    mListFrontEndsMutex.lock();
-    switch(sAttr.type) {
+    switch (sAttr.type) {
         case PAL_STREAM_NON_TUNNEL:
-            if (howMany > listAllNonTunnelSessionIds.size()) {
-                PAL_ERR(LOG_TAG, "allocateFrontEndIds: requested for %d front ends, have only %zu error",
-                                howMany, listAllPcmRecordFrontEnds.size());
-                 goto error;
-            }
-            id = (listAllNonTunnelSessionIds.size() - 1);
-            it =  (listAllNonTunnelSessionIds.begin() + id);
-            for (int i = 0; i < howMany; i++) {
-                f.push_back(listAllNonTunnelSessionIds.at(id));
-                listAllNonTunnelSessionIds.erase(it);
-                PAL_INFO(LOG_TAG, "allocateFrontEndIds: front end %d", f[i]);
-                it -= 1;
-                id -= 1;
-            }
-            break;
+            return PAL_FE_POOL_NON_TUNNEL;
         case PAL_STREAM_LOW_LATENCY:
         case PAL_STREAM_ULTRA_LOW_LATENCY:
         case PAL_STREAM_GENERIC:
@@ -6980,426 +6835,108 @@ const std::vector<int> ResourceManager::allocateFrontEndIds(const struct pal_str
         case PAL_STREAM_SENSOR_PCM_DATA:
         case PAL_STREAM_VOICE_RECOGNITION:
             switch (sAttr.direction) {
-                case PAL_AUDIO_INPUT:
-                    if (lDirection == TX_HOSTLESS) {
-                        if (howMany > listAllPcmHostlessTxFrontEnds.size()) {
-                            PAL_ERR(LOG_TAG, "allocateFrontEndIds: requested for %d front ends, have only %zu error",
-                                              howMany, listAllPcmHostlessTxFrontEnds.size());
-                            goto error;
-                        }
-                        id = (listAllPcmHostlessTxFrontEnds.size() - 1);
-                        it = (listAllPcmHostlessTxFrontEnds.begin() + id);
-                        for (int i = 0; i < howMany; i++) {
-                           f.push_back(listAllPcmHostlessTxFrontEnds.at(id));
-                           listAllPcmHostlessTxFrontEnds.erase(it);
-                           PAL_INFO(LOG_TAG, "allocateFrontEndIds: front end %d", f[i]);
-                           it -= 1;
-                           id -= 1;
-                        }
-                    } else {
-                        if (howMany > listAllPcmRecordFrontEnds.size()) {
-                            PAL_ERR(LOG_TAG, "allocateFrontEndIds: requested for %d front ends, have only %zu error",
-                                              howMany, listAllPcmRecordFrontEnds.size());
-                            goto error;
-                        }
-                        id = (listAllPcmRecordFrontEnds.size() - 1);
-                        it = (listAllPcmRecordFrontEnds.begin() + id);
-                        for (int i = 0; i < howMany; i++) {
-                            f.push_back(listAllPcmRecordFrontEnds.at(id));
-                            listAllPcmRecordFrontEnds.erase(it);
-                            PAL_INFO(LOG_TAG, "allocateFrontEndIds: front end %d", f[i]);
-                            it -= 1;
-                            id -= 1;
-                        }
-                    }
-                    break;
-                case PAL_AUDIO_OUTPUT:
-                    if (lDirection == RX_HOSTLESS) {
-                        if (howMany > listAllPcmHostlessRxFrontEnds.size()) {
-                            PAL_ERR(LOG_TAG, "allocateFrontEndIds: requested for %d front ends, have only %zu error",
-                            howMany, listAllPcmHostlessRxFrontEnds.size());
-                            goto error;
-                        }
-                        id = (listAllPcmHostlessRxFrontEnds.size() - 1);
-                        it = (listAllPcmHostlessRxFrontEnds.begin() + id);
-                        for (int i = 0; i < howMany; i++) {
-                            f.push_back(listAllPcmHostlessRxFrontEnds.at(id));
-                            listAllPcmHostlessRxFrontEnds.erase(it);
-                            PAL_INFO(LOG_TAG, "allocateFrontEndIds: front end %d", f[i]);
-                            it -= 1;
-                            id -= 1;
-                        }
-                    } else {
-                        if (howMany > listAllPcmPlaybackFrontEnds.size()) {
-                            PAL_ERR(LOG_TAG, "allocateFrontEndIds: requested for %d front ends, have only %zu error",
-                            howMany, listAllPcmPlaybackFrontEnds.size());
-                            goto error;
-                        }
-                        if (!listAllPcmPlaybackFrontEnds.size()) {
-                            PAL_ERR(LOG_TAG, "allocateFrontEndIds: requested for %d front ends, but we dont have any (%zu) !!!!!!! ",
-                                    howMany, listAllPcmPlaybackFrontEnds.size());
-                            goto error;
-                        }
-                        id = (int)(((int)listAllPcmPlaybackFrontEnds.size()) - 1);
-                        if (id < 0) {
-                            PAL_ERR(LOG_TAG, "allocateFrontEndIds: negative iterator id %d !!!!! ", id);
-                            goto error;
-                        }
-                        it =  (listAllPcmPlaybackFrontEnds.begin() + id);
-                        for (int i = 0; i < howMany; i++) {
-                            f.push_back(listAllPcmPlaybackFrontEnds.at(id));
-                            listAllPcmPlaybackFrontEnds.erase(it);
-                            PAL_INFO(LOG_TAG, "allocateFrontEndIds: front end %d", f[i]);
-                            it -= 1;
-                            id -= 1;
-                        }
-                    }
-                    break;
-                case PAL_AUDIO_INPUT | PAL_AUDIO_OUTPUT:
-                    if (lDirection == RX_HOSTLESS) {
-                        if (howMany > listAllPcmHostlessRxFrontEnds.size()) {
-                            PAL_ERR(LOG_TAG, "allocateFrontEndIds: requested for %d front ends, have only %zu error",
-                                              howMany, listAllPcmHostlessRxFrontEnds.size());
-                            goto error;
-                        }
-                        id = (listAllPcmHostlessRxFrontEnds.size() - 1);
-                        it = (listAllPcmHostlessRxFrontEnds.begin() + id);
-                        for (int i = 0; i < howMany; i++) {
-                           f.push_back(listAllPcmHostlessRxFrontEnds.at(id));
-                           listAllPcmHostlessRxFrontEnds.erase(it);
-                           PAL_INFO(LOG_TAG, "allocateFrontEndIds: front end %d", f[i]);
-                           it -= 1;
-                           id -= 1;
-                        }
-                    } else {
-                        if (howMany > listAllPcmHostlessTxFrontEnds.size()) {
-                            PAL_ERR(LOG_TAG, "allocateFrontEndIds: requested for %d front ends, have only %zu error",
-                                              howMany, listAllPcmHostlessTxFrontEnds.size());
-                            goto error;
-                        }
-                        id = (listAllPcmHostlessTxFrontEnds.size() - 1);
-                        it = (listAllPcmHostlessTxFrontEnds.begin() + id);
-                        for (int i = 0; i < howMany; i++) {
-                           f.push_back(listAllPcmHostlessTxFrontEnds.at(id));
-                           listAllPcmHostlessTxFrontEnds.erase(it);
-                           PAL_INFO(LOG_TAG, "allocateFrontEndIds: front end %d", f[i]);
-                           it -= 1;
-                           id -= 1;
-                        }
-                    }
-                    break;
-                default:
-                    PAL_ERR(LOG_TAG,"direction unsupported");
-                    break;
-            }
-            break;
-        case PAL_STREAM_COMPRESSED:
-            switch (sAttr.direction) {
-                case PAL_AUDIO_INPUT:
-                    if (howMany > listAllCompressRecordFrontEnds.size()) {
-                        PAL_ERR(LOG_TAG, "allocateFrontEndIds: requested for %d front ends, have only %zu error",
-                                          howMany, listAllCompressRecordFrontEnds.size());
-                        goto error;
-                    }
-                    id = (listAllCompressRecordFrontEnds.size() - 1);
-                    it = (listAllCompressRecordFrontEnds.begin() + id);
-                    for (int i = 0; i < howMany; i++) {
-                        f.push_back(listAllCompressRecordFrontEnds.at(id));
-                        listAllCompressRecordFrontEnds.erase(it);
-                        PAL_INFO(LOG_TAG, "allocateFrontEndIds: front end %d", f[i]);
-                        it -= 1;
-                        id -= 1;
-                    }
-                    break;
-                case PAL_AUDIO_OUTPUT:
-                    if (howMany > listAllCompressPlaybackFrontEnds.size()) {
-                        PAL_ERR(LOG_TAG, "allocateFrontEndIds: requested for %d front ends, have only %zu error",
-                                          howMany, listAllCompressPlaybackFrontEnds.size());
-                        goto error;
-                    }
-                    id = (listAllCompressPlaybackFrontEnds.size() - 1);
-                    it = (listAllCompressPlaybackFrontEnds.begin() + id);
-                    for (int i = 0; i < howMany; i++) {
-                        f.push_back(listAllCompressPlaybackFrontEnds.at(id));
-                        listAllCompressPlaybackFrontEnds.erase(it);
-                        PAL_INFO(LOG_TAG, "allocateFrontEndIds: front end %d", f[i]);
-                        it -= 1;
-                        id -= 1;
-                    }
-                    break;
-                default:
-                    PAL_ERR(LOG_TAG,"direction unsupported");
-                    break;
-                }
-                break;
-        case PAL_STREAM_VOICE_CALL:
-            switch (sAttr.direction) {
-              case PAL_AUDIO_INPUT | PAL_AUDIO_OUTPUT:
-                    if (lDirection == RX_HOSTLESS) {
-                        if (sAttr.info.voice_call_info.VSID == VOICEMMODE1 ||
-                            sAttr.info.voice_call_info.VSID == VOICELBMMODE1) {
-                            f = allocateVoiceFrontEndIds(listAllPcmVoice1RxFrontEnds, howMany);
-                        } else if(sAttr.info.voice_call_info.VSID == VOICEMMODE2 ||
-                            sAttr.info.voice_call_info.VSID == VOICELBMMODE2){
-                            f = allocateVoiceFrontEndIds(listAllPcmVoice2RxFrontEnds, howMany);
-                        } else {
-                            PAL_ERR(LOG_TAG,"invalid VSID 0x%x provided",
-                                    sAttr.info.voice_call_info.VSID);
-                        }
-                    } else {
-                        if (sAttr.info.voice_call_info.VSID == VOICEMMODE1 ||
-                            sAttr.info.voice_call_info.VSID == VOICELBMMODE1) {
-                            f = allocateVoiceFrontEndIds(listAllPcmVoice1TxFrontEnds, howMany);
-                        } else if(sAttr.info.voice_call_info.VSID == VOICEMMODE2 ||
-                            sAttr.info.voice_call_info.VSID == VOICELBMMODE2){
-                            f = allocateVoiceFrontEndIds(listAllPcmVoice2TxFrontEnds, howMany);
-                        } else {
-                            PAL_ERR(LOG_TAG,"invalid VSID 0x%x provided",
-                                    sAttr.info.voice_call_info.VSID);
-                        }
-                    }
-                    break;
-              default:
-                  PAL_ERR(LOG_TAG,"direction unsupported voice must be RX and TX");
-                  break;
-            }
-            break;
-        case PAL_STREAM_VOICE_CALL_RECORD:
-            if (howMany > listAllPcmInCallRecordFrontEnds.size()) {
-                    PAL_ERR(LOG_TAG, "allocateFrontEndIds: requested for %d front ends, have only %zu error",
-                                      howMany, listAllPcmInCallRecordFrontEnds.size());
-                    goto error;
-                }
-            id = (listAllPcmInCallRecordFrontEnds.size() - 1);
-            it = (listAllPcmInCallRecordFrontEnds.begin() + id);
-            for (int i = 0; i < howMany; i++) {
-                f.push_back(listAllPcmInCallRecordFrontEnds.at(id));
-                listAllPcmInCallRecordFrontEnds.erase(it);
-                PAL_ERR(LOG_TAG, "allocateFrontEndIds: front end %d", f[i]);
-                it -= 1;
-                id -= 1;
-            }
-            break;
-        case PAL_STREAM_VOICE_CALL_MUSIC:
-            if (howMany > listAllPcmInCallMusicFrontEnds.size()) {
-                    PAL_ERR(LOG_TAG, "allocateFrontEndIds: requested for %d front ends, have only %zu error",
-                                      howMany, listAllPcmInCallMusicFrontEnds.size());
-                    goto error;
-                }
-            id = (listAllPcmInCallMusicFrontEnds.size() - 1);
-            it = (listAllPcmInCallMusicFrontEnds.begin() + id);
-            for (int i = 0; i < howMany; i++) {
-                f.push_back(listAllPcmInCallMusicFrontEnds.at(id));
-                listAllPcmInCallMusicFrontEnds.erase(it);
-                PAL_ERR(LOG_TAG, "allocateFrontEndIds: front end %d", f[i]);
-                it -= 1;
-                id -= 1;
-            }
-            break;
-       case PAL_STREAM_CONTEXT_PROXY:
-       case PAL_STREAM_COMMON_PROXY:
-            if (howMany > listAllPcmContextProxyFrontEnds.size()) {
-                    PAL_ERR(LOG_TAG, "allocateFrontEndIds: requested for %d front ends, have only %zu error",
-                                      howMany, listAllPcmContextProxyFrontEnds.size());
-                    goto error;
-                }
-            id = (listAllPcmContextProxyFrontEnds.size() - 1);
-            it = (listAllPcmContextProxyFrontEnds.begin() + id);
-            for (int i = 0; i < howMany; i++) {
-                f.push_back(listAllPcmContextProxyFrontEnds.at(id));
-                listAllPcmContextProxyFrontEnds.erase(it);
-                PAL_ERR(LOG_TAG, "allocateFrontEndIds: front end %d", f[i]);
-                it -= 1;
-                id -= 1;
-            }
-            break;
-        default:
-            break;
-    }
-
-error:
-    mListFrontEndsMutex.unlock();
-    return f;
-}
-
-
-const std::vector<int> ResourceManager::allocateVoiceFrontEndIds(std::vector<int> listAllPcmVoiceFrontEnds, const int howMany)
-{
-    std::vector<int> f;
-    f.clear();
-    if ( howMany > listAllPcmVoiceFrontEnds.size()) {
-        PAL_ERR(LOG_TAG, "allocate voice FrontEndIds: requested for %d front ends, have only %zu error",
-                howMany, listAllPcmVoiceFrontEnds.size());
-        return f;
-    }
-    for (int i = 0; i < howMany; i++) {
-        f.push_back(listAllPcmVoiceFrontEnds.back());
-        listAllPcmVoiceFrontEnds.pop_back();
-        PAL_INFO(LOG_TAG, "allocate VoiceFrontEndIds: front end %d", f[i]);
-    }
-
-    return f;
-}
-void ResourceManager::freeFrontEndIds(const std::vector<int> frontend,
-                                      const struct pal_stream_attributes &sAttr,
-                                      int lDirection)
-{
-    mListFrontEndsMutex.lock();
-    if (frontend.size() <= 0) {
-        PAL_ERR(LOG_TAG,"frontend size is invalid");
-        mListFrontEndsMutex.unlock();
-        return;
-    }
-    PAL_INFO(LOG_TAG, "stream type %d, freeing %d\n", sAttr.type,
-             frontend.at(0));
-
-    switch(sAttr.type) {
-        case PAL_STREAM_NON_TUNNEL:
-            for (int i = 0; i < frontend.size(); i++) {
-                 listAllNonTunnelSessionIds.push_back(frontend.at(i));
-            }
-            removeDuplicates(listAllNonTunnelSessionIds);
-            break;
-        case PAL_STREAM_LOW_LATENCY:
-        case PAL_STREAM_ULTRA_LOW_LATENCY:
-        case PAL_STREAM_GENERIC:
-        case PAL_STREAM_PROXY:
-        case PAL_STREAM_DEEP_BUFFER:
-        case PAL_STREAM_SPATIAL_AUDIO:
-        case PAL_STREAM_VOIP:
-        case PAL_STREAM_VOIP_RX:
-        case PAL_STREAM_VOIP_TX:
-        case PAL_STREAM_VOICE_UI:
-        case PAL_STREAM_LOOPBACK:
-        case PAL_STREAM_ACD:
-        case PAL_STREAM_PCM_OFFLOAD:
-        case PAL_STREAM_HAPTICS:
-        case PAL_STREAM_ULTRASOUND:
-        case PAL_STREAM_SENSOR_PCM_DATA:
-        case PAL_STREAM_RAW:
-        case PAL_STREAM_VOICE_RECOGNITION:
-            switch (sAttr.direction) {
-                case PAL_AUDIO_INPUT:
-                    if (lDirection == TX_HOSTLESS) {
-                        for (int i = 0; i < frontend.size(); i++) {
-                            listAllPcmHostlessTxFrontEnds.push_back(frontend.at(i));
-                        }
-                        removeDuplicates(listAllPcmHostlessTxFrontEnds);
-                    } else {
-                        for (int i = 0; i < frontend.size(); i++) {
-                            listAllPcmRecordFrontEnds.push_back(frontend.at(i));
-                        }
-                        removeDuplicates(listAllPcmRecordFrontEnds);
-                    }
-                    break;
-                case PAL_AUDIO_OUTPUT:
-                    if (lDirection == RX_HOSTLESS) {
-                        for (int i = 0; i < frontend.size(); i++) {
-                            listAllPcmHostlessRxFrontEnds.push_back(frontend.at(i));
-                        }
-                        removeDuplicates(listAllPcmHostlessRxFrontEnds);
-                    } else {
-                        for (int i = 0; i < frontend.size(); i++) {
-                             listAllPcmPlaybackFrontEnds.push_back(frontend.at(i));
-                        }
-                        removeDuplicates(listAllPcmPlaybackFrontEnds);
-                    }
-                    break;
+                case PAL_AUDIO_INPUT:
+                    return lDirection == TX_HOSTLESS ? PAL_FE_POOL_PCM_HOSTLESS_TX :
+                                                       PAL_FE_POOL_PCM_RECORD;
+                case PAL_AUDIO_OUTPUT:
+                    return lDirection == RX_HOSTLESS ? PAL_FE_POOL_PCM_HOSTLESS_RX :
+                                                       PAL_FE_POOL_PCM_PLAYBACK;
                 case PAL_AUDIO_INPUT | PAL_AUDIO_OUTPUT:
-                    if (lDirection == RX_HOSTLESS) {
-                        for (int i = 0; i < frontend.size(); i++) {
-                            listAllPcmHostlessRxFrontEnds.push_back(frontend.at(i));
-                        }
-                        removeDuplicates(listAllPcmHostlessRxFrontEnds);
-                    } else {
-                        for (int i = 0; i < frontend.size(); i++) {
-                            listAllPcmHostlessTxFrontEnds.push_back(frontend.at(i));
-                        }
-                        removeDuplicates(listAllPcmHostlessTxFrontEnds);
-                    }
-                    break;
+                    return lDirection == RX_HOSTLESS ? PAL_FE_POOL_PCM_HOSTLESS_RX :
+                                                       PAL_FE_POOL_PCM_HOSTLESS_TX;
                 default:
                     PAL_ERR(LOG_TAG,"direction unsupported");
                     break;
             }
             break;
-
-        case PAL_STREAM_VOICE_CALL:
-            if (lDirection == RX_HOSTLESS) {
-                for (int i = 0; i < frontend.size(); i++) {
-                    if (sAttr.info.voice_call_info.VSID == VOICEMMODE1 ||
-                        sAttr.info.voice_call_info.VSID == VOICELBMMODE1) {
-                        listAllPcmVoice1RxFrontEnds.push_back(frontend.at(i));
-                    } else {
-                        listAllPcmVoice2RxFrontEnds.push_back(frontend.at(i));
-                    }
-
-                }
-                removeDuplicates(listAllPcmVoice1RxFrontEnds);
-                removeDuplicates(listAllPcmVoice2RxFrontEnds);
-            } else {
-                for (int i = 0; i < frontend.size(); i++) {
-                    if (sAttr.info.voice_call_info.VSID == VOICEMMODE1 ||
-                        sAttr.info.voice_call_info.VSID == VOICELBMMODE1) {
-                        listAllPcmVoice1TxFrontEnds.push_back(frontend.at(i));
-                    } else {
-                        listAllPcmVoice2TxFrontEnds.push_back(frontend.at(i));
-                    }
-                }
-                removeDuplicates(listAllPcmVoice1TxFrontEnds);
-                removeDuplicates(listAllPcmVoice2TxFrontEnds);
-            }
-            break;
-
         case PAL_STREAM_COMPRESSED:
             switch (sAttr.direction) {
                 case PAL_AUDIO_INPUT:
-                    for (int i = 0; i < frontend.size(); i++) {
-                        listAllCompressRecordFrontEnds.push_back(frontend.at(i));
-                    }
-                    removeDuplicates(listAllCompressRecordFrontEnds);
-                    break;
+                    return PAL_FE_POOL_COMPRESS_RECORD;
                 case PAL_AUDIO_OUTPUT:
-                    for (int i = 0; i < frontend.size(); i++) {
-                        listAllCompressPlaybackFrontEnds.push_back(frontend.at(i));
-                    }
-                    removeDuplicates(listAllCompressPlaybackFrontEnds);
-                    break;
+                    return PAL_FE_POOL_COMPRESS_PLAYBACK;
                 default:
                     PAL_ERR(LOG_TAG,"direction unsupported");
                     break;
-                }
+            }
             break;
-        case PAL_STREAM_VOICE_CALL_RECORD:
-        case PAL_STREAM_VOICE_CALL_MUSIC:
-            switch (sAttr.direction) {
-              case PAL_AUDIO_INPUT:
-                for (int i = 0; i < frontend.size(); i++) {
-                    listAllPcmInCallRecordFrontEnds.push_back(frontend.at(i));
-                }
-                removeDuplicates(listAllPcmInCallRecordFrontEnds);
-                break;
-              case PAL_AUDIO_OUTPUT:
-                for (int i = 0; i < frontend.size(); i++) {
-                    listAllPcmInCallMusicFrontEnds.push_back(frontend.at(i));
-                }
-                removeDuplicates(listAllPcmInCallMusicFrontEnds);
-                break;
-              default:
+        case PAL_STREAM_VOICE_CALL:
+            if (sAttr.direction != (PAL_AUDIO_INPUT | PAL_AUDIO_OUTPUT)) {
+                PAL_ERR(LOG_TAG,"direction unsupported voice must be RX and TX");
                 break;
             }
-            break;
-       case PAL_STREAM_CONTEXT_PROXY:
-       case PAL_STREAM_COMMON_PROXY:
-            for (int i = 0; i < frontend.size(); i++) {
-                 listAllPcmContextProxyFrontEnds.push_back(frontend.at(i));
+            if (sAttr.info.voice_call_info.VSID == VOICEMMODE1 ||
+                sAttr.info.voice_call_info.VSID == VOICELBMMODE1) {
+                voice1 = true;
+            } else if (sAttr.info.voice_call_info.VSID != VOICEMMODE2 &&
+                       sAttr.info.voice_call_info.VSID != VOICELBMMODE2) {
+                PAL_ERR(LOG_TAG,"invalid VSID 0x%x provided",
+                        sAttr.info.voice_call_info.VSID);
+                break;
             }
-            removeDuplicates(listAllPcmContextProxyFrontEnds);
-            break;
+            if (lDirection == RX_HOSTLESS)
+                return voice1 ? PAL_FE_POOL_VOICE1_RX : PAL_FE_POOL_VOICE2_RX;
+            return voice1 ? PAL_FE_POOL_VOICE1_TX : PAL_FE_POOL_VOICE2_TX;
+        case PAL_STREAM_VOICE_CALL_RECORD:
+            return PAL_FE_POOL_INCALL_RECORD;
+        case PAL_STREAM_VOICE_CALL_MUSIC:
+            return PAL_FE_POOL_INCALL_MUSIC;
+        case PAL_STREAM_CONTEXT_PROXY:
+        case PAL_STREAM_COMMON_PROXY:
+            return PAL_FE_POOL_CONTEXT_PROXY;
         default:
             break;
     }
-    mListFrontEndsMutex.unlock();
+    return PAL_FE_POOL_MAX;
+}
+
+const std::vector<int> ResourceManager::allocateFrontEndIds(const struct pal_stream_attributes &sAttr, int lDirection)
+{
+    std::vector<int> f;
+    const int howMany = getNumFEs(sAttr.type);
+    pal_fe_pool_t pool = getFrontEndPool(sAttr, lDirection);
+    int id = 0;
+
+    if (pool == PAL_FE_POOL_MAX)
+        return f;
+
+    for (int i = 0; i < howMany; i++) {
+        id = fePools[pool].allocate();
+        if (id < 0) {
+            PAL_ERR(LOG_TAG, "allocateFrontEndIds: requested for %d front ends of class %d, have only %u error",
+                    howMany, pool, fePools[pool].size());
+            goto error;
+        }
+        f.push_back(id);
+        PAL_INFO(LOG_TAG, "allocateFrontEndIds: front end %d", id);
+    }
+    return f;
+
+error:
+    for (int i = 0; i < f.size(); i++)
+        fePools[pool].release(f[i]);
+    f.clear();
+    return f;
+}
+
+void ResourceManager::freeFrontEndIds(const std::vector<int> frontend,
+                                      const struct pal_stream_attributes &sAttr,
+                                      int lDirection)
+{
+    pal_fe_pool_t pool = PAL_FE_POOL_MAX;
+
+    if (frontend.size() <= 0) {
+        PAL_ERR(LOG_TAG,"frontend size is invalid");
+        return;
+    }
+    PAL_INFO(LOG_TAG, "stream type %d, freeing %d\n", sAttr.type,
+             frontend.at(0));
+
+    pool = getFrontEndPool(sAttr, lDirection);
+    if (pool == PAL_FE_POOL_MAX)
+        return;
+    for (int i = 0; i < frontend.size(); i++)
+        fePools[pool].release(frontend.at(i));
     return;
 }
 
@@ -7943,7 +7480,7 @@ int32_t ResourceManager::streamDevDisconnect(std::vector <std::tuple<Stream *, u
 
     /* disconnect active list from the current devices they are attached to */
     for (sIter = streamDevDisconnectList.begin(); sIter != streamDevDisconnectList.end(); sIter++) {
-        if ((std::get<0>(*sIter) != NULL) && isStreamActive(std::get<0>(*sIter), mActiveStreams)) {
+        if ((std::get<0>(*sIter) != NULL) && mStreamRegistry.contains(std::get<0>(*sIter))) {
             status = (std::get<0>(*sIter))->disconnectStreamDevice(std::get<0>(*sIter), (pal_device_id_t)std::get<1>(*sIter));
             if (status) {
                 PAL_ERR(LOG_TAG, "failed to disconnect stream %pK from device %d",
@@ -7967,7 +7504,7 @@ int32_t ResourceManager::streamDevConnect(std::vector <std::tuple<Stream *, stru
     PAL_DBG(LOG_TAG, "Enter");
     /* connect active list from the current devices they are attached to */
     for (sIter = streamDevConnectList.begin(); sIter != streamDevConnectList.end(); sIter++) {
-        if ((std::get<0>(*sIter) != NULL) && isStreamActive(std::get<0>(*sIter), mActiveStreams)) {
+        if ((std::get<0>(*sIter) != NULL) && mStreamRegistry.contains(std::get<0>(*sIter))) {
             status = std::get<0>(*sIter)->connectStreamDevice(std::get<0>(*sIter), std::get<1>(*sIter));
             if (status) {
                 PAL_ERR(LOG_TAG,"failed to connect stream %pK from device %d",
@@ -7984,26 +7521,114 @@ error:
     return status;
 }
 
+/*
+ * Device switch planner: a playback stream only reconfigures its own session
+ * graph and the devices it uses, which serialize themselves, so with more
+ * than one playback stream in a switch each of them is switched on its own
+ * thread. The EC reference ties capture streams to the playback devices,
+ * those and all other streams are switched on the calling thread, before
+ * the playback streams on disconnect and after them on connect. The stream
+ * mutexes stay owned by the calling thread.
+ *
+ * The workers only overlap outside mGraphMutex: session graph and mixer
+ * setup is still done one stream at a time, mDevices changes are guarded
+ * by the stream's mDevicesMutex for the lookups the other workers do, and
+ * the mixer round trips a worker commits are credited to the calling
+ * thread after the join.
+ *
+ * Off by default: connect/disconnect also register the devices, which
+ * reconfigures EC on capture streams outside mGraphMutex and concurrently
+ * with the other workers. "parallel_device_switch=true" turns it on.
+ */
+template <class T>
+static void planDevSwitch(std::vector <std::tuple<Stream *, T>> &ops,
+                          std::vector <std::pair<Stream *, std::vector<T>>> &parallelOps,
+                          std::vector <std::tuple<Stream *, T>> &serialOps)
+{
+    std::vector <Stream *> playback;
+    struct pal_stream_attributes sAttr;
+    Stream *s = NULL;
+
+    for (auto &op : ops) {
+        s = std::get<0>(op);
+        if (ResourceManager::isParallelDevSwitchEnabled &&
+            !s->getStreamAttributes(&sAttr) && sAttr.direction == PAL_AUDIO_OUTPUT &&
+            std::find(playback.begin(), playback.end(), s) == playback.end())
+            playback.push_back(s);
+    }
+    if (playback.size() < 2)
+        playback.clear();
+
+    for (auto &op : ops) {
+        s = std::get<0>(op);
+        if (std::find(playback.begin(), playback.end(), s) == playback.end()) {
+            serialOps.push_back(op);
+            continue;
+        }
+        auto it = std::find_if(parallelOps.begin(), parallelOps.end(),
+                [s](const std::pair<Stream *, std::vector<T>> &p) { return p.first == s; });
+        if (it == parallelOps.end())
+            parallelOps.emplace_back(s, std::vector<T>{std::get<1>(op)});
+        else
+            it->second.push_back(std::get<1>(op));
+    }
+}
+
 int32_t ResourceManager::streamDevDisconnect_l(std::vector <std::tuple<Stream *, uint32_t>> streamDevDisconnectList){
     int status = 0;
+    std::vector <std::tuple<Stream *, uint32_t>> activeList, serialList;
+    std::vector <std::pair<Stream *, std::vector<uint32_t>>> parallelList;
     std::vector <std::tuple<Stream *, uint32_t>>::iterator sIter;
+    std::vector <std::thread> workers;
+    std::vector <int32_t> results;
+    std::vector <uint64_t> mixerWrites;
+    PAL_TRACE_SPAN("streamDevDisconnect");
 
     PAL_DBG(LOG_TAG, "Enter");
 
-    /* disconnect active list from the current devices they are attached to */
     for (sIter = streamDevDisconnectList.begin(); sIter != streamDevDisconnectList.end(); sIter++) {
-        if ((std::get<0>(*sIter) != NULL) && isStreamActive(std::get<0>(*sIter), mActiveStreams)) {
-            status = (std::get<0>(*sIter))->disconnectStreamDevice_l(std::get<0>(*sIter), (pal_device_id_t)std::get<1>(*sIter));
-            if (status) {
-                PAL_ERR(LOG_TAG, "failed to disconnect stream %pK from device %d",
-                        std::get<0>(*sIter), std::get<1>(*sIter));
-                goto error;
-            } else {
-                PAL_DBG(LOG_TAG, "disconnect stream %pK from device %d",
-                       std::get<0>(*sIter), std::get<1>(*sIter));
-            }
+        if ((std::get<0>(*sIter) != NULL) && mStreamRegistry.contains(std::get<0>(*sIter)))
+            activeList.push_back(*sIter);
+    }
+    planDevSwitch(activeList, parallelList, serialList);
+
+    /* disconnect active list from the current devices they are attached to */
+    for (sIter = serialList.begin(); sIter != serialList.end(); sIter++) {
+        status = (std::get<0>(*sIter))->disconnectStreamDevice_l(std::get<0>(*sIter), (pal_device_id_t)std::get<1>(*sIter));
+        if (status) {
+            PAL_ERR(LOG_TAG, "failed to disconnect stream %pK from device %d",
+                    std::get<0>(*sIter), std::get<1>(*sIter));
+            goto error;
+        } else {
+            PAL_DBG(LOG_TAG, "disconnect stream %pK from device %d",
+                   std::get<0>(*sIter), std::get<1>(*sIter));
         }
     }
+
+    results.resize(parallelList.size(), 0);
+    mixerWrites.resize(parallelList.size(), 0);
+    for (size_t i = 0; i < parallelList.size(); i++) {
+        workers.emplace_back([&parallelList, &results, &mixerWrites, i] {
+            Stream *s = parallelList[i].first;
+
+            for (uint32_t devId : parallelList[i].second) {
+                results[i] = s->disconnectStreamDevice_l(s, (pal_device_id_t)devId);
+                if (results[i]) {
+                    PAL_ERR(LOG_TAG, "failed to disconnect stream %pK from device %d",
+                            s, devId);
+                    break;
+                }
+                PAL_DBG(LOG_TAG, "disconnect stream %pK from device %d", s, devId);
+            }
+            mixerWrites[i] = MixerTransaction::getThreadRoundTrips();
+        });
+    }
+    for (size_t i = 0; i < workers.size(); i++) {
+        workers[i].join();
+        MixerTransaction::addThreadRoundTrips(mixerWrites[i]);
+        if (results[i] && !status)
+            status = results[i];
+    }
 error:
     PAL_DBG(LOG_TAG, "Exit status: %d", status);
     return status;
@@ -8011,28 +7636,103 @@ error:
 
 int32_t ResourceManager::streamDevConnect_l(std::vector <std::tuple<Stream *, struct pal_device *>> streamDevConnectList){
     int status = 0;
+    int ret = 0;
+    std::vector <std::tuple<Stream *, struct pal_device *>> activeList, serialList;
+    std::vector <std::pair<Stream *, std::vector<struct pal_device *>>> parallelList;
     std::vector <std::tuple<Stream *, struct pal_device *>>::iterator sIter;
+    std::vector <std::thread> workers;
+    std::vector <int32_t> results;
+    std::vector <uint64_t> mixerWrites;
+    PAL_TRACE_SPAN("streamDevConnect");
 
     PAL_DBG(LOG_TAG, "Enter");
-    /* connect active list from the current devices they are attached to */
     for (sIter = streamDevConnectList.begin(); sIter != streamDevConnectList.end(); sIter++) {
-        if ((std::get<0>(*sIter) != NULL) && isStreamActive(std::get<0>(*sIter), mActiveStreams)) {
-            status = std::get<0>(*sIter)->connectStreamDevice_l(std::get<0>(*sIter), std::get<1>(*sIter));
-            if (status) {
-                PAL_ERR(LOG_TAG,"failed to connect stream %pK from device %d",
-                        std::get<0>(*sIter), (std::get<1>(*sIter))->id);
-            } else {
-                PAL_DBG(LOG_TAG,"connected stream %pK from device %d",
-                        std::get<0>(*sIter), (std::get<1>(*sIter))->id);
+        if ((std::get<0>(*sIter) != NULL) && mStreamRegistry.contains(std::get<0>(*sIter)))
+            activeList.push_back(*sIter);
+    }
+    planDevSwitch(activeList, parallelList, serialList);
+
+    /* connect active list from the current devices they are attached to */
+    results.resize(parallelList.size(), 0);
+    mixerWrites.resize(parallelList.size(), 0);
+    for (size_t i = 0; i < parallelList.size(); i++) {
+        workers.emplace_back([&parallelList, &results, &mixerWrites, i] {
+            Stream *s = parallelList[i].first;
+
+            for (struct pal_device *dattr : parallelList[i].second) {
+                int32_t ret = s->connectStreamDevice_l(s, dattr);
+                if (ret) {
+                    PAL_ERR(LOG_TAG, "failed to connect stream %pK from device %d",
+                            s, dattr->id);
+                    results[i] = ret;
+                } else {
+                    PAL_DBG(LOG_TAG, "connected stream %pK from device %d", s, dattr->id);
+                }
             }
-            std::get<0>(*sIter)->unlockStreamMutex();
+            mixerWrites[i] = MixerTransaction::getThreadRoundTrips();
+        });
+    }
+    for (size_t i = 0; i < workers.size(); i++) {
+        workers[i].join();
+        MixerTransaction::addThreadRoundTrips(mixerWrites[i]);
+        if (results[i])
+            status = results[i];
+        /* the workers do not own the stream mutexes, release them here */
+        for (size_t j = 0; j < parallelList[i].second.size(); j++)
+            parallelList[i].first->unlockStreamMutex();
+    }
+
+    for (sIter = serialList.begin(); sIter != serialList.end(); sIter++) {
+        ret = std::get<0>(*sIter)->connectStreamDevice_l(std::get<0>(*sIter), std::get<1>(*sIter));
+        if (ret) {
+            PAL_ERR(LOG_TAG,"failed to connect stream %pK from device %d",
+                    std::get<0>(*sIter), (std::get<1>(*sIter))->id);
+            status = ret;
+        } else {
+            PAL_DBG(LOG_TAG,"connected stream %pK from device %d",
+                    std::get<0>(*sIter), (std::get<1>(*sIter))->id);
         }
+        std::get<0>(*sIter)->unlockStreamMutex();
     }
 
     PAL_DBG(LOG_TAG, "Exit status: %d", status);
     return status;
 }
 
+/*
+ * Wait until the pcm the muted streams had queued before the mute has been
+ * consumed, at most latencyMuteFactor times the longest stream latency.
+ * Streams which were idle when muted do not hold up the switch, streams
+ * which never reported a write wait for the whole deadline as before.
+ */
+void ResourceManager::waitForMuteDrain(std::vector <Stream *> &mutedStreams, uint32_t maxLatencyMs)
+{
+    // multiplication factor applied to latency when calculating a safe mute delay
+    const int latencyMuteFactor = 2;
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() +
+        std::chrono::milliseconds(maxLatencyMs * latencyMuteFactor);
+    std::vector <Stream *> pinned;
+
+    /* keep the streams from being closed while waiting without the lock */
+    mActiveStreamMutex.lock();
+    for (auto str : mutedStreams) {
+        if (mStreamRegistry.contains(str) && !increaseStreamUserCounter(str))
+            pinned.push_back(str);
+    }
+    mActiveStreamMutex.unlock();
+
+    for (auto str : pinned) {
+        if (!str->waitMuteDrain(deadline))
+            PAL_DBG(LOG_TAG, "stream %pK not drained within %u ms", str,
+                    maxLatencyMs * latencyMuteFactor);
+    }
+
+    mActiveStreamMutex.lock();
+    for (auto str : pinned)
+        decreaseStreamUserCounter(str);
+    mActiveStreamMutex.unlock();
+}
+
 
 template <class T>
 void SortAndUnique(std::vector<T> &streams)
@@ -8063,6 +7763,8 @@ int32_t ResourceManager::streamDevSwitch(std::vector <std::tuple<Stream *, uint3
         status = -EINVAL;
         goto exit_no_unlock;
     }
+    /* parked graphs keep their old devices, drop them rather than reroute */
+    SessionPool::invalidate();
     mActiveStreamMutex.lock();
 
     SortAndUnique(streamDevDisconnectList);
@@ -8074,14 +7776,14 @@ int32_t ResourceManager::streamDevSwitch(std::vector <std::tuple<Stream *, uint3
      * middle of the switch
      */
     for (sIter1 = streamDevDisconnectList.begin(); sIter1 != streamDevDisconnectList.end(); sIter1++) {
-        if ((std::get<0>(*sIter1) != NULL) && isStreamActive(std::get<0>(*sIter1), mActiveStreams)) {
+        if ((std::get<0>(*sIter1) != NULL) && mStreamRegistry.contains(std::get<0>(*sIter1))) {
             uniqueStreamsList.push_back(std::get<0>(*sIter1));
             PAL_VERBOSE(LOG_TAG, "streamDevDisconnectList stream %pK", std::get<0>(*sIter1));
         }
     }
 
     for (sIter2 = streamDevConnectList.begin(); sIter2 != streamDevConnectList.end(); sIter2++) {
-        if ((std::get<0>(*sIter2) != NULL) && isStreamActive(std::get<0>(*sIter2), mActiveStreams)) {
+        if ((std::get<0>(*sIter2) != NULL) && mStreamRegistry.contains(std::get<0>(*sIter2))) {
             uniqueStreamsList.push_back(std::get<0>(*sIter2));
             PAL_VERBOSE(LOG_TAG, "streamDevConnectList stream %pK", std::get<0>(*sIter2));
             uniqueDevConnectionList.push_back(std::get<1>(*sIter2));
@@ -8140,7 +7842,7 @@ int32_t ResourceManager::streamDevSwitch(std::vector <std::tuple<Stream *, uint3
     }
 
     for (sIter2 = streamDevConnectList.begin(); sIter2 != streamDevConnectList.end(); sIter2++) {
-        if ((std::get<0>(*sIter2) != NULL) && isStreamActive(std::get<0>(*sIter2), mActiveStreams)) {
+        if ((std::get<0>(*sIter2) != NULL) && mStreamRegistry.contains(std::get<0>(*sIter2))) {
             for (sIter = uniqueStreamsList.begin(); sIter != uniqueStreamsList.end(); sIter++) {
                 if (*sIter == std::get<0>(*sIter2)) {
                     uniqueStreamsList.erase(sIter);
@@ -8317,7 +8019,7 @@ int32_t ResourceManager::forceDeviceSwitch(std::shared_ptr<Device> inDev,
     if (!status) {
         mActiveStreamMutex.lock();
         for (sIter = activeStreams.begin(); sIter != activeStreams.end(); sIter++) {
-            if (((*sIter) != NULL) && isStreamActive(*sIter, mActiveStreams)) {
+            if (((*sIter) != NULL) && mStreamRegistry.contains(*sIter)) {
                 (*sIter)->lockStreamMutex();
                 if (ResourceManager::isDummyDevEnabled) {
                     (*sIter)->removePalDevice(*sIter, inDev->getSndDeviceId());
@@ -8355,7 +8057,7 @@ int32_t ResourceManager::forceDeviceSwitch(std::shared_ptr<Device> inDev,
     // create dev switch vectors
     mActiveStreamMutex.lock();
     for (sIter = prevActiveStreams.begin(); sIter != prevActiveStreams.end(); sIter++) {
-        if (((*sIter) != NULL) && isStreamActive((*sIter), mActiveStreams)) {
+        if (((*sIter) != NULL) && mStreamRegistry.contains((*sIter))) {
             if (!isValidDeviceSwitchForStream((*sIter), newDevAttr->id)) {
                 if (*sIter != NULL)
                     streamsSkippingSwitch.push_back({(*sIter), inDev->getSndDeviceId()});
@@ -8405,7 +8107,7 @@ int32_t ResourceManager::forceDeviceSwitch(std::shared_ptr<Device> inDev,
     if (!status) {
         mActiveStreamMutex.lock();
         for (sIter = prevActiveStreams.begin(); sIter != prevActiveStreams.end(); sIter++) {
-            if (((*sIter) != NULL) && isStreamActive(*sIter, mActiveStreams)) {
+            if (((*sIter) != NULL) && mStreamRegistry.contains(*sIter)) {
                 (*sIter)->lockStreamMutex();
                 if (ResourceManager::isDummyDevEnabled) {
                     (*sIter)->removePalDevice(*sIter, inDev->getSndDeviceId());
@@ -8696,6 +8398,9 @@ int ResourceManager::setConfigParams(struct str_parms *parms)
     ret = setUpdVirtualPortParam(parms, value, len);
     setXPANEnableParam(parms, value, len);
     setDummyDevEnableParam(parms, value, len);
+    setParallelDevSwitchParam(parms, value, len);
+    setGraphKeepAliveParam(parms, value, len);
+    setDebugDumpMaxFilesParam(parms, value, len);
 
     ret = setHapticsPriorityParam(parms, value, len);
     ret = setHapticsDrivenParam(parms, value, len);
@@ -8969,6 +8674,68 @@ void ResourceManager::setDummyDevEnableParam(struct str_parms *parms, char *valu
     }
 }
 
+void ResourceManager::setParallelDevSwitchParam(struct str_parms *parms, char *value, int len)
+{
+    int ret = -EINVAL;
+
+    if (!value || !parms)
+        return;
+
+    ret = str_parms_get_str(parms, AUDIO_PARAMETER_KEY_PARALLEL_DEVICE_SWITCH,
+                            value, len);
+
+    if (ret >= 0) {
+        PAL_VERBOSE(LOG_TAG," value %s", value);
+
+        if (value && !strncmp(value, "true", sizeof("true")))
+            ResourceManager::isParallelDevSwitchEnabled = true;
+        else if (value && !strncmp(value, "false", sizeof("false")))
+            ResourceManager::isParallelDevSwitchEnabled = false;
+
+        str_parms_del(parms, AUDIO_PARAMETER_KEY_PARALLEL_DEVICE_SWITCH);
+    }
+}
+
+void ResourceManager::setGraphKeepAliveParam(struct str_parms *parms, char *value, int len)
+{
+    int ret = -EINVAL;
+
+    if (!value || !parms)
+        return;
+
+    ret = str_parms_get_str(parms, AUDIO_PARAMETER_KEY_GRAPH_KEEP_ALIVE_TTL,
+                            value, len);
+
+    if (ret >= 0) {
+        PAL_VERBOSE(LOG_TAG," value %s", value);
+
+        if (value)
+            SessionPool::setTtl((uint32_t)strtoul(value, NULL, 10));
+
+        str_parms_del(parms, AUDIO_PARAMETER_KEY_GRAPH_KEEP_ALIVE_TTL);
+    }
+}
+
+void ResourceManager::setDebugDumpMaxFilesParam(struct str_parms *parms, char *value, int len)
+{
+    int ret = -EINVAL;
+
+    if (!value || !parms)
+        return;
+
+    ret = str_parms_get_str(parms, AUDIO_PARAMETER_KEY_DEBUG_DUMP_MAX_FILES,
+                            value, len);
+
+    if (ret >= 0) {
+        PAL_VERBOSE(LOG_TAG," value %s", value);
+
+        if (value)
+            PalDumpWriter::setMaxFiles((uint32_t)strtoul(value, NULL, 10));
+
+        str_parms_del(parms, AUDIO_PARAMETER_KEY_DEBUG_DUMP_MAX_FILES);
+    }
+}
+
 
 
 
@@ -9165,6 +8932,7 @@ int32_t ResourceManager::a2dpReconfig()
     struct pal_device a2dpDattr;
     std::vector <Stream*> activeA2dpStreams;
     std::vector <Stream*> activeStreams;
+    std::vector <Stream*> drainStreams;
     std::vector <Stream*>::iterator sIter;
     struct pal_volume_data* volume = NULL;
 
@@ -9200,7 +8968,7 @@ int32_t ResourceManager::a2dpReconfig()
         goto exit;
     }
     for (sIter = activeA2dpStreams.begin(); sIter != activeA2dpStreams.end(); sIter++) {
-        if (((*sIter) != NULL) && isStreamActive(*sIter, mActiveStreams)) {
+        if (((*sIter) != NULL) && mStreamRegistry.contains(*sIter)) {
             (*sIter)->lockStreamMutex();
             if (!((*sIter)->a2dpMuted)) {
                 struct pal_stream_attributes sAttr;
@@ -9228,6 +8996,8 @@ int32_t ResourceManager::a2dpReconfig()
                     // Mute
                     (*sIter)->mute_l(true);
                     (*sIter)->a2dpMuted = true;
+                    (*sIter)->markMuteDrain();
+                    drainStreams.push_back(*sIter);
                 }
             }
             (*sIter)->unlockStreamMutex();
@@ -9237,18 +9007,14 @@ int32_t ResourceManager::a2dpReconfig()
     mActiveStreamMutex.unlock();
 
     // wait for stale pcm drained before switching to speaker
-    if (maxLatencyMs > 0) {
-        // multiplication factor applied to latency when calculating a safe mute delay
-        // TODO: It's not needed if latency is accurate.
-        const int latencyMuteFactor = 2;
-        usleep(maxLatencyMs * 1000 * latencyMuteFactor);
-    }
+    if (maxLatencyMs > 0)
+        waitForMuteDrain(drainStreams, maxLatencyMs);
 
     forceDeviceSwitch(a2dpDev, &a2dpDattr);
 
     mActiveStreamMutex.lock();
     for (sIter = activeA2dpStreams.begin(); sIter != activeA2dpStreams.end(); sIter++) {
-        if (((*sIter) != NULL) && isStreamActive(*sIter, mActiveStreams)) {
+        if (((*sIter) != NULL) && mStreamRegistry.contains(*sIter)) {
             (*sIter)->lockStreamMutex();
             struct pal_stream_attributes sAttr;
             (*sIter)->getStreamAttributes(&sAttr);
@@ -9334,7 +9100,7 @@ int32_t ResourceManager::a2dpSuspendToDummy(pal_device_id_t dev_id)
     }
 
     for (sIter = activeA2dpStreams.begin(); sIter != activeA2dpStreams.end(); sIter++) {
-        if (((*sIter) != NULL) && isStreamActive(*sIter, mActiveStreams)) {
+        if (((*sIter) != NULL) && mStreamRegistry.contains(*sIter)) {
             (*sIter)->lockStreamMutex();
             associatedDevices.clear();
             status = (*sIter)->getAssociatedDevices(associatedDevices);
@@ -9371,7 +9137,7 @@ int32_t ResourceManager::a2dpSuspendToDummy(pal_device_id_t dev_id)
 
     mActiveStreamMutex.lock();
     for (sIter = activeA2dpStreams.begin(); sIter != activeA2dpStreams.end(); sIter++) {
-        if (((*sIter) != NULL) && isStreamActive(*sIter, mActiveStreams)) {
+        if (((*sIter) != NULL) && mStreamRegistry.contains(*sIter)) {
             (*sIter)->lockStreamMutex();
             (*sIter)->removePalDevice(*sIter, a2dpDattr.id);
             if ((*sIter)->suspendedDevIds.size() == 1) {
@@ -9517,7 +9283,7 @@ int32_t ResourceManager::a2dpResumeFromDummy(pal_device_id_t dev_id)
         PAL_ERR(LOG_TAG, "Sound card offline");
         mActiveStreamMutex.lock();
         for (sIter = restoredStreams.begin(); sIter != restoredStreams.end(); sIter++) {
-            if (((*sIter) != NULL) && isStreamActive(*sIter, mActiveStreams)) {
+            if (((*sIter) != NULL) && mStreamRegistry.contains(*sIter)) {
                 (*sIter)->lockStreamMutex();
                 if (std::find((*sIter)->suspendedDevIds.begin(), (*sIter)->suspendedDevIds.end(),
                     a2dpDattr.id) != (*sIter)->suspendedDevIds.end()) {
@@ -9549,7 +9315,7 @@ int32_t ResourceManager::a2dpResumeFromDummy(pal_device_id_t dev_id)
 
     mActiveStreamMutex.lock();
     for (sIter = restoredStreams.begin(); sIter != restoredStreams.end(); sIter++) {
-        if (((*sIter) != NULL) && isStreamActive(*sIter, mActiveStreams)) {
+        if (((*sIter) != NULL) && mStreamRegistry.contains(*sIter)) {
             (*sIter)->lockStreamMutex();
             // update PAL devices for the restored streams
             if ((*sIter)->suspendedDevIds.size() == 1 /* non-combo */) {
@@ -9633,7 +9399,7 @@ int32_t ResourceManager::a2dpCaptureSuspendToDummy(pal_device_id_t dev_id)
     }
 
     for (sIter = activeA2dpStreams.begin(); sIter != activeA2dpStreams.end(); sIter++) {
-        if (((*sIter) != NULL) && isStreamActive(*sIter, mActiveStreams)) {
+        if (((*sIter) != NULL) && mStreamRegistry.contains(*sIter)) {
             (*sIter)->lockStreamMutex();
             if (!((*sIter)->a2dpMuted) && !((*sIter)->mute_l(true))) {
                 (*sIter)->a2dpMuted = true;
@@ -9654,7 +9420,7 @@ int32_t ResourceManager::a2dpCaptureSuspendToDummy(pal_device_id_t dev_id)
 
     mActiveStreamMutex.lock();
     for (sIter = activeA2dpStreams.begin(); sIter != activeA2dpStreams.end(); sIter++) {
-        if (((*sIter) != NULL) && isStreamActive(*sIter, mActiveStreams)) {
+        if (((*sIter) != NULL) && mStreamRegistry.contains(*sIter)) {
             (*sIter)->lockStreamMutex();
             (*sIter)->removePalDevice(*sIter, a2dpDattr.id);
             (*sIter)->addPalDevice(*sIter, &switchDevDattr);
@@ -9757,7 +9523,7 @@ int32_t ResourceManager::a2dpCaptureResumeFromDummy(pal_device_id_t dev_id)
 
     mActiveStreamMutex.lock();
     for (sIter = restoredStreams.begin(); sIter != restoredStreams.end(); sIter++) {
-        if (((*sIter) != NULL) && isStreamActive(*sIter, mActiveStreams)) {
+        if (((*sIter) != NULL) && mStreamRegistry.contains(*sIter)) {
             (*sIter)->lockStreamMutex();
             (*sIter)->removePalDevice(*sIter, activeDattr.id);
             (*sIter)->addPalDevice(*sIter, &a2dpDattr);
@@ -9788,6 +9554,7 @@ int32_t ResourceManager::a2dpSuspend(pal_device_id_t dev_id)
     struct pal_device handsetDattr;
     std::vector <Stream *> activeA2dpStreams;
     std::vector <Stream *> activeStreams;
+    std::vector <Stream *> drainStreams;
     std::vector <Stream*>::iterator sIter;
     std::vector <std::shared_ptr<Device>> associatedDevices;
 
@@ -9864,7 +9631,7 @@ int32_t ResourceManager::a2dpSuspend(pal_device_id_t dev_id)
         switchDevDattr.id);
 
     for (sIter = activeA2dpStreams.begin(); sIter != activeA2dpStreams.end(); sIter++) {
-        if (((*sIter) != NULL) && isStreamActive(*sIter, mActiveStreams)) {
+        if (((*sIter) != NULL) && mStreamRegistry.contains(*sIter)) {
             associatedDevices.clear();
             status = (*sIter)->getAssociatedDevices(associatedDevices);
             if ((0 != status) ||
@@ -9909,8 +9676,11 @@ int32_t ResourceManager::a2dpSuspend(pal_device_id_t dev_id)
                     if (maxLatencyMs < latencyMs)
                         maxLatencyMs = latencyMs;
                     // Mute
-                    if (!(*sIter)->mute_l(true))
+                    if (!(*sIter)->mute_l(true)) {
                         (*sIter)->a2dpMuted = true;
+                        (*sIter)->markMuteDrain();
+                        drainStreams.push_back(*sIter);
+                    }
                 }
             }
             (*sIter)->unlockStreamMutex();
@@ -9920,18 +9690,14 @@ int32_t ResourceManager::a2dpSuspend(pal_device_id_t dev_id)
     mActiveStreamMutex.unlock();
 
     // wait for stale pcm drained before switching to speaker
-    if (maxLatencyMs > 0) {
-        // multiplication factor applied to latency when calculating a safe mute delay
-        // TODO: It's not needed if latency is accurate.
-        const int latencyMuteFactor = 2;
-        usleep(maxLatencyMs * 1000 * latencyMuteFactor);
-    }
+    if (maxLatencyMs > 0)
+        waitForMuteDrain(drainStreams, maxLatencyMs);
 
     forceDeviceSwitch(a2dpDev, &switchDevDattr, activeA2dpStreams);
 
     mActiveStreamMutex.lock();
     for (sIter = activeA2dpStreams.begin(); sIter != activeA2dpStreams.end(); sIter++) {
-        if (((*sIter) != NULL) && isStreamActive(*sIter, mActiveStreams)) {
+        if (((*sIter) != NULL) && mStreamRegistry.contains(*sIter)) {
             (*sIter)->lockStreamMutex();
             struct pal_stream_attributes sAttr;
             (*sIter)->getStreamAttributes(&sAttr);
@@ -10093,7 +9859,7 @@ int32_t ResourceManager::a2dpResume(pal_device_id_t dev_id)
         PAL_ERR(LOG_TAG, "Sound card offline");
         mActiveStreamMutex.lock();
         for (sIter = restoredStreams.begin(); sIter != restoredStreams.end(); sIter++) {
-            if (((*sIter) != NULL) && isStreamActive(*sIter, mActiveStreams)) {
+            if (((*sIter) != NULL) && mStreamRegistry.contains(*sIter)) {
                 (*sIter)->lockStreamMutex();
                 if (std::find((*sIter)->suspendedDevIds.begin(), (*sIter)->suspendedDevIds.end(),
                     a2dpDattr.id) != (*sIter)->suspendedDevIds.end()) {
@@ -10125,7 +9891,7 @@ int32_t ResourceManager::a2dpResume(pal_device_id_t dev_id)
 
     mActiveStreamMutex.lock();
     for (sIter = restoredStreams.begin(); sIter != restoredStreams.end(); sIter++) {
-        if (((*sIter) != NULL) && isStreamActive(*sIter, mActiveStreams)) {
+        if (((*sIter) != NULL) && mStreamRegistry.contains(*sIter)) {
             (*sIter)->lockStreamMutex();
             // update PAL devices for the restored streams
             if ((*sIter)->suspendedDevIds.size() == 1 /* non-combo */) {
@@ -10227,7 +9993,7 @@ int32_t ResourceManager::a2dpCaptureSuspend(pal_device_id_t dev_id)
     }
 
     for (sIter = activeA2dpStreams.begin(); sIter != activeA2dpStreams.end(); sIter++) {
-        if (((*sIter) != NULL) && isStreamActive(*sIter, mActiveStreams)) {
+        if (((*sIter) != NULL) && mStreamRegistry.contains(*sIter)) {
             (*sIter)->lockStreamMutex();
             if (!((*sIter)->a2dpMuted)) {
                 (*sIter)->mute_l(true);
@@ -10243,7 +10009,7 @@ int32_t ResourceManager::a2dpCaptureSuspend(pal_device_id_t dev_id)
 
     mActiveStreamMutex.lock();
     for (sIter = activeA2dpStreams.begin(); sIter != activeA2dpStreams.end(); sIter++) {
-        if (((*sIter) != NULL) && isStreamActive(*sIter, mActiveStreams)) {
+        if (((*sIter) != NULL) && mStreamRegistry.contains(*sIter)) {
             (*sIter)->suspendedDevIds.clear();
             (*sIter)->suspendedDevIds.push_back(a2dpDattr.id);
         }
@@ -10358,7 +10124,7 @@ int32_t ResourceManager::a2dpCaptureResume(pal_device_id_t dev_id)
 
     mActiveStreamMutex.lock();
     for (sIter = restoredStreams.begin(); sIter != restoredStreams.end(); sIter++) {
-        if ((*sIter) && isStreamActive(*sIter, mActiveStreams)) {
+        if ((*sIter) && mStreamRegistry.contains(*sIter)) {
             (*sIter)->lockStreamMutex();
             (*sIter)->suspendedDevIds.clear();
             (*sIter)->mute_l(false);
@@ -10518,6 +10284,83 @@ int ResourceManager::getParameter(uint32_t param_id, void **param_payload,
             memcpy((char*)param_payload, isProxyRecordActive ? "true" : "false", *payload_size);
         }
         break;
+        case PAL_PARAM_ID_INIT_STAGE_TIMING:
+        {
+            pal_param_init_stage_timing_t *timing =
+                *(pal_param_init_stage_timing_t **)param_payload;
+
+            if (!timing) {
+                PAL_ERR(LOG_TAG, "no buffer for init stage timing");
+                status = -EINVAL;
+                goto exit;
+            }
+            initGraph.getTiming(timing);
+            *payload_size = sizeof(pal_param_init_stage_timing_t);
+        }
+        break;
+        case PAL_PARAM_ID_FE_POOL_STATS:
+        {
+            pal_param_fe_pool_stats_t *stats =
+                *(pal_param_fe_pool_stats_t **)param_payload;
+
+            if (!stats) {
+                PAL_ERR(LOG_TAG, "no buffer for front end pool stats");
+                status = -EINVAL;
+                goto exit;
+            }
+            stats->num_pools = PAL_FE_POOL_MAX;
+            for (int i = 0; i < PAL_FE_POOL_MAX; i++)
+                fePools[i].getStats(&stats->pools[i]);
+            *payload_size = sizeof(pal_param_fe_pool_stats_t);
+        }
+        break;
+        case PAL_PARAM_ID_SND_CARD_TRANSITIONS:
+        {
+            pal_param_snd_card_transitions_t *transitions =
+                *(pal_param_snd_card_transitions_t **)param_payload;
+
+            if (!transitions) {
+                PAL_ERR(LOG_TAG, "no buffer for sound card transitions");
+                status = -EINVAL;
+                goto exit;
+            }
+            SndCardMonitor::getTransitions(transitions);
+            *payload_size = sizeof(pal_param_snd_card_transitions_t);
+        }
+        break;
+        case PAL_PARAM_ID_KV_CACHE_STATS:
+        {
+            pal_param_kv_cache_stats_t *stats =
+                *(pal_param_kv_cache_stats_t **)param_payload;
+
+            if (!stats) {
+                PAL_ERR(LOG_TAG, "no buffer for kv cache stats");
+                status = -EINVAL;
+                goto exit;
+            }
+            PayloadBuilder::getKVCacheStats(&stats->hits, &stats->misses);
+            *payload_size = sizeof(pal_param_kv_cache_stats_t);
+        }
+        break;
+        case PAL_PARAM_ID_MIXER_CTL_CACHE_STATS:
+        {
+            pal_param_mixer_ctl_cache_stats_t *stats =
+                *(pal_param_mixer_ctl_cache_stats_t **)param_payload;
+            struct mixer_ctl_cache_stats ctlStats = {};
+
+            if (!stats) {
+                PAL_ERR(LOG_TAG, "no buffer for mixer control cache stats");
+                status = -EINVAL;
+                goto exit;
+            }
+            MixerCtlCache::getStats(&ctlStats);
+            stats->hits = ctlStats.hits;
+            stats->misses = ctlStats.misses;
+            stats->invalidations = ctlStats.invalidations;
+            stats->entries = ctlStats.entries;
+            *payload_size = sizeof(pal_param_mixer_ctl_cache_stats_t);
+        }
+        break;
         default:
             status = -EINVAL;
             PAL_ERR(LOG_TAG, "Unknown ParamID:%d", param_id);
@@ -10578,6 +10421,10 @@ int ResourceManager::setParameter(uint32_t param_id, void *param_payload,
         return VUISetParameters(param_id, param_payload, payload_size);
     }
 
+    /* the dump writes a file, keep it out of the resource manager lock */
+    if (param_id == PAL_PARAM_ID_KPI_TRACE)
+        return PalTrace::setParam(param_payload, payload_size);
+
     mResourceManagerMutex.lock();
     switch (param_id) {
         case PAL_PARAM_ID_UHQA_FLAG:
@@ -11351,7 +11198,7 @@ int ResourceManager::setParameter(uint32_t param_id, void *param_payload,
                        (pal_param_haptics_intensity *)param_payload;
                 PAL_DBG(LOG_TAG, "Haptics Intensity %d", hInt->intensity);
                 char mixer_ctl_name[128] =  "Haptics Amplitude Step";
-                struct mixer_ctl *ctl = mixer_get_ctl_by_name(audio_hw_mixer, mixer_ctl_name);
+                struct mixer_ctl *ctl = MixerCtlCache::getCtl(audio_hw_mixer, mixer_ctl_name);
                 if (!ctl) {
                     PAL_ERR(LOG_TAG, "Could not get ctl for mixer cmd - %s", mixer_ctl_name);
                     status = -EINVAL;
@@ -12265,6 +12112,18 @@ int ResourceManager::resetStreamInstanceID(Stream *str, uint32_t sInstanceID) {
     return status;
 }
 
+void ResourceManager::releaseStreamInstanceID(pal_stream_type_t type, uint32_t sInstanceID)
+{
+    if (sInstanceID < INSTANCE_1 || sInstanceID > MAX_STREAM_INSTANCES) {
+        PAL_ERR(LOG_TAG, "Invalid Stream Instance ID %d", sInstanceID);
+        return;
+    }
+
+    mResourceManagerMutex.lock();
+    stream_instances[type - 1] &= ~(1 << (sInstanceID - 1));
+    mResourceManagerMutex.unlock();
+}
+
 int ResourceManager::getStreamInstanceID(Stream *str) {
     int i, status = 0, listNodeIndex = -1;
     pal_stream_attributes StrAttr;
@@ -13515,7 +13374,10 @@ void ResourceManager::startTag(void *userdata, const XML_Char *tag_name,
     } else if(strcmp(tag_name, "param") == 0) {
         processConfigParams(attr);
     } else if (strcmp(tag_name, "codec") == 0) {
-        processBTCodecInfo(attr, XML_GetSpecifiedAttributeCount(data->parser));
+        int attr_count = 0;
+        while (attr[attr_count])
+            attr_count++;
+        processBTCodecInfo(attr, attr_count);
         return;
     } else if (strcmp(tag_name, "config_gapless") == 0) {
         setGaplessMode(attr);
@@ -13681,63 +13543,15 @@ void ResourceManager::snd_data_handler(void *userdata, const XML_Char *s, int le
 
 int ResourceManager::XmlParser(std::string xmlFile)
 {
-    XML_Parser parser;
-    FILE *file = NULL;
     int ret = 0;
-    int bytes_read;
-    void *buf = NULL;
     struct xml_userdata data;
     memset(&data, 0, sizeof(data));
 
     PAL_INFO(LOG_TAG, "XML parsing started - file name %s", xmlFile.c_str());
-    file = fopen(xmlFile.c_str(), "r");
-    if(!file) {
-        ret = -ENOENT;
-        PAL_ERR(LOG_TAG, "Failed to open xml file name %s ret %d", xmlFile.c_str(), ret);
-        goto done;
-    }
-
-    parser = XML_ParserCreate(NULL);
-    if (!parser) {
-        ret = -EINVAL;
-        PAL_ERR(LOG_TAG, "Failed to create XML ret %d", ret);
-        goto closeFile;
-    }
-
-    data.parser = parser;
-    XML_SetUserData(parser, &data);
-    XML_SetElementHandler(parser, startTag, endTag);
-    XML_SetCharacterDataHandler(parser, snd_data_handler);
-
-    while (1) {
-        buf = XML_GetBuffer(parser, 1024);
-        if(buf == NULL) {
-            ret = -EINVAL;
-            PAL_ERR(LOG_TAG, "XML_Getbuffer failed ret %d", ret);
-            goto freeParser;
-        }
-
-        bytes_read = fread(buf, 1, 1024, file);
-        if(bytes_read < 0) {
-            ret = -EINVAL;
-            PAL_ERR(LOG_TAG, "fread failed ret %d", ret);
-            goto freeParser;
-        }
-
-        if(XML_ParseBuffer(parser, bytes_read, bytes_read == 0) == XML_STATUS_ERROR) {
-            ret = -EINVAL;
-            PAL_ERR(LOG_TAG, "XML ParseBuffer failed for %s file ret %d", xmlFile.c_str(), ret);
-            goto freeParser;
-        }
-        if (bytes_read == 0)
-            break;
-    }
+    ret = PalXmlSnapshot::parse(xmlFile, &data, startTag, endTag, snd_data_handler);
+    if (ret)
+        PAL_ERR(LOG_TAG, "XML parsing failed for %s ret %d", xmlFile.c_str(), ret);
 
-freeParser:
-    XML_ParserFree(parser);
-closeFile:
-    fclose(file);
-done:
     return ret;
 }
 
@@ -35,9 +35,14 @@
 #define LOG_TAG "PAL: SndMonitor"
 #include <stdlib.h>
 #include <unistd.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <sys/poll.h>
+#include <sys/inotify.h>
+#include <algorithm>
 #include <list>
 #include <sys/eventfd.h>
 #include "ResourceManager.h"
@@ -45,41 +50,208 @@
 #include "SndCardMonitor.h"
 
 #define SNDCARD_PATH "/sys/kernel/snd_card/card_state"
-#define MAX_SLEEP_RETRY 100
+#define SND_DEV_DIR "/dev"
+#define SND_DEV_PATH "/dev/snd"
+#define CARD_NODE_WAIT_MIN_MS 10
+#define CARD_NODE_WAIT_MAX_MS 500
+/* same budget as the former 100 retries of 500 ms */
+#define CARD_NODE_WAIT_TOTAL_MS 50000
 
 static int fd = -1, efd = -1;
 static int exit_thread = 0; //by default exit thread is made false
 
+std::mutex SndCardMonitor::transitionMutex;
+pal_param_snd_card_transitions_t SndCardMonitor::transitions;
+
+static uint64_t monotonicNs()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+int SndCardMonitor::openSndNodeWatch()
+{
+    int watchFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    int ret = 0;
+
+    if (watchFd < 0) {
+        ret = -errno;
+        PAL_ERR(LOG_TAG, "inotify init failed %d", ret);
+        return ret;
+    }
+
+    if (inotify_add_watch(watchFd, SND_DEV_PATH, IN_CREATE) >= 0)
+        return watchFd;
+
+    /* /dev/snd is created along with the first sound node */
+    if (errno == ENOENT && inotify_add_watch(watchFd, SND_DEV_DIR, IN_CREATE) >= 0)
+        return watchFd;
+
+    ret = -errno;
+    PAL_ERR(LOG_TAG, "failed to watch %s %d", SND_DEV_PATH, ret);
+    close(watchFd);
+    return ret;
+}
+
+int SndCardMonitor::waitSndNodes(int watchFd, int exitFd, int timeoutMs)
+{
+    struct pollfd pfds[2];
+    int nfds = 0;
+    int exitIdx = -1;
+    int rv = 0;
+    ssize_t len = 0;
+    struct inotify_event *ev = NULL;
+    char buf[sizeof(struct inotify_event) + NAME_MAX + 1]
+        __attribute__((aligned(__alignof__(struct inotify_event))));
+
+    if (watchFd >= 0) {
+        pfds[nfds].fd = watchFd;
+        pfds[nfds].events = POLLIN;
+        pfds[nfds].revents = 0;
+        nfds++;
+    }
+    if (exitFd >= 0) {
+        exitIdx = nfds;
+        pfds[nfds].fd = exitFd;
+        pfds[nfds].events = POLLIN;
+        pfds[nfds].revents = 0;
+        nfds++;
+    }
+
+    /* without any fd this is a plain timed wait */
+    rv = poll(pfds, nfds, timeoutMs);
+    if (rv < 0)
+        return -errno;
+    if (rv == 0)
+        return -ETIMEDOUT;
+    if (exitIdx >= 0 && (pfds[exitIdx].revents & POLLIN))
+        return -EINTR;
+
+    /* being woken up is all that matters, just drain the events */
+    while ((len = read(watchFd, buf, sizeof(buf))) > 0) {
+        for (char *p = buf; p < buf + len; p += sizeof(struct inotify_event) + ev->len) {
+            ev = (struct inotify_event *)p;
+            if ((ev->mask & IN_ISDIR) && ev->len && !strcmp(ev->name, "snd"))
+                inotify_add_watch(watchFd, SND_DEV_PATH, IN_CREATE);
+        }
+    }
+    return 0;
+}
+
+void SndCardMonitor::noteTransition(card_status_t state)
+{
+    std::lock_guard<std::mutex> lock(transitionMutex);
+    struct pal_snd_card_transition *t =
+        &transitions.transitions[transitions.total % PAL_MAX_SND_CARD_TRANSITIONS];
+
+    t->state = state;
+    t->seq = transitions.total++;
+    t->detect_ns = monotonicNs();
+    t->dispatch_ns = 0;
+    t->handled_ns = 0;
+    transitions.num_transitions = std::min(transitions.total,
+                                           (uint32_t)PAL_MAX_SND_CARD_TRANSITIONS);
+}
+
+/* stamps the oldest transition to state which did not reach that step yet */
+void SndCardMonitor::noteDispatched(card_status_t state)
+{
+    std::lock_guard<std::mutex> lock(transitionMutex);
+    uint32_t first = transitions.total - transitions.num_transitions;
+    struct pal_snd_card_transition *t = NULL;
+
+    for (uint32_t i = first; i < transitions.total; i++) {
+        t = &transitions.transitions[i % PAL_MAX_SND_CARD_TRANSITIONS];
+        if (t->state == state && !t->dispatch_ns) {
+            t->dispatch_ns = monotonicNs();
+            return;
+        }
+    }
+}
+
+void SndCardMonitor::noteHandled(card_status_t state)
+{
+    std::lock_guard<std::mutex> lock(transitionMutex);
+    uint32_t first = transitions.total - transitions.num_transitions;
+    struct pal_snd_card_transition *t = NULL;
+
+    for (uint32_t i = first; i < transitions.total; i++) {
+        t = &transitions.transitions[i % PAL_MAX_SND_CARD_TRANSITIONS];
+        if (t->state == state && t->dispatch_ns && !t->handled_ns) {
+            t->handled_ns = monotonicNs();
+            PAL_INFO(LOG_TAG, "card state %d handled %llu us after detection",
+                     state, (unsigned long long)(t->handled_ns - t->detect_ns) / 1000);
+            return;
+        }
+    }
+}
+
+void SndCardMonitor::getTransitions(pal_param_snd_card_transitions_t *out)
+{
+    std::lock_guard<std::mutex> lock(transitionMutex);
+    uint32_t first = transitions.total - transitions.num_transitions;
+
+    out->num_transitions = transitions.num_transitions;
+    out->total = transitions.total;
+    out->ready_ns = transitions.ready_ns;
+    for (uint32_t i = 0; i < transitions.num_transitions; i++)
+        out->transitions[i] =
+            transitions.transitions[(first + i) % PAL_MAX_SND_CARD_TRANSITIONS];
+}
+
+static card_status_t toCardStatus(int card_status, card_status_t prev)
+{
+    if (card_status == 0)
+        return CARD_STATUS_OFFLINE;
+    else if (card_status == 1)
+        return CARD_STATUS_ONLINE;
+    else if (card_status == 2)
+        return CARD_STATUS_STANDBY;
+    return prev;
+}
+
 void SndCardMonitor::monitorThreadLoop()
 {
-    struct pollfd *poll_fds;
+    struct pollfd poll_fds[2];
     int rv = 0;
     char buf[12];
     int card_status = 0;
-    int tries = MAX_SLEEP_RETRY;
+    int watch_fd = -1;
+    int wait_ms = CARD_NODE_WAIT_MIN_MS;
+    uint64_t start_ns = monotonicNs();
+    uint64_t ready_ns = 0;
 
     card_status_t status = CARD_STATUS_NONE;
     std::shared_ptr<ResourceManager> rm = ResourceManager::getInstance();
-    while(--tries) {
+
+    if (efd == -1)
+        goto Done;
+
+    /* armed before the first open, a node created in between still wakes the wait */
+    watch_fd = openSndNodeWatch();
+    while ((fd = open(SNDCARD_PATH, O_RDWR)) < 0) {
         if (exit_thread == 1)
-            break;
-        if ((fd = open(SNDCARD_PATH, O_RDWR)) < 0) {
+            goto Done;
+        if (monotonicNs() - start_ns > CARD_NODE_WAIT_TOTAL_MS * 1000000ULL) {
             PAL_ERR(LOG_TAG, "Open failed snd sysfs node");
+            goto Done;
         }
-        else {
-            PAL_VERBOSE(LOG_TAG, "snd sysfs node open successful");
-            break;
-        }
-        usleep(500000);
+        if (waitSndNodes(watch_fd, efd, wait_ms) == -EINTR)
+            goto Done;
+        wait_ms = std::min(wait_ms * 2, CARD_NODE_WAIT_MAX_MS);
     }
-    efd = eventfd(0, EFD_CLOEXEC);
-    if (fd == -1 || efd == -1)
-        goto Done;
-    poll_fds = (struct pollfd*) calloc(2, sizeof(struct pollfd));
-    if(NULL == poll_fds) {
-        PAL_ERR(LOG_TAG, "Memory allocation failed");
-        goto Done;
+    if (watch_fd >= 0) {
+        close(watch_fd);
+        watch_fd = -1;
     }
+    ready_ns = monotonicNs();
+    PAL_INFO(LOG_TAG, "snd sysfs node ready after %llu ms",
+             (unsigned long long)(ready_ns - start_ns) / 1000000);
+    transitionMutex.lock();
+    transitions.ready_ns = ready_ns;
+    transitionMutex.unlock();
 
     while(1) {
         memset(buf , 0 ,sizeof(buf));
@@ -101,35 +273,36 @@ void SndCardMonitor::monitorThreadLoop()
             read(poll_fds[0].fd, buf, 1);
             sscanf(buf , "%d", &card_status);
             PAL_INFO(LOG_TAG, "card status %d\n",card_status);
-            if (card_status == 0)
-                status = CARD_STATUS_OFFLINE;
-            else if (card_status == 1)
-                status = CARD_STATUS_ONLINE;
-            else if (card_status == 2)
-                status = CARD_STATUS_STANDBY;
-            else if (card_status == 3)
+            if (card_status == 3)
                 break;
-
+            status = toCardStatus(card_status, status);
+            noteTransition(status);
             rm->ssrHandler(status);
         } else if((poll_fds[1].revents & POLLIN)) {
             uint64_t eval;
             read(poll_fds[1].fd, &eval, 8);
-            if (eval == 1) {
-                free(poll_fds);
-                poll_fds = NULL;
-                close(efd);
-                close(fd);
+            if (eval == 1)
                 break;
-            }
        }
     }
 Done:
+    if (watch_fd >= 0)
+        close(watch_fd);
+    if (fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
     return;
 }
 
 SndCardMonitor::SndCardMonitor(int sndNum)
 {
     sndNum = 0; //not used at present.
+    exit_thread = 0;
+    /* created before the thread so the destructor can stop the card node wait */
+    efd = eventfd(0, EFD_CLOEXEC);
+    if (efd == -1)
+        PAL_ERR(LOG_TAG, "eventfd creation failed %d", -errno);
     mThread = std::thread(&SndCardMonitor::monitorThreadLoop, this);
     PAL_VERBOSE(LOG_TAG, "Snd card monitor init done.");
     return;
@@ -143,4 +316,8 @@ SndCardMonitor::~SndCardMonitor()
    if(efd != -1)
       write(efd, &eval, 8);
    mThread.join();
+   if (efd != -1) {
+      close(efd);
+      efd = -1;
+   }
 }
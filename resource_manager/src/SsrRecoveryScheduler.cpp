@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#define LOG_TAG "PAL: SsrRecoveryScheduler"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include "SsrRecoveryScheduler.h"
+#include "Stream.h"
+#include "PalCommon.h"
+
+struct ssrRecoveryJob {
+    Stream *s;
+    pal_stream_type_t type;
+    ssr_recovery_class_t cls;
+};
+
+struct ssrRecoveryState {
+    std::mutex lock;
+    std::condition_variable cv;
+    std::deque<struct ssrRecoveryJob> pending;       /* sorted by class */
+    std::deque<std::pair<Stream *, struct pal_ssr_stream_recovery>> completed;
+    uint32_t voiceLeft;                           /* voice jobs not done yet */
+    bool detectionBusy;
+    std::chrono::steady_clock::time_point start;
+    std::mutex *handlerLock;
+};
+
+static uint32_t elapsedUs(std::chrono::steady_clock::time_point from)
+{
+    return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - from).count();
+}
+
+/* first job allowed to start, pending.end() if the workers have to wait */
+static std::deque<struct ssrRecoveryJob>::iterator nextJob_l(struct ssrRecoveryState &st)
+{
+    auto it = st.pending.begin();
+
+    if (it == st.pending.end())
+        return it;
+    if (it->cls != SSR_RECOVERY_VOICE && st.voiceLeft)
+        return st.pending.end();
+    if (it->cls == SSR_RECOVERY_DETECTION && st.detectionBusy)
+        return st.pending.end();
+    return it;
+}
+
+static void workerLoop(struct ssrRecoveryState *st, SsrRecoveryScheduler::handler_t handler)
+{
+    struct ssrRecoveryJob job;
+    struct pal_ssr_stream_recovery rec;
+    std::chrono::steady_clock::time_point begin;
+
+    std::unique_lock<std::mutex> lck(st->lock);
+    while (!st->pending.empty()) {
+        auto it = nextJob_l(*st);
+        if (it == st->pending.end()) {
+            st->cv.wait(lck);
+            continue;
+        }
+        job = *it;
+        st->pending.erase(it);
+        if (job.cls == SSR_RECOVERY_DETECTION)
+            st->detectionBusy = true;
+        lck.unlock();
+
+        begin = std::chrono::steady_clock::now();
+        st->handlerLock->lock();
+        rec.status = handler(job.s);
+        st->handlerLock->unlock();
+        rec.handler_us = elapsedUs(begin);
+        rec.recovery_us = elapsedUs(st->start);
+        rec.type = job.type;
+        rec.priority = job.cls;
+
+        lck.lock();
+        if (job.cls == SSR_RECOVERY_VOICE)
+            st->voiceLeft--;
+        else if (job.cls == SSR_RECOVERY_DETECTION)
+            st->detectionBusy = false;
+        st->completed.emplace_back(job.s, rec);
+        st->cv.notify_all();
+    }
+}
+
+ssr_recovery_class_t SsrRecoveryScheduler::getClass(Stream *s)
+{
+    struct pal_stream_attributes sAttr;
+
+    if (s->getStreamAttributes(&sAttr))
+        return SSR_RECOVERY_CAPTURE;
+
+    switch (sAttr.type) {
+        case PAL_STREAM_VOICE_CALL:
+        case PAL_STREAM_VOIP:
+        case PAL_STREAM_VOIP_RX:
+        case PAL_STREAM_VOIP_TX:
+            return SSR_RECOVERY_VOICE;
+        case PAL_STREAM_LOW_LATENCY:
+        case PAL_STREAM_ULTRA_LOW_LATENCY:
+        case PAL_STREAM_HAPTICS:
+            if (sAttr.direction == PAL_AUDIO_OUTPUT)
+                return SSR_RECOVERY_LOW_LATENCY;
+            break;
+        case PAL_STREAM_VOICE_UI:
+        case PAL_STREAM_ACD:
+        case PAL_STREAM_CONTEXT_PROXY:
+        case PAL_STREAM_SENSOR_PCM_DATA:
+        case PAL_STREAM_COMMON_PROXY:
+            return SSR_RECOVERY_DETECTION;
+        default:
+            break;
+    }
+
+    return sAttr.direction == PAL_AUDIO_OUTPUT ? SSR_RECOVERY_PLAYBACK :
+                                                 SSR_RECOVERY_CAPTURE;
+}
+
+void SsrRecoveryScheduler::run(const std::vector<Stream *> &streams, std::mutex *handlerLock,
+                               handler_t handler, report_t report,
+                               struct pal_ssr_recovery_done *done)
+{
+    struct ssrRecoveryState st;
+    struct ssrRecoveryJob job;
+    std::vector<std::thread> workers;
+    uint32_t numWorkers = std::thread::hardware_concurrency();
+    uint32_t left = streams.size();
+
+    done->num_streams = streams.size();
+    done->num_failed = 0;
+    done->total_us = 0;
+    if (streams.empty())
+        return;
+
+    st.voiceLeft = 0;
+    st.detectionBusy = false;
+    st.handlerLock = handlerLock;
+    for (auto s : streams) {
+        job.s = s;
+        job.cls = getClass(s);
+        if (s->getStreamType(&job.type))
+            job.type = PAL_STREAM_LOW_LATENCY;
+        if (job.cls == SSR_RECOVERY_VOICE)
+            st.voiceLeft++;
+        st.pending.push_back(job);
+    }
+    std::stable_sort(st.pending.begin(), st.pending.end(),
+        [](const struct ssrRecoveryJob &a, const struct ssrRecoveryJob &b) {
+            return a.cls < b.cls;
+        });
+
+    numWorkers = std::max(1u, std::min(numWorkers, (uint32_t)SSR_RECOVERY_MAX_WORKERS));
+    numWorkers = std::min(numWorkers, left);
+    PAL_INFO(LOG_TAG, "restoring %u streams on %u workers, %u voice",
+             left, numWorkers, st.voiceLeft);
+
+    st.start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < numWorkers; i++)
+        workers.emplace_back(workerLoop, &st, handler);
+
+    std::unique_lock<std::mutex> lck(st.lock);
+    while (left) {
+        if (st.completed.empty()) {
+            st.cv.wait(lck);
+            continue;
+        }
+        auto res = st.completed.front();
+        st.completed.pop_front();
+        left--;
+        lck.unlock();
+        if (res.second.status)
+            done->num_failed++;
+        PAL_INFO(LOG_TAG, "stream %pK type %d restored in %u us (%u us after online), status %d",
+                 res.first, res.second.type, res.second.handler_us,
+                 res.second.recovery_us, res.second.status);
+        report(res.first, &res.second);
+        lck.lock();
+    }
+    lck.unlock();
+
+    for (auto &t : workers)
+        t.join();
+    done->total_us = elapsedUs(st.start);
+    PAL_INFO(LOG_TAG, "%u streams restored in %u us, %u failed",
+             done->num_streams, done->total_us, done->num_failed);
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef MIXER_CTL_CACHE_H
+#define MIXER_CTL_CACHE_H
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <tinyalsa/asoundlib.h>
+
+struct mixer_ctl_cache_stats {
+    uint64_t hits;
+    uint64_t misses;         /* lookups which had to search the mixer by name */
+    uint64_t invalidations;
+    size_t entries;
+};
+
+/*
+ * Registry of resolved mixer controls. mixer_get_ctl_by_name walks every
+ * control of the card comparing names, the result never changes for the
+ * lifetime of a mixer so it is resolved once per (mixer, name) and reused.
+ * PCM controls are additionally keyed by (mixer, pcm id, suffix) so the
+ * "PCM<id> <suffix>" name is only formatted on the first lookup. Controls
+ * which are not found are not cached. The cache is dropped on sound card
+ * state changes and before the mixers are closed.
+ */
+class MixerCtlCache
+{
+public:
+    static struct mixer_ctl *getCtl(struct mixer *am, const char *name);
+    /* control "<device name of pcm id> <suffix>", e.g. "PCM100 setParam" */
+    static struct mixer_ctl *getPcmCtl(struct mixer *am, int device, const char *suffix);
+    static void invalidate();
+    static void getStats(struct mixer_ctl_cache_stats *stats);
+private:
+    struct ctl_key {
+        struct mixer *am;
+        int device;          /* -1 for controls looked up by full name */
+        std::string name;
+        bool operator==(const ctl_key &other) const {
+            return am == other.am && device == other.device && name == other.name;
+        }
+    };
+    struct ctl_key_hash {
+        size_t operator()(const ctl_key &key) const {
+            return std::hash<std::string>()(key.name) ^
+                   (std::hash<void *>()(key.am) << 1) ^ (size_t)key.device;
+        }
+    };
+    static struct mixer_ctl *lookup(const ctl_key &key);
+    static void insert(const ctl_key &key, struct mixer_ctl *ctl);
+
+    static std::mutex cacheMutex;
+    static std::unordered_map<ctl_key, struct mixer_ctl *, ctl_key_hash> ctls;
+    static std::atomic<uint64_t> hits;
+    static std::atomic<uint64_t> misses;
+    static std::atomic<uint64_t> invalidations;
+};
+
+#endif //MIXER_CTL_CACHE_H
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef MIXER_TRANSACTION_H
+#define MIXER_TRANSACTION_H
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <tinyalsa/asoundlib.h>
+
+struct mixer_transaction_stats {
+    uint64_t commits;
+    uint64_t writes;     /* control writes issued to the backend */
+    uint64_t skipped;    /* idempotent writes dropped as unchanged */
+};
+
+/*
+ * Ordered batch of mixer control writes for one connect, disconnect or
+ * setup of a session device. Lookups, metadata formatting and payload
+ * copies happen while queueing, commit() then issues the writes back to
+ * back in queueing order. tinyalsa has no multi control write, so a
+ * commit still costs one round trip per write, but writes flagged as
+ * idempotent (backend media format, group config) are dropped when they
+ * carry the value last committed to that control. By default writes are
+ * issued even if an earlier one failed, like the disconnect sequences this
+ * replaces, and commit returns the first error; stopOnError drops the rest
+ * of the batch instead, e.g. no connect after a failed setParam.
+ */
+class MixerTransaction
+{
+public:
+    MixerTransaction(const char *tag);
+    ~MixerTransaction();
+    void setEnum(struct mixer_ctl *ctl, const char *value);
+    void setArray(struct mixer_ctl *ctl, const void *data, size_t count,
+                  bool idempotent = false);
+    int commit(bool stopOnError = false);
+    uint32_t getRoundTrips() const { return roundTrips; }
+
+    /* round trips committed by the calling thread, sampled around a device switch */
+    static uint64_t getThreadRoundTrips();
+    /* credit round trips a helper thread committed on behalf of this one */
+    static void addThreadRoundTrips(uint64_t count);
+    static void getStats(struct mixer_transaction_stats *stats);
+    /* forget committed values, the backend lost its state */
+    static void invalidate();
+private:
+    enum op_type {
+        MIXER_OP_ENUM,
+        MIXER_OP_ARRAY,
+    };
+    struct mixer_op {
+        struct mixer_ctl *ctl;
+        enum op_type type;
+        std::vector<uint8_t> data;
+        size_t count;
+        bool idempotent;
+    };
+    static bool isUnchanged(const struct mixer_op &op);
+    static void updateShadow(const struct mixer_op &op);
+
+    std::string tag;
+    std::vector<struct mixer_op> ops;
+    uint32_t roundTrips;
+    uint32_t skipped;
+
+    static std::mutex shadowMutex;
+    static std::unordered_map<struct mixer_ctl *, std::vector<uint8_t>> shadow;
+    static struct mixer_transaction_stats stats;
+    static thread_local uint64_t threadRoundTrips;
+};
+
+#endif //MIXER_TRANSACTION_H
@@ -40,6 +40,9 @@
 #include <algorithm>
 #include <expat.h>
 #include <map>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
 #include <regex>
 #include <sstream>
 #include "PalDefs.h"
@@ -153,6 +156,25 @@ struct allKVs {
     std::vector<kvInfo> keys_values;
 };
 
+typedef enum {
+    KV_TABLE_STREAMS = 0,
+    KV_TABLE_STREAMPPS,
+    KV_TABLE_DEVICES,
+    KV_TABLE_DEVICEPPS,
+} kv_table_t;
+
+/* Key vector computed for a set of selector inputs, see kvCache */
+struct kvCacheEntry {
+    uint32_t version;
+    std::vector<std::pair<int, int>> keyVector;
+};
+
+/*
+ * Upper bound of selector combinations indexed for one stream/device id,
+ * ids exceeding it are resolved by scanning the KV tables instead.
+ */
+#define KV_INDEX_MAX_COMBINATIONS 4096
+
 typedef enum {
     TAG_USECASEXML_ROOT,
     TAG_STREAM_SEL,
@@ -179,6 +201,43 @@ struct user_xml_data{
 };
 class SessionGsl;
 
+/* Initial capacity of a PayloadArena, grown on demand */
+#define PAYLOAD_ARENA_DEFAULT_SIZE 4096
+
+/*
+ * Bump allocator for apm_module_param_data_t payloads. Blocks are laid
+ * out back to back in a single buffer which is sent to AGM in one
+ * setParam and then rewound with reset(), keeping the buffer around for
+ * the next batch instead of a malloc/free per module param. Callers pass
+ * 8 byte padded sizes as the payload* builders do. Growing may move the
+ * buffer, so a pointer returned by alloc() is only valid until the next
+ * alloc()/append() on the same arena.
+ *
+ * Builders taking an optional arena return heap memory without one, and
+ * builders without the argument always do. Session::freeCustomPayload
+ * only frees what no session arena owns, so call sites may mix both.
+ */
+class PayloadArena
+{
+public:
+    PayloadArena();
+    ~PayloadArena();
+    PayloadArena(const PayloadArena&) = delete;
+    PayloadArena& operator=(const PayloadArena&) = delete;
+    uint8_t* alloc(size_t size);
+    uint8_t* append(const void *payload, size_t size);
+    bool owns(const void *payload) const;
+    /* drops everything past size, blocks below it stay valid */
+    void truncate(size_t size);
+    void reset();
+    uint8_t* data() const { return used ? buf : nullptr; }
+    size_t size() const { return used; }
+private:
+    uint8_t *buf;
+    size_t capacity;
+    size_t used;
+};
+
 class PayloadBuilder
 {
 protected:
@@ -186,6 +245,24 @@ protected:
    static std::vector<allKVs> all_streampps;
    static std::vector<allKVs> all_devices;
    static std::vector<allKVs> all_devicepps;
+   /*
+    * KV lookup index built by init(). Keys are composed of the KV table,
+    * the stream type/device id and the sorted interned selector pairs.
+    */
+   static std::unordered_map<std::string, uint32_t> selectorValueIds;
+   static std::unordered_map<std::string, std::vector<kvPairs>> kvIndex;
+   static std::set<std::pair<uint32_t, int32_t>> kvIndexSkippedIds;
+   static std::map<std::pair<uint32_t, int32_t>, std::vector<std::string>> kvSelectorIndex;
+   /*
+    * Graph key vectors keyed by every stream/device input the selectors
+    * of usecaseKvManager.xml are derived from, entries of an older
+    * version are stale and get recomputed.
+    */
+   static std::mutex kvCacheMutex;
+   static std::unordered_map<std::string, kvCacheEntry> kvCache;
+   static std::atomic<uint32_t> kvCacheVersion;
+   static std::atomic<uint64_t> kvCacheHits;
+   static std::atomic<uint64_t> kvCacheMisses;
 
 public:
     void payloadUsbAudioConfig(uint8_t** payload, size_t* size,
@@ -195,30 +272,37 @@ public:
                            uint32_t miid,
                            struct dpAudioConfig *data);
     void payloadVolumeCtrlRamp(uint8_t** payload, size_t* size,
-         uint32_t miid, uint32_t ramp_period_ms);
+         uint32_t miid, uint32_t ramp_period_ms,
+         PayloadArena *arena = nullptr);
     void payloadMFCConfig(uint8_t** payload, size_t* size,
                            uint32_t miid,
-                           struct sessionToPayloadParam* data);
+                           struct sessionToPayloadParam* data,
+                           PayloadArena *arena = nullptr);
     void payloadMFCMixerCoeff(uint8_t** payload, size_t* size,
                            uint32_t miid, int numCh, int rotationType);
     void payloadCRSMFCMixerCoeff(uint8_t** payload, size_t* size,
                            uint32_t miid);
     void payloadVolumeConfig(uint8_t** payload, size_t* size,
                            uint32_t miid,
-                           struct pal_volume_data * data);
+                           struct pal_volume_data * data,
+                           PayloadArena *arena = nullptr);
     void payloadMultichVolumemConfig(uint8_t** payload, size_t* size,
                            uint32_t miid,
-                           struct pal_volume_data * data);
+                           struct pal_volume_data * data,
+                           PayloadArena *arena = nullptr);
     void payloadGainConfig(uint8_t** payload, size_t* size,
                            uint32_t miid,
-                           struct pal_gain_data * data);
+                           struct pal_gain_data * data,
+                           PayloadArena *arena = nullptr);
     int payloadCustomParam(uint8_t **alsaPayload, size_t *size,
                             uint32_t *customayload, uint32_t customPayloadSize,
-                            uint32_t moduleInstanceId, uint32_t dspParamId);
+                            uint32_t moduleInstanceId, uint32_t dspParamId,
+                            PayloadArena *arena = nullptr);
     int payloadACDBParam(uint8_t **alsaPayload, size_t *size,
                             uint8_t *acdbParam,
                             uint32_t moduleInstanceId,
-                            uint32_t sampleRate);
+                            uint32_t sampleRate,
+                            PayloadArena *arena = nullptr);
     int payloadACDBTunnelParam(uint8_t **alsaPayload, size_t *size,
                             uint8_t *acdbParam,
                             const std::set <std::pair<int, int>> &acdbGKVSet,
@@ -252,6 +336,10 @@ public:
                           bool isStreamMapDirIn);
     void payloadTWSConfig(uint8_t** payload, size_t* size, uint32_t miid,
                           bool isTwsMonoModeOn, uint32_t codecFormat);
+    /*
+     * Always heap allocated, the speaker protection device accumulates it
+     * in its own customPayload and frees it, it has no session arena.
+     */
     void payloadSPConfig(uint8_t** payload, size_t* size, uint32_t miid,
                          int paramId, void *data);
     void payloadHapticsDevPConfig(uint8_t** payload, size_t* size, uint32_t miid,
@@ -317,6 +405,20 @@ public:
     static bool findKVs(std::vector<std::pair<selector_type_t, std::string>>
         &filled_selector_pairs, uint32_t type, std::vector<allKVs> &any_type,
         std::vector<std::pair<int32_t, int32_t>> &keyVector);
+    static void invalidateKVCache();
+    static void getKVCacheStats(uint64_t *hits, uint64_t *misses);
+    static std::string getKVCacheKey(uint32_t table, int32_t id, Stream *s,
+        struct pal_stream_attributes *sattr, struct pal_device *dAttr);
+    static bool lookupKVCache(const std::string &key,
+        std::vector<std::pair<int, int>> &keyVector);
+    static void updateKVCache(const std::string &key,
+        std::vector<std::pair<int, int>> &keyVector, size_t offset);
+    static void buildKVIndex();
+    static void indexKVTable(uint32_t table, std::vector<allKVs> &any_type);
+    static uint32_t getKVTableId(std::vector<allKVs> &any_type);
+    static bool getKVIndexKey(uint32_t table, int32_t type,
+        std::vector<std::pair<selector_type_t, std::string>> &selector_pairs,
+        std::string &key);
     static std::string removeSpaces(const std::string& str);
     static std::vector<std::string> splitStrings(const std::string& str);
     static int getBtDeviceKV(int dev_id, std::vector<std::pair<int, int>> &deviceKV,
@@ -324,6 +426,7 @@ public:
     static int getDeviceKV(int dev_id, std::vector<std::pair<int, int>> &deviceKV);
     static bool compareNumSelectors(struct kvInfo info_1, struct kvInfo info_2);
     static int payloadDualMono(uint8_t **payloadInfo);
+    static uint8_t* allocPayload(PayloadArena *arena, size_t size);
     void payloadAFSInfo(uint8_t **payload, size_t *size, uint32_t moduleId);
     PayloadBuilder();
     ~PayloadBuilder();
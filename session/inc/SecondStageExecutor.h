@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef SECOND_STAGE_EXECUTOR_H
+#define SECOND_STAGE_EXECUTOR_H
+
+#include <stdint.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define SSTAGE_MAX_WORKERS 4
+
+/*
+ * Worker pool shared by all second stage CAPI engines. An engine submits
+ * one job per first stage detection instead of parking a thread of its own
+ * for its whole lifetime, so keyword and user verification engines of every
+ * loaded model run in parallel on at most SSTAGE_MAX_WORKERS threads.
+ *
+ * Workers are started on demand and exit once the last engine detaches.
+ * Jobs are tagged with their owner so an engine going away can drop the
+ * job it queued but that did not start yet.
+ */
+class SecondStageExecutor
+{
+public:
+    static void attach();
+    static void detach();
+    static int submit(const void *owner, std::function<void()> job);
+    /* true when a queued job of owner was removed before it ran */
+    static bool cancel(const void *owner);
+private:
+    struct job {
+        const void *owner;
+        std::function<void()> fn;
+    };
+    static void workerLoop(uint32_t gen);
+    static uint32_t maxWorkers();
+
+    static std::mutex execMutex;
+    static std::condition_variable execCv;
+    static std::deque<struct job> jobs;
+    static std::vector<std::thread> workers;
+    static uint32_t idleWorkers;
+    static uint32_t users;
+    static uint32_t generation;
+};
+
+#endif //SECOND_STAGE_EXECUTOR_H
@@ -108,8 +108,17 @@ protected:
     struct mixer *mixer;
     std::vector<std::pair<int32_t, std::string>> rxAifBackEnds;
     std::vector<std::pair<int32_t, std::string>> txAifBackEnds;
-    void *customPayload;
-    size_t customPayloadSize;
+    void *customPayload = nullptr;
+    size_t customPayloadSize = 0;
+    /*
+     * customPayload lives in payloadArena, module params built with it
+     * are accumulated in place and customPayloadSize covers the ones
+     * committed by updateCustomPayload. paramArena holds one-shot payloads
+     * that are sent and reset right away from setParameters,
+     * setEffectParametersNonTKV and rwACDBParameters.
+     */
+    PayloadArena payloadArena;
+    PayloadArena paramArena;
     int updateCustomPayload(void *payload, size_t size);
     int freeCustomPayload(uint8_t **payload, size_t *payloadSize);
     uint32_t eventId;
@@ -123,6 +132,12 @@ protected:
     static std::mutex extECMutex;
     pal_device_id_t ecRefDevId;
     bool frontEndIdAllocated = false;
+    /*
+     * Set once volume, mute, pause or effect state was pushed to the graph
+     * after open. Such a graph no longer matches a freshly opened one and
+     * is not kept in the SessionPool.
+     */
+    bool graphStateChanged = false;
     struct pal_param_haptics_cnfg_t *hpCnfg;
     int32_t setInitialVolume();
 public:
@@ -193,6 +208,10 @@ public:
     virtual int GetMmapPosition(Stream *s __unused, struct pal_mmap_position *position __unused) {return -EINVAL;}
     virtual int ResetMmapBuffer(Stream *s __unused) {return -EINVAL;}
     virtual int openGraph(Stream *s __unused) { return 0; }
+    /* keep-alive pool, see SessionPool */
+    virtual int park(Stream *s __unused) { return -ENOSYS; }
+    virtual int unpark(Stream *s __unused) { return -ENOSYS; }
+    virtual int closeParked() { return -ENOSYS; }
     virtual int getTagsWithModuleInfo(Stream *s __unused, size_t *size __unused,
                                       uint8_t *payload __unused) {return -EINVAL;}
     virtual int checkAndSetExtEC(const std::shared_ptr<ResourceManager>& rm,
@@ -72,6 +72,7 @@
 #include <tinyalsa/asoundlib.h>
 #include <thread>
 #include <mutex>
+#include <atomic>
 
 #define PARAM_ID_DETECTION_ENGINE_CONFIG_VOICE_WAKEUP 0x08001049
 #define PARAM_ID_VOICE_WAKEUP_BUFFERING_CONFIG 0x08001044
@@ -104,7 +105,20 @@ private:
     uint32_t vaMicChannels;
     static std::mutex pcmLpmRefCntMtx;
     static int pcmLpmRefCnt;
+    /*
+     * what read()/write() need of the stream attributes, refreshed by
+     * updateIoAttr() on start and on every setParameters/setConfig
+     */
+    std::atomic<bool> ioMmap;
+    std::atomic<uint32_t> ioInRate;
+    std::atomic<uint32_t> ioOutRate;
+    /* graph state while parked in the SessionPool, see park() */
+    struct pal_stream_attributes parkedAttr;
+    std::vector<std::shared_ptr<Device>> parkedDevices;
+    bool parkedMixerCb;
+    bool reattached;
     int32_t configureInCallRxMFC();
+    void releaseLpmVote(const struct pal_stream_attributes &sAttr);
 public:
 
     SessionAlsaPcm(std::shared_ptr<ResourceManager> Rm);
@@ -145,6 +159,9 @@ public:
     int GetMmapPosition(Stream *s, struct pal_mmap_position *position) override;
     int ResetMmapBuffer(Stream *s) override;
     int openGraph(Stream *s) override;
+    int park(Stream *s) override;
+    int unpark(Stream *s) override;
+    int closeParked() override;
     void adjustMmapPeriodCount(struct pcm_config *config, int32_t min_size_frames);
     void registerAdmStream(Stream *s, pal_stream_direction_t dir,
             pal_stream_flags_t flags, struct pcm *, struct pcm_config *cfg);
@@ -157,6 +174,7 @@ public:
     int getTagsWithModuleInfo(Stream *s, size_t *size __unused, uint8_t *payload);
     void retryOpenWithoutEC(Stream *s, unsigned int pcm_flags, struct pcm_config *config);
     int reconfigureModule(uint32_t tagID, const char* BE, struct sessionToPayloadParam *data);
+    void updateIoAttr(Stream *s);
 };
 
 #endif //SESSION_ALSAPCM_H
@@ -33,6 +33,8 @@
 #include "Session.h"
 #include "ResourceManager.h"
 #include "PayloadBuilder.h"
+#include "MixerCtlCache.h"
+#include "MixerTransaction.h"
 
 #include <tinyalsa/asoundlib.h>
 #include <sound/asound.h>
@@ -102,6 +104,10 @@ public:
                     pal_device_id_t deviceId, void *payload, bool isParamWrite, uint32_t instanceId);
     static int close(Stream * s, std::shared_ptr<ResourceManager> rm, const std::vector<int> &DevIds,
             const std::vector<std::pair<int32_t, std::string>> &BackEnds, std::vector<std::pair<std::string, int>> &freedevicemetadata);
+    /* for graphs no longer attached to a stream, e.g. parked in the SessionPool */
+    static int close(const struct pal_stream_attributes &sAttr, std::shared_ptr<ResourceManager> rm,
+            const std::vector<int> &DevIds, const std::vector<std::pair<int32_t, std::string>> &BackEnds,
+            std::vector<std::pair<std::string, int>> &freedevicemetadata);
     static int close(Stream * s, std::shared_ptr<ResourceManager> rm,
                     const std::vector<int> &RxDevIds, const std::vector<int> &TxDevIds,
                     const std::vector<std::pair<int32_t, std::string>> &rxBackEnds,
@@ -113,6 +119,10 @@ public:
                        uint8_t *payload);
     static int setMixerParameter(struct mixer *mixer, int device,
                                  void *payload, int size);
+    static int setMixerParameter(struct mixer *mixer, int device,
+                                 PayloadArena &arena);
+    static int setMixerParameter(MixerTransaction &txn, struct mixer *mixer, int device,
+                                 void *payload, int size);
     static int setStreamMetadataType(struct mixer *mixer, int device, const char *val);
     static int registerMixerEvent(struct mixer *mixer, int device, const char *intf_name, int tag_id, void *payload, int payload_size);
     static int registerMixerEvent(struct mixer *mixer, int device, void *payload, int payload_size);
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef SESSION_POOL_H
+#define SESSION_POOL_H
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "PalDefs.h"
+
+#define SESSION_POOL_MAX_ENTRIES 4
+
+class Stream;
+class Session;
+class Device;
+
+/*
+ * Keep-alive pool for low latency and deep buffer playback graphs. On
+ * close an idle graph is parked here instead of being torn down: front end
+ * ids, graph metadata and the stopped pcm are kept for
+ * graph_keep_alive_ttl_ms. A stream opened with the same
+ * stream and device configuration takes the graph over and skips front end
+ * allocation, metadata writes and, when its buffers match, pcm_open.
+ *
+ * Only graphs in the state open() left them in are parked: a session that
+ * had volume, mute, pause or effect parameters applied is closed as before,
+ * so a reattached graph never carries state of the previous stream.
+ *
+ * The devices are closed with the stream as usual, so a parked graph does
+ * not keep a device path enabled. Its front ends stay allocated: the graph
+ * is bound to the front end pcm ids and giving them back means tearing
+ * down the graph the pool is there to keep. At most SESSION_POOL_MAX_ENTRIES
+ * front ends are held this way, and an open which runs out of front ends
+ * flushes the pool and retries.
+ *
+ * Off while the TTL is 0, the default. park() and take() run under the
+ * graph lock, expired graphs are closed by a reaper thread. Device
+ * switches drop the whole pool since parked graphs are not rerouted.
+ */
+class SessionPool
+{
+public:
+    static void setTtl(uint32_t ttl);
+    static bool isEnabled() { return ttlMs.load(std::memory_order_relaxed) > 0; }
+    /* takes over session of s if s is eligible */
+    static bool park(Stream *s, Session *session);
+    /* parked graph matching s, devices of s must be open */
+    static Session *take(Stream *s);
+    /* close every parked graph, returns how many; flush_l expects the graph lock held */
+    static int flush();
+    static int flush_l();
+    /* expire every parked graph from any context, the reaper closes them */
+    static void invalidate();
+    static void deinit();
+private:
+    struct entry {
+        std::string key;
+        Session *session;
+        pal_stream_type_t type;
+        uint32_t instanceId;
+        std::chrono::steady_clock::time_point expiry;
+    };
+    static int getKey(Stream *s, std::string &key);
+    static void closeEntry_l(struct entry &e);
+    static void reaperLoop();
+
+    static std::atomic<uint32_t> ttlMs;
+    static std::mutex poolMutex;
+    static std::condition_variable poolCv;
+    static std::list<struct entry> entries;   /* oldest first */
+    static std::thread reaper;
+    static bool exitReaper;
+};
+
+#endif //SESSION_POOL_H
@@ -106,7 +106,8 @@ private:
     int32_t StartKeywordDetection();
     int32_t StartUserVerification();
     int32_t UpdateConfThreshold(Stream *s);
-    static void BufferThreadLoop(SoundTriggerEngineCapi *capi_engine);
+    void ProcessDetection();
+    void DrainDetectionJob();
 
     std::string lib_name_;
     capi_v2_t *capi_handle_;
@@ -116,6 +117,8 @@ private:
     std::mutex event_mutex_;
     st_sound_model_type_t detection_type_;
     bool processing_started_;
+    bool job_pending_;       /* detection job queued or running */
+    bool executor_attached_;
     bool keyword_detected_;
     int32_t confidence_threshold_;
     uint32_t buffer_size_;
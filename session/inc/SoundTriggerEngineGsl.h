@@ -65,6 +65,7 @@
 
 #include <map>
 #include <queue>
+#include <deque>
 #include "SoundTriggerEngine.h"
 #include "SoundTriggerUtils.h"
 #include "StreamSoundTrigger.h"
@@ -146,6 +147,10 @@ class SoundTriggerEngineGsl : public SoundTriggerEngine {
     void ProcessEventTask();
     void HandleSessionEvent(uint32_t event_id __unused, void *data, uint32_t size);
     int32_t StartBuffering(Stream *s);
+    void WaitForLabData_l(uint32_t wait_ms);
+    void UpdateLabTransferStats(Stream *s, size_t ftrt_size,
+                                ChronoSteadyClock_t first_byte,
+                                ChronoSteadyClock_t end);
     int32_t RestartRecognition_l(Stream *s);
     int32_t UpdateSessionPayload(Stream *s, st_param_id_type_t param);
 
@@ -199,6 +204,10 @@ class SoundTriggerEngineGsl : public SoundTriggerEngine {
     size_t mmap_buffer_size_;
     uint32_t mmap_write_position_;
     uint64_t kw_transfer_latency_;
+    /* FTRT transfer latency of the last detections, for tail latency */
+    std::deque<uint64_t> kw_latency_history_;
+    /* wakes the buffering loop on new detections and stop requests */
+    std::condition_variable_any lab_cv_;
     int32_t ec_ref_count_;
     std::map<Stream*, ChronoSteadyClock_t> detection_time_map_;
     std::mutex state_mutex_;
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#define LOG_TAG "PAL: MixerCtlCache"
+
+#include "MixerCtlCache.h"
+#include "ResourceManager.h"
+#include "PalCommon.h"
+
+std::mutex MixerCtlCache::cacheMutex;
+std::unordered_map<MixerCtlCache::ctl_key, struct mixer_ctl *,
+                   MixerCtlCache::ctl_key_hash> MixerCtlCache::ctls;
+std::atomic<uint64_t> MixerCtlCache::hits(0);
+std::atomic<uint64_t> MixerCtlCache::misses(0);
+std::atomic<uint64_t> MixerCtlCache::invalidations(0);
+
+struct mixer_ctl *MixerCtlCache::lookup(const ctl_key &key)
+{
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto it = ctls.find(key);
+
+    if (it == ctls.end())
+        return NULL;
+    hits++;
+    return it->second;
+}
+
+void MixerCtlCache::insert(const ctl_key &key, struct mixer_ctl *ctl)
+{
+    std::lock_guard<std::mutex> lock(cacheMutex);
+
+    ctls[key] = ctl;
+}
+
+struct mixer_ctl *MixerCtlCache::getCtl(struct mixer *am, const char *name)
+{
+    ctl_key key = {am, -1, name};
+    struct mixer_ctl *ctl = NULL;
+
+    if (!am || !name)
+        return NULL;
+
+    ctl = lookup(key);
+    if (ctl)
+        return ctl;
+
+    misses++;
+    ctl = mixer_get_ctl_by_name(am, name);
+    if (ctl)
+        insert(key, ctl);
+    return ctl;
+}
+
+struct mixer_ctl *MixerCtlCache::getPcmCtl(struct mixer *am, int device, const char *suffix)
+{
+    ctl_key key = {am, device, suffix};
+    struct mixer_ctl *ctl = NULL;
+    char *pcmDeviceName = NULL;
+    std::string name;
+    std::shared_ptr<ResourceManager> rm = ResourceManager::getInstance();
+
+    if (!am || !suffix)
+        return NULL;
+
+    ctl = lookup(key);
+    if (ctl)
+        return ctl;
+
+    pcmDeviceName = rm->getDeviceNameFromID(device);
+    if (!pcmDeviceName) {
+        PAL_ERR(LOG_TAG, "Device name from id %d not found", device);
+        return NULL;
+    }
+    name = std::string(pcmDeviceName) + " " + suffix;
+    PAL_DBG(LOG_TAG, "- mixer -%s-", name.c_str());
+
+    misses++;
+    ctl = mixer_get_ctl_by_name(am, name.c_str());
+    if (!ctl) {
+        PAL_ERR(LOG_TAG, "Invalid mixer control: %s", name.c_str());
+        return NULL;
+    }
+    insert(key, ctl);
+    return ctl;
+}
+
+void MixerCtlCache::invalidate()
+{
+    std::lock_guard<std::mutex> lock(cacheMutex);
+
+    PAL_INFO(LOG_TAG, "drop %zu controls, hits %llu misses %llu", ctls.size(),
+             (unsigned long long)hits.load(), (unsigned long long)misses.load());
+    ctls.clear();
+    invalidations++;
+}
+
+void MixerCtlCache::getStats(struct mixer_ctl_cache_stats *stats)
+{
+    std::lock_guard<std::mutex> lock(cacheMutex);
+
+    stats->hits = hits.load();
+    stats->misses = misses.load();
+    stats->invalidations = invalidations.load();
+    stats->entries = ctls.size();
+}
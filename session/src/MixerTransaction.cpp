@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#define LOG_TAG "PAL: MixerTransaction"
+
+#include <errno.h>
+#include <string.h>
+#include "MixerTransaction.h"
+#include "PalCommon.h"
+
+std::mutex MixerTransaction::shadowMutex;
+std::unordered_map<struct mixer_ctl *, std::vector<uint8_t>> MixerTransaction::shadow;
+struct mixer_transaction_stats MixerTransaction::stats = {};
+thread_local uint64_t MixerTransaction::threadRoundTrips = 0;
+
+MixerTransaction::MixerTransaction(const char *tag)
+    : tag(tag), roundTrips(0), skipped(0)
+{
+}
+
+MixerTransaction::~MixerTransaction()
+{
+    if (!ops.empty())
+        PAL_DBG(LOG_TAG, "%s: dropping %zu uncommitted writes", tag.c_str(), ops.size());
+}
+
+void MixerTransaction::setEnum(struct mixer_ctl *ctl, const char *value)
+{
+    struct mixer_op op;
+
+    op.ctl = ctl;
+    op.type = MIXER_OP_ENUM;
+    op.data.assign(value, value + strlen(value) + 1);
+    op.count = 0;
+    op.idempotent = false;
+    ops.push_back(std::move(op));
+}
+
+void MixerTransaction::setArray(struct mixer_ctl *ctl, const void *data, size_t count,
+                                bool idempotent)
+{
+    struct mixer_op op;
+    size_t size = count;
+
+    /* array controls are sized in elements, integer elements are passed as long */
+    if (mixer_ctl_get_type(ctl) == MIXER_CTL_TYPE_INT)
+        size = count * sizeof(long);
+    op.ctl = ctl;
+    op.type = MIXER_OP_ARRAY;
+    op.data.assign((const uint8_t *)data, (const uint8_t *)data + size);
+    op.count = count;
+    op.idempotent = idempotent;
+    ops.push_back(std::move(op));
+}
+
+bool MixerTransaction::isUnchanged(const struct mixer_op &op)
+{
+    std::lock_guard<std::mutex> lock(shadowMutex);
+    auto it = shadow.find(op.ctl);
+
+    return it != shadow.end() && it->second == op.data;
+}
+
+void MixerTransaction::updateShadow(const struct mixer_op &op)
+{
+    std::lock_guard<std::mutex> lock(shadowMutex);
+
+    shadow[op.ctl] = op.data;
+}
+
+int MixerTransaction::commit(bool stopOnError)
+{
+    int status = 0;
+    int ret = 0;
+
+    for (auto &op : ops) {
+        if (status && stopOnError) {
+            skipped++;
+            continue;
+        }
+        if (op.idempotent && isUnchanged(op)) {
+            skipped++;
+            continue;
+        }
+        if (op.type == MIXER_OP_ENUM)
+            ret = mixer_ctl_set_enum_by_string(op.ctl, (const char *)op.data.data());
+        else
+            ret = mixer_ctl_set_array(op.ctl, op.data.data(), op.count);
+        roundTrips++;
+        if (ret) {
+            PAL_ERR(LOG_TAG, "%s: write to %s failed %d", tag.c_str(),
+                    mixer_ctl_get_name(op.ctl), ret);
+            if (!status)
+                status = ret;
+            if (op.idempotent) {
+                std::lock_guard<std::mutex> lock(shadowMutex);
+                shadow.erase(op.ctl);
+            }
+        } else if (op.idempotent) {
+            updateShadow(op);
+        }
+    }
+    ops.clear();
+    threadRoundTrips += roundTrips;
+
+    std::lock_guard<std::mutex> lock(shadowMutex);
+    stats.commits++;
+    stats.writes += roundTrips;
+    stats.skipped += skipped;
+    PAL_DBG(LOG_TAG, "%s: %u round trips, %u skipped, status %d", tag.c_str(),
+            roundTrips, skipped, status);
+    return status;
+}
+
+uint64_t MixerTransaction::getThreadRoundTrips()
+{
+    return threadRoundTrips;
+}
+
+void MixerTransaction::addThreadRoundTrips(uint64_t count)
+{
+    threadRoundTrips += count;
+}
+
+void MixerTransaction::getStats(struct mixer_transaction_stats *out)
+{
+    std::lock_guard<std::mutex> lock(shadowMutex);
+
+    *out = stats;
+}
+
+void MixerTransaction::invalidate()
+{
+    std::lock_guard<std::mutex> lock(shadowMutex);
+
+    shadow.clear();
+}
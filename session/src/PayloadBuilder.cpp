@@ -80,6 +80,7 @@
 #include "mspp_module_calibration_api.h"
 #include "tsm_module_api.h"
 #include "USBAudio.h"
+#include "PalXmlSnapshot.h"
 
 #if defined(FEATURE_IPQ_OPENWRT) || defined(LINUX_ENABLED)
 #define USECASE_XML_FILE "/etc/usecaseKvManager.xml"
@@ -291,6 +292,15 @@ std::vector<allKVs> PayloadBuilder::all_streams;
 std::vector<allKVs> PayloadBuilder::all_streampps;
 std::vector<allKVs> PayloadBuilder::all_devices;
 std::vector<allKVs> PayloadBuilder::all_devicepps;
+std::unordered_map<std::string, uint32_t> PayloadBuilder::selectorValueIds;
+std::unordered_map<std::string, std::vector<kvPairs>> PayloadBuilder::kvIndex;
+std::set<std::pair<uint32_t, int32_t>> PayloadBuilder::kvIndexSkippedIds;
+std::map<std::pair<uint32_t, int32_t>, std::vector<std::string>> PayloadBuilder::kvSelectorIndex;
+std::mutex PayloadBuilder::kvCacheMutex;
+std::unordered_map<std::string, kvCacheEntry> PayloadBuilder::kvCache;
+std::atomic<uint32_t> PayloadBuilder::kvCacheVersion(0);
+std::atomic<uint64_t> PayloadBuilder::kvCacheHits(0);
+std::atomic<uint64_t> PayloadBuilder::kvCacheMisses(0);
 
 template <typename T>
 void PayloadBuilder::populateChannelMixerCoeff(T pcmChannel, uint8_t numChannel,
@@ -530,7 +540,7 @@ void PayloadBuilder::payloadDpAudioConfig(uint8_t** payload, size_t* size,
 
 #define PLAYBACK_VOLUME_MAX 0x2000
 void PayloadBuilder::payloadVolumeConfig(uint8_t** payload, size_t* size,
-        uint32_t miid, struct pal_volume_data* voldata)
+        uint32_t miid, struct pal_volume_data* voldata, PayloadArena *arena)
 {
     struct apm_module_param_data_t* header = nullptr;
     volume_ctrl_master_gain_t *volConf = nullptr;
@@ -551,7 +561,7 @@ void PayloadBuilder::payloadVolumeConfig(uint8_t** payload, size_t* size,
     payloadSize = sizeof(struct apm_module_param_data_t) +
                   sizeof(struct volume_ctrl_master_gain_t);
     padBytes = PAL_PADDING_8BYTE_ALIGN(payloadSize);
-    payloadInfo = (uint8_t*) calloc(1, payloadSize + padBytes);
+    payloadInfo = allocPayload(arena, payloadSize + padBytes);
     if (!payloadInfo) {
         PAL_ERR(LOG_TAG, "payloadInfo malloc failed %s", strerror(errno));
         return;
@@ -572,7 +582,7 @@ void PayloadBuilder::payloadVolumeConfig(uint8_t** payload, size_t* size,
 }
 
 void PayloadBuilder::payloadMultichVolumemConfig(uint8_t** payload, size_t* size,
-        uint32_t miid, struct pal_volume_data* voldata)
+        uint32_t miid, struct pal_volume_data* voldata, PayloadArena *arena)
 {
     const uint32_t PLAYBACK_MULTI_VOLUME_GAIN = 1 << 28;
     struct apm_module_param_data_t* header = nullptr;
@@ -589,7 +599,12 @@ void PayloadBuilder::payloadMultichVolumemConfig(uint8_t** payload, size_t* size
                   sizeof(struct volume_ctrl_multichannel_gain_t) +
                   numChannels * sizeof(volume_ctrl_channels_gain_config_t);
     padBytes = PAL_PADDING_8BYTE_ALIGN(payloadSize);
-    payloadInfo = (uint8_t*) calloc(1, payloadSize + padBytes);
+    //always unmute when set multi channel gain
+    mutePayloadSize = sizeof(struct apm_module_param_data_t) +
+                      sizeof(struct volume_ctrl_master_mute_t);
+    mutePadBytes = PAL_PADDING_8BYTE_ALIGN(mutePayloadSize);
+    payloadInfo = allocPayload(arena, payloadSize + padBytes +
+                               mutePayloadSize + mutePadBytes);
     if (!payloadInfo) {
         PAL_ERR(LOG_TAG, "payloadInfo malloc failed %s", strerror(errno));
         return;
@@ -620,16 +635,6 @@ void PayloadBuilder::payloadMultichVolumemConfig(uint8_t** payload, size_t* size
                   header->module_instance_id, header->param_id,
                   header->error_code, header->param_size);
 
-    //always unmute when set multi channel gain
-    mutePayloadSize = sizeof(struct apm_module_param_data_t) +
-                      sizeof(struct volume_ctrl_master_mute_t);
-    mutePadBytes = PAL_PADDING_8BYTE_ALIGN(mutePayloadSize);
-    payloadInfo = (uint8_t*) realloc(payloadInfo, payloadSize + padBytes +
-                                        mutePayloadSize + mutePadBytes);
-    if (!payloadInfo) {
-        PAL_ERR(LOG_TAG, "payloadInfo realloc failed %s", strerror(errno));
-        return;
-    }
     muteheader = (struct apm_module_param_data_t*) (payloadInfo + payloadSize + padBytes);
     muteheader->module_instance_id = miid;
     muteheader->param_id = PARAM_ID_VOL_CTRL_MASTER_MUTE;
@@ -647,7 +652,7 @@ void PayloadBuilder::payloadMultichVolumemConfig(uint8_t** payload, size_t* size
 }
 
 void PayloadBuilder::payloadGainConfig(uint8_t** payload, size_t* size,
-        uint32_t miid, struct pal_gain_data* gaindata)
+        uint32_t miid, struct pal_gain_data* gaindata, PayloadArena *arena)
 
 {
     struct apm_module_param_data_t* header = nullptr;
@@ -660,7 +665,7 @@ void PayloadBuilder::payloadGainConfig(uint8_t** payload, size_t* size,
     payloadSize = sizeof(struct apm_module_param_data_t) +
                   sizeof(struct param_id_module_gain_cfg_t);
     padBytes = PAL_PADDING_8BYTE_ALIGN(payloadSize);
-    payloadInfo = (uint8_t*) calloc(1, payloadSize + padBytes);
+    payloadInfo = allocPayload(arena, payloadSize + padBytes);
     if (!payloadInfo) {
         PAL_ERR(LOG_TAG, "payloadInfo malloc failed %s", strerror(errno));
         return;
@@ -681,7 +686,7 @@ void PayloadBuilder::payloadGainConfig(uint8_t** payload, size_t* size,
 }
 
 void PayloadBuilder::payloadVolumeCtrlRamp(uint8_t** payload, size_t* size,
-        uint32_t miid, uint32_t ramp_period_ms)
+        uint32_t miid, uint32_t ramp_period_ms, PayloadArena *arena)
 {
     struct apm_module_param_data_t* header = NULL;
     struct volume_ctrl_gain_ramp_params_t *rampParams;
@@ -691,7 +696,7 @@ void PayloadBuilder::payloadVolumeCtrlRamp(uint8_t** payload, size_t* size,
     payloadSize = sizeof(struct apm_module_param_data_t) +
                   sizeof(struct volume_ctrl_gain_ramp_params_t);
     padBytes = PAL_PADDING_8BYTE_ALIGN(payloadSize);
-    payloadInfo = (uint8_t*) calloc(1, payloadSize + padBytes);
+    payloadInfo = allocPayload(arena, payloadSize + padBytes);
     if (!payloadInfo) {
         PAL_ERR(LOG_TAG, "payloadInfo malloc failed %s", strerror(errno));
         return;
@@ -864,7 +869,7 @@ void PayloadBuilder::payloadCRSMFCMixerCoeff(uint8_t** payload, size_t* size,
 }
 
 void PayloadBuilder::payloadMFCConfig(uint8_t** payload, size_t* size,
-        uint32_t miid, struct sessionToPayloadParam* data)
+        uint32_t miid, struct sessionToPayloadParam* data, PayloadArena *arena)
 {
     struct apm_module_param_data_t* header = NULL;
     struct param_id_mfc_output_media_fmt_t *mfcConf;
@@ -883,7 +888,7 @@ void PayloadBuilder::payloadMFCConfig(uint8_t** payload, size_t* size,
                   sizeof(uint16_t)*numChannels;
     padBytes = PAL_PADDING_8BYTE_ALIGN(payloadSize);
 
-    payloadInfo = (uint8_t*) calloc(1, payloadSize + padBytes);
+    payloadInfo = allocPayload(arena, payloadSize + padBytes);
     if (!payloadInfo) {
         PAL_ERR(LOG_TAG, "payloadInfo malloc failed %s", strerror(errno));
         return;
@@ -972,6 +977,76 @@ PayloadBuilder::~PayloadBuilder()
 
 }
 
+PayloadArena::PayloadArena()
+{
+    buf = NULL;
+    capacity = 0;
+    used = 0;
+}
+
+PayloadArena::~PayloadArena()
+{
+    if (buf)
+        free(buf);
+}
+
+uint8_t* PayloadArena::alloc(size_t size)
+{
+    uint8_t *block = NULL;
+    uint8_t *newBuf = NULL;
+    size_t newCapacity = 0;
+
+    if (!buf || used + size > capacity) {
+        newCapacity = std::max(std::max(capacity * 2, used + size),
+                               (size_t)PAYLOAD_ARENA_DEFAULT_SIZE);
+        newBuf = (uint8_t *)realloc(buf, newCapacity);
+        if (!newBuf) {
+            PAL_ERR(LOG_TAG, "failed to grow payload arena to %zu", newCapacity);
+            return NULL;
+        }
+        PAL_VERBOSE(LOG_TAG, "payload arena grown %zu -> %zu", capacity, newCapacity);
+        buf = newBuf;
+        capacity = newCapacity;
+    }
+    block = buf + used;
+    memset(block, 0, size);
+    used += size;
+    return block;
+}
+
+uint8_t* PayloadArena::append(const void *payload, size_t size)
+{
+    uint8_t *block = alloc(size);
+
+    if (block && payload)
+        memcpy(block, payload, size);
+    return block;
+}
+
+bool PayloadArena::owns(const void *payload) const
+{
+    return buf && (const uint8_t *)payload >= buf &&
+           (const uint8_t *)payload < buf + used;
+}
+
+void PayloadArena::truncate(size_t size)
+{
+    if (size < used)
+        used = size;
+}
+
+void PayloadArena::reset()
+{
+    used = 0;
+}
+
+uint8_t* PayloadBuilder::allocPayload(PayloadArena *arena, size_t size)
+{
+    if (arena)
+        return arena->alloc(size);
+    return (uint8_t *)calloc(1, size);
+}
+
 uint16_t numOfBitsSet(uint32_t lines)
 {
     uint16_t numBitsSet = 0;
@@ -1318,11 +1393,7 @@ void PayloadBuilder::handleData(void *userdata, const char *s, int len)
 
 int PayloadBuilder::init()
 {
-    XML_Parser parser;
-    FILE *file = NULL;
     int ret = 0;
-    int bytes_read;
-    void *buf = NULL;
     struct user_xml_data tag_data;
     memset(&tag_data, 0, sizeof(tag_data));
     all_streams.clear();
@@ -1331,52 +1402,187 @@ int PayloadBuilder::init()
     all_devicepps.clear();
 
     PAL_INFO(LOG_TAG, "XML parsing started %s", USECASE_XML_FILE);
-    file = fopen(USECASE_XML_FILE, "r");
-    if (!file) {
-        PAL_ERR(LOG_TAG, "Failed to open xml");
+    ret = PalXmlSnapshot::parse(USECASE_XML_FILE, &tag_data, startTag, endTag, handleData);
+    if (ret) {
+        PAL_ERR(LOG_TAG, "Failed to parse xml ret %d", ret);
         ret = -EINVAL;
         goto done;
     }
+    buildKVIndex();
+
+done:
+    return ret;
+}
 
-    parser = XML_ParserCreate(NULL);
-    if (!parser) {
-        PAL_ERR(LOG_TAG, "Failed to create XML");
-        goto closeFile;
+uint32_t PayloadBuilder::getKVTableId(std::vector<allKVs> &any_type)
+{
+    if (&any_type == &all_streams)
+        return KV_TABLE_STREAMS;
+    else if (&any_type == &all_streampps)
+        return KV_TABLE_STREAMPPS;
+    else if (&any_type == &all_devices)
+        return KV_TABLE_DEVICES;
+    else
+        return KV_TABLE_DEVICEPPS;
+}
+
+/*
+ * Compose the index key for a set of selector pairs. Returns false when
+ * the pairs cannot be looked up in the index, i.e. a selector type is
+ * repeated or a value is unknown to usecaseKvManager.xml.
+ */
+bool PayloadBuilder::getKVIndexKey(uint32_t table, int32_t type,
+    std::vector<std::pair<selector_type_t, std::string>> &selector_pairs,
+    std::string &key)
+{
+    std::vector<uint32_t> ids;
+    uint32_t id = 0;
+
+    for (auto &pair : selector_pairs) {
+        auto it = selectorValueIds.find(pair.second);
+        if (it == selectorValueIds.end())
+            return false;
+        ids.push_back(((uint32_t)pair.first << 24) | it->second);
+    }
+    std::sort(ids.begin(), ids.end());
+    for (int32_t i = 1; i < ids.size(); i++) {
+        if ((ids[i] >> 24) == (ids[i - 1] >> 24))
+            return false;
+    }
+
+    key.clear();
+    key.append((const char *)&table, sizeof(table));
+    key.append((const char *)&type, sizeof(type));
+    for (int32_t i = 0; i < ids.size(); i++) {
+        id = ids[i];
+        key.append((const char *)&id, sizeof(id));
     }
-    XML_SetUserData(parser,&tag_data);
-    XML_SetElementHandler(parser, startTag, endTag);
-    XML_SetCharacterDataHandler(parser, handleData);
+    return true;
+}
 
-    while (1) {
-        buf = XML_GetBuffer(parser, 1024);
-        if (buf == NULL) {
-            PAL_ERR(LOG_TAG, "XML_Getbuffer failed");
-            ret = -EINVAL;
-            goto freeParser;
+/*
+ * A lookup matches the first keys_and_values entry of every KV block of the
+ * id whose selector pairs contain all the requested pairs, so index every
+ * combination of at most one value per selector type of each entry.
+ */
+void PayloadBuilder::indexKVTable(uint32_t table, std::vector<allKVs> &any_type)
+{
+    std::map<int32_t, size_t> combinations;
+
+    for (auto &kvs : any_type) {
+        for (auto &kv_info : kvs.keys_values) {
+            std::map<selector_type_t, std::vector<std::string>> values;
+            size_t count = 1;
+
+            for (auto &pair : kv_info.selector_pairs)
+                values[pair.first].push_back(pair.second);
+            for (auto &value : values)
+                count *= value.second.size() + 1;
+            for (auto id : kvs.id_type)
+                combinations[id] += count;
+        }
+    }
+    for (auto &id : combinations) {
+        if (id.second > KV_INDEX_MAX_COMBINATIONS) {
+            PAL_INFO(LOG_TAG, "KV table %u id %d has %zu combinations, not indexed",
+                table, id.first, id.second);
+            kvIndexSkippedIds.insert(std::make_pair(table, id.first));
         }
+    }
+
+    for (auto &kvs : any_type) {
+        std::set<std::string> matched;
 
-        bytes_read = fread(buf, 1, 1024, file);
-        if (bytes_read < 0) {
-            PAL_ERR(LOG_TAG, "fread failed");
-            ret = -EINVAL;
-            goto freeParser;
+        for (auto &kv_info : kvs.keys_values) {
+            std::vector<std::pair<selector_type_t, std::vector<std::string>>> values;
+            std::vector<std::vector<std::pair<selector_type_t, std::string>>> subsets(1);
+
+            for (auto &pair : kv_info.selector_pairs) {
+                auto it = std::find_if(values.begin(), values.end(),
+                    [&](const std::pair<selector_type_t, std::vector<std::string>> &v) {
+                        return v.first == pair.first; });
+                if (it == values.end())
+                    values.push_back(std::make_pair(pair.first,
+                        std::vector<std::string>(1, pair.second)));
+                else
+                    it->second.push_back(pair.second);
+            }
+            for (auto &value : values) {
+                size_t size = subsets.size();
+                for (size_t i = 0; i < size; i++) {
+                    for (auto &v : value.second) {
+                        subsets.push_back(subsets[i]);
+                        subsets.back().push_back(std::make_pair(value.first, v));
+                    }
+                }
+            }
+
+            for (auto id : kvs.id_type) {
+                if (kvIndexSkippedIds.count(std::make_pair(table, id)))
+                    continue;
+                for (auto &subset : subsets) {
+                    std::string key;
+
+                    /* only entries without selectors match empty lookups */
+                    if (subset.empty() && !kv_info.selector_pairs.empty())
+                        continue;
+                    if (!getKVIndexKey(table, id, subset, key) ||
+                        !matched.insert(key).second)
+                        continue;
+                    std::vector<kvPairs> &kv_pairs = kvIndex[key];
+                    kv_pairs.insert(kv_pairs.end(), kv_info.kv_pairs.begin(),
+                        kv_info.kv_pairs.end());
+                }
+            }
         }
+    }
+}
 
-        if (XML_ParseBuffer(parser, bytes_read, bytes_read == 0) == XML_STATUS_ERROR) {
-            PAL_ERR(LOG_TAG, "XML ParseBuffer failed ");
-            ret = -EINVAL;
-            goto freeParser;
+void PayloadBuilder::buildKVIndex()
+{
+    std::vector<allKVs> *tables[] = {&all_streams, &all_streampps,
+                                     &all_devices, &all_devicepps};
+
+    selectorValueIds.clear();
+    kvIndex.clear();
+    kvIndexSkippedIds.clear();
+
+    for (auto table : tables) {
+        for (auto &kvs : *table) {
+            for (auto &kv_info : kvs.keys_values) {
+                for (auto &pair : kv_info.selector_pairs)
+                    selectorValueIds.insert(std::make_pair(pair.second,
+                        (uint32_t)selectorValueIds.size()));
+                /* keep compareSelectorPairs from reordering shared tables */
+                std::sort(kv_info.selector_pairs.begin(),
+                    kv_info.selector_pairs.end());
+            }
         }
-        if (bytes_read == 0)
-            break;
     }
 
-freeParser:
-    XML_ParserFree(parser);
-closeFile:
-    fclose(file);
-done:
-    return ret;
+    for (uint32_t i = 0; i < sizeof(tables) / sizeof(tables[0]); i++)
+        indexKVTable(i, *tables[i]);
+
+    /* selector names per id, in the order retrieveSelectors used to find them */
+    kvSelectorIndex.clear();
+    for (uint32_t i = 0; i < sizeof(tables) / sizeof(tables[0]); i++) {
+        for (auto &kvs : *tables[i]) {
+            for (auto id : kvs.id_type) {
+                std::vector<std::string> &selectors =
+                    kvSelectorIndex[std::make_pair(i, id)];
+                for (auto &kv_info : kvs.keys_values)
+                    selectors.insert(selectors.end(),
+                        kv_info.selector_names.begin(), kv_info.selector_names.end());
+            }
+        }
+    }
+    for (auto &selectors : kvSelectorIndex)
+        removeDuplicateSelectors(selectors.second);
+
+    invalidateKVCache();
+
+    PAL_INFO(LOG_TAG, "KV index built, %zu selector values, %zu keys",
+        selectorValueIds.size(), kvIndex.size());
 }
 
 void PayloadBuilder::payloadTimestamp(std::shared_ptr<std::vector<uint8_t>>& payload,
@@ -1610,7 +1816,7 @@ int PayloadBuilder::payloadACDBTunnelParam(uint8_t **alsaPayload,
 
 int PayloadBuilder::payloadACDBParam(uint8_t **alsaPayload, size_t *size,
             uint8_t *payload,
-            uint32_t moduleInstanceId, uint32_t sampleRate) {
+            uint32_t moduleInstanceId, uint32_t sampleRate, PayloadArena *arena) {
     struct apm_module_param_data_t* header;
     //uint8_t* payloadInfo = NULL;
     struct agm_acdb_param *payloadInfo = NULL;
@@ -1668,11 +1874,11 @@ int PayloadBuilder::payloadACDBParam(uint8_t **alsaPayload, size_t *size,
                         - sizeof(pal_effect_custom_payload_t);
         paddedSize = PAL_ALIGN_8BYTE(payloadSize);
         PAL_INFO(LOG_TAG, "payloadSize=%d paddedSize=%x", payloadSize, paddedSize);
-        payloadInfo = (struct agm_acdb_param *)calloc(1,
-            sizeof(struct agm_acdb_param) +
+        payloadInfo = (struct agm_acdb_param *)allocPayload(arena,
+            PAL_ALIGN_8BYTE(sizeof(struct agm_acdb_param) +
             (acdbParam->num_kvs + appendSampleRateInCKV) *
             sizeof(struct gsl_key_value_pair) +
-            sizeof(struct apm_module_param_data_t) + paddedSize);
+            sizeof(struct apm_module_param_data_t) + paddedSize));
         if (!payloadInfo) {
             PAL_ERR(LOG_TAG, "failed to allocate memory.");
             return -ENOMEM;
@@ -1726,11 +1932,11 @@ int PayloadBuilder::payloadACDBParam(uint8_t **alsaPayload, size_t *size,
                         - sizeof(pal_effect_custom_payload_t);
 
         repackedData =
-                (struct agm_acdb_param *)calloc(1,
-                    sizeof(struct agm_acdb_param) +
+                (struct agm_acdb_param *)allocPayload(arena,
+                    PAL_ALIGN_8BYTE(sizeof(struct agm_acdb_param) +
                     (acdbParam->num_kvs + appendSampleRateInCKV) *
                     sizeof(struct gsl_key_value_pair) +
-                    sizeof(struct apm_module_param_data_t) + payloadSize * 2);
+                    sizeof(struct apm_module_param_data_t) + payloadSize * 2));
 
         if (!repackedData) {
                 PAL_ERR(LOG_TAG, "failed to allocate memory of 0x%x bytes",
@@ -1805,7 +2011,7 @@ int PayloadBuilder::payloadACDBParam(uint8_t **alsaPayload, size_t *size,
 
 int PayloadBuilder::payloadCustomParam(uint8_t **alsaPayload, size_t *size,
             uint32_t *customPayload, uint32_t customPayloadSize,
-            uint32_t moduleInstanceId, uint32_t paramId) {
+            uint32_t moduleInstanceId, uint32_t paramId, PayloadArena *arena) {
     struct apm_module_param_data_t* header;
     uint8_t* payloadInfo = NULL;
     size_t alsaPayloadSize = 0;
@@ -1816,7 +2022,7 @@ int PayloadBuilder::payloadCustomParam(uint8_t **alsaPayload, size_t *size,
     if (paramId) {
         alsaPayloadSize = PAL_ALIGN_8BYTE(sizeof(struct apm_module_param_data_t)
                                             + customPayloadSize);
-        payloadInfo = (uint8_t *)calloc(1, (size_t)alsaPayloadSize);
+        payloadInfo = allocPayload(arena, (size_t)alsaPayloadSize);
         if (!payloadInfo) {
             PAL_ERR(LOG_TAG, "failed to allocate memory.");
             return -ENOMEM;
@@ -1835,15 +2041,26 @@ int PayloadBuilder::payloadCustomParam(uint8_t **alsaPayload, size_t *size,
         *size = alsaPayloadSize;
         *alsaPayload = payloadInfo;
     } else {
-        // make sure memory is big enough to handle padding
-        uint8_t *repackedData = (uint8_t *)calloc(1, customPayloadSize * 2);
+        legacyGefParamHeader *gefMultipleParamHeader = NULL;
+        PAL_DBG(LOG_TAG, "custom payloadsize=0x%x", customPayloadSize);
+
+        // size the repacked params up front so they fit in one block
+        while (parsedSize < customPayloadSize) {
+            gefMultipleParamHeader =
+                (legacyGefParamHeader *)((uint8_t *)customPayload + parsedSize);
+            totalPaddedSize += PAL_ALIGN_8BYTE(sizeof(struct apm_module_param_data_t)
+                                                + gefMultipleParamHeader->length);
+            parsedSize += sizeof(legacyGefParamHeader) +
+                            gefMultipleParamHeader->length;
+        }
+        uint8_t *repackedData = allocPayload(arena, totalPaddedSize);
         if (!repackedData) {
             PAL_ERR(LOG_TAG, "failed to allocate memory of 0x%x bytes",
-                        customPayloadSize * 2);
+                        totalPaddedSize);
             return -ENOMEM;
         }
-        legacyGefParamHeader *gefMultipleParamHeader = NULL;
-        PAL_DBG(LOG_TAG, "custom payloadsize=0x%x", customPayloadSize);
+        parsedSize = 0;
+        totalPaddedSize = 0;
 
         while (parsedSize < customPayloadSize) {
             gefMultipleParamHeader =
@@ -2617,37 +2834,36 @@ int PayloadBuilder::populateStreamPPKV(Stream* s, std::vector <std::pair<int,int
         std::vector <std::pair<int,int>> &keyVectorTx __unused)
 {
     int status = 0;
-    struct pal_stream_attributes *sattr = NULL;
+    struct pal_stream_attributes sattr;
     std::vector <std::string> selectors;
     std::vector <std::pair<selector_type_t, std::string>> filled_selector_pairs;
+    std::string cacheKey;
+    size_t offset = keyVectorRx.size();
 
     PAL_DBG(LOG_TAG, "Enter");
-    sattr = new struct pal_stream_attributes();
-    if (!sattr) {
-        PAL_ERR(LOG_TAG, "sattr alloc failed %s", strerror(errno));
-        status = -ENOMEM;
-        goto exit;
-    }
-    memset(sattr, 0, sizeof(struct pal_stream_attributes));
-    status = s->getStreamAttributes(sattr);
+    memset(&sattr, 0, sizeof(struct pal_stream_attributes));
+    status = s->getStreamAttributes(&sattr);
     if (0 != status) {
         PAL_ERR(LOG_TAG, "getStreamAttributes Failed status %d", status);
-        goto free_sattr;
+        goto exit;
     }
 
-    PAL_INFO(LOG_TAG, "stream type %d", sattr->type);
+    PAL_INFO(LOG_TAG, "stream type %d", sattr.type);
 
-    if (sattr->type == PAL_STREAM_VOICE_CALL) {
-        selectors = retrieveSelectors(sattr->type, all_streampps);
+    if (sattr.type == PAL_STREAM_VOICE_CALL) {
+        cacheKey = getKVCacheKey(KV_TABLE_STREAMPPS, sattr.type, s, &sattr, NULL);
+        if (lookupKVCache(cacheKey, keyVectorRx))
+            goto exit;
+
+        selectors = retrieveSelectors(sattr.type, all_streampps);
         if (selectors.empty() != true)
             filled_selector_pairs = getSelectorValues(selectors, s, NULL);
-        retrieveKVs(filled_selector_pairs ,sattr->type, all_streampps, keyVectorRx);
+        retrieveKVs(filled_selector_pairs ,sattr.type, all_streampps, keyVectorRx);
+        updateKVCache(cacheKey, keyVectorRx, offset);
     } else {
-        PAL_DBG(LOG_TAG, "KVs not provided for stream type:%d", sattr->type);
+        PAL_DBG(LOG_TAG, "KVs not provided for stream type:%d", sattr.type);
     }
 
-free_sattr:
-    delete sattr;
 exit:
     PAL_DBG(LOG_TAG, "Exit, status %d", status);
     return status;
@@ -2696,7 +2912,29 @@ bool PayloadBuilder::findKVs(std::vector<std::pair<selector_type_t, std::string>
     std::vector<std::pair<int, int>> &keyVector)
 {
     bool found = false;
+    uint32_t table = getKVTableId(any_type);
+    std::string key;
+
+    if (!kvIndexSkippedIds.count(std::make_pair(table, (int32_t)type))) {
+        if (!getKVIndexKey(table, type, filled_selector_pairs, key)) {
+            /* a repeated selector type can only be resolved by scanning */
+            if (std::all_of(filled_selector_pairs.begin(), filled_selector_pairs.end(),
+                    [](const std::pair<selector_type_t, std::string> &pair) {
+                        return selectorValueIds.count(pair.second); }))
+                goto scan;
+            return false;
+        }
+        auto it = kvIndex.find(key);
+        if (it == kvIndex.end())
+            return false;
+        for (auto &kv : it->second) {
+            keyVector.push_back(std::make_pair(kv.key, kv.value));
+            PAL_VERBOSE(LOG_TAG, "key: 0x%x value: 0x%x", kv.key, kv.value);
+        }
+        return true;
+    }
 
+scan:
     for (int32_t i = 0; i < any_type.size(); i++) {
         if (isIdTypeAvailable(type, any_type[i].id_type)) {
             for (int32_t j = 0; j < any_type[i].keys_values.size(); j++) {
@@ -2707,7 +2945,7 @@ bool PayloadBuilder::findKVs(std::vector<std::pair<selector_type_t, std::string>
                             keyVector.push_back(
                                 std::make_pair(any_type[i].keys_values[j].kv_pairs[k].key,
                                 any_type[i].keys_values[j].kv_pairs[k].value));
-                            PAL_INFO(LOG_TAG, "key: 0x%x value: 0x%x\n",
+                            PAL_VERBOSE(LOG_TAG, "key: 0x%x value: 0x%x",
                                 any_type[i].keys_values[j].kv_pairs[k].key,
                                 any_type[i].keys_values[j].kv_pairs[k].value);
                         }
@@ -2720,7 +2958,7 @@ bool PayloadBuilder::findKVs(std::vector<std::pair<selector_type_t, std::string>
                             keyVector.push_back(
                                 std::make_pair(any_type[i].keys_values[j].kv_pairs[k].key,
                                 any_type[i].keys_values[j].kv_pairs[k].value));
-                            PAL_INFO(LOG_TAG, "key: 0x%x value: 0x%x\n",
+                            PAL_VERBOSE(LOG_TAG, "key: 0x%x value: 0x%x",
                                 any_type[i].keys_values[j].kv_pairs[k].key,
                                 any_type[i].keys_values[j].kv_pairs[k].value);
                         }
@@ -2745,7 +2983,8 @@ int PayloadBuilder::retrieveKVs(std::vector<std::pair<selector_type_t, std::stri
 
     found = findKVs(filled_selector_pairs, type, any_type, keyVector);
     if (found) {
-        PAL_DBG(LOG_TAG, "KVs found for the stream type/dev id: %d", type);
+        PAL_DBG(LOG_TAG, "%zu KVs found for the stream type/dev id: %d",
+            keyVector.size(), type);
         goto exit;
     } else {
         /* Add a fallback approach to search for KVs again without custom config as selector */
@@ -2780,30 +3019,26 @@ std::vector<std::pair<selector_type_t, std::string>> PayloadBuilder::getSelector
 {
     int instance_id = 0;
     int status = 0;
-    struct pal_stream_attributes *sattr = NULL;
+    struct pal_stream_attributes sAttr;
+    struct pal_stream_attributes *sattr = &sAttr;
     std::stringstream st;
     std::vector<std::shared_ptr<Device>> associatedDevices;
     std::vector<std::pair<selector_type_t, std::string>> filled_selector_pairs;
     std::shared_ptr<ResourceManager> rm = ResourceManager::getInstance();
 
     PAL_DBG(LOG_TAG, "Enter");
-    sattr = new struct pal_stream_attributes();
-    if (!sattr) {
-        PAL_ERR(LOG_TAG, "sattr alloc failed %s", strerror(errno));
-        goto exit;
-    }
     memset(sattr, 0, sizeof(struct pal_stream_attributes));
 
     if (!s) {
         PAL_ERR(LOG_TAG, "stream is NULL");
         filled_selector_pairs.clear();
-        goto free_sattr;
+        goto exit;
     }
 
     status = s->getStreamAttributes(sattr);
     if (0 != status) {
         PAL_ERR(LOG_TAG, "getStreamAttributes failed status %d", status);
-        goto free_sattr;
+        goto exit;
     }
 
     for (int i = 0; i < selector_names.size(); i++) {
@@ -2831,7 +3066,7 @@ std::vector<std::pair<selector_type_t, std::string>> PayloadBuilder::getSelector
                     instance_id = rm->getStreamInstanceID(s);
                 if (instance_id < INSTANCE_1) {
                     PAL_ERR(LOG_TAG, "Invalid instance id %d", instance_id);
-                    goto free_sattr;
+                    goto exit;
                 }
                 st << instance_id;
                 filled_selector_pairs.push_back(std::make_pair(selector_type, st.str()));
@@ -2865,7 +3100,7 @@ std::vector<std::pair<selector_type_t, std::string>> PayloadBuilder::getSelector
             case VUI_MODULE_TYPE_SEL:
                 if (!s) {
                     PAL_ERR(LOG_TAG, "Invalid stream");
-                    goto free_sattr;
+                    goto exit;
                 }
 
                 if (s->getStreamSelector().length() != 0)
@@ -2877,7 +3112,7 @@ std::vector<std::pair<selector_type_t, std::string>> PayloadBuilder::getSelector
             case ACD_MODULE_TYPE_SEL:
                 if (!s) {
                     PAL_ERR(LOG_TAG, "Invalid stream");
-                    goto free_sattr;
+                    goto exit;
                 }
 
                 if (s->getStreamSelector().length() != 0)
@@ -2889,7 +3124,7 @@ std::vector<std::pair<selector_type_t, std::string>> PayloadBuilder::getSelector
             case DEVICEPP_TYPE_SEL:
                 if (!s) {
                     PAL_ERR(LOG_TAG, "Invalid stream");
-                    goto free_sattr;
+                    goto exit;
                 }
 
                 if (s->getDevicePPSelector().length() != 0)
@@ -2928,8 +3163,6 @@ std::vector<std::pair<selector_type_t, std::string>> PayloadBuilder::getSelector
                 break;
         }
     }
-free_sattr:
-    delete sattr;
 exit:
     PAL_DBG(LOG_TAG, "Exit");
     return filled_selector_pairs;
@@ -2957,60 +3190,125 @@ bool PayloadBuilder::isIdTypeAvailable(int32_t type, std::vector<int>& id_type)
 
 std::vector<std::string> PayloadBuilder::retrieveSelectors(int32_t type, std::vector<allKVs> &any_type)
 {
-    std::vector<std::string> gkv_selectors;
     PAL_DBG(LOG_TAG, "Enter: size_of_all :%zu type:%d", any_type.size(), type);
 
-    /* looping for all keys_and_values selectors and store in the gkv_selectors */
-    for (int32_t i = 0; i < any_type.size(); i++) {
-         if (isIdTypeAvailable(type, any_type[i].id_type)) {
-             PAL_DBG(LOG_TAG, "KeysAndValues_size: %zu", any_type[i].keys_values.size());
-             for(int32_t j = 0; j < any_type[i].keys_values.size(); j++) {
-                 for(int32_t k = 0; k < any_type[i].keys_values[j].selector_names.size(); k++) {
-                     gkv_selectors.push_back(any_type[i].keys_values[j].selector_names[k]);
-                 }
-             }
-         }
-    }
+    auto it = kvSelectorIndex.find(std::make_pair(getKVTableId(any_type), type));
+    if (it == kvSelectorIndex.end())
+        return std::vector<std::string>();
+
+    return it->second;
+}
+
+void PayloadBuilder::invalidateKVCache()
+{
+    std::lock_guard<std::mutex> lock(kvCacheMutex);
 
-    if (gkv_selectors.size())
-          removeDuplicateSelectors(gkv_selectors);
+    kvCacheVersion++;
+    kvCache.clear();
+}
+
+void PayloadBuilder::getKVCacheStats(uint64_t *hits, uint64_t *misses)
+{
+    *hits = kvCacheHits.load();
+    *misses = kvCacheMisses.load();
+}
 
-    for (int32_t i = 0; i < gkv_selectors.size(); i++) {
-         PAL_DBG(LOG_TAG, "gkv_selectors: %s", gkv_selectors[i].c_str());
+/*
+ * Compose a key out of all inputs getSelectorValues may use for the
+ * selectors of this stream type/device id. Instance id is only part of
+ * the key when the id actually selects on it.
+ */
+std::string PayloadBuilder::getKVCacheKey(uint32_t table, int32_t id, Stream *s,
+    struct pal_stream_attributes *sattr, struct pal_device *dAttr)
+{
+    std::stringstream key;
+    int instance_id = 0;
+    std::shared_ptr<ResourceManager> rm = nullptr;
+    auto selectors = kvSelectorIndex.find(std::make_pair(table, id));
+
+    key << table << ":" << id << ":" << sattr->type << ":" << sattr->direction;
+    key << ":" << sattr->info.opt_stream_info.loopback_type << ":"
+        << sattr->info.opt_stream_info.tx_proxy_type << ":"
+        << sattr->info.opt_stream_info.rx_proxy_type;
+    key << ":" << isPalPCMFormat(sattr->out_media_config.aud_fmt_id);
+    if (sattr->type == PAL_STREAM_VOICE_CALL_MUSIC)
+        key << ":" << sattr->info.incall_music_info.local_playback;
+    if (selectors != kvSelectorIndex.end() &&
+        std::find(selectors->second.begin(), selectors->second.end(),
+            "Instance") != selectors->second.end()) {
+        if (sattr->type == PAL_STREAM_VOICE_UI) {
+            instance_id = dynamic_cast<StreamSoundTrigger *>(s)->GetInstanceId();
+        } else {
+            rm = ResourceManager::getInstance();
+            instance_id = rm->getStreamInstanceID(s);
+        }
+        key << ":" << instance_id;
     }
-    return gkv_selectors;
+    key << ":" << s->getStreamSelector() << ":" << s->getDevicePPSelector();
+    if (dAttr)
+        key << ":" << dAttr->custom_config.custom_key;
+
+    return key.str();
+}
+
+bool PayloadBuilder::lookupKVCache(const std::string &key,
+    std::vector<std::pair<int, int>> &keyVector)
+{
+    std::lock_guard<std::mutex> lock(kvCacheMutex);
+
+    auto it = kvCache.find(key);
+    if (it == kvCache.end() || it->second.version != kvCacheVersion.load()) {
+        kvCacheMisses++;
+        return false;
+    }
+    keyVector.insert(keyVector.end(), it->second.keyVector.begin(),
+        it->second.keyVector.end());
+    kvCacheHits++;
+    PAL_VERBOSE(LOG_TAG, "KV cache hit, %zu KVs", it->second.keyVector.size());
+    return true;
+}
+
+/* Cache the key vector appended to keyVector since offset */
+void PayloadBuilder::updateKVCache(const std::string &key,
+    std::vector<std::pair<int, int>> &keyVector, size_t offset)
+{
+    std::lock_guard<std::mutex> lock(kvCacheMutex);
+    kvCacheEntry &entry = kvCache[key];
+
+    entry.version = kvCacheVersion.load();
+    entry.keyVector.assign(keyVector.begin() + offset, keyVector.end());
 }
 
 int PayloadBuilder::populateStreamKV(Stream* s,
         std::vector <std::pair<int,int>> &keyVector)
 {
     int status = -EINVAL;
-    struct pal_stream_attributes *sattr = NULL;
+    struct pal_stream_attributes sattr;
     std::vector <std::string> selectors;
     std::vector <std::pair<selector_type_t, std::string>> filled_selector_pairs;
+    std::string cacheKey;
+    size_t offset = keyVector.size();
 
     PAL_DBG(LOG_TAG, "enter");
-    sattr = new struct pal_stream_attributes;
-    if (!sattr) {
-        status = -ENOMEM;
-        PAL_ERR(LOG_TAG,"sattr malloc failed %s status %d", strerror(errno), status);
-        goto exit;
-    }
-    memset(sattr, 0, sizeof(struct pal_stream_attributes));
+    memset(&sattr, 0, sizeof(struct pal_stream_attributes));
 
-    status = s->getStreamAttributes(sattr);
+    status = s->getStreamAttributes(&sattr);
     if (0 != status) {
         PAL_ERR(LOG_TAG,"getStreamAttributes Failed status %d", status);
-        goto free_sattr;
+        goto exit;
     }
-    PAL_INFO(LOG_TAG, "stream type %d", sattr->type);
-    selectors = retrieveSelectors(sattr->type, all_streams);
+    PAL_INFO(LOG_TAG, "stream type %d", sattr.type);
+    cacheKey = getKVCacheKey(KV_TABLE_STREAMS, sattr.type, s, &sattr, NULL);
+    if (lookupKVCache(cacheKey, keyVector))
+        goto exit;
+
+    selectors = retrieveSelectors(sattr.type, all_streams);
     if (selectors.empty() != true)
         filled_selector_pairs = getSelectorValues(selectors, s, NULL);
 
-    if (sattr->type == PAL_STREAM_VOICE_CALL_MUSIC) {
-        PAL_DBG(LOG_TAG, "ICMD + playback usecase is %d", sattr->info.incall_music_info.local_playback);
-        if (sattr->info.incall_music_info.local_playback) {
+    if (sattr.type == PAL_STREAM_VOICE_CALL_MUSIC) {
+        PAL_DBG(LOG_TAG, "ICMD + playback usecase is %d", sattr.info.incall_music_info.local_playback);
+        if (sattr.info.incall_music_info.local_playback) {
             filled_selector_pairs.push_back(
                 std::make_pair(CUSTOM_CONFIG_SEL,
                 "icmd_plus"));
@@ -3018,10 +3316,9 @@ int PayloadBuilder::populateStreamKV(Stream* s,
         }
     }
 
-    retrieveKVs(filled_selector_pairs ,sattr->type, all_streams, keyVector);
+    retrieveKVs(filled_selector_pairs ,sattr.type, all_streams, keyVector);
+    updateKVCache(cacheKey, keyVector, offset);
 
-free_sattr:
-    delete sattr;
 exit:
     return status;
 }
@@ -3120,9 +3417,12 @@ int PayloadBuilder::populateDeviceKV(Stream* s, int32_t beDevId,
     std::vector <std::string> selectors;
     std::vector <std::pair<selector_type_t, std::string>> filled_selector_pairs;
     struct pal_device dAttr;
+    struct pal_stream_attributes sAttr;
     std::shared_ptr<Device> dev = nullptr;
     std::shared_ptr<ResourceManager> rm = ResourceManager::getInstance();
     uint32_t soundCardId = 0;
+    std::string cacheKey;
+    size_t offset = keyVector.size();
 
     if (s)
         soundCardId = s->getSoundCardId();
@@ -3147,10 +3447,17 @@ int PayloadBuilder::populateDeviceKV(Stream* s, int32_t beDevId,
         dev = Device::getInstance(&dAttr, rm);
         if (dev) {
             status = dev->getDeviceAttributes(&dAttr, s);
+            if (s && s->getStreamAttributes(&sAttr) == 0) {
+                cacheKey = getKVCacheKey(KV_TABLE_DEVICES, beDevId, s, &sAttr, &dAttr);
+                if (lookupKVCache(cacheKey, keyVector))
+                    goto exit;
+            }
             selectors = retrieveSelectors(beDevId, all_devices);
             if (selectors.empty() != true)
                 filled_selector_pairs = getSelectorValues(selectors, s, &dAttr);
             retrieveKVs(filled_selector_pairs, beDevId, all_devices, keyVector);
+            if (!cacheKey.empty())
+                updateKVCache(cacheKey, keyVector, offset);
         }
     }
 
@@ -3260,10 +3567,13 @@ int PayloadBuilder::populateDevicePPKV(Stream* s, int32_t rxBeDevId,
 {
     int status = 0;
     struct pal_device dAttr;
+    struct pal_stream_attributes sAttr;
     std::shared_ptr<Device> dev = nullptr;
     std::shared_ptr<ResourceManager> rm = ResourceManager::getInstance();
     std::vector <std::string> selectors;
     std::vector <std::pair<selector_type_t, std::string>> filled_selector_pairs;
+    std::string cacheKey;
+    size_t offset = 0;
 
     PAL_DBG(LOG_TAG, "Enter");
     /* Populate Rx Device PP KV */
@@ -3274,13 +3584,24 @@ int PayloadBuilder::populateDevicePPKV(Stream* s, int32_t rxBeDevId,
         dev = Device::getInstance(&dAttr, rm);
         if (dev) {
             status = dev->getDeviceAttributes(&dAttr, s);
+            cacheKey.clear();
+            offset = keyVectorRx.size();
+            if (s && s->getStreamAttributes(&sAttr) == 0) {
+                cacheKey = getKVCacheKey(KV_TABLE_DEVICEPPS, rxBeDevId, s,
+                    &sAttr, &dAttr);
+                if (lookupKVCache(cacheKey, keyVectorRx))
+                    goto rx_done;
+            }
             selectors = retrieveSelectors(dAttr.id, all_devicepps);
             if (selectors.empty() != true)
                 filled_selector_pairs = getSelectorValues(selectors, s, &dAttr);
             retrieveKVs(filled_selector_pairs, rxBeDevId, all_devicepps,
                 keyVectorRx);
+            if (!cacheKey.empty())
+                updateKVCache(cacheKey, keyVectorRx, offset);
         }
     }
+rx_done:
 
     filled_selector_pairs.clear();
     selectors.clear();
@@ -3293,13 +3614,24 @@ int PayloadBuilder::populateDevicePPKV(Stream* s, int32_t rxBeDevId,
         dev = Device::getInstance(&dAttr, rm);
         if (dev) {
             status = dev->getDeviceAttributes(&dAttr, s);
+            cacheKey.clear();
+            offset = keyVectorTx.size();
+            if (s && s->getStreamAttributes(&sAttr) == 0) {
+                cacheKey = getKVCacheKey(KV_TABLE_DEVICEPPS, txBeDevId, s,
+                    &sAttr, &dAttr);
+                if (lookupKVCache(cacheKey, keyVectorTx))
+                    goto tx_done;
+            }
             selectors = retrieveSelectors(dAttr.id, all_devicepps);
             if (selectors.empty() != true)
                 filled_selector_pairs = getSelectorValues(selectors, s, &dAttr);
             retrieveKVs(filled_selector_pairs, txBeDevId, all_devicepps,
                 keyVectorTx);
+            if (!cacheKey.empty())
+                updateKVCache(cacheKey, keyVectorTx, offset);
         }
     }
+tx_done:
     PAL_DBG(LOG_TAG, "Exit, status: %d", status);
     return 0;
 }
@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#define LOG_TAG "PAL: SecondStageExecutor"
+
+#include <errno.h>
+#include "SecondStageExecutor.h"
+#include "PalCommon.h"
+
+std::mutex SecondStageExecutor::execMutex;
+std::condition_variable SecondStageExecutor::execCv;
+std::deque<struct SecondStageExecutor::job> SecondStageExecutor::jobs;
+std::vector<std::thread> SecondStageExecutor::workers;
+uint32_t SecondStageExecutor::idleWorkers = 0;
+uint32_t SecondStageExecutor::users = 0;
+uint32_t SecondStageExecutor::generation = 0;
+
+uint32_t SecondStageExecutor::maxWorkers()
+{
+    uint32_t cpus = std::thread::hardware_concurrency();
+
+    /* keyword and user verification of one detection always run together */
+    if (cpus < 2)
+        cpus = 2;
+    return cpus < SSTAGE_MAX_WORKERS ? cpus : SSTAGE_MAX_WORKERS;
+}
+
+void SecondStageExecutor::attach()
+{
+    std::lock_guard<std::mutex> lock(execMutex);
+    users++;
+}
+
+void SecondStageExecutor::detach()
+{
+    std::vector<std::thread> exiting;
+
+    {
+        std::lock_guard<std::mutex> lock(execMutex);
+        if (!users || --users)
+            return;
+        /* workers of an older generation exit, see workerLoop() */
+        generation++;
+        idleWorkers = 0;
+        exiting.swap(workers);
+    }
+    execCv.notify_all();
+    for (auto &t : exiting)
+        t.join();
+    PAL_DBG(LOG_TAG, "%zu workers joined", exiting.size());
+}
+
+int SecondStageExecutor::submit(const void *owner, std::function<void()> fn)
+{
+    {
+        std::lock_guard<std::mutex> lock(execMutex);
+        if (!users) {
+            PAL_ERR(LOG_TAG, "job submitted without attached engines");
+            return -EINVAL;
+        }
+        jobs.push_back({owner, std::move(fn)});
+        if (idleWorkers < jobs.size() && workers.size() < maxWorkers()) {
+            workers.emplace_back(workerLoop, generation);
+            PAL_DBG(LOG_TAG, "started worker %zu", workers.size());
+            return 0;
+        }
+    }
+    execCv.notify_one();
+    return 0;
+}
+
+bool SecondStageExecutor::cancel(const void *owner)
+{
+    std::lock_guard<std::mutex> lock(execMutex);
+
+    for (auto it = jobs.begin(); it != jobs.end(); it++) {
+        if (it->owner == owner) {
+            jobs.erase(it);
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * A worker belongs to the generation it was started in. detach() of the
+ * last engine bumps the generation and joins the old workers, workers
+ * started by an engine attaching meanwhile are not affected.
+ */
+void SecondStageExecutor::workerLoop(uint32_t gen)
+{
+    std::function<void()> fn;
+
+    std::unique_lock<std::mutex> lock(execMutex);
+    while (gen == generation) {
+        if (jobs.empty()) {
+            idleWorkers++;
+            execCv.wait(lock);
+            if (gen != generation)
+                break;
+            idleWorkers--;
+            continue;
+        }
+        fn = std::move(jobs.front().fn);
+        jobs.pop_front();
+        lock.unlock();
+        fn();
+        fn = nullptr;
+        lock.lock();
+    }
+}
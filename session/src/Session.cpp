@@ -457,24 +457,17 @@ int Session::setEffectParametersNonTKV(Stream *s __unused, effect_pal_payload_t
     status = builder.payloadCustomParam(&payloadData, &payloadSize,
             effectCustomPayload->data,
             effectPayload->payloadSize - sizeof(uint32_t),
-            miid, effectCustomPayload->paramId);
+            miid, effectCustomPayload->paramId, &paramArena);
     if (status != 0) {
         PAL_ERR(LOG_TAG, "payloadCustomParam failed. status = %d",
                 status);
         goto exit;
     }
     /* set param through set mixer param */
-    status = SessionAlsaUtils::setMixerParameter(mixer,
-            device,
-            payloadData,
-            payloadSize);
+    status = SessionAlsaUtils::setMixerParameter(mixer, device, paramArena);
     PAL_INFO(LOG_TAG, "mixer set param status = %d\n", status);
 
 exit:
-    if (payloadData) {
-        free(payloadData);
-        payloadData = NULL;
-    }
     if (status && effectCustomPayload) {
         PAL_ERR(LOG_TAG, "setEffectParameters for param_id %d failed, status = %d",
                 effectCustomPayload->paramId, status);
@@ -489,6 +482,7 @@ int Session::setEffectParameters(Stream *s, effect_pal_payload_t *effectPayload)
 
     PAL_DBG(LOG_TAG, "Enter.");
 
+    graphStateChanged = true;
     /* Identify whether this is tkv or set param call */
     if (effectPayload->isTKV) {
         /* This is tkv set call */
@@ -551,7 +545,7 @@ int Session::rwACDBParameters(void *payload, uint32_t sampleRate,
 
     status = builder.payloadACDBParam(&payloadData, &payloadSize,
                             (uint8_t *)effectACDBPayload,
-                            miid, sampleRate);
+                            miid, sampleRate, &paramArena);
     if (!payloadData) {
         PAL_ERR(LOG_TAG, "failed to create payload data.");
         goto exit;
@@ -567,7 +561,7 @@ int Session::rwACDBParameters(void *payload, uint32_t sampleRate,
 
 exit:
     ctl = NULL;
-    free(payloadData);
+    paramArena.reset();
     PAL_ERR(LOG_TAG, "Exit. status %d", status);
     return status;
 }
@@ -601,19 +595,29 @@ exit:
 
 int Session::updateCustomPayload(void *payload, size_t size)
 {
-    if (!customPayloadSize || !customPayload) {
-        customPayload = calloc(1, size);
+    uint8_t *end = NULL;
+
+    /*
+     * Payloads built with payloadArena are already in place, anything
+     * else is copied behind the params accumulated so far. Blocks of
+     * builds which failed before getting here are dropped, only the
+     * committed params are sent.
+     */
+    if (payloadArena.owns(payload)) {
+        end = payloadArena.data() + customPayloadSize;
+        if ((uint8_t *)payload != end)
+            memmove(end, payload, size);
+        payloadArena.truncate(customPayloadSize + size);
     } else {
-        customPayload = realloc(customPayload, customPayloadSize + size);
-    }
-
-    if (!customPayload) {
-        PAL_ERR(LOG_TAG, "failed to allocate memory for custom payload");
-        return -ENOMEM;
+        payloadArena.truncate(customPayloadSize);
+        if (!payloadArena.append(payload, size)) {
+            PAL_ERR(LOG_TAG, "failed to allocate memory for custom payload");
+            return -ENOMEM;
+        }
     }
 
-    memcpy((uint8_t *)customPayload + customPayloadSize, payload, size);
-    customPayloadSize += size;
+    customPayload = payloadArena.data();
+    customPayloadSize = payloadArena.size();
     PAL_INFO(LOG_TAG, "customPayloadSize = %zu", customPayloadSize);
     return 0;
 }
@@ -630,7 +634,8 @@ int Session::getCustomPayload(uint8_t **payload, size_t *payloadSize)
 int Session::freeCustomPayload(uint8_t **payload, size_t *payloadSize)
 {
     if (*payload) {
-        free(*payload);
+        if (!payloadArena.owns(*payload) && !paramArena.owns(*payload))
+            free(*payload);
         *payload = NULL;
         *payloadSize = 0;
     }
@@ -639,11 +644,9 @@ int Session::freeCustomPayload(uint8_t **payload, size_t *payloadSize)
 
 int Session::freeCustomPayload()
 {
-    if (customPayload) {
-        free(customPayload);
-        customPayload = NULL;
-        customPayloadSize = 0;
-    }
+    payloadArena.reset();
+    customPayload = NULL;
+    customPayloadSize = 0;
     return 0;
 }
 
@@ -814,7 +817,7 @@ int Session::setSlotMask(const std::shared_ptr<ResourceManager>& rm, struct pal_
 
     // set FE ctl to BE first in case this is called from connectionSessionDevice
     rm->getBackendName(dAttr.id, backendname);
-    ctl = mixer_get_ctl_by_name(mixer, feName.str().data());
+    ctl = MixerCtlCache::getCtl(mixer, feName.str().data());
     if (!ctl) {
         PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", feName.str().data());
         status = -EINVAL;
@@ -824,7 +827,7 @@ int Session::setSlotMask(const std::shared_ptr<ResourceManager>& rm, struct pal_
     ctl = NULL;
 
     // set tag data
-    ctl = mixer_get_ctl_by_name(mixer, tagCntrlName.str().data());
+    ctl = MixerCtlCache::getCtl(mixer, tagCntrlName.str().data());
     if (!ctl) {
         PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", tagCntrlName.str().data());
         status = -EINVAL;
@@ -885,7 +888,7 @@ int Session::configureMFC(const std::shared_ptr<ResourceManager>& rm, struct pal
                 mfcData.numChannel = dAttr.config.ch_info.channels;
             mfcData.ch_info = nullptr;
 
-            builder->payloadMFCConfig((uint8_t**)&payload, &payloadSize, miid, &mfcData);
+            builder->payloadMFCConfig((uint8_t**)&payload, &payloadSize, miid, &mfcData, &payloadArena);
             if (!payloadSize) {
                 PAL_ERR(LOG_TAG, "payloadMFCConfig failed\n");
                 status = -EINVAL;
@@ -924,7 +927,7 @@ int Session::configureMFC(const std::shared_ptr<ResourceManager>& rm, struct pal
             mfcData.sampleRate = sAttr.in_media_config.sample_rate;
             mfcData.numChannel = sAttr.in_media_config.ch_info.channels;
             mfcData.ch_info = nullptr;
-            builder->payloadMFCConfig((uint8_t **)&payload, &payloadSize, miid, &mfcData);
+            builder->payloadMFCConfig((uint8_t **)&payload, &payloadSize, miid, &mfcData, &payloadArena);
             if (payloadSize && payload) {
                 status = updateCustomPayload(payload, payloadSize);
                 freeCustomPayload(&payload, &payloadSize);
@@ -981,7 +984,7 @@ int Session::configureMFC(const std::shared_ptr<ResourceManager>& rm, struct pal
             dAttr.id == PAL_DEVICE_OUT_HDMI)
             mfcData.ch_info = &dAttr.config.ch_info;
 
-        builder->payloadMFCConfig((uint8_t **)&payload, &payloadSize, miid, &mfcData);
+        builder->payloadMFCConfig((uint8_t **)&payload, &payloadSize, miid, &mfcData, &payloadArena);
         if (!payloadSize) {
             PAL_ERR(LOG_TAG, "payloadMFCConfig failed\n");
             status = -EINVAL;
@@ -1357,7 +1360,7 @@ int setConfig(Stream * s, pal_stream_type_t sType, configType type, uint32_t tag
                 goto exit;
             }
             tagCntrlName << stream << pcmDevIds.at(0) << " " << setParamTagControl;
-            ctl = mixer_get_ctl_by_name(mixer, tagCntrlName.str().data());
+            ctl = MixerCtlCache::getCtl(mixer, tagCntrlName.str().data());
             if (!ctl) {
                 PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", tagCntrlName.str().data());
                 return -ENOENT;
@@ -1084,7 +1084,7 @@ int SessionAlsaCompress::setTKV(Stream * s __unused, configType type, effect_pal
                 goto exit;
             }
             tagCntrlName<<stream<<compressDevIds.at(0)<<" "<<setParamTagControl;
-            ctl = mixer_get_ctl_by_name(mixer, tagCntrlName.str().data());
+            ctl = MixerCtlCache::getCtl(mixer, tagCntrlName.str().data());
             if (!ctl) {
                 PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", tagCntrlName.str().data());
                 status = -ENOENT;
@@ -1162,7 +1162,7 @@ int SessionAlsaCompress::setConfig(Stream * s, configType type, uint32_t tag1,
                 goto exit;
             }
             tagCntrlName << stream << compressDevIds.at(0) << " " << setParamTagControl;
-            ctl = mixer_get_ctl_by_name(mixer, tagCntrlName.str().data());
+            ctl = MixerCtlCache::getCtl(mixer, tagCntrlName.str().data());
             if (!ctl) {
                 PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", tagCntrlName.str().data());
                 status = -ENOENT;
@@ -1228,7 +1228,7 @@ int SessionAlsaCompress::setConfig(Stream * s, configType type, int tag)
     }
     beCntrlName<<stream<<compressDevIds.at(0)<<" "<<setBEControl;
 
-    ctl = mixer_get_ctl_by_name(mixer, beCntrlName.str().data());
+    ctl = MixerCtlCache::getCtl(mixer, beCntrlName.str().data());
     if (!ctl) {
         PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", tagCntrlName.str().data());
         return -ENOENT;
@@ -1265,7 +1265,7 @@ int SessionAlsaCompress::setConfig(Stream * s, configType type, int tag)
             }
             //TODO: how to get the id '5'
             tagCntrlName<<stream<<compressDevIds.at(0)<<" "<<setParamTagControl;
-            ctl = mixer_get_ctl_by_name(mixer, tagCntrlName.str().data());
+            ctl = MixerCtlCache::getCtl(mixer, tagCntrlName.str().data());
             if (!ctl) {
                 PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", tagCntrlName.str().data());
                 if (tagConfig)
@@ -1307,7 +1307,7 @@ int SessionAlsaCompress::setConfig(Stream * s, configType type, int tag)
             status = SessionAlsaUtils::getCalMetadata(ckv, calConfig);
             //TODO: how to get the id '0'
             calCntrlName<<stream<<compressDevIds.at(0)<<" "<<setCalibrationControl;
-            ctl = mixer_get_ctl_by_name(mixer, calCntrlName.str().data());
+            ctl = MixerCtlCache::getCtl(mixer, calCntrlName.str().data());
             if (!ctl) {
                 PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", calCntrlName.str().data());
                 status = -ENOENT;
@@ -1558,11 +1558,7 @@ int SessionAlsaCompress::start(Stream * s)
                     }
                     volStatus = SessionAlsaUtils::setMixerParameter(mixer, compressDevIds.at(0),
                                                                  customPayload, customPayloadSize);
-                    if (customPayload) {
-                        free(customPayload);
-                        customPayload = NULL;
-                        customPayloadSize = 0;
-                    }
+                    freeCustomPayload();
                     if (volStatus != 0) {
                         PAL_ERR(LOG_TAG,"setMixerParameter failed for MSPP module");
                         break;
@@ -1587,11 +1583,7 @@ int SessionAlsaCompress::start(Stream * s)
                     }
                     status = SessionAlsaUtils::setMixerParameter(mixer, compressDevIds.at(0),
                                                                  customPayload, customPayloadSize);
-                    if (customPayload) {
-                        free(customPayload);
-                        customPayload = NULL;
-                        customPayloadSize = 0;
-                    }
+                    freeCustomPayload();
                     if (status != 0) {
                         PAL_ERR(LOG_TAG,"setMixerParameter failed for soft Pause module");
                         break;
@@ -1652,7 +1644,7 @@ int SessionAlsaCompress::start(Stream * s)
             streamData.sampleRate = sAttr.in_media_config.sample_rate;
             streamData.numChannel = sAttr.in_media_config.ch_info.channels;
             streamData.ch_info = nullptr;
-            builder->payloadMFCConfig(&payload, &payloadSize, miid, &streamData);
+            builder->payloadMFCConfig(&payload, &payloadSize, miid, &streamData, &payloadArena);
             if (payloadSize && payload) {
                 status = updateCustomPayload(payload, payloadSize);
                 freeCustomPayload(&payload, &payloadSize);
@@ -2084,7 +2076,7 @@ struct mixer_ctl* SessionAlsaCompress::getFEMixerCtl(const char *controlName, in
 
     *device = compressDevIds.at(0);
     CntrlName << "COMPRESS" << compressDevIds.at(0) << " " << controlName;
-    ctl = mixer_get_ctl_by_name(mixer, CntrlName.str().data());
+    ctl = MixerCtlCache::getCtl(mixer, CntrlName.str().data());
     if (!ctl) {
         PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", CntrlName.str().data());
         return nullptr;
@@ -2285,16 +2277,17 @@ int SessionAlsaCompress::setParameters(Stream *s __unused, int tagId, uint32_t p
             }
 
             if (vdata->no_of_volpair > 1 && sAttr.out_media_config.ch_info.channels > 1) {
-                builder->payloadMultichVolumemConfig(&alsaParamData, &alsaPayloadSize, miid, vdata);
+                builder->payloadMultichVolumemConfig(&alsaParamData, &alsaPayloadSize, miid, vdata,
+                                                     &paramArena);
             } else {
-                builder->payloadVolumeConfig(&alsaParamData, &alsaPayloadSize, miid, vdata);
+                builder->payloadVolumeConfig(&alsaParamData, &alsaPayloadSize, miid, vdata,
+                                             &paramArena);
             }
 
             if (alsaPayloadSize) {
-                status = SessionAlsaUtils::setMixerParameter(mixer, device,
-                                               alsaParamData, alsaPayloadSize);
+                status = SessionAlsaUtils::setMixerParameter(mixer, device, paramArena);
                 PAL_INFO(LOG_TAG, "mixer set volume config status=%d\n", status);
-                freeCustomPayload(&alsaParamData, &alsaPayloadSize);
+                alsaParamData = NULL;
                 alsaPayloadSize = 0;
             }
         }
@@ -2341,12 +2334,12 @@ int SessionAlsaCompress::setParameters(Stream *s __unused, int tagId, uint32_t p
             status = SessionAlsaUtils::getModuleInstanceId(mixer, device,
                                rxAifBackEnds[0].second.data(), tagId, &miid);
             builder->payloadVolumeCtrlRamp(&alsaParamData, &alsaPayloadSize,
-                 miid, rampParam->ramp_period_ms);
+                 miid, rampParam->ramp_period_ms, &paramArena);
             if (alsaPayloadSize) {
-                status = SessionAlsaUtils::setMixerParameter(mixer, device,
-                                               alsaParamData, alsaPayloadSize);
+                status = SessionAlsaUtils::setMixerParameter(mixer, device, paramArena);
                 PAL_INFO(LOG_TAG, "mixer set vol ctrl ramp status=%d\n", status);
-                freeCustomPayload(&alsaParamData, &alsaPayloadSize);
+                alsaParamData = NULL;
+                alsaPayloadSize = 0;
             }
             break;
         }
@@ -77,6 +77,12 @@ SessionAlsaPcm::SessionAlsaPcm(std::shared_ptr<ResourceManager> Rm)
    ecRefDevId = PAL_DEVICE_OUT_MIN;
    streamHandle = NULL;
    vaMicChannels = 0;
+   ioMmap = false;
+   ioInRate = 0;
+   ioOutRate = 0;
+   memset(&parkedAttr, 0, sizeof(parkedAttr));
+   parkedMixerCb = false;
+   reattached = false;
 }
 
 SessionAlsaPcm::~SessionAlsaPcm()
@@ -238,6 +244,7 @@ int SessionAlsaPcm::open(Stream * s)
         }
     }
     frontEndIdAllocated = true;
+    graphStateChanged = false;
     switch (sAttr.direction) {
         case PAL_AUDIO_INPUT:
             status = SessionAlsaUtils::open(s, rm, pcmDevIds, txAifBackEnds);
@@ -353,6 +360,7 @@ int SessionAlsaPcm::setConfig(Stream * s, configType type, uint32_t tag1,
     struct mixer_ctl *ctl = nullptr;
     uint32_t tkv_size = 0;
     PAL_DBG(LOG_TAG, "Enter tags: %d %d %d", tag1, tag2, tag3);
+    updateIoAttr(s);
     switch (type) {
         case MODULE:
             tkv.clear();
@@ -384,7 +392,7 @@ int SessionAlsaPcm::setConfig(Stream * s, configType type, uint32_t tag1,
                 status = -EINVAL;
                 goto exit;
             }
-            ctl = mixer_get_ctl_by_name(mixer, tagCntrlName.str().data());
+            ctl = MixerCtlCache::getCtl(mixer, tagCntrlName.str().data());
             if (!ctl) {
                 PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", tagCntrlName.str().data());
                 status = -ENOENT;
@@ -439,7 +447,7 @@ struct mixer_ctl* SessionAlsaPcm::getFEMixerCtl(const char *controlName, int *de
     }
 
     CntrlName << "PCM" << *device << " " << controlName;
-    ctl = mixer_get_ctl_by_name(mixer, CntrlName.str().data());
+    ctl = MixerCtlCache::getCtl(mixer, CntrlName.str().data());
     if (!ctl) {
         PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", CntrlName.str().data());
         return NULL;
@@ -599,6 +607,7 @@ int SessionAlsaPcm::setConfig(Stream * s, configType type, int tag)
         PAL_ERR(LOG_TAG, "stream get attributes failed");
         return status;
     }
+    updateIoAttr(s);
 
     if (sAttr.type != PAL_STREAM_VOICE_CALL_RECORD &&
         sAttr.type != PAL_STREAM_VOICE_CALL_MUSIC  &&
@@ -617,7 +626,7 @@ int SessionAlsaPcm::setConfig(Stream * s, configType type, int tag)
                 beCntrlName << stream << pcmDevIds.at(0) << " " << setBEControl;
         }
 
-        ctl = mixer_get_ctl_by_name(mixer, beCntrlName.str().data());
+        ctl = MixerCtlCache::getCtl(mixer, beCntrlName.str().data());
         if (!ctl) {
             PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", beCntrlName.str().data());
             return -ENOENT;
@@ -627,6 +636,10 @@ int SessionAlsaPcm::setConfig(Stream * s, configType type, int tag)
     }
 
     PAL_DBG(LOG_TAG, "Enter tag: %d", tag);
+    /* orientation is applied again on every start */
+    if ((type == MODULE && tag != ORIENTATION_TAG) ||
+        (type == CALIBRATION && tag == TAG_STREAM_VOLUME))
+        graphStateChanged = true;
     switch (type) {
         case MODULE:
             tkv.clear();
@@ -668,7 +681,7 @@ int SessionAlsaPcm::setConfig(Stream * s, configType type, int tag)
                 goto exit;
             }
 
-            ctl = mixer_get_ctl_by_name(mixer, tagCntrlName.str().data());
+            ctl = MixerCtlCache::getCtl(mixer, tagCntrlName.str().data());
             if (!ctl) {
                 PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", tagCntrlName.str().data());
                 status = -ENOENT;
@@ -739,7 +752,7 @@ int SessionAlsaPcm::setConfig(Stream * s, configType type, int tag)
                 goto unlock_kvMutex;
             }
 
-            ctl = mixer_get_ctl_by_name(mixer, calCntrlName.str().data());
+            ctl = MixerCtlCache::getCtl(mixer, calCntrlName.str().data());
             if (!ctl) {
                 PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", calCntrlName.str().data());
                 status = -ENOENT;
@@ -831,7 +844,7 @@ int SessionAlsaPcm::setTKV(Stream * s, configType type, effect_pal_payload_t *ef
                 goto exit;
             }
 
-            ctl = mixer_get_ctl_by_name(mixer, tagCntrlName.str().data());
+            ctl = MixerCtlCache::getCtl(mixer, tagCntrlName.str().data());
             if (!ctl) {
                 PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", tagCntrlName.str().data());
                 status = -ENOENT;
@@ -875,6 +888,7 @@ void SessionAlsaPcm::deRegisterAdmStream(Stream *s)
 void SessionAlsaPcm::registerAdmStream(Stream *s, pal_stream_direction_t dir,
         pal_stream_flags_t flags, struct pcm *pcm, struct pcm_config *cfg)
 {
+    rm->loadAdmLib();
     switch (dir) {
     case PAL_AUDIO_INPUT:
         if (rm->admRegisterInputStreamFn) {
@@ -953,6 +967,7 @@ int SessionAlsaPcm::start(Stream * s)
         PAL_ERR(LOG_TAG, "stream get attributes failed");
         goto exit;
     }
+    updateIoAttr(s);
 
     /*
      * For VoiceUI streams, multi streams may use same session
@@ -963,6 +978,20 @@ int SessionAlsaPcm::start(Stream * s)
         streamHandle = s;
     }
 
+    if (reattached) {
+        /* pcm kept open by the SessionPool is configured for the previous stream's buffers */
+        size_t inSize = 0, inCount = 0, outSize = 0, outCount = 0;
+
+        reattached = false;
+        s->getBufInfo(&inSize, &inCount, &outSize, &outCount);
+        if (pcm && (outSize != out_buf_size || outCount != out_buf_count)) {
+            PAL_DBG(LOG_TAG, "buffer config changed, reopen pcm");
+            pcm_close(pcm);
+            pcm = NULL;
+            mState = SESSION_IDLE;
+        }
+    }
+
     if (mState == SESSION_IDLE) {
         s->getBufInfo(&in_buf_size,&in_buf_count,&out_buf_size,&out_buf_count);
         memset(&config, 0, sizeof(config));
@@ -1190,7 +1219,7 @@ int SessionAlsaPcm::start(Stream * s)
                 streamData.sampleRate = sAttr.in_media_config.sample_rate;
                 streamData.numChannel = sAttr.in_media_config.ch_info.channels;
                 streamData.ch_info = nullptr;
-                builder->payloadMFCConfig(&payload, &payloadSize, miid, &streamData);
+                builder->payloadMFCConfig(&payload, &payloadSize, miid, &streamData, &payloadArena);
                 if (payloadSize && payload) {
                     status = updateCustomPayload(payload, payloadSize);
                     freeCustomPayload(&payload, &payloadSize);
@@ -1243,7 +1272,7 @@ int SessionAlsaPcm::start(Stream * s)
                             streamData.bitWidth   = AUDIO_BIT_WIDTH_DEFAULT_16;
                             streamData.numChannel = 0xFFFF;
                         }
-                        builder->payloadMFCConfig(&payload, &payloadSize, miid, &streamData);
+                        builder->payloadMFCConfig(&payload, &payloadSize, miid, &streamData, &payloadArena);
                         if (payloadSize && payload) {
                             status = updateCustomPayload(payload, payloadSize);
                             freeCustomPayload(&payload, &payloadSize);
@@ -1284,7 +1313,7 @@ int SessionAlsaPcm::start(Stream * s)
                             streamData.bitWidth   = AUDIO_BIT_WIDTH_DEFAULT_16;
                             streamData.numChannel = 0xFFFF;
                         }
-                        builder->payloadMFCConfig(&payload, &payloadSize, miid, &streamData);
+                        builder->payloadMFCConfig(&payload, &payloadSize, miid, &streamData, &payloadArena);
                         if (payloadSize && payload) {
                             status = updateCustomPayload(payload, payloadSize);
                             freeCustomPayload(&payload, &payloadSize);
@@ -1429,7 +1458,7 @@ set_mixer:
                     streamData.sampleRate = sAttr.in_media_config.sample_rate;
                     streamData.numChannel = sAttr.in_media_config.ch_info.channels;
                     streamData.ch_info = nullptr;
-                    builder->payloadMFCConfig(&payload, &payloadSize, miid, &streamData);
+                    builder->payloadMFCConfig(&payload, &payloadSize, miid, &streamData, &payloadArena);
                     if (payloadSize && payload) {
                         status = updateCustomPayload(payload, payloadSize);
                         freeCustomPayload(&payload, &payloadSize);
@@ -1637,11 +1666,7 @@ set_mixer:
                     }
                     status = SessionAlsaUtils::setMixerParameter(mixer, pcmDevIds.at(0),
                                                                  customPayload, customPayloadSize);
-                    if (customPayload) {
-                        free(customPayload);
-                        customPayload = NULL;
-                        customPayloadSize = 0;
-                    }
+                    freeCustomPayload();
                     if (status != 0) {
                         PAL_ERR(LOG_TAG,"setMixerParameter failed for MSPP module");
                         goto pcm_start;
@@ -1667,11 +1692,7 @@ set_mixer:
                     }
                     status = SessionAlsaUtils::setMixerParameter(mixer, pcmDevIds.at(0),
                                                                  customPayload, customPayloadSize);
-                    if (customPayload) {
-                        free(customPayload);
-                        customPayload = NULL;
-                        customPayloadSize = 0;
-                    }
+                    freeCustomPayload();
                     if (status != 0) {
                         PAL_ERR(LOG_TAG,"setMixerParameter failed for soft Pause module");
                         goto pcm_start;
@@ -1740,7 +1761,7 @@ set_mixer:
                         streamData.bitWidth   = AUDIO_BIT_WIDTH_DEFAULT_16;
                         streamData.numChannel = 0xFFFF;
                     }
-                    builder->payloadMFCConfig(&payload, &payloadSize, miid, &streamData);
+                    builder->payloadMFCConfig(&payload, &payloadSize, miid, &streamData, &payloadArena);
                     if (payloadSize && payload) {
                         status = updateCustomPayload(payload, payloadSize);
                         freeCustomPayload(&payload, &payloadSize);
@@ -2084,8 +2105,6 @@ int SessionAlsaPcm::close(Stream * s)
     std::vector<std::shared_ptr<Device>> associatedDevices;
     int ldir = 0;
     std::vector<int> pcmId;
-    struct disable_lpm_info lpm_info;
-    bool isStreamAvail = false;
 
     PAL_DBG(LOG_TAG, "Enter");
     if (!frontEndIdAllocated) {
@@ -2164,23 +2183,7 @@ int SessionAlsaPcm::close(Stream * s)
                 !(sAttr.flags & PAL_STREAM_FLAG_MMAP_NO_IRQ_MASK))
                 deRegisterAdmStream(s);
 
-            memset(&lpm_info, 0, sizeof(struct disable_lpm_info));
-            rm->getDisableLpmInfo(&lpm_info);
-            isStreamAvail = (find(lpm_info.streams_.begin(),
-                            lpm_info.streams_.end(), sAttr.type) !=
-                            lpm_info.streams_.end());
-            if (isStreamAvail && lpm_info.isDisableLpm) {
-                std::lock_guard<std::mutex> lock(pcmLpmRefCntMtx);
-                PAL_DBG(LOG_TAG, "pcm_close pcmLpmRefCnt %d", pcmLpmRefCnt);
-                pcmLpmRefCnt--;
-                if (pcmLpmRefCnt < 0) { //May not happen, to catch the error, if it happens to be
-                    PAL_ERR(LOG_TAG, "pcm_close Unacceptable pcmLpmRefCnt %d, resetting to 0", pcmLpmRefCnt);
-                    pcmLpmRefCnt = 0;
-                }
-                if (0 == pcmLpmRefCnt)
-                    setPmQosMixerCtl(PM_QOS_VOTE_DISABLE);
-                PAL_DBG(LOG_TAG, "pcm_close pcmLpmRefCnt %d", pcmLpmRefCnt);
-            }
+            releaseLpmVote(sAttr);
 
             if (pcm)
                 status = pcm_close(pcm);
@@ -2290,6 +2293,155 @@ exit:
     return status;
 }
 
+void SessionAlsaPcm::releaseLpmVote(const struct pal_stream_attributes &sAttr)
+{
+    struct disable_lpm_info lpm_info = {};
+    bool isStreamAvail = false;
+
+    rm->getDisableLpmInfo(&lpm_info);
+    isStreamAvail = (find(lpm_info.streams_.begin(),
+                    lpm_info.streams_.end(), sAttr.type) !=
+                    lpm_info.streams_.end());
+    if (isStreamAvail && lpm_info.isDisableLpm) {
+        std::lock_guard<std::mutex> lock(pcmLpmRefCntMtx);
+        PAL_DBG(LOG_TAG, "pcm_close pcmLpmRefCnt %d", pcmLpmRefCnt);
+        pcmLpmRefCnt--;
+        if (pcmLpmRefCnt < 0) { //May not happen, to catch the error, if it happens to be
+            PAL_ERR(LOG_TAG, "pcm_close Unacceptable pcmLpmRefCnt %d, resetting to 0", pcmLpmRefCnt);
+            pcmLpmRefCnt = 0;
+        }
+        if (0 == pcmLpmRefCnt)
+            setPmQosMixerCtl(PM_QOS_VOTE_DISABLE);
+        PAL_DBG(LOG_TAG, "pcm_close pcmLpmRefCnt %d", pcmLpmRefCnt);
+    }
+}
+
+/*
+ * Detach an idle playback graph from the stream being closed so the
+ * SessionPool can hand it to the next matching stream. Front end ids,
+ * graph metadata and a stopped pcm stay as they are, everything that
+ * refers to the closing stream (mixer event callback, callback cookie,
+ * custom payloads) is dropped here.
+ */
+int SessionAlsaPcm::park(Stream *s)
+{
+    int status = 0;
+    struct pal_stream_attributes sAttr = {};
+    std::vector<std::shared_ptr<Device>> associatedDevices;
+
+    PAL_DBG(LOG_TAG, "Enter");
+    status = s->getStreamAttributes(&sAttr);
+    if (status != 0) {
+        PAL_ERR(LOG_TAG, "stream get attributes failed");
+        goto exit;
+    }
+    if (!frontEndIdAllocated || sAttr.direction != PAL_AUDIO_OUTPUT ||
+        SessionAlsaUtils::isMmapUsecase(sAttr) || graphStateChanged ||
+        (mState != SESSION_IDLE && mState != SESSION_STOPPED)) {
+        PAL_DBG(LOG_TAG, "session in state %d changed %d can not be parked",
+                mState, graphStateChanged);
+        status = -EINVAL;
+        goto exit;
+    }
+    status = s->getAssociatedDevices(associatedDevices);
+    if (status != 0) {
+        PAL_ERR(LOG_TAG, "getAssociatedDevices Failed");
+        goto exit;
+    }
+
+    parkedMixerCb = isMixerEventCbRegd;
+    if (isMixerEventCbRegd) {
+        status = rm->registerMixerEventCallback(pcmDevIds,
+            sessionCb, cbCookie, false);
+        if (status != 0) {
+            PAL_ERR(LOG_TAG, "Failed to deregister callback to rm");
+            goto exit;
+        }
+        isMixerEventCbRegd = false;
+    }
+    releaseLpmVote(sAttr);
+    freeCustomPayload();
+    if (eventPayload) {
+        free(eventPayload);
+        eventPayload = NULL;
+        eventPayloadSize = 0;
+        eventId = 0;
+    }
+    sessionCb = NULL;
+    cbCookie = 0;
+    streamHandle = NULL;
+    parkedAttr = sAttr;
+    parkedDevices = associatedDevices;
+exit:
+    PAL_DBG(LOG_TAG, "Exit status: %d", status);
+    return status;
+}
+
+/* Attach a parked graph to stream s, callback must already be registered */
+int SessionAlsaPcm::unpark(Stream *s)
+{
+    int status = 0;
+
+    PAL_DBG(LOG_TAG, "Enter. state %d", mState);
+    streamHandle = s;
+    parkedDevices.clear();
+    if (parkedMixerCb) {
+        status = rm->registerMixerEventCallback(pcmDevIds,
+            sessionCb, cbCookie, true);
+        if (status == 0) {
+            isMixerEventCbRegd = true;
+        } else {
+            // Not a fatal error, same as in open()
+            PAL_ERR(LOG_TAG, "Failed to register callback to rm");
+            status = 0;
+        }
+        parkedMixerCb = false;
+    }
+    reattached = (mState == SESSION_STOPPED);
+    PAL_DBG(LOG_TAG, "Exit status: %d", status);
+    return status;
+}
+
+/* close() for a graph that expired in the SessionPool without being reattached */
+int SessionAlsaPcm::closeParked()
+{
+    int status = 0;
+    std::string backendname;
+
+    PAL_DBG(LOG_TAG, "Enter");
+    if (!frontEndIdAllocated) {
+        PAL_DBG(LOG_TAG, "Session not opened or already closed");
+        goto exit;
+    }
+
+    freeDeviceMetadata.clear();
+    for (auto &dev: parkedDevices) {
+        rm->getBackendName(dev->getSndDeviceId(), backendname);
+        /* the pool holds no device count, any left belong to other streams */
+        if (dev->getDeviceCount() > 0)
+            freeDeviceMetadata.push_back(std::make_pair(backendname, 0));
+        else
+            freeDeviceMetadata.push_back(std::make_pair(backendname, 1));
+    }
+    status = SessionAlsaUtils::close(parkedAttr, rm, pcmDevIds, rxAifBackEnds,
+            freeDeviceMetadata);
+    if (status) {
+        PAL_ERR(LOG_TAG, "session alsa close failed with %d", status);
+    }
+    if (pcm && pcm_close(pcm)) {
+        status = errno;
+        PAL_ERR(LOG_TAG, "pcm_close failed %d", status);
+    }
+    rm->freeFrontEndIds(pcmDevIds, parkedAttr, 0);
+    pcm = NULL;
+    frontEndIdAllocated = false;
+    mState = SESSION_IDLE;
+    parkedDevices.clear();
+exit:
+    PAL_DBG(LOG_TAG, "Exit status: %d", status);
+    return status;
+}
+
 /* TODO: Check if this can be moved to Session class */
 int SessionAlsaPcm::disconnectSessionDevice(Stream *streamHandle,
         pal_stream_type_t streamType, std::shared_ptr<Device> deviceToDisconnect)
@@ -2465,17 +2617,26 @@ int SessionAlsaPcm::connectSessionDevice(Stream* streamHandle, pal_stream_type_t
     return status;
 }
 
+/*
+ * read()/write() run on the stream I/O fast path without the stream mutex,
+ * so they use this copy instead of querying the stream for every buffer.
+ */
+void SessionAlsaPcm::updateIoAttr(Stream *s)
+{
+    struct pal_stream_attributes sAttr = {};
+
+    if (!s || s->getStreamAttributes(&sAttr))
+        return;
+    ioMmap = SessionAlsaUtils::isMmapUsecase(sAttr);
+    ioInRate = sAttr.in_media_config.sample_rate;
+    ioOutRate = sAttr.out_media_config.sample_rate;
+}
+
 int SessionAlsaPcm::read(Stream *s, int tag __unused, struct pal_buffer *buf, int * size)
 {
     int status = 0, bytesRead = 0, bytesToRead = 0, offset = 0, pcmReadSize = 0;
-    struct pal_stream_attributes sAttr = {};
 
     PAL_VERBOSE(LOG_TAG, "Enter")
-    status = s->getStreamAttributes(&sAttr);
-    if (status != 0) {
-        PAL_ERR(LOG_TAG, "stream get attributes failed");
-        return status;
-    }
     while (1) {
         offset = bytesRead + buf->offset;
         bytesToRead = buf->size - offset;
@@ -2488,12 +2649,12 @@ int SessionAlsaPcm::read(Stream *s, int tag __unused, struct pal_buffer *buf, in
         void *data = buf->buffer;
         data = static_cast<char*>(data) + offset;
 
-        if(SessionAlsaUtils::isMmapUsecase(sAttr))
+        if (ioMmap)
         {
             long ns = 0;
-            if (sAttr.in_media_config.sample_rate)
-                ns = pcm_bytes_to_frames(pcm, pcmReadSize)*1000000000LL/
-                    sAttr.in_media_config.sample_rate;
+            uint32_t rate = ioInRate;
+            if (rate)
+                ns = pcm_bytes_to_frames(pcm, pcmReadSize)*1000000000LL/rate;
             requestAdmFocus(s, ns);
             status =  pcm_mmap_read(pcm, data,  pcmReadSize);
             releaseAdmFocus(s);
@@ -2519,16 +2680,9 @@ int SessionAlsaPcm::write(Stream *s, int tag, struct pal_buffer *buf, int * size
 {
     int status = 0;
     size_t bytesWritten = 0, bytesRemaining = 0, offset = 0, sizeWritten = 0;
-    struct pal_stream_attributes sAttr = {};
 
     PAL_VERBOSE(LOG_TAG, "Enter buf:%p tag:%d flag:%d", buf, tag, flag);
 
-    status = s->getStreamAttributes(&sAttr);
-    if (status != 0) {
-        PAL_ERR(LOG_TAG, "stream get attributes failed");
-        return status;
-    }
-
     if (pcm == NULL) {
         PAL_ERR(LOG_TAG, "PCM is NULL");
         return -EINVAL;
@@ -2550,11 +2704,11 @@ int SessionAlsaPcm::write(Stream *s, int tag, struct pal_buffer *buf, int * size
             goto exit;
         }
 
-        if (SessionAlsaUtils::isMmapUsecase(sAttr)) {
+        if (ioMmap) {
             long ns = 0;
-            if (sAttr.out_media_config.sample_rate)
-                ns = pcm_bytes_to_frames(pcm, sizeWritten)*1000000000LL/
-                    sAttr.out_media_config.sample_rate;
+            uint32_t rate = ioOutRate;
+            if (rate)
+                ns = pcm_bytes_to_frames(pcm, sizeWritten)*1000000000LL/rate;
             PAL_DBG(LOG_TAG, "1.bufsize:%u ns:%ld", sizeWritten, ns);
             requestAdmFocus(s, ns);
             status =  pcm_mmap_write(pcm, data,  sizeWritten);
@@ -2581,12 +2735,12 @@ int SessionAlsaPcm::write(Stream *s, int tag, struct pal_buffer *buf, int * size
     }
 
     data = static_cast<char *>(data) + offset;
-    if (SessionAlsaUtils::isMmapUsecase(sAttr)) {
+    if (ioMmap) {
         if (sizeWritten) {
             long ns = 0;
-            if (sAttr.out_media_config.sample_rate)
-                ns = pcm_bytes_to_frames(pcm, sizeWritten)*1000000000LL/
-                    sAttr.out_media_config.sample_rate;
+            uint32_t rate = ioOutRate;
+            if (rate)
+                ns = pcm_bytes_to_frames(pcm, sizeWritten)*1000000000LL/rate;
             PAL_DBG(LOG_TAG, "2.bufsize:%u ns:%ld", sizeWritten, ns);
             requestAdmFocus(s, ns);
             status =  pcm_mmap_write(pcm, data,  sizeWritten);
@@ -2647,8 +2801,12 @@ int SessionAlsaPcm::setParameters(Stream *streamHandle, int tagId, uint32_t para
     struct pal_stream_attributes sAttr = {};
 
     PAL_DBG(LOG_TAG, "Enter. param id: %d", param_id);
+    updateIoAttr(streamHandle);
     if (pcmDevIds.size() > 0)
         device = pcmDevIds.at(0);
+    /* rotation is applied again on every start, the ramp is restored by setInitialVolume */
+    if (param_id != PAL_PARAM_ID_DEVICE_ROTATION && param_id != PAL_PARAM_ID_VOLUME_CTRL_RAMP)
+        graphStateChanged = true;
     switch (param_id) {
         case PAL_PARAM_ID_DEVICE_ROTATION:
         {
@@ -2673,22 +2831,11 @@ int SessionAlsaPcm::setParameters(Stream *streamHandle, int tagId, uint32_t para
             paramSize = PAL_ALIGN_8BYTE(header->param_size +
                 sizeof(struct apm_module_param_data_t));
             if (mState == SESSION_IDLE) {
-                if (!customPayloadSize) {
-                    customPayload = (uint8_t *)calloc(1, paramSize);
-                } else {
-                    customPayload = (uint8_t *)realloc(customPayload,
-                        customPayloadSize + paramSize);
-                }
-                if (!customPayload) {
-                    status = -ENOMEM;
-                    PAL_ERR(LOG_TAG, "failed to allocate memory for custom payload");
+                status = updateCustomPayload(paramData, paramSize);
+                if (status) {
+                    PAL_ERR(LOG_TAG, "updateCustomPayload failed, status = %d", status);
                     goto exit;
                 }
-
-                ar_mem_cpy((uint8_t *)customPayload + customPayloadSize, paramSize,
-                    paramData, paramSize);
-                customPayloadSize += paramSize;
-                PAL_INFO(LOG_TAG, "customPayloadSize = %zu", customPayloadSize);
             } else {
                 if (pcmDevIds.size() > 0) {
                     status = SessionAlsaUtils::setMixerParameter(mixer,
@@ -2806,16 +2953,16 @@ int SessionAlsaPcm::setParameters(Stream *streamHandle, int tagId, uint32_t para
             }
 
             if (vdata->no_of_volpair > 1 && sAttr.out_media_config.ch_info.channels > 1) {
-                builder->payloadMultichVolumemConfig(&paramData, &paramSize, miid, vdata);
+                builder->payloadMultichVolumemConfig(&paramData, &paramSize, miid, vdata,
+                                                     &paramArena);
             } else {
-                builder->payloadVolumeConfig(&paramData, &paramSize, miid, vdata);
+                builder->payloadVolumeConfig(&paramData, &paramSize, miid, vdata, &paramArena);
             }
 
             if (paramSize) {
-                status = SessionAlsaUtils::setMixerParameter(mixer, device,
-                                               paramData, paramSize);
+                status = SessionAlsaUtils::setMixerParameter(mixer, device, paramArena);
                 PAL_INFO(LOG_TAG, "mixer set volume config status=%d\n", status);
-                freeCustomPayload(&paramData, &paramSize);
+                paramData = NULL;
                 paramSize = 0;
             }
             return 0;
@@ -2871,7 +3018,7 @@ int SessionAlsaPcm::setParameters(Stream *streamHandle, int tagId, uint32_t para
 
             // set UPD RX tag data
             tagCntrlNameRx<<streamPcm<<pcmDevRxIds.at(0)<<setParamTagControl;
-            ctl = mixer_get_ctl_by_name(mixer, tagCntrlNameRx.str().data());
+            ctl = MixerCtlCache::getCtl(mixer, tagCntrlNameRx.str().data());
             if (!ctl) {
                 PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", tagCntrlNameRx.str().data());
                 status = -EINVAL;
@@ -2887,7 +3034,7 @@ int SessionAlsaPcm::setParameters(Stream *streamHandle, int tagId, uint32_t para
 
             // set UPD TX tag data
             tagCntrlNameTx<<streamPcm<<pcmDevTxIds.at(0)<<setParamTagControl;
-            ctl = mixer_get_ctl_by_name(mixer, tagCntrlNameTx.str().data());
+            ctl = MixerCtlCache::getCtl(mixer, tagCntrlNameTx.str().data());
             if (!ctl) {
                 PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", tagCntrlNameTx.str().data());
                 status = -EINVAL;
@@ -2943,12 +3090,12 @@ int SessionAlsaPcm::setParameters(Stream *streamHandle, int tagId, uint32_t para
                 return status;
             }
             builder->payloadVolumeCtrlRamp(&paramData, &paramSize,
-                 miid, rampParam->ramp_period_ms);
+                 miid, rampParam->ramp_period_ms, &paramArena);
             if (paramSize) {
-                status = SessionAlsaUtils::setMixerParameter(mixer, device,
-                                               paramData, paramSize);
+                status = SessionAlsaUtils::setMixerParameter(mixer, device, paramArena);
                 PAL_INFO(LOG_TAG, "mixer set vol ctrl ramp status=%d\n", status);
-                freeCustomPayload(&paramData, &paramSize);
+                paramData = NULL;
+                paramSize = 0;
             }
             return 0;
          }
@@ -3058,13 +3205,13 @@ int SessionAlsaPcm::setParameters(Stream *streamHandle, int tagId, uint32_t para
                 goto exit;
             }
 
-            builder->payloadGainConfig(&paramData, &paramSize, miid, gdata);
+            builder->payloadGainConfig(&paramData, &paramSize, miid, gdata, &paramArena);
 
             if (paramSize) {
-                status = SessionAlsaUtils::setMixerParameter(mixer, device,
-                                               paramData, paramSize);
+                status = SessionAlsaUtils::setMixerParameter(mixer, device, paramArena);
                 PAL_DBG(LOG_TAG, "GainLog - mixer set gain config status=%d\n", status);
-                freeCustomPayload(&paramData, &paramSize);
+                paramData = NULL;
+                paramSize = 0;
             }
             return 0;
         }
@@ -3127,7 +3274,7 @@ int SessionAlsaPcm::setParameters(Stream *streamHandle, int tagId, uint32_t para
 
             if (sendToRx) {
                 tagCntrlName<<streamPcm<<pcmDevRxIds.at(0)<<setParamTagControl;
-                ctl = mixer_get_ctl_by_name(mixer, tagCntrlName.str().data());
+                ctl = MixerCtlCache::getCtl(mixer, tagCntrlName.str().data());
                 if (!ctl) {
                     PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", tagCntrlName.str().data());
                     status = -EINVAL;
@@ -3137,7 +3284,7 @@ int SessionAlsaPcm::setParameters(Stream *streamHandle, int tagId, uint32_t para
                 status = mixer_ctl_set_array(ctl, tagConfig, sizeof(struct agm_tag_config) + tkv_size);
             } else {
                 tagCntrlName<<streamPcm<<pcmDevTxIds.at(0)<<setParamTagControl;
-                ctl = mixer_get_ctl_by_name(mixer, tagCntrlName.str().data());
+                ctl = MixerCtlCache::getCtl(mixer, tagCntrlName.str().data());
                 if (!ctl) {
                     PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", tagCntrlName.str().data());
                     status = -EINVAL;
@@ -3417,7 +3564,7 @@ int SessionAlsaPcm::getParameters(Stream *s __unused, int tagId, uint32_t param_
         status = -EINVAL;
         goto exit;
     }
-    ctl = mixer_get_ctl_by_name(mixer, CntrlName.str().data());
+    ctl = MixerCtlCache::getCtl(mixer, CntrlName.str().data());
     if (!ctl) {
         PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", CntrlName.str().data());
         status = -ENOENT;
@@ -3749,7 +3896,7 @@ int SessionAlsaPcm::createMmapBuffer(Stream *s, int32_t min_size_frames,
 
 
         CntrlName << stream << pcmDevIds.at(0) << " " << control;
-        ctl = mixer_get_ctl_by_name(mixer, CntrlName.str().data());
+        ctl = MixerCtlCache::getCtl(mixer, CntrlName.str().data());
         if (!ctl) {
             PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", CntrlName.str().data());
             status = -ENOENT;
@@ -4028,7 +4175,7 @@ int SessionAlsaPcm::reconfigureModule(uint32_t tagID, const char* BE, struct ses
         goto exit;
     }
     PAL_DBG(LOG_TAG, "miid : %x id = %d\n", miid, pcmDevIds.at(0));
-    builder->payloadMFCConfig(&payload, &payloadSize, miid, data);
+    builder->payloadMFCConfig(&payload, &payloadSize, miid, data, &payloadArena);
     if (payloadSize && payload) {
         status = updateCustomPayload(payload, payloadSize);
         freeCustomPayload(&payload, &payloadSize);
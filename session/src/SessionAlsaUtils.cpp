@@ -328,12 +328,9 @@ bool SessionAlsaUtils::isMmapUsecase(struct pal_stream_attributes &sAttr)
 
 struct mixer_ctl *SessionAlsaUtils::getStaticMixerControl(struct mixer *am, std::string name)
 {
-    std::ostringstream cntrlName;
-
-    cntrlName << name;
-    PAL_DBG(LOG_TAG, "mixer control name is %s", cntrlName.str().data());
+    PAL_DBG(LOG_TAG, "mixer control name is %s", name.c_str());
 
-    return mixer_get_ctl_by_name(am, cntrlName.str().data());
+    return MixerCtlCache::getCtl(am, name.c_str());
 }
 
 struct mixer_ctl *SessionAlsaUtils::getFeMixerControl(struct mixer *am, std::string feName,
@@ -344,7 +341,7 @@ struct mixer_ctl *SessionAlsaUtils::getFeMixerControl(struct mixer *am, std::str
 
     cntrlName << feName << feCtrlNames[idx];
     PAL_DBG(LOG_TAG, "mixer control %s", cntrlName.str().data());
-    ctl = mixer_get_ctl_by_name(am, cntrlName.str().data());
+    ctl = MixerCtlCache::getCtl(am, cntrlName.str().data());
     if (!ctl)
         PAL_FATAL(LOG_TAG, "invalid mixer control: %s", cntrlName.str().data());
 
@@ -358,7 +355,7 @@ struct mixer_ctl *SessionAlsaUtils::getBeMixerControl(struct mixer *am, std::str
 
     cntrlName << beName << beCtrlNames[idx];
     PAL_DBG(LOG_TAG, "mixer control %s", cntrlName.str().data());
-    return mixer_get_ctl_by_name(am, cntrlName.str().data());
+    return MixerCtlCache::getCtl(am, cntrlName.str().data());
 }
 
 int SessionAlsaUtils::open(Stream * streamHandle, std::shared_ptr<ResourceManager> rmHandle,
@@ -623,11 +620,27 @@ exit:
 int SessionAlsaUtils::close(Stream * streamHandle, std::shared_ptr<ResourceManager> rmHandle,
     const std::vector<int> &DevIds, const std::vector<std::pair<int32_t, std::string>> &BackEnds,
     std::vector<std::pair<std::string, int>> &freedevicemetadata)
+{
+    int status = 0;
+    struct pal_stream_attributes sAttr = {};
+
+    status = streamHandle->getStreamAttributes(&sAttr);
+    if(0 != status) {
+        PAL_ERR(LOG_TAG, "getStreamAttributes Failed \n");
+        return status;
+    }
+
+    return close(sAttr, rmHandle, DevIds, BackEnds, freedevicemetadata);
+}
+
+int SessionAlsaUtils::close(const struct pal_stream_attributes &sAttr,
+    std::shared_ptr<ResourceManager> rmHandle, const std::vector<int> &DevIds,
+    const std::vector<std::pair<int32_t, std::string>> &BackEnds,
+    std::vector<std::pair<std::string, int>> &freedevicemetadata)
 {
     int status = 0;
     uint32_t i;
     std::vector <std::pair<int, int>> emptyKV;
-    struct pal_stream_attributes sAttr = {};
     struct agmMetaData streamMetaData(nullptr, 0);
     struct agmMetaData deviceMetaData(nullptr, 0);
     struct agmMetaData streamDeviceMetaData(nullptr, 0);
@@ -639,12 +652,6 @@ int SessionAlsaUtils::close(Stream * streamHandle, std::shared_ptr<ResourceManag
     struct mixer_ctl *beMetaDataMixerCtrl = nullptr;
     struct mixer *mixerHandle = nullptr;
 
-    status = streamHandle->getStreamAttributes(&sAttr);
-    if(0 != status) {
-        PAL_ERR(LOG_TAG, "getStreamAttributes Failed \n");
-        goto exit;
-    }
-
     if (DevIds.size() <= 0) {
         PAL_ERR(LOG_TAG, "DevIds size is invalid \n");
         goto exit;
@@ -989,6 +996,7 @@ int SessionAlsaUtils::setDeviceMediaConfig(std::shared_ptr<ResourceManager> rmHa
     long aif_media_config[4];
     long aif_group_atrr_config[5];
     struct mixer *mixerHandle = NULL;
+    MixerTransaction txn("setDeviceMediaConfig");
     int status = 0;
 
     status = rmHandle->getVirtualAudioMixer(&mixerHandle);
@@ -1039,8 +1047,10 @@ int SessionAlsaUtils::setDeviceMediaConfig(std::shared_ptr<ResourceManager> rmHa
         aif_group_atrr_config[3] = AGM_DATA_FORMAT_FIXED_POINT;
         aif_group_atrr_config[4] = rmHandle->activeGroupDevConfig->grp_dev_hwep_cfg.slot_mask;
 
-        mixer_ctl_set_array(ctl, &aif_group_atrr_config,
-                               sizeof(aif_group_atrr_config)/sizeof(aif_group_atrr_config[0]));
+        txn.setArray(ctl, &aif_group_atrr_config,
+                     sizeof(aif_group_atrr_config)/sizeof(aif_group_atrr_config[0]), true);
+        /* a failed group config write is logged but was never fatal */
+        txn.commit();
         PAL_INFO(LOG_TAG, "%s rate ch fmt data_fmt slot_mask %ld %ld %ld %ld %ld\n", truncatedBeName.c_str(),
                 aif_group_atrr_config[0], aif_group_atrr_config[1], aif_group_atrr_config[2],
                 aif_group_atrr_config[3], aif_group_atrr_config[4]);
@@ -1057,8 +1067,10 @@ int SessionAlsaUtils::setDeviceMediaConfig(std::shared_ptr<ResourceManager> rmHa
                      aif_media_config[0], aif_media_config[1],
                      aif_media_config[2], aif_media_config[3]);
 
-    return mixer_ctl_set_array(ctl, &aif_media_config,
-                               sizeof(aif_media_config)/sizeof(aif_media_config[0]));
+    /* an unchanged media format write is dropped by the transaction */
+    txn.setArray(ctl, &aif_media_config,
+                 sizeof(aif_media_config)/sizeof(aif_media_config[0]), true);
+    return txn.commit();
 }
 
 int SessionAlsaUtils::getTimestamp(struct mixer *mixer, const std::vector<int> &DevIds,
@@ -1066,29 +1078,19 @@ int SessionAlsaUtils::getTimestamp(struct mixer *mixer, const std::vector<int> &
 {
     int status = 0;
     const char *getParamControl = "getParam";
-    char *pcmDeviceName = NULL;
-    std::ostringstream CntrlName;
     struct mixer_ctl *ctl;
     struct param_id_spr_session_time_t *spr_session_time;
     std::shared_ptr<std::vector<uint8_t>> payload = nullptr;
     size_t payloadSize = 0;
-    std::shared_ptr<ResourceManager> rm = ResourceManager::getInstance();
 
-    if (DevIds.size() > 0) {
-        pcmDeviceName = rm->getDeviceNameFromID(DevIds.at(0));
-    } else {
+    if (DevIds.size() == 0) {
         PAL_ERR(LOG_TAG, "DevIds size is invalid");
         return -EINVAL;
     }
 
-    if(!pcmDeviceName){
-        PAL_ERR(LOG_TAG, "Device name from id not found");
-        return -EINVAL;
-    }
-    CntrlName<<pcmDeviceName<<" "<<getParamControl;
-    ctl = mixer_get_ctl_by_name(mixer, CntrlName.str().data());
+    ctl = MixerCtlCache::getPcmCtl(mixer, DevIds.at(0), getParamControl);
     if (!ctl) {
-        PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", CntrlName.str().data());
+        PAL_ERR(LOG_TAG, "Invalid mixer control: %s for device %d", getParamControl, DevIds.at(0));
         return -ENOENT;
     }
 
@@ -1130,45 +1132,26 @@ exit:
 int SessionAlsaUtils::getModuleInstanceId(struct mixer *mixer, int device, const char *intf_name,
                        int tag_id, uint32_t *miid)
 {
-    char *pcmDeviceName = NULL;
     char const *control = "getTaggedInfo";
-    char *mixer_str;
     struct mixer_ctl *ctl;
-    int ctl_len = 0,ret = 0, i;
+    int ret = 0, i;
     void *payload;
     struct gsl_tag_module_info *tag_info;
     struct gsl_tag_module_info_entry *tag_entry;
     int offset = 0;
-    std::shared_ptr<ResourceManager> rm = ResourceManager::getInstance();
-
-    pcmDeviceName = rm->getDeviceNameFromID(device);
-    if(!pcmDeviceName){
-        PAL_ERR(LOG_TAG, "Device name from id %d not found", device);
-        return -EINVAL;
-    }
 
     ret = setStreamMetadataType(mixer, device, intf_name);
     if (ret)
         return ret;
 
-    ctl_len = strlen(pcmDeviceName) + 1 + strlen(control) + 1;
-    mixer_str = (char *)calloc(1, ctl_len);
-    if (!mixer_str)
-        return -ENOMEM;
-
-    snprintf(mixer_str, ctl_len, "%s %s", pcmDeviceName, control);
-
-    PAL_DBG(LOG_TAG, "- mixer -%s-\n", mixer_str);
-    ctl = mixer_get_ctl_by_name(mixer, mixer_str);
+    ctl = MixerCtlCache::getPcmCtl(mixer, device, control);
     if (!ctl) {
-        PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", mixer_str);
-        free(mixer_str);
+        PAL_ERR(LOG_TAG, "Invalid mixer control: %s for device %d", control, device);
         return ENOENT;
     }
 
     payload = calloc(1024, sizeof(char));
     if (!payload) {
-        free(mixer_str);
         return -ENOMEM;
     }
 
@@ -1176,7 +1159,6 @@ int SessionAlsaUtils::getModuleInstanceId(struct mixer *mixer, int device, const
     if (ret < 0) {
         PAL_ERR(LOG_TAG, "Failed to mixer_ctl_get_array\n");
         free(payload);
-        free(mixer_str);
         return ret;
     }
     tag_info = (struct gsl_tag_module_info *)payload;
@@ -1208,51 +1190,29 @@ int SessionAlsaUtils::getModuleInstanceId(struct mixer *mixer, int device, const
     }
 
     free(payload);
-    free(mixer_str);
     return ret;
 }
 
 int SessionAlsaUtils::getTagsWithModuleInfo(struct mixer *mixer, int device, const char *intf_name,
                                             uint8_t *payload)
 {
-    char *pcmDeviceName = NULL;
     char const *control = "getTaggedInfo";
-    char *mixer_str;
     struct mixer_ctl *ctl;
-    int ctl_len = 0, ret = 0;
+    int ret = 0;
     void *payload_;
 
-    std::shared_ptr<ResourceManager> rm = ResourceManager::getInstance();
-
-    pcmDeviceName = rm->getDeviceNameFromID(device);
-
     ret = setStreamMetadataType(mixer, device, intf_name);
     if (ret)
         return ret;
 
-    if (!pcmDeviceName) {
-        PAL_ERR(LOG_TAG, "pcmDeviceName not initialized");
-        return -EINVAL;
-    }
-
-    ctl_len = strlen(pcmDeviceName) + 1 + strlen(control) + 1;
-    mixer_str = (char *)calloc(1, ctl_len);
-    if (!mixer_str)
-        return -ENOMEM;
-
-    snprintf(mixer_str, ctl_len, "%s %s", pcmDeviceName, control);
-
-    PAL_DBG(LOG_TAG, "- mixer -%s-\n", mixer_str);
-    ctl = mixer_get_ctl_by_name(mixer, mixer_str);
+    ctl = MixerCtlCache::getPcmCtl(mixer, device, control);
     if (!ctl) {
-        PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", mixer_str);
-        free(mixer_str);
+        PAL_ERR(LOG_TAG, "Invalid mixer control: %s for device %d", control, device);
         return ENOENT;
     }
 
     payload_ = calloc(1024, sizeof(char));
     if (!payload_) {
-        free(mixer_str);
         return -ENOMEM;
     }
 
@@ -1260,86 +1220,75 @@ int SessionAlsaUtils::getTagsWithModuleInfo(struct mixer *mixer, int device, con
     if (ret < 0) {
         PAL_ERR(LOG_TAG, "Failed to mixer_ctl_get_array\n");
         free(payload_);
-        free(mixer_str);
         return ret;
     }
     memcpy(payload, (uint8_t *)payload_, 1024);
 
     free(payload_);
-    free(mixer_str);
     return ret;
 }
 
 int SessionAlsaUtils::setMixerParameter(struct mixer *mixer, int device,
                                         void *payload, int size)
 {
-    char *pcmDeviceName = NULL;
     char const *control = "setParam";
-    char *mixer_str;
     struct mixer_ctl *ctl;
-    int ctl_len = 0,ret = 0;
-    std::shared_ptr<ResourceManager> rm = ResourceManager::getInstance();
+    int ret = 0;
 
-    pcmDeviceName = rm->getDeviceNameFromID(device);
-    if(!pcmDeviceName){
-        PAL_ERR(LOG_TAG, "Device name from id %d not found", device);
-        return -EINVAL;
+    ctl = MixerCtlCache::getPcmCtl(mixer, device, control);
+    if (!ctl) {
+        PAL_ERR(LOG_TAG, "Invalid mixer control: %s for device %d", control, device);
+        return ENOENT;
     }
+    ret = mixer_ctl_set_array(ctl, payload, size);
 
-    PAL_DBG(LOG_TAG, "- mixer -%s-\n", pcmDeviceName);
-    ctl_len = strlen(pcmDeviceName) + 1 + strlen(control) + 1;
-    mixer_str = (char *)calloc(1, ctl_len);
-    if (!mixer_str) {
-        return -ENOMEM;
-    }
-    snprintf(mixer_str, ctl_len, "%s %s", pcmDeviceName, control);
+    PAL_DBG(LOG_TAG, "ret = %d, cnt = %d\n", ret, size);
+    return ret;
+}
 
-    PAL_DBG(LOG_TAG, "- mixer -%s-\n", mixer_str);
-    ctl = mixer_get_ctl_by_name(mixer, mixer_str);
+/* Queues the payload on txn, it is copied so the caller may free it right away */
+int SessionAlsaUtils::setMixerParameter(MixerTransaction &txn, struct mixer *mixer,
+                                        int device, void *payload, int size)
+{
+    char const *control = "setParam";
+    struct mixer_ctl *ctl;
+
+    ctl = MixerCtlCache::getPcmCtl(mixer, device, control);
     if (!ctl) {
-        PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", mixer_str);
-        free(mixer_str);
+        PAL_ERR(LOG_TAG, "Invalid mixer control: %s for device %d", control, device);
         return ENOENT;
     }
-    ret = mixer_ctl_set_array(ctl, payload, size);
+    txn.setArray(ctl, payload, size);
+    return 0;
+}
 
-    PAL_DBG(LOG_TAG, "ret = %d, cnt = %d\n", ret, size);
-    free(mixer_str);
+/* Sends every payload accumulated in the arena and rewinds it for reuse */
+int SessionAlsaUtils::setMixerParameter(struct mixer *mixer, int device,
+                                        PayloadArena &arena)
+{
+    int ret = 0;
+
+    if (!arena.size())
+        return 0;
+
+    ret = setMixerParameter(mixer, device, arena.data(), arena.size());
+    arena.reset();
     return ret;
 }
 
 int SessionAlsaUtils::setStreamMetadataType(struct mixer *mixer, int device, const char *val)
 {
-    char *pcmDeviceName = NULL;
     char const *control = "control";
-    char *mixer_str;
     struct mixer_ctl *ctl;
-    int ctl_len = 0,ret = 0;
-    std::shared_ptr<ResourceManager> rm = ResourceManager::getInstance();
+    int ret = 0;
 
-    pcmDeviceName = rm->getDeviceNameFromID(device);
-    if(!pcmDeviceName){
-        PAL_ERR(LOG_TAG, "Device name from id %d not found", device);
-        return -EINVAL;
-    }
-    ctl_len = strlen(pcmDeviceName) + 1 + strlen(control) + 1;
-    mixer_str = (char *)calloc(1, ctl_len);
-    if(mixer_str == NULL) {
-        ret = -ENOMEM;
-        PAL_ERR(LOG_TAG, "calloc failed");
-        return ret;
-    }
-    snprintf(mixer_str, ctl_len, "%s %s", pcmDeviceName, control);
-    PAL_DBG(LOG_TAG, "- mixer -%s-\n", mixer_str);
-    ctl = mixer_get_ctl_by_name(mixer, mixer_str);
+    ctl = MixerCtlCache::getPcmCtl(mixer, device, control);
     if (!ctl) {
-        PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", mixer_str);
-        free(mixer_str);
+        PAL_ERR(LOG_TAG, "Invalid mixer control: %s for device %d", control, device);
         return ENOENT;
     }
 
     ret = mixer_ctl_set_enum_by_string(ctl, val);
-    free(mixer_str);
     return ret;
 }
 
@@ -1348,7 +1297,6 @@ int SessionAlsaUtils::registerMixerEvent(struct mixer *mixer, int device, const
     struct agm_event_reg_cfg *event_cfg;
     int status = 0;
     uint32_t miid;
-    std::shared_ptr<ResourceManager> rm = ResourceManager::getInstance();
 
     // get module instance id
     status = SessionAlsaUtils::getModuleInstanceId(mixer, device, intf_name, tag_id, &miid);
@@ -1366,112 +1314,53 @@ int SessionAlsaUtils::registerMixerEvent(struct mixer *mixer, int device, const
 
 int SessionAlsaUtils::registerMixerEvent(struct mixer *mixer, int device, void *payload, int payload_size)
 {
-    char *pcmDeviceName = NULL;
     char const *control = "event";
-    char *mixer_str;
     struct mixer_ctl *ctl;
-    int ctl_len = 0,status = 0;
-    std::shared_ptr<ResourceManager> rm = ResourceManager::getInstance();
-
-    pcmDeviceName = rm->getDeviceNameFromID(device);
-    if (!pcmDeviceName)
-        return -EINVAL;
-
-    ctl_len = strlen(pcmDeviceName) + 1 + strlen(control) + 1;
-    mixer_str = (char *)calloc(1, ctl_len);
-    if (!mixer_str)
-        return -ENOMEM;
-
-    snprintf(mixer_str, ctl_len, "%s %s", pcmDeviceName, control);
+    int status = 0;
 
-    PAL_DBG(LOG_TAG, "- mixer -%s-\n", mixer_str);
-    ctl = mixer_get_ctl_by_name(mixer, mixer_str);
+    ctl = MixerCtlCache::getPcmCtl(mixer, device, control);
     if (!ctl) {
-        PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", mixer_str);
-        free(mixer_str);
+        PAL_ERR(LOG_TAG, "Invalid mixer control: %s for device %d", control, device);
         return ENOENT;
     }
 
     status = mixer_ctl_set_array(ctl, (struct agm_event_reg_cfg *)payload,
                         payload_size);
-    free(mixer_str);
     return status;
 }
 
 int SessionAlsaUtils::setECRefPath(struct mixer *mixer, int device, const char *intf_name)
 {
-    char *pcmDeviceName = NULL;
     char const *control = "echoReference";
-    char *mixer_str;
     struct mixer_ctl *ctl;
-    int ctl_len = 0;
     int ret = 0;
-    std::shared_ptr<ResourceManager> rm = ResourceManager::getInstance();
-
-    pcmDeviceName = rm->getDeviceNameFromID(device);
-    if(!pcmDeviceName){
-        PAL_ERR(LOG_TAG, "Device name from id %d not found", device);
-        return -EINVAL;
-    }
 
-    ctl_len = strlen(pcmDeviceName) + 1 + strlen(control) + 1;
-    mixer_str = (char *)calloc(1, ctl_len);
-    if(mixer_str == NULL) {
-        ret = -ENOMEM;
-        PAL_ERR(LOG_TAG, "calloc failed");
-        return ret;
-    }
-    snprintf(mixer_str, ctl_len, "%s %s", pcmDeviceName, control);
-
-    printf("%s mixer -%s-\n", __func__, mixer_str);
-    ctl = mixer_get_ctl_by_name(mixer, mixer_str);
+    ctl = MixerCtlCache::getPcmCtl(mixer, device, control);
     if (!ctl) {
-        printf("Invalid mixer control: %s\n", mixer_str);
-        free(mixer_str);
+        PAL_ERR(LOG_TAG, "Invalid mixer control: %s for device %d", control, device);
         return ENOENT;
     }
 
     ret = mixer_ctl_set_enum_by_string(ctl, intf_name);
-    free(mixer_str);
     return ret;
 }
 
 int SessionAlsaUtils::mixerWriteDatapathParams(struct mixer *mixer, int device,
                                         void *payload, int size)
 {
-    char *pcmDeviceName = NULL;
     char const *control = "datapathParams";
-    char *mixer_str;
     struct mixer_ctl *ctl;
-    int ctl_len = 0,ret = 0;
-    std::shared_ptr<ResourceManager> rm = ResourceManager::getInstance();
-
-    pcmDeviceName = rm->getDeviceNameFromID(device);
-    if(!pcmDeviceName){
-        PAL_ERR(LOG_TAG, "Device name from id %d not found", device);
-        return -EINVAL;
-    }
-
-    PAL_DBG(LOG_TAG, "- mixer -%s-\n", pcmDeviceName);
-    ctl_len = strlen(pcmDeviceName) + 1 + strlen(control) + 1;
-    mixer_str = (char *)calloc(1, ctl_len);
-    if (!mixer_str) {
-        return -ENOMEM;
-    }
-    snprintf(mixer_str, ctl_len, "%s %s", pcmDeviceName, control);
+    int ret = 0;
 
-    PAL_DBG(LOG_TAG, "- mixer -%s-\n", mixer_str);
-    ctl = mixer_get_ctl_by_name(mixer, mixer_str);
+    ctl = MixerCtlCache::getPcmCtl(mixer, device, control);
     if (!ctl) {
-        PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", mixer_str);
-        free(mixer_str);
+        PAL_ERR(LOG_TAG, "Invalid mixer control: %s for device %d", control, device);
         return ENOENT;
     }
     PAL_DBG(LOG_TAG, "payload = %p\n", payload);
     ret = mixer_ctl_set_array(ctl, payload, size);
 
     PAL_DBG(LOG_TAG, "ret = %d, cnt = %d\n", ret, size);
-    free(mixer_str);
     return ret;
 }
 
@@ -2089,6 +1978,7 @@ int SessionAlsaUtils::disconnectSessionDevice(Stream* streamHandle, pal_stream_t
     struct mixer_ctl* beMetaDataMixerCtrl = nullptr;
     std::shared_ptr<ResourceManager> rm = ResourceManager::getInstance();
     std::shared_ptr<Device> dev = nullptr;
+    MixerTransaction txn("disconnectSessionDevice");
     int sub = 1;
     uint32_t i;
     int devCount = 0;
@@ -2129,7 +2019,7 @@ int SessionAlsaUtils::disconnectSessionDevice(Stream* streamHandle, pal_stream_t
             break;
     }
     status = rmHandle->getVirtualAudioMixer(&mixerHandle);
-    disconnectCtrl = mixer_get_ctl_by_name(mixerHandle, disconnectCtrlName.str().data());
+    disconnectCtrl = MixerCtlCache::getCtl(mixerHandle, disconnectCtrlName.str().data());
     if (!disconnectCtrl) {
         PAL_ERR(LOG_TAG, "invalid mixer control: %s", disconnectCtrlName.str().data());
         return -EINVAL;
@@ -2146,7 +2036,7 @@ int SessionAlsaUtils::disconnectSessionDevice(Stream* streamHandle, pal_stream_t
     }
 
     /** Disconnect FE to BE */
-    mixer_ctl_set_enum_by_string(disconnectCtrl, aifBackEndsToDisconnect[0].second.data());
+    txn.setEnum(disconnectCtrl, aifBackEndsToDisconnect[0].second.data());
 
     /** clear device metadata*/
     getAgmMetaData(emptyKV, emptyKV, (struct prop_data*)devicePropId,
@@ -2196,16 +2086,18 @@ int SessionAlsaUtils::disconnectSessionDevice(Stream* streamHandle, pal_stream_t
     if (devCount > 1) {
         PAL_INFO(LOG_TAG, "No need to free device metadata since active streams present on device");
     } else {
-        mixer_ctl_set_array(beMetaDataMixerCtrl, (void*)deviceMetaData.buf,
+        txn.setArray(beMetaDataMixerCtrl, (void*)deviceMetaData.buf,
             deviceMetaData.size);
     }
 
-    mixer_ctl_set_enum_by_string(feMixerCtrls[FE_CONTROL],
+    txn.setEnum(feMixerCtrls[FE_CONTROL],
         aifBackEndsToDisconnect[0].second.data());
-    mixer_ctl_set_array(feMixerCtrls[FE_METADATA], (void*)streamDeviceMetaData.buf,
+    txn.setArray(feMixerCtrls[FE_METADATA], (void*)streamDeviceMetaData.buf,
         streamDeviceMetaData.size);
 
 freeMetaData:
+    /* the disconnect goes out even if clearing the metadata could not be prepared */
+    txn.commit();
     if (streamDeviceMetaData.buf)
         free(streamDeviceMetaData.buf);
     if (deviceMetaData.buf)
@@ -2225,6 +2117,7 @@ int SessionAlsaUtils::disconnectSessionDevice(Stream* streamHandle, pal_stream_t
     struct mixer_ctl *disconnectCtrl = nullptr;
     struct mixer_ctl *txFeMixerCtrls[FE_MAX_NUM_MIXER_CONTROLS] = { nullptr };
     std::ostringstream txFeName;
+    MixerTransaction txn("disconnectSessionDevice");
 
     switch (streamType) {
          case PAL_STREAM_ULTRASOUND:
@@ -2238,7 +2131,7 @@ int SessionAlsaUtils::disconnectSessionDevice(Stream* streamHandle, pal_stream_t
                  status = -EINVAL;
                  return status;
              }
-             mixer_ctl_set_enum_by_string(txFeMixerCtrls[FE_LOOPBACK], "ZERO");
+             txn.setEnum(txFeMixerCtrls[FE_LOOPBACK], "ZERO");
              if (dAttr.id > PAL_DEVICE_OUT_MIN && dAttr.id < PAL_DEVICE_OUT_MAX) {
                  disconnectCtrlName << PCM_SND_DEV_NAME_PREFIX << pcmRxDevIds.at(0) << " disconnect";
              } else if (dAttr.id > PAL_DEVICE_IN_MIN && dAttr.id < PAL_DEVICE_IN_MAX) {
@@ -2250,13 +2143,15 @@ int SessionAlsaUtils::disconnectSessionDevice(Stream* streamHandle, pal_stream_t
             break;
     }
     status = rmHandle->getVirtualAudioMixer(&mixerHandle);
-    disconnectCtrl = mixer_get_ctl_by_name(mixerHandle, disconnectCtrlName.str().data());
+    disconnectCtrl = MixerCtlCache::getCtl(mixerHandle, disconnectCtrlName.str().data());
     if (!disconnectCtrl) {
         PAL_ERR(LOG_TAG, "invalid mixer control: %s", disconnectCtrlName.str().data());
+        txn.commit();
         return -EINVAL;
     }
     /** Disconnect FE to BE */
-    mixer_ctl_set_enum_by_string(disconnectCtrl, aifBackEndsToDisconnect[0].second.data());
+    txn.setEnum(disconnectCtrl, aifBackEndsToDisconnect[0].second.data());
+    txn.commit();
 
     return status;
 }
@@ -2279,6 +2174,7 @@ int SessionAlsaUtils::connectSessionDevice(Session* sess, Stream* streamHandle,
     struct sessionToPayloadParam streamData = {};
     PayloadBuilder* builder = new PayloadBuilder();
     std::shared_ptr<ResourceManager> rm = ResourceManager::getInstance();
+    MixerTransaction txn("connectSessionDevice");
 
     status = rmHandle->getVirtualAudioMixer(&mixerHandle);
     if (status) {
@@ -2348,7 +2244,7 @@ int SessionAlsaUtils::connectSessionDevice(Session* sess, Stream* streamHandle,
                         status = 0; //rotaton setting failed is not fatal.
                         sess->getCustomPayload(&payload, &payloadSize);
                         if (payload) {
-                            status = SessionAlsaUtils::setMixerParameter(mixerHandle,
+                            status = SessionAlsaUtils::setMixerParameter(txn, mixerHandle,
                                                                      pcmDevIds.at(0),
                                                                      payload, payloadSize);
                             sess->freeCustomPayload();
@@ -2363,7 +2259,7 @@ int SessionAlsaUtils::connectSessionDevice(Session* sess, Stream* streamHandle,
                 } else {
                     sess->getCustomPayload(&payload, &payloadSize);
                     if (payload) {
-                        status = SessionAlsaUtils::setMixerParameter(mixerHandle, pcmDevIds.at(0),
+                        status = SessionAlsaUtils::setMixerParameter(txn, mixerHandle, pcmDevIds.at(0),
                                                                  payload, payloadSize);
                         sess->freeCustomPayload();
                         payload = NULL;
@@ -2396,7 +2292,7 @@ int SessionAlsaUtils::connectSessionDevice(Session* sess, Stream* streamHandle,
                                     aifBackEndsToConnect[0].second.data());
                     sess->getCustomPayload(&payload, &payloadSize);
                     if (payload) {
-                        status = SessionAlsaUtils::setMixerParameter(mixerHandle, pcmDevIds.at(0),
+                        status = SessionAlsaUtils::setMixerParameter(txn, mixerHandle, pcmDevIds.at(0),
                                                 payload, payloadSize);
                     }
                     sess->freeCustomPayload();
@@ -2434,13 +2330,15 @@ int SessionAlsaUtils::connectSessionDevice(Session* sess, Stream* streamHandle,
     }
 
 
-    connectCtrl = mixer_get_ctl_by_name(mixerHandle, connectCtrlName.str().data());
+    connectCtrl = MixerCtlCache::getCtl(mixerHandle, connectCtrlName.str().data());
     if (!connectCtrl) {
         PAL_ERR(LOG_TAG, "invalid mixer control: %s", connectCtrlName.str().data());
         status = -EINVAL;
         goto exit;
     }
-    status = mixer_ctl_set_enum_by_string(connectCtrl, aifBackEndsToConnect[0].second.data());
+    /* the custom payload queued above goes out right before the connect */
+    txn.setEnum(connectCtrl, aifBackEndsToConnect[0].second.data());
+    status = txn.commit(true);
 
     if (PAL_STREAM_VOICE_CALL == streamType) {
         SessionAlsaVoice *voiceSession = dynamic_cast<SessionAlsaVoice *>(sess);
@@ -2454,6 +2352,8 @@ int SessionAlsaUtils::connectSessionDevice(Session* sess, Stream* streamHandle,
         }
     }
 exit:
+    /* flush whatever was queued before an error, as if it was written directly */
+    txn.commit(true);
     if (builder) {
        delete builder;
        builder = NULL;
@@ -2468,6 +2368,7 @@ int SessionAlsaUtils::connectSessionDevice(Session* sess, Stream* streamHandle,
 {
     std::ostringstream connectCtrlName;
     int status = 0;
+    int ret = 0;
     struct mixer *mixerHandle = nullptr;
     struct mixer_ctl *connectCtrl = nullptr;
     struct mixer_ctl *txFeMixerCtrls[FE_MAX_NUM_MIXER_CONTROLS] = { nullptr };
@@ -2476,6 +2377,7 @@ int SessionAlsaUtils::connectSessionDevice(Session* sess, Stream* streamHandle,
     uint8_t* payload = NULL;
     size_t payloadSize = 0;
     bool is_out_dev = false;
+    MixerTransaction txn("connectSessionDevice");
 
     if (dAttr.id > PAL_DEVICE_OUT_MIN && dAttr.id < PAL_DEVICE_OUT_MAX) {
         is_out_dev = true;
@@ -2507,7 +2409,7 @@ int SessionAlsaUtils::connectSessionDevice(Session* sess, Stream* streamHandle,
                                 aifBackEndsToConnect[0].second.data());
             sess->getCustomPayload(&payload, &payloadSize);
             if (payload) {
-                status = SessionAlsaUtils::setMixerParameter(mixerHandle, pcmRxDevIds.at(0),
+                status = SessionAlsaUtils::setMixerParameter(txn, mixerHandle, pcmRxDevIds.at(0),
                                                          payload, payloadSize);
                 sess->freeCustomPayload();
                 payload = NULL;
@@ -2524,14 +2426,14 @@ int SessionAlsaUtils::connectSessionDevice(Session* sess, Stream* streamHandle,
         }
     }
 
-    connectCtrl = mixer_get_ctl_by_name(mixerHandle, connectCtrlName.str().data());
+    connectCtrl = MixerCtlCache::getCtl(mixerHandle, connectCtrlName.str().data());
     if (!connectCtrl) {
         PAL_ERR(LOG_TAG, "invalid mixer control: %s", connectCtrlName.str().data());
         status = -EINVAL;
         goto exit;
     }
     /** connect FE to BE */
-    mixer_ctl_set_enum_by_string(connectCtrl, aifBackEndsToConnect[0].second.data());
+    txn.setEnum(connectCtrl, aifBackEndsToConnect[0].second.data());
 
     switch (streamType) {
          case PAL_STREAM_ULTRASOUND:
@@ -2546,7 +2448,7 @@ int SessionAlsaUtils::connectSessionDevice(Session* sess, Stream* streamHandle,
                  status = -EINVAL;
                  goto exit;
              }
-             mixer_ctl_set_enum_by_string(txFeMixerCtrls[FE_LOOPBACK], rxFeName.str().data());
+             txn.setEnum(txFeMixerCtrls[FE_LOOPBACK], rxFeName.str().data());
              break;
          default:
              PAL_ERR(LOG_TAG, "unknown stream type %d",streamType);
@@ -2554,6 +2456,10 @@ int SessionAlsaUtils::connectSessionDevice(Session* sess, Stream* streamHandle,
     }
 
 exit:
+    /* setParam, connect and loopback go out back to back, skipped after a failure */
+    ret = txn.commit(true);
+    if (!status)
+        status = ret;
     return status;
 }
 
@@ -2578,6 +2484,7 @@ int SessionAlsaUtils::setupSessionDevice(Stream* streamHandle, pal_stream_type_t
     struct mixer_ctl *feCtrl = nullptr;
     struct mixer_ctl *feMdCtrl = nullptr;
     struct mixer_ctl *aifMdCtrl = nullptr;
+    MixerTransaction txn("setupSessionDevice");
     PayloadBuilder* builder = new PayloadBuilder();
     struct mixer *mixerHandle = nullptr;
     uint32_t devicePropId[] = {0x08000010, 2, 0x2, 0x5};
@@ -2750,7 +2657,7 @@ int SessionAlsaUtils::setupSessionDevice(Stream* streamHandle, pal_stream_type_t
 
     status = rmHandle->getVirtualAudioMixer(&mixerHandle);
 
-    aifMdCtrl = mixer_get_ctl_by_name(mixerHandle, aifMdName.str().data());
+    aifMdCtrl = MixerCtlCache::getCtl(mixerHandle, aifMdName.str().data());
     PAL_DBG(LOG_TAG, "mixer control %s", aifMdName.str().data());
     if (!aifMdCtrl) {
         PAL_ERR(LOG_TAG, "invalid mixer control: %s", aifMdName.str().data());
@@ -2758,18 +2665,18 @@ int SessionAlsaUtils::setupSessionDevice(Stream* streamHandle, pal_stream_type_t
         goto freeMetaData;
     }
     if (deviceMetaData.size)
-        mixer_ctl_set_array(aifMdCtrl, (void *)deviceMetaData.buf, deviceMetaData.size);
+        txn.setArray(aifMdCtrl, (void *)deviceMetaData.buf, deviceMetaData.size);
 
-    feCtrl = mixer_get_ctl_by_name(mixerHandle, cntrlName.str().data());
+    feCtrl = MixerCtlCache::getCtl(mixerHandle, cntrlName.str().data());
     PAL_DBG(LOG_TAG, "mixer control %s", cntrlName.str().data());
     if (!feCtrl) {
         PAL_ERR(LOG_TAG, "invalid mixer control: %s", cntrlName.str().data());
         status = -EINVAL;
         goto freeMetaData;
     }
-    mixer_ctl_set_enum_by_string(feCtrl, aifBackEndsToConnect[0].second.data());
+    txn.setEnum(feCtrl, aifBackEndsToConnect[0].second.data());
 
-    feMdCtrl = mixer_get_ctl_by_name(mixerHandle, feMdName.str().data());
+    feMdCtrl = MixerCtlCache::getCtl(mixerHandle, feMdName.str().data());
     PAL_DBG(LOG_TAG, "mixer control %s", feMdName.str().data());
     if (!feMdCtrl) {
         PAL_ERR(LOG_TAG, "invalid mixer control: %s", feMdName.str().data());
@@ -2777,8 +2684,9 @@ int SessionAlsaUtils::setupSessionDevice(Stream* streamHandle, pal_stream_type_t
         goto freeMetaData;
     }
     if (streamDeviceMetaData.size)
-        mixer_ctl_set_array(feMdCtrl, (void *)streamDeviceMetaData.buf, streamDeviceMetaData.size);
+        txn.setArray(feMdCtrl, (void *)streamDeviceMetaData.buf, streamDeviceMetaData.size);
 freeMetaData:
+    txn.commit();
     free(streamDeviceMetaData.buf);
     free(deviceMetaData.buf);
 
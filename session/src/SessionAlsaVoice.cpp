@@ -151,7 +151,7 @@ struct mixer_ctl* SessionAlsaVoice::getFEMixerCtl(const char *controlName, int *
     }
 
     CntrlName << stream << " " << controlName;
-    ctl = mixer_get_ctl_by_name(mixer, CntrlName.str().data());
+    ctl = MixerCtlCache::getCtl(mixer, CntrlName.str().data());
     if (!ctl) {
         PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", CntrlName.str().data());
         return NULL;
@@ -674,7 +674,7 @@ int SessionAlsaVoice::populate_rx_mfc_payload(Stream *s, uint32_t rx_mfc_tag)
         PAL_ERR(LOG_TAG,"failed to get deviceData")
         goto exit;
     }
-    builder->payloadMFCConfig(&payload, &payloadSize, miid, &deviceData);
+    builder->payloadMFCConfig(&payload, &payloadSize, miid, &deviceData, &payloadArena);
     if (payload && payloadSize) {
         status = updateCustomPayload(payload, payloadSize);
         freeCustomPayload(&payload, &payloadSize);
@@ -1532,7 +1532,7 @@ int SessionAlsaVoice::payloadTaged(Stream * s, configType type, int tag,
                 goto exit;
             }
             tagCntrlName<<stream<<" "<<setParamTagControl;
-            ctl = mixer_get_ctl_by_name(mixer, tagCntrlName.str().data());
+            ctl = MixerCtlCache::getCtl(mixer, tagCntrlName.str().data());
             if (!ctl) {
                 PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", tagCntrlName.str().data());
                 if (tagConfig)
@@ -2065,7 +2065,7 @@ int SessionAlsaVoice::setVoiceMixerParameter(Stream * s, struct mixer *mixer,
     snprintf(mixer_str, ctl_len, "%s %s", stream, control);
 
     PAL_VERBOSE(LOG_TAG, "- mixer -%s-\n", mixer_str);
-    ctl = mixer_get_ctl_by_name(mixer, mixer_str);
+    ctl = MixerCtlCache::getCtl(mixer, mixer_str);
     if (!ctl) {
         PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", mixer_str);
         free(mixer_str);
@@ -0,0 +1,259 @@
+/*
+ * Copyright (c) 2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#define LOG_TAG "PAL: SessionPool"
+
+#include <errno.h>
+#include <string.h>
+#include <algorithm>
+#include <sstream>
+#include "SessionPool.h"
+#include "SessionAlsaUtils.h"
+#include "Session.h"
+#include "Stream.h"
+#include "Device.h"
+#include "ResourceManager.h"
+#include "PalCommon.h"
+
+std::atomic<uint32_t> SessionPool::ttlMs(0);
+std::mutex SessionPool::poolMutex;
+std::condition_variable SessionPool::poolCv;
+std::list<struct SessionPool::entry> SessionPool::entries;
+std::thread SessionPool::reaper;
+bool SessionPool::exitReaper = false;
+
+void SessionPool::setTtl(uint32_t ttl)
+{
+    PAL_INFO(LOG_TAG, "graph keep alive ttl %u ms", ttl);
+    ttlMs.store(ttl);
+    if (!ttl)
+        invalidate();
+}
+
+/*
+ * Everything the graph metadata of a stream is built from: stream type,
+ * flags and media config, the kv selectors and the configuration of every
+ * device. Fails for streams that are never parked.
+ */
+int SessionPool::getKey(Stream *s, std::string &key)
+{
+    struct pal_stream_attributes sAttr = {};
+    struct pal_device dAttr = {};
+    std::vector<std::shared_ptr<Device>> devices;
+    std::ostringstream k;
+
+    if (s->getStreamAttributes(&sAttr) || s->getAssociatedDevices(devices))
+        return -EINVAL;
+    if ((sAttr.type != PAL_STREAM_LOW_LATENCY && sAttr.type != PAL_STREAM_DEEP_BUFFER) ||
+        sAttr.direction != PAL_AUDIO_OUTPUT || SessionAlsaUtils::isMmapUsecase(sAttr) ||
+        devices.empty())
+        return -EINVAL;
+
+    k << sAttr.type << ":" << sAttr.flags << ":" << sAttr.out_media_config.sample_rate
+      << ":" << sAttr.out_media_config.bit_width << ":" << sAttr.out_media_config.aud_fmt_id
+      << ":" << sAttr.out_media_config.ch_info.channels;
+    for (int i = 0; i < sAttr.out_media_config.ch_info.channels && i < PAL_MAX_CHANNELS_SUPPORTED; i++)
+        k << "." << (int)sAttr.out_media_config.ch_info.ch_map[i];
+    k << ":" << s->getStreamSelector() << ":" << s->getDevicePPSelector();
+    for (auto &dev : devices) {
+        /* A2DP/BLE graphs depend on the encoder state, never keep them */
+        if (ResourceManager::isBtDevice((pal_device_id_t)dev->getSndDeviceId()))
+            return -EINVAL;
+        memset(&dAttr, 0, sizeof(dAttr));
+        dev->getDeviceAttributes(&dAttr, s);
+        k << ":" << dAttr.id << "/" << dAttr.config.sample_rate << "/"
+          << dAttr.config.bit_width << "/" << dAttr.config.aud_fmt_id << "/"
+          << dAttr.config.ch_info.channels << "/" << dAttr.custom_config.custom_key;
+    }
+    key = k.str();
+    return 0;
+}
+
+bool SessionPool::park(Stream *s, Session *session)
+{
+    struct entry e;
+    struct entry victim;
+    bool evict = false;
+    uint32_t ttl = ttlMs.load();
+
+    if (!ttl || !session || getKey(s, e.key))
+        return false;
+    if (session->park(s))
+        return false;
+
+    s->getStreamType(&e.type);
+    e.session = session;
+    /* the graph was built with this instance, it stays reserved until the graph closes */
+    e.instanceId = s->getInstanceId();
+    s->setInstanceId(0);
+    e.expiry = std::chrono::steady_clock::now() + std::chrono::milliseconds(ttl);
+
+    std::unique_lock<std::mutex> lock(poolMutex);
+    if (entries.size() >= SESSION_POOL_MAX_ENTRIES) {
+        victim = entries.front();
+        entries.pop_front();
+        evict = true;
+    }
+    entries.push_back(e);
+    if (!reaper.joinable())
+        reaper = std::thread(reaperLoop);
+    lock.unlock();
+    poolCv.notify_all();
+
+    PAL_INFO(LOG_TAG, "parked session %pK of stream %pK for %u ms", session, s, ttl);
+    if (evict)
+        closeEntry_l(victim);
+    return true;
+}
+
+Session *SessionPool::take(Stream *s)
+{
+    std::string key;
+    struct entry e;
+    bool found = false;
+    uint32_t instanceId = s->getInstanceId();
+    auto now = std::chrono::steady_clock::now();
+
+    if (!isEnabled() || getKey(s, key))
+        return nullptr;
+
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        for (auto it = entries.begin(); it != entries.end(); it++) {
+            if (it->expiry > now && it->key == key &&
+                (!instanceId || instanceId == it->instanceId)) {
+                e = *it;
+                entries.erase(it);
+                found = true;
+                break;
+            }
+        }
+    }
+    if (!found)
+        return nullptr;
+
+    if (e.instanceId)
+        s->setInstanceId(e.instanceId);
+    PAL_INFO(LOG_TAG, "stream %pK reattached parked session %pK", s, e.session);
+    return e.session;
+}
+
+void SessionPool::closeEntry_l(struct entry &e)
+{
+    std::shared_ptr<ResourceManager> rm = ResourceManager::getInstance();
+
+    PAL_DBG(LOG_TAG, "closing parked session %pK", e.session);
+    e.session->closeParked();
+    if (rm && e.instanceId)
+        rm->releaseStreamInstanceID(e.type, e.instanceId);
+    delete e.session;
+    e.session = nullptr;
+}
+
+int SessionPool::flush_l()
+{
+    std::list<struct entry> closing;
+    int count = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        closing.swap(entries);
+    }
+    for (auto &e : closing) {
+        closeEntry_l(e);
+        count++;
+    }
+    if (count)
+        PAL_INFO(LOG_TAG, "flushed %d parked sessions", count);
+    return count;
+}
+
+int SessionPool::flush()
+{
+    std::shared_ptr<ResourceManager> rm = ResourceManager::getInstance();
+    int count = 0;
+
+    if (!rm)
+        return 0;
+    rm->lockGraph();
+    count = flush_l();
+    rm->unlockGraph();
+    return count;
+}
+
+void SessionPool::invalidate()
+{
+    auto now = std::chrono::steady_clock::now();
+
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        if (entries.empty())
+            return;
+        for (auto &e : entries)
+            e.expiry = now;
+    }
+    poolCv.notify_all();
+}
+
+void SessionPool::reaperLoop()
+{
+    std::shared_ptr<ResourceManager> rm = nullptr;
+    std::vector<struct entry> expired;
+    std::chrono::steady_clock::time_point next, now;
+    std::unique_lock<std::mutex> lock(poolMutex);
+
+    PAL_DBG(LOG_TAG, "reaper started");
+    while (!exitReaper) {
+        if (entries.empty()) {
+            poolCv.wait(lock);
+        } else {
+            next = entries.front().expiry;
+            for (auto &e : entries)
+                next = std::min(next, e.expiry);
+            poolCv.wait_until(lock, next);
+        }
+        if (exitReaper)
+            break;
+
+        now = std::chrono::steady_clock::now();
+        for (auto it = entries.begin(); it != entries.end();) {
+            if (it->expiry <= now) {
+                expired.push_back(*it);
+                it = entries.erase(it);
+            } else {
+                it++;
+            }
+        }
+        if (expired.empty())
+            continue;
+
+        lock.unlock();
+        rm = ResourceManager::getInstance();
+        if (rm) {
+            rm->lockGraph();
+            for (auto &e : expired)
+                closeEntry_l(e);
+            rm->unlockGraph();
+        }
+        PAL_DBG(LOG_TAG, "closed %zu expired sessions", expired.size());
+        expired.clear();
+        lock.lock();
+    }
+    PAL_DBG(LOG_TAG, "reaper exited");
+}
+
+void SessionPool::deinit()
+{
+    flush();
+
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        exitReaper = true;
+    }
+    poolCv.notify_all();
+    if (reaper.joinable())
+        reaper.join();
+    exitReaper = false;
+}
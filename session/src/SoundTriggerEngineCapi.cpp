@@ -46,6 +46,8 @@
 #include "Stream.h"
 #include "SoundTriggerPlatformInfo.h"
 #include "VoiceUIInterface.h"
+#include "PalDumpWriter.h"
+#include "SecondStageExecutor.h"
 
 #define CNN_BUFFER_LENGTH 10000
 #define CNN_FRAME_SIZE 320
@@ -53,94 +55,97 @@
 ST_DBG_DECLARE(static int keyword_detection_cnt = 0);
 ST_DBG_DECLARE(static int user_verification_cnt = 0);
 
-void SoundTriggerEngineCapi::BufferThreadLoop(
-    SoundTriggerEngineCapi *capi_engine)
+/*
+ * Runs on a SecondStageExecutor worker, one job per first stage detection.
+ * event_mutex_ is held while the data is processed like the dedicated
+ * buffer thread used to, so stop/restart wait for the job to leave the
+ * ring buffer before resetting the reader.
+ */
+void SoundTriggerEngineCapi::ProcessDetection()
 {
     StreamSoundTrigger *s = nullptr;
     int32_t status = 0;
     int32_t detection_state = ENGINE_IDLE;
 
     PAL_DBG(LOG_TAG, "Enter");
-    if (!capi_engine) {
-        PAL_ERR(LOG_TAG, "Invalid sound trigger capi engine");
-        return;
-    }
-
-    std::unique_lock<std::mutex> lck(capi_engine->event_mutex_);
-    while (!capi_engine->exit_thread_) {
-        PAL_VERBOSE(LOG_TAG, "waiting on cond, processing started  = %d",
-                    capi_engine->processing_started_);
-        // Wait for keyword buffer data from DSP
-        if (!capi_engine->processing_started_)
-            capi_engine->cv_.wait(lck);
-        PAL_VERBOSE(LOG_TAG, "done waiting on cond, exit buffering = %d",
-                    capi_engine->exit_buffering_);
-
-        if (capi_engine->exit_thread_) {
-            break;
-        }
-
-        /*
-         * If 1st stage buffering overflows before 2nd stage starts processing,
-         * the below functions need to be called to reset the 1st stage session
-         * for the next detection. We might be able to check states of the engine
-         * to avoid this buffering flag.
-         */
-        if (capi_engine->exit_buffering_) {
-            continue;  // skip over processing if we want to exit already
-        }
+    std::unique_lock<std::mutex> lck(event_mutex_);
+    PAL_VERBOSE(LOG_TAG, "processing started = %d, exit buffering = %d",
+                processing_started_, exit_buffering_);
 
-        if (capi_engine->processing_started_) {
-            s = dynamic_cast<StreamSoundTrigger *>(capi_engine->stream_handle_);
-            if (capi_engine->detection_type_ ==
-                ST_SM_TYPE_KEYWORD_DETECTION) {
-                status = capi_engine->StartKeywordDetection();
-                /*
-                 * StreamSoundTrigger may call stop recognition to second stage
-                 * engines when one of the second stage engine reject detection.
-                 * So check processing_started_ before notify stream in case
-                 * stream has already stopped recognition.
-                 */
-                if (capi_engine->processing_started_) {
-                    if (status)
-                        detection_state = KEYWORD_DETECTION_REJECT;
-                    else
-                        detection_state = capi_engine->detection_state_;
-                    lck.unlock();
-                    s->SetEngineDetectionState(detection_state);
-                    lck.lock();
-                }
-            } else if (capi_engine->detection_type_ ==
-                ST_SM_TYPE_USER_VERIFICATION) {
-                status = capi_engine->StartUserVerification();
-                /*
-                 * StreamSoundTrigger may call stop recognition to second stage
-                 * engines when one of the second stage engine reject detection.
-                 * So check processing_started_ before notify stream in case
-                 * stream has already stopped recognition.
-                 */
-                if (capi_engine->processing_started_) {
-                    if (status)
-                        detection_state = USER_VERIFICATION_REJECT;
-                    else
-                        detection_state = capi_engine->detection_state_;
-                    lck.unlock();
-                    s->SetEngineDetectionState(detection_state);
-                    lck.lock();
-                }
+    /*
+     * If 1st stage buffering overflows before 2nd stage starts processing,
+     * the below functions need to be called to reset the 1st stage session
+     * for the next detection. We might be able to check states of the engine
+     * to avoid this buffering flag.
+     */
+    if (processing_started_ && !exit_buffering_) {
+        s = dynamic_cast<StreamSoundTrigger *>(stream_handle_);
+        if (detection_type_ == ST_SM_TYPE_KEYWORD_DETECTION) {
+            status = StartKeywordDetection();
+            /*
+             * StreamSoundTrigger may call stop recognition to second stage
+             * engines when one of the second stage engine reject detection.
+             * So check processing_started_ before notify stream in case
+             * stream has already stopped recognition.
+             */
+            if (processing_started_) {
+                if (status)
+                    detection_state = KEYWORD_DETECTION_REJECT;
+                else
+                    detection_state = detection_state_;
+                lck.unlock();
+                s->SetEngineDetectionState(detection_state);
+                lck.lock();
+            }
+        } else if (detection_type_ == ST_SM_TYPE_USER_VERIFICATION) {
+            status = StartUserVerification();
+            /*
+             * StreamSoundTrigger may call stop recognition to second stage
+             * engines when one of the second stage engine reject detection.
+             * So check processing_started_ before notify stream in case
+             * stream has already stopped recognition.
+             */
+            if (processing_started_) {
+                if (status)
+                    detection_state = USER_VERIFICATION_REJECT;
+                else
+                    detection_state = detection_state_;
+                lck.unlock();
+                s->SetEngineDetectionState(detection_state);
+                lck.lock();
             }
-            capi_engine->detection_state_ = ENGINE_IDLE;
-            capi_engine->keyword_detected_ = false;
-            capi_engine->processing_started_ = false;
         }
     }
+    detection_state_ = ENGINE_IDLE;
+    keyword_detected_ = false;
+    processing_started_ = false;
+    job_pending_ = false;
+    cv_.notify_all();
     PAL_DBG(LOG_TAG, "Exit");
 }
 
+/* drop a detection job that did not start yet, or wait for the running one */
+void SoundTriggerEngineCapi::DrainDetectionJob()
+{
+    std::unique_lock<std::mutex> lck(event_mutex_);
+
+    processing_started_ = false;
+    exit_buffering_ = true;
+    if (job_pending_ && SecondStageExecutor::cancel(this))
+        job_pending_ = false;
+    if (job_pending_) {
+        if (reader_)
+            reader_->cancelWait();
+        cv_.wait(lck, [this] { return !job_pending_; });
+        PAL_DBG(LOG_TAG, "detection job finished");
+    }
+}
+
 int32_t SoundTriggerEngineCapi::StartKeywordDetection()
 {
     int32_t status = 0;
     char *process_input_buff = nullptr;
+    void *process_data = nullptr;
     capi_v2_err_t rc = CAPI_V2_EOK;
     capi_v2_stream_data_t *stream_input = nullptr;
     sva_result_t *result_cfg_ptr = nullptr;
@@ -149,7 +154,7 @@ int32_t SoundTriggerEngineCapi::StartKeywordDetection()
     bool buffer_advanced = false;
     size_t lab_buffer_size = 0;
     bool first_buffer_processed = false;
-    FILE *keyword_detection_fd = nullptr;
+    int keyword_detection_fd = -1;
     ChronoSteadyClock_t process_start;
     ChronoSteadyClock_t process_end;
     ChronoSteadyClock_t capi_call_start;
@@ -201,7 +206,7 @@ int32_t SoundTriggerEngineCapi::StartKeywordDetection()
     buffer_size_ = ftrt_sz;
 
     if (vui_ptfm_info_->GetEnableDebugDumps()) {
-        ST_DBG_FILE_OPEN_WR(keyword_detection_fd, ST_DEBUG_DUMP_LOCATION,
+        keyword_detection_fd = PalDumpWriter::open(ST_DEBUG_DUMP_LOCATION,
             "keyword_detection", "bin", keyword_detection_cnt);
         PAL_DBG(LOG_TAG, "keyword detection data stored in: keyword_detection_%d.bin",
             keyword_detection_cnt);
@@ -261,7 +266,12 @@ int32_t SoundTriggerEngineCapi::StartKeywordDetection()
         if (!reader_->waitForBuffers(buffer_size_))
             continue;
 
-        read_size = reader_->read((void*)process_input_buff, buffer_size_);
+        /*
+         * Process keyword data in place, it is only copied to
+         * process_input_buff when it wraps around the ring buffer end.
+         */
+        read_size = reader_->peekContiguous(&process_data, buffer_size_,
+            (void *)process_input_buff);
         if (read_size == 0) {
             continue;
         } else if (read_size < 0) {
@@ -273,11 +283,11 @@ int32_t SoundTriggerEngineCapi::StartKeywordDetection()
         stream_input->bufs_num = 1;
         stream_input->buf_ptr->max_data_len = buffer_size_;
         stream_input->buf_ptr->actual_data_len = read_size;
-        stream_input->buf_ptr->data_ptr = (int8_t *)process_input_buff;
+        stream_input->buf_ptr->data_ptr = (int8_t *)process_data;
 
         if (vui_ptfm_info_->GetEnableDebugDumps()) {
-            ST_DBG_FILE_WRITE(keyword_detection_fd,
-                process_input_buff, read_size);
+            PalDumpWriter::write(keyword_detection_fd,
+                process_data, read_size);
         }
 
         PAL_VERBOSE(LOG_TAG, "Calling Capi Process");
@@ -300,6 +310,7 @@ int32_t SoundTriggerEngineCapi::StartKeywordDetection()
             goto exit;
         }
 
+        reader_->commit(read_size);
         processed_sz += read_size;
 
         capi_result.data_ptr = (int8_t*)result_cfg_ptr;
@@ -371,7 +382,7 @@ exit:
         (long long)total_capi_process_duration,
         (long long)total_capi_get_param_duration);
     if (vui_ptfm_info_->GetEnableDebugDumps()) {
-        ST_DBG_FILE_CLOSE(keyword_detection_fd);
+        PalDumpWriter::close(keyword_detection_fd);
     }
 
     if (reader_)
@@ -396,6 +407,7 @@ int32_t SoundTriggerEngineCapi::StartUserVerification()
 {
     int32_t status = 0;
     char *process_input_buff = nullptr;
+    void *process_data = nullptr;
     capi_v2_err_t rc = CAPI_V2_EOK;
     capi_v2_stream_data_t *stream_input = nullptr;
     capi_v2_buf_t capi_uv_ptr;
@@ -405,7 +417,7 @@ int32_t SoundTriggerEngineCapi::StartUserVerification()
     capi_v2_buf_t capi_result;
     bool buffer_advanced = false;
     StreamSoundTrigger *str = nullptr;
-    FILE *user_verification_fd = nullptr;
+    int user_verification_fd = -1;
     ChronoSteadyClock_t process_start;
     ChronoSteadyClock_t process_end;
     ChronoSteadyClock_t capi_call_start;
@@ -447,7 +459,7 @@ int32_t SoundTriggerEngineCapi::StartUserVerification()
     }
     PAL_INFO(LOG_TAG, "processing size %u", max_processing_sz);
     if (vui_ptfm_info_->GetEnableDebugDumps()) {
-        ST_DBG_FILE_OPEN_WR(user_verification_fd, ST_DEBUG_DUMP_LOCATION,
+        user_verification_fd = PalDumpWriter::open(ST_DEBUG_DUMP_LOCATION,
             "user_verification", "bin", user_verification_cnt);
         PAL_DBG(LOG_TAG, "User Verification data stored in: user_verification_%d.bin",
             user_verification_cnt);
@@ -546,7 +558,8 @@ int32_t SoundTriggerEngineCapi::StartUserVerification()
         if (!reader_->waitForBuffers(max_processing_sz))
             continue;
 
-        read_size = reader_->read((void*)process_input_buff, max_processing_sz);
+        read_size = reader_->peekContiguous(&process_data, max_processing_sz,
+            (void *)process_input_buff);
         if (read_size == 0) {
             continue;
         } else if (read_size < 0) {
@@ -557,11 +570,11 @@ int32_t SoundTriggerEngineCapi::StartUserVerification()
         stream_input->bufs_num = 1;
         stream_input->buf_ptr->max_data_len = max_processing_sz;
         stream_input->buf_ptr->actual_data_len = read_size;
-        stream_input->buf_ptr->data_ptr = (int8_t *)process_input_buff;
+        stream_input->buf_ptr->data_ptr = (int8_t *)process_data;
 
         if (vui_ptfm_info_->GetEnableDebugDumps()) {
-            ST_DBG_FILE_WRITE(user_verification_fd,
-                process_input_buff, read_size);
+            PalDumpWriter::write(user_verification_fd,
+                process_data, read_size);
         }
 
         PAL_VERBOSE(LOG_TAG, "Calling Capi Process\n");
@@ -584,6 +597,7 @@ int32_t SoundTriggerEngineCapi::StartUserVerification()
             goto exit;
         }
 
+        reader_->commit(read_size);
         processed_sz += read_size;
 
         capi_result.data_ptr = (int8_t*)result_cfg_ptr;
@@ -641,7 +655,7 @@ exit:
         (long long)total_capi_process_duration,
         (long long)total_capi_get_param_duration);
     if (vui_ptfm_info_->GetEnableDebugDumps()) {
-        ST_DBG_FILE_CLOSE(user_verification_fd);
+        PalDumpWriter::close(user_verification_fd);
     }
 
     /* Reinit the UV module */
@@ -688,8 +702,9 @@ SoundTriggerEngineCapi::SoundTriggerEngineCapi(
     sm_cfg_ = sm_cfg;
     vui_intf_ = nullptr;
     processing_started_ = false;
+    job_pending_ = false;
+    executor_attached_ = false;
     sm_data_ = nullptr;
-    exit_thread_ = false;
     exit_buffering_ = false;
     reader_ = nullptr;
     buffer_ = nullptr;
@@ -785,18 +800,13 @@ SoundTriggerEngineCapi::~SoundTriggerEngineCapi()
 {
     PAL_DBG(LOG_TAG, "Enter");
     /*
-     * join thread if it is not joined, sometimes
+     * detach from the executor if still attached, sometimes
      * stop/unload may fail before deconstruction.
      */
-    if (buffer_thread_handler_.joinable()) {
-        processing_started_ = false;
-        std::unique_lock<std::mutex> lck(event_mutex_);
-        exit_thread_ = true;
-        exit_buffering_ = true;
-        cv_.notify_one();
-        lck.unlock();
-        buffer_thread_handler_.join();
-        PAL_INFO(LOG_TAG, "Thread joined");
+    if (executor_attached_) {
+        DrainDetectionJob();
+        SecondStageExecutor::detach();
+        executor_attached_ = false;
     }
     if (buffer_) {
         delete buffer_;
@@ -821,7 +831,6 @@ int32_t SoundTriggerEngineCapi::StartSoundEngine()
 {
     int32_t status = 0;
     processing_started_ = false;
-    exit_thread_ = false;
     exit_buffering_ = false;
     capi_v2_err_t rc = CAPI_V2_EOK;
     capi_v2_buf_t capi_buf;
@@ -909,17 +918,10 @@ int32_t SoundTriggerEngineCapi::StopSoundEngine()
     int32_t status = 0;
 
     PAL_DBG(LOG_TAG, "Enter");
-    {
-        processing_started_ = false;
-        std::lock_guard<std::mutex> lck(event_mutex_);
-        exit_thread_ = true;
-        exit_buffering_ = true;
-
-        cv_.notify_one();
-    }
-    if (buffer_thread_handler_.joinable()) {
-        PAL_DBG(LOG_TAG, "Thread joined");
-        buffer_thread_handler_.join();
+    DrainDetectionJob();
+    if (executor_attached_) {
+        SecondStageExecutor::detach();
+        executor_attached_ = false;
     }
     PAL_DBG(LOG_TAG, "Exit, status %d", status);
 
@@ -1004,13 +1006,9 @@ int32_t SoundTriggerEngineCapi::LoadSoundModel(Stream *s __unused,
         goto exit;
     }
 
-    buffer_thread_handler_ =
-        std::thread(SoundTriggerEngineCapi::BufferThreadLoop, this);
-
-    if (!buffer_thread_handler_.joinable()) {
-        status = -EINVAL;
-        PAL_ERR(LOG_TAG, "failed to create buffer thread = %d", status);
-        goto exit;
+    if (!executor_attached_) {
+        SecondStageExecutor::attach();
+        executor_attached_ = true;
     }
 
     if (detection_type_ == ST_SM_TYPE_USER_VERIFICATION) {
@@ -1150,8 +1148,11 @@ int32_t SoundTriggerEngineCapi::RestartRecognition(Stream *s __unused)
     PAL_DBG(LOG_TAG, "Enter");
     std::lock_guard<std::mutex> lck(mutex_);
     processing_started_ = false;
+    exit_buffering_ = true;
+    /* a job blocked on the ring buffer sees exit_buffering_ right away */
+    if (reader_)
+        reader_->cancelWait();
     {
-        exit_buffering_ = true;
         std::lock_guard<std::mutex> event_lck(event_mutex_);
     }
     if (reader_) {
@@ -1174,8 +1175,11 @@ int32_t SoundTriggerEngineCapi::StopRecognition(Stream *s __unused)
     PAL_DBG(LOG_TAG, "Enter");
     std::lock_guard<std::mutex> lck(mutex_);
     processing_started_ = false;
+    exit_buffering_ = true;
+    /* a job blocked on the ring buffer sees exit_buffering_ right away */
+    if (reader_)
+        reader_->cancelWait();
     {
-        exit_buffering_ = true;
         std::lock_guard<std::mutex> event_lck(event_mutex_);
     }
     if (reader_) {
@@ -1201,7 +1205,15 @@ void SoundTriggerEngineCapi::SetDetected(bool detected)
         processing_started_ = detected;
         exit_buffering_ = !processing_started_;
         PAL_INFO(LOG_TAG, "setting processing started %d", detected);
-        cv_.notify_one();
+        if (detected && !job_pending_) {
+            if (SecondStageExecutor::submit(this, [this] { ProcessDetection(); })) {
+                PAL_ERR(LOG_TAG, "failed to queue detection job");
+                processing_started_ = false;
+                exit_buffering_ = true;
+            } else {
+                job_pending_ = true;
+            }
+        }
     } else {
         PAL_VERBOSE(LOG_TAG, "processing started unchanged");
     }
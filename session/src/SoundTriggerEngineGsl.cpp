@@ -46,6 +46,7 @@
 #include "ResourceManager.h"
 #include "SoundTriggerPlatformInfo.h"
 #include "VoiceUIInterface.h"
+#include "PalDumpWriter.h"
 #include "sh_mem_pull_push_mode_api.h"
 // TODO: find another way to print debug logs by default
 #define ST_DBG_LOGS
@@ -55,6 +56,8 @@
 
 #define TIMEOUT_FOR_EOS 100000
 #define MAX_MMAP_POSITION_QUERY_RETRY_CNT 5
+#define LAB_POLL_MIN_MS 1
+#define LAB_LATENCY_HISTORY 16
 
 ST_DBG_DECLARE(static int dsp_output_cnt = 0);
 
@@ -156,21 +159,29 @@ int32_t SoundTriggerEngineGsl::StartBuffering(Stream *s) {
     size_t read_offset = 0;
     size_t bytes_written = 0;
     uint32_t sleep_ms = 0;
+    uint32_t period_ms = 0;
+    uint32_t poll_ms = LAB_POLL_MIN_MS;
+    uint32_t stall_ms = 0;
     bool event_notified = false;
+    bool first_byte_read = false;
     StreamSoundTrigger *st = (StreamSoundTrigger *)s;
     struct pal_mmap_position mmap_pos;
-    FILE *dsp_output_fd = nullptr;
+    int dsp_output_fd = -1;
     ChronoSteadyClock_t kw_transfer_begin;
     ChronoSteadyClock_t kw_transfer_end;
+    ChronoSteadyClock_t kw_first_byte;
     vui_intf_param_t param {};
     struct buffer_config buf_config;
-    size_t retry_cnt = 0;
 
     PAL_DBG(LOG_TAG, "Enter");
     UpdateState(ENG_BUFFERING);
     s->getBufInfo(&input_buf_size, &input_buf_num, nullptr, nullptr);
     sleep_ms = (input_buf_size * input_buf_num) *
         BITS_PER_BYTE * MS_PER_SEC / (sample_rate_ * bit_width_ * channels_);
+    period_ms = input_buf_size *
+        BITS_PER_BYTE * MS_PER_SEC / (sample_rate_ * bit_width_ * channels_);
+    if (period_ms < LAB_POLL_MIN_MS)
+        period_ms = LAB_POLL_MIN_MS;
 
     std::memset(&buf, 0, sizeof(struct pal_buffer));
     buf.size = input_buf_size * input_buf_num;
@@ -193,7 +204,7 @@ int32_t SoundTriggerEngineGsl::StartBuffering(Stream *s) {
     }
 
     if (vui_ptfm_info_->GetEnableDebugDumps()) {
-        ST_DBG_FILE_OPEN_WR(dsp_output_fd, ST_DEBUG_DUMP_LOCATION,
+        dsp_output_fd = PalDumpWriter::open(ST_DEBUG_DUMP_LOCATION,
             "dsp_output", "bin", dsp_output_cnt);
         PAL_DBG(LOG_TAG, "DSP output data stored in: dsp_output_%d.bin",
             dsp_output_cnt);
@@ -228,6 +239,7 @@ int32_t SoundTriggerEngineGsl::StartBuffering(Stream *s) {
             det_streams_q_.pop();
             buffer_->getIndices(s, &start_index, &end_index, &ftrt_size);
             event_notified = false;
+            first_byte_read = false;
             PAL_DBG(LOG_TAG, "new detected stream added, size %d", det_streams_q_.size());
             kw_transfer_begin = std::chrono::steady_clock::now();
         }
@@ -264,16 +276,20 @@ int32_t SoundTriggerEngineGsl::StartBuffering(Stream *s) {
                 }
                 if (bytes_written > total_read_size) {
                     size_to_read = bytes_written - total_read_size;
-                    retry_cnt = 0;
+                    stall_ms = 0;
+                    poll_ms = LAB_POLL_MIN_MS;
                 } else {
-                    retry_cnt++;
-                    if (retry_cnt > MAX_MMAP_POSITION_QUERY_RETRY_CNT) {
+                    /*
+                     * FTRT data lands in bursts, so poll finely and back off
+                     * to one period while the position does not move.
+                     */
+                    if (stall_ms > MAX_MMAP_POSITION_QUERY_RETRY_CNT * sleep_ms) {
                         status = -EIO;
                         goto exit;
                     }
-                    mutex_.unlock();
-                    std::this_thread::sleep_for(std::chrono::milliseconds(sleep_ms));
-                    mutex_.lock();
+                    WaitForLabData_l(poll_ms);
+                    stall_ms += poll_ms;
+                    poll_ms = std::min(poll_ms * 2, period_ms);
                     continue;
                 }
                 if (size_to_read > (2 * mmap_buffer_size_) - read_offset) {
@@ -338,6 +354,10 @@ int32_t SoundTriggerEngineGsl::StartBuffering(Stream *s) {
 #endif
         // write data to ring buffer
         if (size) {
+            if (!first_byte_read) {
+                kw_first_byte = std::chrono::steady_clock::now();
+                first_byte_read = true;
+            }
             if (total_read_size < ftrt_size) {
                 param.data = buf.buffer;
                 param.size = size;
@@ -351,7 +371,7 @@ int32_t SoundTriggerEngineGsl::StartBuffering(Stream *s) {
                     ret = buffer_->write((void*)(buf.buffer + bytes_to_drop),
                         size - bytes_to_drop);
                     if (vui_ptfm_info_->GetEnableDebugDumps()) {
-                        ST_DBG_FILE_WRITE(dsp_output_fd,
+                        PalDumpWriter::write(dsp_output_fd,
                             buf.buffer + bytes_to_drop, size - bytes_to_drop);
                     }
                     bytes_to_drop = 0;
@@ -359,7 +379,7 @@ int32_t SoundTriggerEngineGsl::StartBuffering(Stream *s) {
             } else {
                 ret = buffer_->write(buf.buffer, size);
                 if (vui_ptfm_info_->GetEnableDebugDumps()) {
-                    ST_DBG_FILE_WRITE(dsp_output_fd, buf.buffer, size);
+                    PalDumpWriter::write(dsp_output_fd, buf.buffer, size);
                 }
             }
             PAL_VERBOSE(LOG_TAG, "%zu written to ring buffer", ret);
@@ -376,6 +396,8 @@ int32_t SoundTriggerEngineGsl::StartBuffering(Stream *s) {
                     kw_transfer_end - kw_transfer_begin).count();
                 PAL_INFO(LOG_TAG, "FTRT data read done! total_read_size %zu, ftrt_size %zu, read latency %llums",
                         total_read_size, ftrt_size, (long long)kw_transfer_latency_);
+                UpdateLabTransferStats(s, ftrt_size,
+                    first_byte_read ? kw_first_byte : kw_transfer_begin, kw_transfer_end);
                 st = dynamic_cast<StreamSoundTrigger *>(s);
                 if (st) {
                     mutex_.unlock();
@@ -394,10 +416,12 @@ int32_t SoundTriggerEngineGsl::StartBuffering(Stream *s) {
                 }
                 event_notified = true;
             }
-            // From now on, capture the real time data.
-            mutex_.unlock();
-            std::this_thread::sleep_for(std::chrono::milliseconds(sleep_ms));
-            mutex_.lock();
+            /*
+             * From now on, capture the real time data. Shared buffer reads
+             * are plain copies and can follow the DSP period by period,
+             * pcm reads block for the whole buffer so keep their pace.
+             */
+            WaitForLabData_l(mmap_buffer_size_ ? period_ms : sleep_ms);
         }
     }
 
@@ -429,12 +453,59 @@ exit:
         free(buf.ts);
     }
     if (vui_ptfm_info_->GetEnableDebugDumps()) {
-        ST_DBG_FILE_CLOSE(dsp_output_fd);
+        PalDumpWriter::close(dsp_output_fd);
     }
     PAL_DBG(LOG_TAG, "Exit, status %d", status);
     return status;
 }
 
+/*
+ * Called from the buffering loop with mutex_ held, which is released while
+ * waiting. Returns after wait_ms or as soon as a new detection is queued or
+ * buffering is asked to stop. Notifiers hold mutex_, so a wake up cannot
+ * land between the loop checking exit_buffering_ and starting to wait.
+ */
+void SoundTriggerEngineGsl::WaitForLabData_l(uint32_t wait_ms) {
+    lab_cv_.wait_for(mutex_, std::chrono::milliseconds(wait_ms));
+}
+
+void SoundTriggerEngineGsl::UpdateLabTransferStats(Stream *s, size_t ftrt_size,
+    ChronoSteadyClock_t first_byte, ChronoSteadyClock_t end) {
+    uint64_t first_byte_ms = 0;
+    uint64_t transfer_us = 0;
+    uint64_t audio_us = 0;
+    uint64_t kbps = 0;
+    uint64_t rt_factor = 0;
+    std::vector<uint64_t> sorted;
+
+    auto det = detection_time_map_.find(s);
+    if (det != detection_time_map_.end() && first_byte > det->second)
+        first_byte_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            first_byte - det->second).count();
+    transfer_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        end - first_byte).count();
+    audio_us = (uint64_t)ftrt_size * BITS_PER_BYTE * MS_PER_SEC * 1000 /
+        (sample_rate_ * bit_width_ * channels_);
+    if (transfer_us) {
+        kbps = (uint64_t)ftrt_size * 1000 / transfer_us;
+        rt_factor = audio_us * 10 / transfer_us;
+    }
+
+    kw_latency_history_.push_back(kw_transfer_latency_);
+    if (kw_latency_history_.size() > LAB_LATENCY_HISTORY)
+        kw_latency_history_.pop_front();
+    sorted.assign(kw_latency_history_.begin(), kw_latency_history_.end());
+    std::sort(sorted.begin(), sorted.end());
+
+    PAL_INFO(LOG_TAG, "lab transfer: first byte %llums after detection, %zu bytes in %lluus "
+        "(%llu KB/s, %llu.%llux real time), latency p90 %llums max %llums over %zu detections",
+        (unsigned long long)first_byte_ms, ftrt_size, (unsigned long long)transfer_us,
+        (unsigned long long)kbps, (unsigned long long)rt_factor / 10,
+        (unsigned long long)rt_factor % 10,
+        (unsigned long long)sorted[sorted.size() * 9 / 10],
+        (unsigned long long)sorted.back(), sorted.size());
+}
+
 SoundTriggerEngineGsl::SoundTriggerEngineGsl(
     Stream *s,
     listen_model_indicator_enum type,
@@ -548,6 +619,7 @@ SoundTriggerEngineGsl::~SoundTriggerEngineGsl() {
     {
         exit_buffering_ = true;
         std::unique_lock<std::mutex> lck(mutex_);
+        lab_cv_.notify_all();
         exit_thread_ = true;
         cv_.notify_one();
     }
@@ -749,6 +821,7 @@ int32_t SoundTriggerEngineGsl::LoadSoundModel(Stream *s, uint8_t *data,
 
     exit_buffering_ = true;
     std::unique_lock<std::mutex> lck(mutex_);
+    lab_cv_.notify_all();
     /* Check whether any stream is already attached to this engine */
     if (CheckIfOtherStreamsAttached(s)) {
         status = HandleMultiStreamLoad(s, data, data_size);
@@ -801,6 +874,7 @@ int32_t SoundTriggerEngineGsl::UnloadSoundModel(Stream *s) {
 
     exit_buffering_ = true;
     std::unique_lock<std::mutex> lck(mutex_);
+    lab_cv_.notify_all();
 
     /* Check whether any stream is already attached to this engine */
     if (CheckIfOtherStreamsAttached(s)) {
@@ -871,6 +945,12 @@ int32_t SoundTriggerEngineGsl::CreateBuffer(uint32_t buffer_size,
     }
 
     if (engine_size != reader_list.size()) {
+        /*
+         * The ring buffer has a fixed number of reader slots, give back the
+         * ones held by the old list. The readers themselves stay owned by
+         * the stream and engines they were handed to.
+         */
+        ResetBufferReaders(reader_list);
         reader_list.clear();
         for (i = 0; i < engine_size; i++) {
             reader = buffer_->newReader();
@@ -994,8 +1074,8 @@ int32_t SoundTriggerEngineGsl::StartRecognition(Stream *s) {
     PAL_DBG(LOG_TAG, "Enter");
 
     exit_buffering_ = true;
-
     std::unique_lock<std::mutex> lck(mutex_);
+    lab_cv_.notify_all();
 
     // We should start Recognition only during the last stream.
     if (dev_disconnect_count_) {
@@ -1066,6 +1146,7 @@ int32_t SoundTriggerEngineGsl::RestartRecognition_l(Stream *s) {
         return status;
     }
     exit_buffering_ = true;
+    lab_cv_.notify_all();
     if (buffer_) {
         buffer_->reset();
     }
@@ -1116,6 +1197,7 @@ int32_t SoundTriggerEngineGsl::ReconfigureDetectionGraph(Stream *s) {
 
     exit_buffering_ = true;
     std::unique_lock<std::mutex> lck(mutex_);
+    lab_cv_.notify_all();
     DetachStream(s, false);
 
     /*
@@ -1193,6 +1275,7 @@ int32_t SoundTriggerEngineGsl::StopRecognition(Stream *s) {
 
     exit_buffering_ = true;
     std::lock_guard<std::mutex> lck(mutex_);
+    lab_cv_.notify_all();
 
     param.stream = (void *)s;
     param.data = (void *)&state;
@@ -1488,6 +1571,7 @@ void SoundTriggerEngineGsl::HandleSessionEvent(uint32_t event_id __unused,
         cv_.notify_one();
     } else {
         det_streams_q_.push(s);
+        lab_cv_.notify_all();
 
         param.stream = (void *)s;
         param.data = (void *)&kw2_stats;
@@ -1543,12 +1627,12 @@ void SoundTriggerEngineGsl::HandleSessionEvent(uint32_t event_id __unused,
     }
 
     if (vui_ptfm_info_->GetEnableDebugDumps()) {
-        ST_DBG_DECLARE(FILE *det_event_fd = NULL;
+        ST_DBG_DECLARE(int det_event_fd = -1;
             static int det_event_cnt = 0);
-        ST_DBG_FILE_OPEN_WR(det_event_fd, ST_DEBUG_DUMP_LOCATION,
+        det_event_fd = PalDumpWriter::open(ST_DEBUG_DUMP_LOCATION,
             "det_event", "bin", det_event_cnt);
-        ST_DBG_FILE_WRITE(det_event_fd, data, size);
-        ST_DBG_FILE_CLOSE(det_event_fd);
+        PalDumpWriter::write(det_event_fd, data, size);
+        PalDumpWriter::close(det_event_fd);
         PAL_DBG(LOG_TAG, "detection event stored in: det_event_%d.bin",
             det_event_cnt);
         det_event_cnt++;
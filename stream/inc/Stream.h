@@ -72,6 +72,8 @@
 #include <math.h>
 #include <memory>
 #include <mutex>
+#include <atomic>
+#include <chrono>
 #include <exception>
 #include <semaphore.h>
 #include <errno.h>
@@ -171,6 +173,7 @@ typedef enum {
  */
 #define MUTE_RAMP_PERIOD (40*1000)
 #define DEFAULT_RAMP_PERIOD 0x28 //40ms
+#define MUTE_DRAIN_RINGS 2
 
 class Device;
 class ResourceManager;
@@ -181,6 +184,14 @@ class Stream
 protected:
     uint32_t mNoOfDevices;
     std::vector <std::shared_ptr<Device>> mDevices;  // current running devices
+    /*
+     * parallel device switch: other streams' workers look up the running
+     * devices of this stream while its own worker connects or disconnects
+     * them. Held around changes to mDevices in the switch path and by
+     * isDeviceAssociated/getAssociatedDevices, nothing else is called
+     * with it held.
+     */
+    std::mutex mDevicesMutex;
     std::vector <std::shared_ptr<Device>> mPalDevices; // pal devices set from client, which may differ from mDevices
     Session* session;
     struct pal_stream_attributes* mStreamAttr;
@@ -188,6 +199,33 @@ protected:
     int mOrientation = 0;
     std::mutex mStreamMutex;
     std::mutex mGetParamMutex;
+    /*
+     * read/write fast path: while ioOpen is set the I/O only holds mIoMutex
+     * around the blocking session call, so set_param, volume and device
+     * switch are not held off for a buffer period. Whatever leaves the
+     * started state calls closeIo() under mStreamMutex, which waits for a
+     * read or write in flight.
+     */
+    std::mutex mIoMutex;
+    std::atomic<bool> ioOpen{false};
+    void openIo() { ioOpen = true; }
+    void closeIo();
+    /*
+     * mute drain: the pcm queued before a mute has been consumed once
+     * MUTE_DRAIN_RINGS full rings of buffers were written after it, which
+     * matches the 2x latency the switch used to sleep. Every write path
+     * reports completed writes through writeDone(), which wakes
+     * waitMuteDrain(). A started stream that never reported a write cannot
+     * be tracked and waits out the whole latency based deadline.
+     */
+    std::mutex mDrainMutex;
+    std::condition_variable mDrainCv;
+    std::atomic<uint64_t> writeCount{0};
+    std::atomic<int64_t> lastWriteNs{0};
+    std::atomic<uint32_t> drainWaiters{0};
+    uint64_t drainTarget = 0;
+    bool drainUntracked = false;
+    void writeDone();
     static std::mutex mBaseStreamMutex; //TBD change this. as having a single static mutex for all instances of Stream is incorrect. Replace
     static std::shared_ptr<ResourceManager> rm;
     struct modifier_kv *mModifiers;
@@ -269,6 +307,12 @@ public:
     uint32_t getRenderLatency();
     uint32_t getLatency();
     int32_t getAssociatedDevices(std::vector <std::shared_ptr<Device>> &adevices);
+    /* d is one of the running devices, or any device runs if d is null */
+    bool isDeviceAssociated(const std::shared_ptr<Device> &d);
+    /* called with mStreamMutex held right after the stream was muted */
+    void markMuteDrain();
+    /* false if the queued pcm was not consumed by the deadline */
+    bool waitMuteDrain(std::chrono::steady_clock::time_point deadline);
     int32_t getPalDevices(std::vector <std::shared_ptr<Device>> &PalDevices);
     void removePalDevice(Stream *streamHandle, int palDevId);
     void clearOutPalDevices(Stream *streamHandle);
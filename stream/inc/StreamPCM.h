@@ -76,6 +76,10 @@ public:
    static int32_t isSampleRateSupported(uint32_t sampleRate);
    static int32_t isChannelSupported(uint32_t numChannels);
    static int32_t isBitWidthSupported(uint32_t bitWidth);
+private:
+   int32_t sessionIoFailed(int32_t status, struct pal_buffer *buf);
+   int32_t openSession_l();
+   bool parkSession_l();
 };
 
 #endif//STREAMPCM_H_
@@ -581,7 +581,7 @@ private:
     uint32_t hist_buf_duration_;
     uint32_t pre_roll_duration_;
     uint32_t model_id_;
-    FILE *lab_fd_;
+    int lab_fd_;
     bool rejection_notified_;
     ChronoSteadyClock_t transit_start_time_;
     ChronoSteadyClock_t transit_end_time_;
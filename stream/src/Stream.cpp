@@ -47,9 +47,11 @@
 #include "StreamHaptics.h"
 #include "Session.h"
 #include "SessionAlsaPcm.h"
+#include "MixerTransaction.h"
 #include "ResourceManager.h"
 #include "Device.h"
 #include "USBAudio.h"
+#include "PalTrace.h"
 #include "mem_logger.h"
 
 std::shared_ptr<ResourceManager> Stream::rm = nullptr;
@@ -543,6 +545,7 @@ int32_t Stream::getAssociatedDevices(std::vector <std::shared_ptr<Device>> &aDev
 {
     int32_t status = 0;
 
+    std::lock_guard<std::mutex> lock(mDevicesMutex);
     PAL_DBG(LOG_TAG, "no. of devices %zu", mDevices.size());
     for (int32_t i=0; i < mDevices.size(); i++) {
         aDevices.push_back(mDevices[i]);
@@ -551,6 +554,67 @@ int32_t Stream::getAssociatedDevices(std::vector <std::shared_ptr<Device>> &aDev
     return status;
 }
 
+void Stream::closeIo()
+{
+    ioOpen = false;
+    /* a read or write which saw the gate open finishes before we return */
+    std::lock_guard<std::mutex> lock(mIoMutex);
+}
+
+void Stream::writeDone()
+{
+    writeCount++;
+    lastWriteNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    if (drainWaiters) {
+        std::lock_guard<std::mutex> lock(mDrainMutex);
+        mDrainCv.notify_all();
+    }
+}
+
+void Stream::markMuteDrain()
+{
+    int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    int64_t ringNs = (int64_t)getLatency() * 1000000;
+    std::lock_guard<std::mutex> lock(mDrainMutex);
+
+    drainUntracked = false;
+    if (currentState != STREAM_STARTED) {
+        drainTarget = writeCount;
+    } else if (lastWriteNs == 0) {
+        /* no write reported yet, only the deadline tells it drained */
+        drainUntracked = true;
+    } else if (now - lastWriteNs > ringNs) {
+        /* no write for a ring duration, nothing unmuted is queued */
+        drainTarget = writeCount;
+    } else {
+        drainTarget = writeCount + MUTE_DRAIN_RINGS * outBufCount;
+    }
+}
+
+bool Stream::waitMuteDrain(std::chrono::steady_clock::time_point deadline)
+{
+    std::unique_lock<std::mutex> lock(mDrainMutex);
+    bool drained = false;
+
+    drainWaiters++;
+    drained = mDrainCv.wait_until(lock, deadline, [this] {
+        return !drainUntracked && writeCount >= drainTarget;
+    });
+    drainWaiters--;
+    return drained;
+}
+
+bool Stream::isDeviceAssociated(const std::shared_ptr<Device> &d)
+{
+    std::lock_guard<std::mutex> lock(mDevicesMutex);
+
+    if (!d)
+        return !mDevices.empty();
+    return std::find(mDevices.begin(), mDevices.end(), d) != mDevices.end();
+}
+
 int32_t Stream::getPalDevices(std::vector <std::shared_ptr<Device>> &PalDevices)
 {
     int32_t status = 0;
@@ -1284,10 +1348,14 @@ int32_t Stream::disconnectStreamDevice(Stream* streamHandle, pal_device_id_t dev
 int32_t Stream::disconnectStreamDevice_l(Stream* streamHandle, pal_device_id_t dev_id)
 {
     int32_t status = 0;
+    PAL_TRACE_SPAN_ARG("Stream::disconnectStreamDevice", dev_id);
 
+    /* no unlocked read/write while the session devices change */
+    closeIo();
     if (currentState == STREAM_IDLE) {
         for (int i = 0; i < mDevices.size(); i++) {
             if (dev_id == mDevices[i]->getSndDeviceId()) {
+                std::lock_guard<std::mutex> lock(mDevicesMutex);
                 mDevices.erase(mDevices.begin() + i);
                 PAL_DBG(LOG_TAG, "stream is in IDLE state, erase device: %d", dev_id);
                 break;
@@ -1349,7 +1417,9 @@ int32_t Stream::disconnectStreamDevice_l(Stream* streamHandle, pal_device_id_t d
                 rm->unlockGraph();
                 goto exit;
             }
+            mDevicesMutex.lock();
             mDevices.erase(mDevices.begin() + i);
+            mDevicesMutex.unlock();
             rm->unlockGraph();
             break;
         }
@@ -1373,6 +1443,7 @@ int32_t Stream::connectStreamDevice(Stream* streamHandle, struct pal_device *dat
 int32_t Stream::connectStreamDevice_l(Stream* streamHandle, struct pal_device *dattr)
 {
     int32_t status = 0;
+    PAL_TRACE_SPAN_ARG("Stream::connectStreamDevice", dattr ? dattr->id : 0);
     std::shared_ptr<Device> dev = nullptr;
     std::string newBackEndName;
     std::string curBackEndName;
@@ -1393,7 +1464,9 @@ int32_t Stream::connectStreamDevice_l(Stream* streamHandle, struct pal_device *d
 
     if (currentState == STREAM_IDLE) {
         PAL_DBG(LOG_TAG, "stream is in IDLE state, insert %d to mDevices", dev->getSndDeviceId());
+        mDevicesMutex.lock();
         mDevices.push_back(dev);
+        mDevicesMutex.unlock();
         status = 0;
         goto exit;
     }
@@ -1439,11 +1512,16 @@ int32_t Stream::connectStreamDevice_l(Stream* streamHandle, struct pal_device *d
         goto exit;
     }
 
+    mDevicesMutex.lock();
     mDevices.push_back(dev);
+    mDevicesMutex.unlock();
+    /* graph and mixer setup stay serialised when streams switch in parallel */
+    rm->lockGraph();
     status = session->setupSessionDevice(streamHandle, mStreamAttr->type, dev);
     if (0 != status) {
         PAL_ERR(LOG_TAG, "setupSessionDevice for %d failed with status %d",
                 dev->getSndDeviceId(), status);
+        rm->unlockGraph();
         goto dev_close;
     }
 
@@ -1455,7 +1533,6 @@ int32_t Stream::connectStreamDevice_l(Stream* streamHandle, struct pal_device *d
      * Currently device switch to BT is not supported for stopped mmap stream.
      */
     // TODO: add support for device switch to BT for stopped streams
-    rm->lockGraph();
     if ((currentState != STREAM_INIT && currentState != STREAM_STOPPED) ||
         (currentState == STREAM_INIT &&
         ((dev->getSndDeviceId() == PAL_DEVICE_OUT_BLUETOOTH_A2DP) ||
@@ -1511,7 +1588,9 @@ dev_close:
      * event so that when SSR is up that device will be associated to stream.
      */
     if (status != -ENETRESET) {
+        mDevicesMutex.lock();
         mDevices.pop_back();
+        mDevicesMutex.unlock();
         dev->close();
     }
 
@@ -1527,6 +1606,8 @@ exit:
        }
 
     }
+    if (!status && currentState == STREAM_STARTED && cachedState == STREAM_IDLE)
+        openIo();
     return status;
 }
 
@@ -1596,11 +1677,13 @@ int32_t Stream::switchDevice(Stream* streamHandle, uint32_t numDev, struct pal_d
     uint32_t curDeviceSlots[PAL_DEVICE_IN_MAX], newDeviceSlots[PAL_DEVICE_IN_MAX];
     std::vector <std::tuple<Stream *, uint32_t>> streamDevDisconnect, sharedBEStreamDev, streamsSkippingSwitch;
     std::vector <std::tuple<Stream *, struct pal_device *>> StreamDevConnect;
+    uint64_t mixerWrites = 0;
     struct pal_device dAttr;
     struct pal_device_info deviceInfo;
     uint32_t temp_prio = MIN_USECASE_PRIORITY;
     pal_stream_attributes strAttr;
     char CurrentSndDeviceName[DEVICE_NAME_MAX_SIZE] = {0};
+    PAL_TRACE_SPAN_ARG("Stream::switchDevice", numDev);
     std::vector <Stream *> streamsToSwitch;
     struct pal_device streamDevAttr;
     struct pal_device sco_Dattr = {};
@@ -1967,10 +2050,14 @@ int32_t Stream::switchDevice(Stream* streamHandle, uint32_t numDev, struct pal_d
         goto done;
     }
 
+    mixerWrites = MixerTransaction::getThreadRoundTrips();
     status = rm->streamDevSwitch(streamDevDisconnect, StreamDevConnect);
     if (status) {
         PAL_ERR(LOG_TAG, "Device switch failed");
     }
+    PAL_INFO(LOG_TAG, "device switch of %zu streams issued %llu batched mixer writes",
+             StreamDevConnect.size(),
+             (unsigned long long)(MixerTransaction::getThreadRoundTrips() - mixerWrites));
 
 done:
     mStreamMutex.lock();
@@ -39,6 +39,7 @@
 #include "ResourceManager.h"
 #include "Device.h"
 #include "kvh2xml.h"
+#include "PalDumpWriter.h"
 
 StreamACD::StreamACD(struct pal_stream_attributes *sattr,
                                        struct pal_device *dattr,
@@ -850,13 +851,13 @@ int32_t StreamACD::UpdateRecognitionConfig(struct acd_recognition_cfg *acd_recog
 
     // dump acd recognition config data
     if (acd_info_->GetEnableDebugDumps()) {
-        ST_DBG_DECLARE(FILE *rec_opaque_fd = NULL; static int rec_opaque_cnt = 0);
-        ST_DBG_FILE_OPEN_WR(rec_opaque_fd, ST_DEBUG_DUMP_LOCATION,
+        ST_DBG_DECLARE(int rec_opaque_fd = -1; static int rec_opaque_cnt = 0);
+        rec_opaque_fd = PalDumpWriter::open(ST_DEBUG_DUMP_LOCATION,
             "acd_rec_config", "bin", rec_opaque_cnt);
-        ST_DBG_FILE_WRITE(rec_opaque_fd,
+        PalDumpWriter::write(rec_opaque_fd,
             (uint8_t *)rec_config_, sizeof(struct acd_recognition_cfg) +
             (num_contexts * sizeof(struct acd_per_context_cfg)));
-        ST_DBG_FILE_CLOSE(rec_opaque_fd);
+        PalDumpWriter::close(rec_opaque_fd);
         PAL_DBG(LOG_TAG, "acd_recognition_cfg data stored in: acd_rec_config_%d.bin",
             rec_opaque_cnt);
         rec_opaque_cnt++;
@@ -876,12 +877,12 @@ int32_t StreamACD::UpdateRecognitionConfig(struct acd_recognition_cfg *acd_recog
 
     // dump acd context config data
     if (acd_info_->GetEnableDebugDumps()) {
-        ST_DBG_DECLARE(FILE *ctx_opaque_fd = NULL; static int ctx_opaque_cnt = 0);
-        ST_DBG_FILE_OPEN_WR(ctx_opaque_fd, ST_DEBUG_DUMP_LOCATION,
+        ST_DBG_DECLARE(int ctx_opaque_fd = -1; static int ctx_opaque_cnt = 0);
+        ctx_opaque_fd = PalDumpWriter::open(ST_DEBUG_DUMP_LOCATION,
             "acd_context_config", "bin", ctx_opaque_cnt);
-        ST_DBG_FILE_WRITE(ctx_opaque_fd,
+        PalDumpWriter::write(ctx_opaque_fd,
             (uint8_t *)context_config_, len);
-        ST_DBG_FILE_CLOSE(ctx_opaque_fd);
+        PalDumpWriter::close(ctx_opaque_fd);
         PAL_DBG(LOG_TAG, "acd_context_cfg data stored in: acd_context_config_%d.bin",
             ctx_opaque_cnt);
         ctx_opaque_cnt++;
@@ -938,12 +939,12 @@ int32_t StreamACD::UpdateContextConfig(struct pal_param_context_list *config)
 
     // dump acd context config data
     if (acd_info_->GetEnableDebugDumps()) {
-        ST_DBG_DECLARE(FILE *ctx_opaque_fd = NULL; static int ctx_opaque_cnt = 0);
-        ST_DBG_FILE_OPEN_WR(ctx_opaque_fd, ST_DEBUG_DUMP_LOCATION,
+        ST_DBG_DECLARE(int ctx_opaque_fd = -1; static int ctx_opaque_cnt = 0);
+        ctx_opaque_fd = PalDumpWriter::open(ST_DEBUG_DUMP_LOCATION,
             "acd_context_config", "bin", ctx_opaque_cnt);
-        ST_DBG_FILE_WRITE(ctx_opaque_fd,
+        PalDumpWriter::write(ctx_opaque_fd,
             (uint8_t *)context_config_, len);
-        ST_DBG_FILE_CLOSE(ctx_opaque_fd);
+        PalDumpWriter::close(ctx_opaque_fd);
         PAL_ERR(LOG_TAG, "acd_context_cfg data stored in: acd_context_config_%d.bin",
             ctx_opaque_cnt);
         ctx_opaque_cnt++;
@@ -692,6 +692,7 @@ int32_t StreamCompress::write(struct pal_buffer *buf)
                 return status;
             }
         }
+        writeDone();
         if ((currentState != STREAM_STARTED) &&
             !(currentState == STREAM_PAUSED && isPaused)) {
             currentState = STREAM_STARTED;
@@ -612,6 +612,7 @@ int32_t  StreamInCall::write(struct pal_buffer* buf)
                 goto exit;
             }
         }
+        writeDone();
         PAL_DBG(LOG_TAG, "Exit. session write successful size - %d", size);
         return size;
     } else if (currentState == STREAM_PAUSED) {
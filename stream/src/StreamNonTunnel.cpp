@@ -181,6 +181,7 @@ int32_t  StreamNonTunnel::close()
 {
     int32_t status = 0;
     mStreamMutex.lock();
+    closeIo();
 
     PAL_INFO(LOG_TAG, "Enter. session handle - %pK state %d",
             session, currentState);
@@ -248,6 +249,7 @@ int32_t StreamNonTunnel::start()
         }
         PAL_VERBOSE(LOG_TAG, "session start successful");
         currentState = STREAM_STARTED;
+        openIo();
     } else if (currentState == STREAM_STARTED) {
         PAL_INFO(LOG_TAG, "Stream already started, state %d", currentState);
         goto exit;
@@ -270,6 +272,7 @@ int32_t StreamNonTunnel::stop()
     int32_t status = 0;
 
     mStreamMutex.lock();
+    closeIo();
     PAL_DBG(LOG_TAG, "Enter. session handle - %pK mStreamAttr->direction - %d state %d",
                 session, mStreamAttr->direction, currentState);
 
@@ -329,6 +332,23 @@ int32_t  StreamNonTunnel::read(struct pal_buffer* buf)
     PAL_DBG(LOG_TAG, "Enter. session handle - %pK, state %d",
             session, currentState);
 
+    mIoMutex.lock();
+    if (ioOpen && PAL_CARD_STATUS_UP(rm->cardState) && !ssrInNTMode) {
+        status = session->read(this, SHMEM_ENDPOINT, buf, &size);
+        mIoMutex.unlock();
+        if (0 == status) {
+            PAL_DBG(LOG_TAG, "Exit. session read successful size - %d", size);
+            return size;
+        }
+        PAL_ERR(LOG_TAG, "session read is failed with status %d", status);
+        if (status == -ENETRESET && (PAL_CARD_STATUS_UP(rm->cardState))) {
+            PAL_ERR(LOG_TAG, "Sound card offline/standby, informing RM");
+            rm->ssrHandler(CARD_STATUS_OFFLINE);
+        }
+        return status;
+    }
+    mIoMutex.unlock();
+
     mStreamMutex.lock();
     if ((PAL_CARD_STATUS_DOWN(rm->cardState))
              || ssrInNTMode == true) {
@@ -379,6 +399,25 @@ int32_t  StreamNonTunnel::write(struct pal_buffer* buf)
     PAL_DBG(LOG_TAG, "Enter. session handle - %pK, state %d",
             session, currentState);
 
+    mIoMutex.lock();
+    if (ioOpen && PAL_CARD_STATUS_UP(rm->cardState) && !ssrInNTMode) {
+        status = session->write(this, SHMEM_ENDPOINT, buf, &size, 0);
+        mIoMutex.unlock();
+        if (0 == status) {
+            writeDone();
+            PAL_DBG(LOG_TAG, "Exit. session write successful size - %d", size);
+            return size;
+        }
+        PAL_ERR(LOG_TAG, "session write is failed with status %d", status);
+        /* ENETRESET is the error code returned by AGM during SSR */
+        if (status == -ENETRESET && (PAL_CARD_STATUS_UP(rm->cardState))) {
+            PAL_ERR(LOG_TAG, "Sound card offline/standby, informing RM");
+            rm->ssrHandler(CARD_STATUS_OFFLINE);
+        }
+        return status;
+    }
+    mIoMutex.unlock();
+
     mStreamMutex.lock();
 
     // If cached state is not STREAM_IDLE, we are still processing SSR up.
@@ -413,6 +452,7 @@ int32_t  StreamNonTunnel::write(struct pal_buffer* buf)
                 goto exit;
             }
          }
+         writeDone();
          PAL_DBG(LOG_TAG, "Exit. session write successful size - %d", size);
          return size;
     } else {
@@ -552,6 +592,7 @@ int32_t StreamNonTunnel::suspend()
     }
 
     if (currentState == STREAM_STARTED) {
+        closeIo();
         status = session->suspend(this);
         if (status) {
             PAL_ERR(LOG_TAG, "Rx session suspend failed with status %d", status);
@@ -641,6 +682,7 @@ int32_t StreamNonTunnel::ssrDownHandler()
     PAL_DBG(LOG_TAG, "Enter. session handle - %pK currentState State %d",
             session, currentState);
 
+    closeIo();
     ssrInNTMode = true;
     if (streamCb)
         streamCb(reinterpret_cast<pal_stream_handle_t *>(this), PAL_STREAM_CBK_EVENT_ERROR, NULL, 0, this->cookie);
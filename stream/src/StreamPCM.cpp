@@ -38,6 +38,7 @@
 #include "Session.h"
 #include "kvh2xml.h"
 #include "SessionAlsaPcm.h"
+#include "SessionPool.h"
 #include "ResourceManager.h"
 #include "Device.h"
 #include <unistd.h>
@@ -237,7 +238,7 @@ int32_t  StreamPCM::open()
         }
 
         rm->lockGraph();
-        status = session->open(this);
+        status = openSession_l();
         rm->unlockGraph();
         if (0 != status) {
             PAL_ERR(LOG_TAG, "session open failed with status %d", status);
@@ -294,6 +295,7 @@ int32_t  StreamPCM::close()
 {
     int32_t status = 0;
     mStreamMutex.lock();
+    closeIo();
 
     if (currentState == STREAM_IDLE) {
         PAL_INFO(LOG_TAG, "Stream is already closed");
@@ -327,9 +329,13 @@ int32_t  StreamPCM::close()
     }
 
     rm->lockGraph();
-    status = session->close(this);
-    if (0 != status) {
-        PAL_ERR(LOG_TAG, "session close failed with status %d", status);
+    if (parkSession_l()) {
+        PAL_VERBOSE(LOG_TAG, "session kept alive");
+    } else {
+        status = session->close(this);
+        if (0 != status) {
+            PAL_ERR(LOG_TAG, "session close failed with status %d", status);
+        }
     }
 
     for (int32_t i = 0; i < mDevices.size(); i++) {
@@ -350,6 +356,60 @@ int32_t  StreamPCM::close()
     return status;
 }
 
+/*
+ * Reattach a graph from the SessionPool when one matches, else open a
+ * new one. Graphs parked in the pool also hold front ends, so an open
+ * that fails is retried once after the pool gave them back.
+ */
+int32_t StreamPCM::openSession_l()
+{
+    int32_t status = 0;
+    Session *parked = SessionPool::take(this);
+
+    if (parked) {
+        if (mStreamAttr->direction == PAL_AUDIO_OUTPUT)
+            parked->registerCallBack(handleSoftPauseCallBack, (uint64_t)this);
+        status = parked->unpark(this);
+        if (0 == status) {
+            delete session;
+            session = parked;
+            return status;
+        }
+        PAL_ERR(LOG_TAG, "unpark failed with status %d, open a new session", status);
+        parked->close(this);
+        delete parked;
+    }
+
+    status = session->open(this);
+    if (0 != status && SessionPool::flush_l() > 0)
+        status = session->open(this);
+    return status;
+}
+
+/*
+ * Hand the idle graph of a closing stream to the SessionPool, the stream
+ * continues with a new unopened session.
+ */
+bool StreamPCM::parkSession_l()
+{
+    Session *idle = nullptr;
+
+    if (!SessionPool::isEnabled() || PAL_CARD_STATUS_DOWN(rm->cardState))
+        return false;
+
+    idle = Session::makeSession(rm, mStreamAttr);
+    if (!idle)
+        return false;
+    if (!SessionPool::park(this, session)) {
+        delete idle;
+        return false;
+    }
+    if (mStreamAttr->direction == PAL_AUDIO_OUTPUT)
+        idle->registerCallBack(handleSoftPauseCallBack, (uint64_t)this);
+    session = idle;
+    return true;
+}
+
 StreamPCM::~StreamPCM()
 {
     cachedState = STREAM_IDLE;
@@ -664,6 +724,8 @@ session_fail:
             status = devStatus;
     }
 exit:
+    if (!status && currentState == STREAM_STARTED && cachedState == STREAM_IDLE)
+        openIo();
     palStateEnqueue(this, PAL_STATE_STARTED, status);
     PAL_DBG(LOG_TAG, "Exit. state %d, status %d", currentState, status);
     mStreamMutex.unlock();
@@ -676,6 +738,7 @@ int32_t StreamPCM::stop()
     int32_t status = 0;
 
     mStreamMutex.lock();
+    closeIo();
     PAL_DBG(LOG_TAG, "Enter. session handle - %pK mStreamAttr->direction - %d state %d",
                 session, mStreamAttr->direction, currentState);
 
@@ -937,13 +1000,46 @@ exit:
     return status;
 }
 
+/* status to return for a failed session read/write, buffers are dropped during SSR */
+int32_t StreamPCM::sessionIoFailed(int32_t status, struct pal_buffer *buf)
+{
+    PAL_ERR(LOG_TAG, "session read/write is failed with status %d", status);
+    if (errno == ENETRESET &&
+        (PAL_CARD_STATUS_UP(rm->cardState))) {
+        PAL_ERR(LOG_TAG, "Sound card offline/standby, informing RM");
+        rm->ssrHandler(CARD_STATUS_OFFLINE);
+        PAL_DBG(LOG_TAG, "dropped buffer size - %zu", buf->size);
+        return buf->size;
+    } else if (PAL_CARD_STATUS_DOWN(rm->cardState)) {
+        PAL_DBG(LOG_TAG, "dropped buffer size - %zu", buf->size);
+        return buf->size;
+    }
+    return status;
+}
+
 int32_t  StreamPCM::read(struct pal_buffer* buf)
 {
     int32_t status = 0;
     int32_t size;
+    bool fastPath = false;
     PAL_VERBOSE(LOG_TAG, "Enter. session handle - %pK, state %d",
             session, currentState);
 
+    mIoMutex.lock();
+    fastPath = ioOpen && PAL_CARD_STATUS_UP(rm->cardState);
+#ifdef LINUX_ENABLED
+    fastPath = fastPath && !ecref_op;
+#endif
+    if (fastPath) {
+        status = session->read(this, SHMEM_ENDPOINT, buf, &size);
+        mIoMutex.unlock();
+        if (0 != status)
+            return sessionIoFailed(status, buf);
+        PAL_VERBOSE(LOG_TAG, "Exit. session read successful size - %d", size);
+        return size;
+    }
+    mIoMutex.unlock();
+
 #ifdef LINUX_ENABLED
     std::unique_lock<std::mutex> stream_lock(mStreamMutex);
 #else
@@ -980,23 +1076,8 @@ int32_t  StreamPCM::read(struct pal_buffer* buf)
 #endif
         status = session->read(this, SHMEM_ENDPOINT, buf, &size);
         if (0 != status) {
-            PAL_ERR(LOG_TAG, "session read is failed with status %d", status);
-            if (errno == -ENETRESET &&
-                (PAL_CARD_STATUS_UP(rm->cardState))) {
-                PAL_ERR(LOG_TAG, "Sound card offline/standby, informing RM");
-                rm->ssrHandler(CARD_STATUS_OFFLINE);
-                size = buf->size;
-                status = size;
-                PAL_DBG(LOG_TAG, "dropped buffer size - %d", size);
-                goto exit;
-            } else if (PAL_CARD_STATUS_DOWN(rm->cardState)) {
-                size = buf->size;
-                status = size;
-                PAL_DBG(LOG_TAG, "dropped buffer size - %d", size);
-                goto exit;
-            } else {
-                goto exit;
-            }
+            status = sessionIoFailed(status, buf);
+            goto exit;
         }
     } else {
         PAL_ERR(LOG_TAG, "Stream not started yet, state %d", currentState);
@@ -1024,6 +1105,18 @@ int32_t StreamPCM::write(struct pal_buffer* buf)
     PAL_VERBOSE(LOG_TAG, "Enter. session handle - %pK, state %d",
             session, currentState);
 
+    mIoMutex.lock();
+    if (ioOpen && PAL_CARD_STATUS_UP(rm->cardState) && !a2dpPaused) {
+        status = session->write(this, SHMEM_ENDPOINT, buf, &size, 0);
+        mIoMutex.unlock();
+        if (0 != status)
+            return sessionIoFailed(status, buf);
+        writeDone();
+        PAL_VERBOSE(LOG_TAG, "Exit. session write successful size - %d", size);
+        return size;
+    }
+    mIoMutex.unlock();
+
     mStreamMutex.lock();
     // If cached state is not STREAM_IDLE, we are still processing SSR up.
     // or when a softpause happens during a2dpsuspend, stream does not write data.
@@ -1054,35 +1147,26 @@ int32_t StreamPCM::write(struct pal_buffer* buf)
         status = session->write(this, SHMEM_ENDPOINT, buf, &size, 0);
         mStreamMutex.unlock();
         if (0 != status) {
-            PAL_ERR(LOG_TAG, "session write is failed with status %d", status);
-
             /* ENETRESET is the error code returned by AGM during SSR */
-            if (errno == -ENETRESET &&
-                (PAL_CARD_STATUS_UP(rm->cardState))) {
-                PAL_ERR(LOG_TAG, "Sound card offline/standby, informing RM");
-                rm->ssrHandler(CARD_STATUS_OFFLINE);
-                size = buf->size;
-                status = size;
-                PAL_DBG(LOG_TAG, "dropped buffer size - %d", size);
-                goto exit;
-            } else if (PAL_CARD_STATUS_DOWN(rm->cardState)) {
-                size = buf->size;
-                status = size;
-                PAL_DBG(LOG_TAG, "dropped buffer size - %d", size);
-                goto exit;
-            } else {
-                goto exit;
-            }
-        } else if (currentState == STREAM_PAUSED && !isPaused) {
+            status = sessionIoFailed(status, buf);
+            goto exit;
+        }
+        writeDone();
+        if (currentState == STREAM_PAUSED && !isPaused) {
             rm->lockActiveStream();
             mStreamMutex.lock();
-            for (int i = 0; i < mDevices.size(); i++) {
-                rm->registerDevice(mDevices[i], this);
+            /* a stop may have run since the write, only a resumed stream restarts */
+            if (currentState == STREAM_PAUSED && !isPaused) {
+                for (int i = 0; i < mDevices.size(); i++) {
+                    rm->registerDevice(mDevices[i], this);
+                }
+                currentState = STREAM_STARTED;
+                if (cachedState == STREAM_IDLE)
+                    openIo();
+                palStateEnqueue(this, PAL_STATE_STARTED, status);
             }
             mStreamMutex.unlock();
             rm->unlockActiveStream();
-            currentState = STREAM_STARTED;
-            palStateEnqueue(this, PAL_STATE_STARTED, status);
         }
         PAL_VERBOSE(LOG_TAG, "Exit. session write successful size - %d", size);
         return size;
@@ -1275,6 +1359,7 @@ int32_t StreamPCM::pause_l()
     std::unique_lock<std::mutex> pauseLock(pauseMutex);
 
     PAL_DBG(LOG_TAG, "Enter. session handle - %pK", session);
+    closeIo();
     if (PAL_CARD_STATUS_DOWN(rm->cardState)) {
         cachedState = STREAM_PAUSED;
         isPaused = true;
@@ -1522,16 +1607,22 @@ int32_t StreamPCM::setECRef(std::shared_ptr<Device> dev, bool is_enable)
 int32_t StreamPCM::setECRef_l(std::shared_ptr<Device> dev, bool is_enable)
 {
     int32_t status = 0;
+    bool reopenIo = false;
 
     if (!session)
         return -EINVAL;
 
     PAL_DBG(LOG_TAG, "Enter. session handle - %pK", session);
 
+    /* reads are held off while the ec reference is reconfigured */
+    reopenIo = ioOpen;
+    closeIo();
     status = session->setECRef(this, dev, is_enable);
     if (status) {
         PAL_ERR(LOG_TAG, "Failed to set ec ref in session");
     }
+    if (reopenIo && currentState == STREAM_STARTED)
+        openIo();
 
     PAL_DBG(LOG_TAG, "Exit, status %d", status);
 
@@ -1543,6 +1634,7 @@ int32_t StreamPCM::ssrDownHandler()
     int32_t status = 0;
 
     mStreamMutex.lock();
+    closeIo();
 
     if (false == isStreamSSRDownFeasibile()) {
         mStreamMutex.unlock();
@@ -1658,7 +1750,11 @@ int32_t StreamPCM::ssrUpHandler()
         PAL_ERR(LOG_TAG, "stream not in correct state to handle %d", cachedState);
     }
 exit :
+    mStreamMutex.lock();
     cachedState = STREAM_IDLE;
+    if (currentState == STREAM_STARTED)
+        openIo();
+    mStreamMutex.unlock();
 skip_up_handling :
     PAL_DBG(LOG_TAG, "Exit, status %d", status);
     return status;
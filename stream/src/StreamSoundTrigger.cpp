@@ -64,6 +64,7 @@
 
 #include "StreamSoundTrigger.h"
 
+#include <algorithm>
 #include <chrono>
 #include <unistd.h>
 #include <dlfcn.h>
@@ -75,6 +76,8 @@
 #include "kvh2xml.h"
 #include "VoiceUIInterface.h"
 #include "VUIInterfaceProxy.h"
+#include "PalTrace.h"
+#include "PalDumpWriter.h"
 
 // TODO: find another way to print debug logs by default
 #define ST_DBG_LOGS
@@ -116,7 +119,7 @@ StreamSoundTrigger::StreamSoundTrigger(struct pal_stream_attributes *sattr,
     conf_levels_intf_version_ = 0;
     st_conf_levels_ = nullptr;
     st_conf_levels_v2_ = nullptr;
-    lab_fd_ = nullptr;
+    lab_fd_ = -1;
     rejection_notified_ = false;
     mutex_unlocked_after_cb_ = false;
     common_cp_update_disable_ = false;
@@ -252,6 +255,8 @@ StreamSoundTrigger::~StreamSoundTrigger() {
         UnloadSoundModel();
     st_states_.clear();
     engines_.clear();
+    PalDumpWriter::close(lab_fd_);
+    lab_fd_ = -1;
     mStreamMutex.unlock();
 
     rm->deregisterStream(this);
@@ -389,8 +394,8 @@ int32_t StreamSoundTrigger::read(struct pal_buffer* buf) {
     }
 
     std::lock_guard<std::mutex> lck(mStreamMutex);
-    if (vui_ptfm_info_->GetEnableDebugDumps() && !lab_fd_) {
-        ST_DBG_FILE_OPEN_WR(lab_fd_, ST_DEBUG_DUMP_LOCATION,
+    if (vui_ptfm_info_->GetEnableDebugDumps() && lab_fd_ < 0) {
+        lab_fd_ = PalDumpWriter::open(ST_DEBUG_DUMP_LOCATION,
             "lab_reading", "bin", lab_cnt);
         PAL_DBG(LOG_TAG, "lab data stored in: lab_reading_%d.bin",
             lab_cnt);
@@ -583,8 +588,8 @@ int32_t StreamSoundTrigger::setParameters(uint32_t param_id, void *payload) {
             status = cur_state_->ProcessEvent(ev_cfg);
 
             if (vui_ptfm_info_->GetEnableDebugDumps()) {
-                ST_DBG_FILE_CLOSE(lab_fd_);
-                lab_fd_ = nullptr;
+                PalDumpWriter::close(lab_fd_);
+                lab_fd_ = -1;
             }
             break;
         }
@@ -846,6 +851,7 @@ int32_t StreamSoundTrigger::getCallBack(pal_stream_callback *cb) {
 int32_t StreamSoundTrigger::SetEngineDetectionState(int32_t det_type) {
     int32_t status = 0;
     bool lock_status = false;
+    PAL_TRACE_SPAN_ARG("st_detection", det_type);
 
     PAL_DBG(LOG_TAG, "Enter, det_type %d", det_type);
     if (!(det_type & DETECTION_TYPE_ALL)) {
@@ -1371,12 +1377,12 @@ int32_t StreamSoundTrigger::SendRecognitionConfig(
 
     // dump recognition config opaque data
     if (config->data_size > 0 && vui_ptfm_info_->GetEnableDebugDumps()) {
-        ST_DBG_DECLARE(FILE *rec_opaque_fd = NULL; static int rec_opaque_cnt = 0);
-        ST_DBG_FILE_OPEN_WR(rec_opaque_fd, ST_DEBUG_DUMP_LOCATION,
+        ST_DBG_DECLARE(int rec_opaque_fd = -1; static int rec_opaque_cnt = 0);
+        rec_opaque_fd = PalDumpWriter::open(ST_DEBUG_DUMP_LOCATION,
             "rec_config_opaque", "bin", rec_opaque_cnt);
-        ST_DBG_FILE_WRITE(rec_opaque_fd,
+        PalDumpWriter::write(rec_opaque_fd,
             (uint8_t *)rec_config_ + config->data_offset, config->data_size);
-        ST_DBG_FILE_CLOSE(rec_opaque_fd);
+        PalDumpWriter::close(rec_opaque_fd);
         PAL_DBG(LOG_TAG, "recognition config opaque data stored in: rec_config_opaque_%d.bin",
             rec_opaque_cnt);
         rec_opaque_cnt++;
@@ -1479,6 +1485,10 @@ int32_t StreamSoundTrigger::SendRecognitionConfig(
      */
     for (i = 0; i < engines_.size(); i++) {
         if (engines_[i]->GetEngineId() == ST_SM_ID_SVA_F_STAGE_GMM) {
+            /* the previous reader was released if the list was rebuilt */
+            if (reader_ && std::find(reader_list_.begin(), reader_list_.end(),
+                    reader_) == reader_list_.end())
+                delete reader_;
             reader_ = reader_list_[i];
         } else {
             status = engines_[i]->GetEngine()->SetBufferReader(
@@ -1601,6 +1611,7 @@ int32_t StreamSoundTrigger::notifyClient(uint32_t detection) {
     uint64_t total_process_duration = 0;
     bool lock_status = false;
     vui_intf_param_t param {};
+    PAL_TRACE_SPAN_ARG("st_notify_client", detection);
 
     PostDelayedStop();
 
@@ -3015,7 +3026,7 @@ int32_t StreamSoundTrigger::StBuffering::ProcessEvent(
             }
             status = st_stream_.reader_->read(buf->buffer, buf->size);
             if (st_stream_.vui_ptfm_info_->GetEnableDebugDumps() && status >= 0) {
-                ST_DBG_FILE_WRITE(st_stream_.lab_fd_, buf->buffer, status);
+                PalDumpWriter::write(st_stream_.lab_fd_, buf->buffer, status);
             }
             break;
         }
@@ -3215,12 +3226,13 @@ int32_t StreamSoundTrigger::StBuffering::ProcessEvent(
                 PAL_DBG(LOG_TAG, "Second stage rejected, type %d",
                         data->det_type_);
 
+                /*
+                 * One rejection decides the detection, stop all second stage
+                 * engines of the stream instead of letting the others process
+                 * the rest of the keyword.
+                 */
                 for (auto& eng : st_stream_.engines_) {
-                    if ((data->det_type_ == USER_VERIFICATION_REJECT &&
-                        eng->GetEngineId() & ST_SM_ID_SVA_S_STAGE_KWD) ||
-                        (data->det_type_ == KEYWORD_DETECTION_REJECT &&
-                        eng->GetEngineId() & ST_SM_ID_SVA_S_STAGE_USER)) {
-
+                    if (eng->GetEngineId() != ST_SM_ID_SVA_F_STAGE_GMM) {
                         status = eng->GetEngine()->StopRecognition(&st_stream_);
                         if (status) {
                             PAL_ERR(LOG_TAG, "Failed to stop recognition for engines");
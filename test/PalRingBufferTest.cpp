@@ -0,0 +1,267 @@
+/*
+ * Copyright (c) 2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+/*
+ * Host unit test for PalRingBuffer, built against test/stubs. Covers the
+ * wrap around of peek/commit, several readers sharing one writer, reader
+ * reset and reuse of reader slots.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <string.h>
+#include "PalRingBuffer.h"
+
+uint32_t pal_log_lvl = 0;
+
+static int failures;
+
+#define CHECK(cond) do {                                                   \
+        if (!(cond)) {                                                     \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__,         \
+                    __LINE__, #cond);                                      \
+            failures++;                                                    \
+        }                                                                  \
+    } while (0)
+
+static void fill(char *data, size_t size, uint32_t seq)
+{
+    for (size_t i = 0; i < size; i++)
+        data[i] = (char)(seq + i);
+}
+
+static bool verify(const char *data, size_t size, uint32_t seq)
+{
+    for (size_t i = 0; i < size; i++)
+        if (data[i] != (char)(seq + i))
+            return false;
+    return true;
+}
+
+/* data crossing the buffer end comes back as two spans in order */
+static void testWrapAround()
+{
+    PalRingBuffer rb(100);
+    PalRingBufferReader *reader = rb.newReader();
+    PalRingBufferSpan spans[2];
+    char in[100], out[100], scratch[100];
+    void *data = nullptr;
+    uint32_t seq = 0;
+
+    reader->updateState(READER_ENABLED);
+
+    fill(in, 70, seq);
+    CHECK(rb.write(in, 70) == 70);
+    CHECK(reader->read(out, 70) == 70);
+    CHECK(verify(out, 70, seq));
+    seq += 70;
+
+    /* 30 bytes up to the end, 30 from the start */
+    fill(in, 60, seq);
+    CHECK(rb.write(in, 60) == 60);
+    CHECK(reader->peek(spans, 60) == 60);
+    CHECK(spans[0].size == 30);
+    CHECK(spans[1].size == 30);
+    CHECK(verify(spans[0].data, 30, seq));
+    CHECK(verify(spans[1].data, 30, seq + 30));
+
+    /* peek does not consume, peekContiguous gathers into scratch */
+    CHECK(reader->peekContiguous(&data, 60, scratch) == 60);
+    CHECK(data == scratch);
+    CHECK(verify((char *)data, 60, seq));
+    CHECK(reader->commit(60) == 60);
+    CHECK(reader->getUnreadSize() == 0);
+    seq += 60;
+
+    /* a contiguous peek points straight into the buffer */
+    fill(in, 20, seq);
+    CHECK(rb.write(in, 20) == 20);
+    CHECK(reader->peekContiguous(&data, 20, scratch) == 20);
+    CHECK(data != scratch);
+    CHECK(verify((char *)data, 20, seq));
+    reader->commit(20);
+
+    /* the writer never overruns an enabled reader */
+    fill(in, 100, 0);
+    CHECK(rb.write(in, 100) == 100);
+    CHECK(rb.write(in, 1) == 0);
+    CHECK(rb.getFreeSize() == 0);
+}
+
+/* the slowest enabled reader limits the writer, each reads independently */
+static void testMultiReader()
+{
+    PalRingBuffer rb(64);
+    PalRingBufferReader *fast = rb.newReader();
+    PalRingBufferReader *slow = rb.newReader();
+    PalRingBufferReader *idle = rb.newReader();
+    char in[64], out[64];
+
+    fast->updateState(READER_ENABLED);
+    slow->updateState(READER_ENABLED);
+
+    fill(in, 48, 0);
+    CHECK(rb.write(in, 48) == 48);
+    CHECK(fast->read(out, 48) == 48);
+    CHECK(verify(out, 48, 0));
+    CHECK(slow->read(out, 16) == 16);
+    CHECK(verify(out, 16, 0));
+
+    /* slow still has 32 unread, so only 32 bytes fit */
+    fill(in, 48, 48);
+    CHECK(rb.write(in, 48) == 32);
+    CHECK(fast->getUnreadSize() == 32);
+    CHECK(slow->getUnreadSize() == 64);
+    CHECK(slow->read(out, 64) == 64);
+    CHECK(verify(out, 64, 16));
+    CHECK(fast->read(out, 64) == 32);
+    CHECK(verify(out, 32, 48));
+
+    /* a disabled reader does not hold the writer back and cannot read */
+    CHECK(!idle->isEnabled());
+    CHECK(idle->read(out, 16) == -EINVAL);
+    CHECK(rb.getFreeSize() == 64);
+}
+
+/* a prepared reader skips data it was too late for and enables on read */
+static void testPreparedReader()
+{
+    PalRingBuffer rb(32);
+    PalRingBufferReader *reader = rb.newReader();
+    char in[64], out[32];
+
+    reader->updateState(READER_PREPARED);
+    fill(in, 64, 0);
+    CHECK(rb.write(in, 32) == 32);
+    CHECK(rb.write(in + 32, 32) == 32);
+    CHECK(reader->read(out, 32) == 32);
+    CHECK(verify(out, 32, 32));
+    CHECK(reader->isEnabled());
+}
+
+/* reset drops unread data and disables, reuse after re-enabling */
+static void testReaderReset()
+{
+    PalRingBuffer rb(32);
+    PalRingBufferReader *reader = rb.newReader();
+    char in[32], out[32];
+    std::atomic<bool> woken{false};
+
+    reader->updateState(READER_ENABLED);
+    fill(in, 16, 0);
+    CHECK(rb.write(in, 16) == 16);
+    reader->reset();
+    CHECK(!reader->isEnabled());
+    CHECK(reader->getUnreadSize() == 0);
+    CHECK(reader->read(out, 16) == -EINVAL);
+
+    reader->updateState(READER_ENABLED);
+    fill(in, 8, 16);
+    CHECK(rb.write(in, 8) == 8);
+    CHECK(reader->read(out, 32) == 8);
+    CHECK(verify(out, 8, 16));
+
+    /* a blocked waiter is released by reset rather than its timeout */
+    std::thread t([&] {
+        reader->waitForBuffers(16);
+        woken = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    reader->reset();
+    t.join();
+    CHECK(woken);
+
+    /* resetting the buffer rewinds the writer and every reader */
+    reader->updateState(READER_ENABLED);
+    CHECK(rb.write(in, 8) == 8);
+    rb.reset();
+    CHECK(reader->getUnreadSize() == 0);
+    CHECK(rb.getFreeSize() == 32);
+}
+
+/* slots are fixed, removeReader must hand them back */
+static void testReaderSlots()
+{
+    PalRingBuffer rb(32);
+    std::vector<PalRingBufferReader *> readers;
+    PalRingBufferReader *reader = nullptr;
+
+    for (int i = 0; i < PAL_RING_BUFFER_MAX_READERS; i++) {
+        reader = rb.newReader();
+        CHECK(reader != nullptr);
+        readers.push_back(reader);
+    }
+    CHECK(rb.newReader() == nullptr);
+
+    rb.removeReader(readers[3]);
+    delete readers[3];
+    readers[3] = rb.newReader();
+    CHECK(readers[3] != nullptr);
+    CHECK(rb.newReader() == nullptr);
+
+    /* the remaining readers are freed with the buffer */
+}
+
+/* a reader enabled while the writer runs never sees torn data */
+static void testConcurrentEnable()
+{
+    PalRingBuffer rb(256);
+    PalRingBufferReader *pacer = rb.newReader();
+    std::atomic<bool> stop{false};
+    char in[32];
+    uint32_t seq = 0;
+
+    pacer->updateState(READER_ENABLED);
+    std::thread writer([&] {
+        char chunk[32];
+        while (!stop) {
+            fill(chunk, sizeof(chunk), seq);
+            if (rb.write(chunk, sizeof(chunk)) == sizeof(chunk))
+                seq += sizeof(chunk);
+            else
+                std::this_thread::yield();
+        }
+    });
+
+    for (int i = 0; i < 200; i++) {
+        PalRingBufferReader *late = rb.newReader();
+        PalRingBufferSpan spans[2];
+        int32_t size = 0;
+
+        late->updateState(READER_PREPARED);
+        size = late->peek(spans, sizeof(in));
+        if (size > 0) {
+            memcpy(in, spans[0].data, spans[0].size);
+            memcpy(in + spans[0].size, spans[1].data, spans[1].size);
+            /* bytes follow the pattern from wherever the reader started */
+            CHECK(verify(in, size, (uint8_t)in[0]));
+        }
+        rb.removeReader(late);
+        delete late;
+        pacer->commit(pacer->getUnreadSize());
+    }
+    stop = true;
+    writer.join();
+}
+
+int main()
+{
+    testWrapAround();
+    testMultiReader();
+    testPreparedReader();
+    testReaderReset();
+    testReaderSlots();
+    testConcurrentEnable();
+
+    if (failures) {
+        fprintf(stderr, "PalRingBufferTest: %d failures\n", failures);
+        return 1;
+    }
+    printf("PalRingBufferTest: PASS\n");
+    return 0;
+}
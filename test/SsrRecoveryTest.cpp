@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+/*
+ * Host unit test for SsrRecoveryScheduler, built against test/stubs/Stream.h.
+ * The handlers follow StreamPCM/StreamInCall::ssrUpHandler: entered with
+ * the active stream lock held, they drop it around start() and take it
+ * back before returning.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <unistd.h>
+#include "SsrRecoveryScheduler.h"
+#include "Stream.h"
+
+uint32_t pal_log_lvl = 0;
+
+static int failures;
+
+#define CHECK(cond) do {                                                   \
+        if (!(cond)) {                                                     \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__,         \
+                    __LINE__, #cond);                                      \
+            failures++;                                                    \
+        }                                                                  \
+    } while (0)
+
+static std::mutex activeStreamLock;
+
+struct handlerLog {
+    std::mutex lock;
+    std::atomic<int> running{0};
+    int maxRunning = 0;
+    int lockNotHeld = 0;
+    std::vector<std::pair<Stream *, std::chrono::steady_clock::time_point>> starts;
+    std::vector<std::pair<Stream *, std::chrono::steady_clock::time_point>> ends;
+};
+
+static bool heldByOther()
+{
+    bool held;
+
+    std::thread t([&held] {
+        held = !activeStreamLock.try_lock();
+        if (!held)
+            activeStreamLock.unlock();
+    });
+    t.join();
+    return held;
+}
+
+static int32_t fakeUpHandler(struct handlerLog *log, Stream *s, uint32_t startMs)
+{
+    int n;
+
+    /* entered with the active stream lock held */
+    if (!heldByOther()) {
+        std::lock_guard<std::mutex> l(log->lock);
+        log->lockNotHeld++;
+    }
+
+    activeStreamLock.unlock();
+    {
+        std::lock_guard<std::mutex> l(log->lock);
+        log->starts.emplace_back(s, std::chrono::steady_clock::now());
+    }
+    n = ++log->running;
+    {
+        std::lock_guard<std::mutex> l(log->lock);
+        log->maxRunning = std::max(log->maxRunning, n);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(startMs));
+    log->running--;
+    {
+        std::lock_guard<std::mutex> l(log->lock);
+        log->ends.emplace_back(s, std::chrono::steady_clock::now());
+    }
+    activeStreamLock.lock();
+    return 0;
+}
+
+static std::chrono::steady_clock::time_point find(
+        const std::vector<std::pair<Stream *, std::chrono::steady_clock::time_point>> &v,
+        Stream *s)
+{
+    for (auto &e : v)
+        if (e.first == s)
+            return e.second;
+    return std::chrono::steady_clock::time_point();
+}
+
+/* two started PCM playback streams and a voice call */
+static void testPcmAndVoice()
+{
+    Stream ll1(PAL_STREAM_LOW_LATENCY), ll2(PAL_STREAM_LOW_LATENCY);
+    Stream deep(PAL_STREAM_DEEP_BUFFER);
+    Stream voice(PAL_STREAM_VOICE_CALL);
+    std::vector<Stream *> streams = { &ll1, &deep, &voice, &ll2 };
+    struct handlerLog log;
+    struct pal_ssr_recovery_done done;
+    std::vector<Stream *> reported;
+
+    auto fut = std::async(std::launch::async, [&] {
+        SsrRecoveryScheduler::run(streams, &activeStreamLock,
+            [&log](Stream *s) { return fakeUpHandler(&log, s, 50); },
+            [&reported](Stream *s, struct pal_ssr_stream_recovery *rec) {
+                (void)rec;
+                reported.push_back(s);
+            }, &done);
+    });
+    if (fut.wait_for(std::chrono::seconds(5)) != std::future_status::ready) {
+        fprintf(stderr, "ssr recovery did not finish, deadlock\n");
+        fflush(stderr);
+        _exit(1);
+    }
+
+    CHECK(done.num_streams == 4);
+    CHECK(done.num_failed == 0);
+    CHECK(reported.size() == 4);
+    CHECK(log.lockNotHeld == 0);
+    CHECK(find(log.ends, &voice) <= find(log.starts, &ll1));
+    CHECK(find(log.ends, &voice) <= find(log.starts, &ll2));
+    CHECK(find(log.ends, &voice) <= find(log.starts, &deep));
+    /*
+     * the three playback streams overlap once the call is up, well under
+     * the 200ms a serial restore takes. The scheduler uses one worker per
+     * core, so there is nothing to overlap on a single core host.
+     */
+    if (std::thread::hardware_concurrency() > 1) {
+        CHECK(log.maxRunning >= 2);
+        CHECK(done.total_us < 180000);
+    }
+    /* the lock is free again once run returns */
+    CHECK(!heldByOther());
+}
+
+/* detection streams are restored one at a time */
+static void testDetectionSerial()
+{
+    Stream st1(PAL_STREAM_VOICE_UI, PAL_AUDIO_INPUT);
+    Stream st2(PAL_STREAM_VOICE_UI, PAL_AUDIO_INPUT);
+    Stream acd(PAL_STREAM_ACD, PAL_AUDIO_INPUT);
+    std::vector<Stream *> streams = { &st1, &st2, &acd };
+    struct handlerLog log;
+    struct pal_ssr_recovery_done done;
+
+    SsrRecoveryScheduler::run(streams, &activeStreamLock,
+        [&log](Stream *s) { return fakeUpHandler(&log, s, 10); },
+        [](Stream *, struct pal_ssr_stream_recovery *) {}, &done);
+
+    CHECK(done.num_streams == 3);
+    CHECK(log.maxRunning == 1);
+}
+
+int main()
+{
+    testPcmAndVoice();
+    testDetectionSerial();
+
+    if (failures) {
+        fprintf(stderr, "SsrRecoveryTest: %d failures\n", failures);
+        return 1;
+    }
+    printf("SsrRecoveryTest: PASS\n");
+    return 0;
+}
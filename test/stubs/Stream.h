@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef PAL_TEST_STUB_STREAM_H
+#define PAL_TEST_STUB_STREAM_H
+
+/*
+ * The part of Stream the ssr recovery scheduler looks at, so the scheduler
+ * can be unit tested without the rest of PAL.
+ */
+#include <string.h>
+#include "PalDefs.h"
+
+class Stream
+{
+public:
+    explicit Stream(pal_stream_type_t type,
+                    pal_stream_direction_t dir = PAL_AUDIO_OUTPUT)
+    {
+        memset(&mAttr, 0, sizeof(mAttr));
+        mAttr.type = type;
+        mAttr.direction = dir;
+    }
+    virtual ~Stream() {}
+
+    int32_t getStreamAttributes(struct pal_stream_attributes *sattr)
+    {
+        *sattr = mAttr;
+        return 0;
+    }
+    int32_t getStreamType(pal_stream_type_t *streamType)
+    {
+        *streamType = mAttr.type;
+        return 0;
+    }
+
+private:
+    struct pal_stream_attributes mAttr;
+};
+
+#endif //PAL_TEST_STUB_STREAM_H
@@ -0,0 +1,33 @@
+/*
+ * Copyright (c) 2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef PAL_TEST_STUB_STREAMSOUNDTRIGGER_H
+#define PAL_TEST_STUB_STREAMSOUNDTRIGGER_H
+
+/*
+ * The part of StreamSoundTrigger the ring buffer keyword config looks at.
+ */
+#include <vector>
+#include "Stream.h"
+
+class PalRingBufferReader;
+
+class StreamSoundTrigger : public Stream
+{
+public:
+    StreamSoundTrigger()
+        : Stream(PAL_STREAM_VOICE_UI, PAL_AUDIO_INPUT) {}
+
+    std::vector<PalRingBufferReader *> GetReaders() { return readers_; }
+    void SetReaders(std::vector<PalRingBufferReader *> readers)
+    {
+        readers_ = readers;
+    }
+
+private:
+    std::vector<PalRingBufferReader *> readers_;
+};
+
+#endif //PAL_TEST_STUB_STREAMSOUNDTRIGGER_H
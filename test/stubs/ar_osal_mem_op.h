@@ -0,0 +1,28 @@
+/*
+ * Copyright (c) 2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef PAL_TEST_STUB_AR_OSAL_MEM_OP_H
+#define PAL_TEST_STUB_AR_OSAL_MEM_OP_H
+
+/* host stand-in for the ar_osal copy helpers PalCommon.h pulls in */
+#include <string.h>
+#include <stddef.h>
+
+static inline size_t ar_mem_cpy(void *dst, size_t dst_size,
+                                const void *src, size_t src_size)
+{
+    size_t n = dst_size < src_size ? dst_size : src_size;
+
+    memcpy(dst, src, n);
+    return n;
+}
+
+static inline int ar_mem_set(void *dst, int val, size_t size)
+{
+    memset(dst, val, size);
+    return 0;
+}
+
+#endif //PAL_TEST_STUB_AR_OSAL_MEM_OP_H
@@ -0,0 +1,17 @@
+/*
+ * Copyright (c) 2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef PAL_TEST_STUB_LOG_H
+#define PAL_TEST_STUB_LOG_H
+
+/* host stand-in for liblog, unit tests print to stderr */
+#include <stdio.h>
+
+#define ALOGE(fmt, ...) fprintf(stderr, "E " fmt "\n", ##__VA_ARGS__)
+#define ALOGI(fmt, ...) fprintf(stderr, "I " fmt "\n", ##__VA_ARGS__)
+#define ALOGD(fmt, ...) fprintf(stderr, "D " fmt "\n", ##__VA_ARGS__)
+#define ALOGV(fmt, ...) fprintf(stderr, "V " fmt "\n", ##__VA_ARGS__)
+
+#endif //PAL_TEST_STUB_LOG_H
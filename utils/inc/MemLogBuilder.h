@@ -15,6 +15,7 @@
 #include "kpi_queue.h"
 #include "ResourceManager.h"
 #include "Stream.h"
+#include "PalTrace.h"
 #include <inttypes.h>
 #ifndef PAL_MEMLOG_UNSUPPORTED
 int palStateQueueBuilder(pal_state_queue &que, Stream *s, pal_state_queue_state state, int32_t error);
@@ -26,11 +27,12 @@ void kpiEnqueue(const char name[], bool isEnter);
 static inline int palStateQueueBuilder(pal_state_queue &que, Stream *s, pal_state_queue_state state, int32_t error)
 {return 0;}
 static inline int palStateEnqueue(Stream *s, pal_state_queue_state state, int32_t error)
-{return 0;}
+{PalTrace::instant("pal_state", state); return 0;}
 static inline int palStateEnqueue(Stream *s, pal_state_queue_state state, int32_t error, union pal_mlog_str_info str_info)
-{return 0;}
+{PalTrace::instant("pal_state", state); return 0;}
 pal_mlog_acdstr_info palStateACDStreamBuilder(Stream *s);
+/* name must be a literal or __func__, it is kept by pointer for tracing */
 static inline void kpiEnqueue(const char name[], bool isEnter)
-{return;}
+{isEnter ? PalTrace::begin(name) : PalTrace::end(name);}
 #endif
 #endif
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef PAL_DUMP_WRITER_H
+#define PAL_DUMP_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#define PAL_DUMP_QUEUE_SIZE (1 << 20)
+#define PAL_DUMP_MAX_OPEN 16
+#define PAL_DUMP_PATH_LEN 128
+#define PAL_DUMP_DEFAULT_MAX_FILES 32
+#define PAL_DUMP_WRITER_NICE 10
+
+/*
+ * Debug dump files written off the audio threads. write() copies the data
+ * into a preallocated queue and returns, a low priority thread does the
+ * file I/O. When the queue is full the data is dropped and counted instead
+ * of blocking the caller, the drops of a file are logged when it closes.
+ *
+ * Files are named <dir>/<name>_<cnt>.<ext> like the ST_DBG_FILE macros,
+ * only the last debug_dump_max_files files of a name are kept on disk.
+ * Nothing is allocated until the first open().
+ */
+class PalDumpWriter
+{
+public:
+    /* returns a handle for write/close, negative errno on failure */
+    static int open(const char *dir, const char *name, const char *ext, int cnt);
+    static int write(int handle, const void *data, size_t size);
+    static void close(int handle);
+    /* 0 keeps every file */
+    static void setMaxFiles(uint32_t maxFiles);
+    static void deinit();
+private:
+    enum op {
+        OP_PAD = 0,
+        OP_OPEN,
+        OP_WRITE,
+        OP_CLOSE,
+    };
+    /* records are 16 byte aligned and never wrap, see enqueue_l() */
+    struct record {
+        uint32_t op;
+        int32_t handle;
+        uint32_t size;
+        uint32_t reserved;
+    };
+    struct file {
+        bool used;
+        FILE *fp;
+        char path[PAL_DUMP_PATH_LEN];
+        char stale[PAL_DUMP_PATH_LEN];   /* file rotated out on open */
+        uint64_t written;
+        uint64_t dropped;
+    };
+    static int enqueue_l(uint32_t op, int handle, const void *data, size_t size,
+                         size_t reserve);
+    static void writerLoop();
+    static void process(struct record *rec);
+
+    static std::mutex dumpMutex;
+    static std::condition_variable dumpCv;
+    static std::thread writer;
+    static bool exitWriter;
+    static uint8_t *queue;
+    static uint64_t head;     /* bytes ever queued */
+    static uint64_t tail;     /* bytes ever written out */
+    static struct file files[PAL_DUMP_MAX_OPEN];
+    static std::atomic<uint32_t> maxFiles;
+};
+
+#endif //PAL_DUMP_WRITER_H
@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef PAL_INIT_GRAPH_H
+#define PAL_INIT_GRAPH_H
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "PalDefs.h"
+
+/*
+ * Dependency aware list of initialization stages. run() starts every
+ * stage on its own worker thread, a stage only executes once all of its
+ * dependencies finished successfully and is skipped with -ECANCELED when
+ * one of them failed. Stages run inline on the caller thread (lazily
+ * loaded plugins, pal_init steps) are timed into the same report so one
+ * PAL_PARAM_ID_INIT_STAGE_TIMING query covers the whole bring-up.
+ */
+class PalInitGraph
+{
+public:
+    typedef std::function<int()> stage_fn_t;
+
+    PalInitGraph();
+    int addStage(const std::string &name, stage_fn_t fn,
+                 const std::vector<std::string> &deps = {});
+    /* returns the status of the first failed stage in registration order */
+    int run();
+    int runInline(const std::string &name, stage_fn_t fn);
+    std::string getFailedStage();
+    void getTiming(pal_param_init_stage_timing_t *timing);
+private:
+    struct init_stage {
+        std::string name;
+        stage_fn_t fn;
+        std::vector<size_t> deps;
+        bool done;
+        int status;
+        uint32_t start_us;
+        uint32_t duration_us;
+    };
+    void runStage(size_t idx);
+    uint32_t elapsedUs();
+
+    std::vector<struct init_stage> stages;
+    size_t pendingBegin;
+    std::mutex stageMutex;
+    std::condition_variable stageCv;
+    std::chrono::steady_clock::time_point t0;
+};
+
+#endif //PAL_INIT_GRAPH_H
@@ -34,6 +34,9 @@
 
 
 #include <stdlib.h>
+#include <array>
+#include <atomic>
+#include <condition_variable>
 #include <memory>
 #include <mutex>
 #include <vector>
@@ -47,6 +50,7 @@
 #define PALRINGBUFFER_H_
 
 #define DEFAULT_PAL_RING_BUFFER_SIZE 4096 * 10
+#define PAL_RING_BUFFER_MAX_READERS 16
 
 typedef enum {
     READER_DISABLED = 0,
@@ -65,55 +69,85 @@ struct kwdConfig {
     uint32_t ftrtSize;
 };
 
+/*
+ * Contiguous region of unread data inside the ring buffer. Data which
+ * wraps around the end of the buffer is described by two spans.
+ */
+struct PalRingBufferSpan {
+    char *data;
+    size_t size;
+};
+
 class PalRingBuffer;
 
+/*
+ * Single writer/multi reader ring buffer. The writer publishes a monotonic
+ * write count and every reader owns a monotonic read count, so the data path
+ * (write, peek, commit, read) never takes a lock. mutex_ in PalRingBuffer only
+ * guards reader registration and keyword configuration.
+ */
 class PalRingBufferReader {
  public:
      PalRingBufferReader(PalRingBuffer *buffer)
          : ringBuffer_(buffer),
-           unreadSize_(0),
-           readOffset_(0),
-           requestedSize_(0),
-           state_(READER_DISABLED) {}
+           readCount_(0),
+           state_(READER_DISABLED),
+           requestedSize_(0) {}
 
     ~PalRingBufferReader() {};
 
     size_t advanceReadOffset(size_t advanceSize);
     int32_t read(void* readBuffer, size_t readSize);
+    /*
+     * peek returns up to maxSize unread bytes as at most two spans without
+     * consuming them, the data stays valid until commit is called.
+     */
+    int32_t peek(PalRingBufferSpan spans[2], size_t maxSize);
+    /*
+     * peekContiguous returns a pointer to size unread bytes, the data is
+     * gathered into scratch only when it wraps around the buffer end.
+     */
+    int32_t peekContiguous(void **data, size_t size, void *scratch);
+    size_t commit(size_t size);
     void updateState(pal_ring_buffer_reader_state state);
     void getIndices(Stream *s,
         uint32_t *startIdx, uint32_t *endIdx, uint32_t *ftrtSize);
     size_t getUnreadSize();
     size_t getBufferSize();
     void reset();
-    bool isEnabled() { return state_ == READER_ENABLED; }
+    /* disable the reader and wake waitForBuffers, the read count is kept */
+    void cancelWait();
+    bool isEnabled() { return state_.load() == READER_ENABLED; }
     bool waitForBuffers(uint32_t buffer_size);
 
     friend class PalRingBuffer;
 
  protected:
     PalRingBuffer *ringBuffer_;
-    size_t unreadSize_;
-    size_t readOffset_;
-    pal_ring_buffer_reader_state state_;
+    std::atomic<uint64_t> readCount_;
+    std::atomic<pal_ring_buffer_reader_state> state_;
     std::mutex mutex_;
     std::condition_variable cv_;
-    uint32_t requestedSize_;
+    std::atomic<uint32_t> requestedSize_;
 };
 
 class PalRingBuffer {
  public:
     explicit PalRingBuffer(size_t bufferSize)
         : buffer_((char*)(new char[bufferSize])),
-          writeOffset_(0),
-          bufferEnd_(bufferSize) {}
+          writeCount_(0),
+          bufferEnd_(bufferSize),
+          writeActive_(false) {
+        for (auto &reader : readers_)
+            reader.store(nullptr);
+    }
 
     ~PalRingBuffer() {
         if (buffer_)
-            delete buffer_;
+            delete[] buffer_;
 
-        for (int i = 0; i < readers_.size(); i++)
-            delete readers_[i];
+        for (auto &reader : readers_)
+            delete reader.load();
     }
 
     PalRingBufferReader* newReader();
@@ -135,10 +169,13 @@ class PalRingBuffer {
     std::mutex mutex_;
     char* buffer_;
     std::unordered_map<Stream*, struct kwdConfig> kwCfg_;
-    size_t writeOffset_;
+    std::atomic<uint64_t> writeCount_;
     size_t bufferEnd_;
-    std::vector<PalRingBufferReader*> readers_;
-    void updateUnReadSize(size_t writtenSize);
+    std::array<std::atomic<PalRingBufferReader*>, PAL_RING_BUFFER_MAX_READERS> readers_;
+    std::atomic<bool> writeActive_;
+    size_t getFreeSize_l();
+    void notifyReaders();
+    size_t getUnreadSize(PalRingBufferReader *reader);
     friend class PalRingBufferReader;
 };
 #endif
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef PAL_TRACE_H
+#define PAL_TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+
+/* traces are only written here, clients pick the file name */
+#define PAL_TRACE_DIR "/data/vendor/audio"
+#define PAL_TRACE_DEFAULT_NAME "pal_trace.json"
+#define PAL_TRACE_EVENTS_PER_THREAD 2048
+#define PAL_TRACE_MAX_THREADS 64
+
+/*
+ * Span tracer for production builds, where ATRACE is compiled out. Every
+ * thread records into its own ring of PAL_TRACE_EVENTS_PER_THREAD events,
+ * recording is a relaxed load of the enable flag when tracing is off and
+ * a seqlocked slot write when it is on, no lock is taken.
+ * The rings are exported as a Chrome/Perfetto JSON trace on demand through
+ * PAL_PARAM_ID_KPI_TRACE.
+ *
+ * Event names are stored by pointer and must be string literals or
+ * __func__.
+ */
+class PalTrace
+{
+public:
+    static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+    static void begin(const char *name, uint64_t arg = 0)
+    {
+        if (isEnabled())
+            record(name, 'B', arg);
+    }
+    static void end(const char *name, uint64_t arg = 0)
+    {
+        if (isEnabled())
+            record(name, 'E', arg);
+    }
+    static void instant(const char *name, uint64_t arg)
+    {
+        if (isEnabled())
+            record(name, 'i', arg);
+    }
+    /* starting drops the events of a previous session */
+    static void enable(bool enable);
+    /* name is a plain file name under PAL_TRACE_DIR */
+    static int dump(const char *name);
+    /* PAL_PARAM_ID_KPI_TRACE */
+    static int setParam(void *payload, size_t size);
+private:
+    struct event {
+        uint64_t ts_ns;
+        const char *name;
+        uint64_t arg;
+        int32_t tid;
+        char phase;
+    };
+    struct slot {
+        std::atomic<uint64_t> seq;    /* odd while being written */
+        struct event e;
+    };
+    struct ring {
+        std::atomic<bool> owned;
+        std::atomic<uint64_t> head;   /* events ever written */
+        struct slot slots[PAL_TRACE_EVENTS_PER_THREAD];
+    };
+    static void record(const char *name, char phase, uint64_t arg);
+    static struct ring *threadRing();
+
+    static std::atomic<bool> enabled;
+    static std::atomic<uint64_t> sessionStartNs;
+    static std::atomic<uint32_t> dropped;
+    static std::mutex ringMutex;
+    static struct ring *rings[PAL_TRACE_MAX_THREADS];
+    static size_t numRings;
+};
+
+/* begin/end span for the enclosing scope */
+class PalTraceSpan
+{
+public:
+    PalTraceSpan(const char *name, uint64_t arg = 0) : name(name)
+    {
+        PalTrace::begin(name, arg);
+    }
+    ~PalTraceSpan() { PalTrace::end(name); }
+private:
+    const char *name;
+};
+
+#define PAL_TRACE_SPAN(name) PalTraceSpan palTraceSpan(name)
+#define PAL_TRACE_SPAN_ARG(name, arg) PalTraceSpan palTraceSpan(name, arg)
+
+#endif //PAL_TRACE_H
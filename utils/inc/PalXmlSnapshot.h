@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef PAL_XML_SNAPSHOT_H
+#define PAL_XML_SNAPSHOT_H
+
+#include <expat.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/*
+ * Binary snapshot of the expat callback stream of a config XML. The
+ * first parse of an XML records every start tag, end tag and character
+ * data callback, later parses mmap the snapshot and replay the records
+ * into the same handlers without running expat. Tag names, attributes
+ * and the indentation between tags repeat all over the PAL XMLs, so each
+ * distinct string is stored once and the records refer to it by index.
+ *
+ * Validity is decided from stat() of the XML alone, the XML itself is not
+ * read when a snapshot matches:
+ * - a prebuilt snapshot next to the XML (palxmlsnapshot at build time)
+ *   matches when it records the XML size and the XML was not modified or
+ *   changed after the snapshot was written, like a make rule. Both come
+ *   from the same image, a pushed or restored XML is newer.
+ * - the snapshot parse keeps in PAL_XML_SNAPSHOT_DIR matches when the XML
+ *   size, mtime, ctime and inode are the ones it was recorded from.
+ * When neither matches, the XML is parsed and the snapshot in
+ * PAL_XML_SNAPSHOT_DIR rebuilt. An update which replaces an XML by one of
+ * the same size and timestamps must ship its prebuilt snapshot.
+ */
+#ifndef PAL_XML_SNAPSHOT_DIR
+#define PAL_XML_SNAPSHOT_DIR "/data/vendor/audio"
+#endif
+#define PAL_XML_SNAPSHOT_EXT ".snapshot"
+#define PAL_XML_SNAPSHOT_MAGIC 0x4c4d5850 /* "PXML" */
+#define PAL_XML_SNAPSHOT_VERSION 3
+
+typedef enum {
+    XML_SNAPSHOT_START_TAG = 1,
+    XML_SNAPSHOT_END_TAG,
+    XML_SNAPSHOT_CHAR_DATA,
+} xml_snapshot_record_t;
+
+/* identity of the source XML, only the size is set for prebuilt snapshots */
+struct xml_snapshot_key {
+    uint64_t size;
+    uint64_t mtime_ns;
+    uint64_t ctime_ns;
+    uint64_t ino;
+};
+
+/*
+ * Followed by string_count strings (varint length, bytes, NUL) and the
+ * records (type byte, varint string indices; a start tag has its
+ * attribute count, the tag name and the attribute names and values).
+ */
+struct xml_snapshot_header {
+    uint32_t magic;
+    uint32_t version;
+    struct xml_snapshot_key xml;
+    uint32_t string_count;
+    uint32_t strings_size;
+    uint32_t records_size;
+    uint32_t reserved;
+};
+
+struct xml_snapshot_handlers {
+    void *userdata;
+    XML_StartElementHandler start_tag;
+    XML_EndElementHandler end_tag;
+    XML_CharacterDataHandler char_data;
+};
+
+struct xml_snapshot_recorder;
+
+class PalXmlSnapshot
+{
+public:
+    /*
+     * Drive handlers with the content of xmlFile, from its snapshot when
+     * valid or with expat otherwise. Returns -ENOENT if xmlFile does not
+     * exist, like the fopen based parsers it replaces.
+     */
+    static int parse(const std::string &xmlFile, void *userdata,
+                     XML_StartElementHandler startTag,
+                     XML_EndElementHandler endTag,
+                     XML_CharacterDataHandler charData);
+    /* Offline generation, used by the palxmlsnapshot host tool */
+    static int generate(const std::string &xmlFile, const std::string &snapshotFile);
+    static std::string getSnapshotPath(const std::string &xmlFile);
+    static std::string getPrebuiltSnapshotPath(const std::string &xmlFile);
+    static uint32_t crc32(const uint8_t *data, size_t size);
+private:
+    static int statXml(const std::string &xmlFile, struct xml_snapshot_key *key,
+                       uint64_t *changed_ns);
+    static int mapXml(const std::string &xmlFile, const uint8_t **data, size_t *size);
+    static void unmapXml(const uint8_t *data, size_t size);
+    static int parseXml(const std::string &xmlFile, const uint8_t *data, size_t size,
+                        struct xml_snapshot_handlers *handlers,
+                        struct xml_snapshot_recorder *rec);
+    static int replay(const std::string &snapshotFile, const std::string &xmlFile,
+                      const struct xml_snapshot_key &key, uint64_t changed_ns,
+                      bool prebuilt, struct xml_snapshot_handlers *handlers);
+    static int validateRecords(const uint8_t *records, size_t size, uint32_t count);
+    static int writeSnapshot(const std::string &snapshotFile,
+                             const struct xml_snapshot_key &key,
+                             const struct xml_snapshot_recorder &rec);
+    static void putVarint(std::vector<uint8_t> *out, uint32_t val);
+    static bool getVarint(const uint8_t *data, size_t size, size_t *offs, uint32_t *val);
+    static uint32_t internString(struct xml_snapshot_recorder *rec, const char *str, size_t len);
+    static void recordStartTag(void *userdata, const XML_Char *tag_name, const XML_Char **attr);
+    static void recordEndTag(void *userdata, const XML_Char *tag_name);
+    static void recordCharData(void *userdata, const XML_Char *s, int len);
+};
+
+#endif //PAL_XML_SNAPSHOT_H
@@ -33,6 +33,7 @@
  */
 
 #include "AudioHapticsInterface.h"
+#include "PalXmlSnapshot.h"
 
 #define LOG_TAG "PAL: AudioHapticsInterface"
 #define HAPTICS_XML_FILE "/vendor/etc/Hapticsconfig.xml"
@@ -124,60 +125,17 @@ void AudioHapticsInterface::handleData(void *userdata, const char *s, int len)
 }
 
 int AudioHapticsInterface::XmlParser(std::string xmlFile) {
-    XML_Parser parser;
-    FILE *file = NULL;
     int ret = 0;
-    int bytes_read;
-    void *buf = NULL;
     struct haptics_xml_data data;
     memset(&data, 0, sizeof(data));
 
     PAL_INFO(LOG_TAG, "XML parsing started %s", xmlFile.c_str());
-    file = fopen(xmlFile.c_str(), "r");
-    if (!file) {
-        PAL_ERR(LOG_TAG, "Failed to open xml");
+    ret = PalXmlSnapshot::parse(xmlFile, &data, startTag, endTag, handleData);
+    if (ret) {
+        PAL_ERR(LOG_TAG, "Failed to parse xml ret %d", ret);
         ret = -EINVAL;
-        goto done;
-    }
-
-    parser = XML_ParserCreate(NULL);
-    if (!parser) {
-        PAL_ERR(LOG_TAG, "Failed to create XML");
-        goto closeFile;
-    }
-    XML_SetUserData(parser,&data);
-    XML_SetElementHandler(parser, startTag, endTag);
-    XML_SetCharacterDataHandler(parser, handleData);
-
-while (1) {
-        buf = XML_GetBuffer(parser, 1024);
-        if (buf == NULL) {
-            PAL_ERR(LOG_TAG, "XML_Getbuffer failed");
-            ret = -EINVAL;
-            goto freeParser;
-        }
-
-        bytes_read = fread(buf, 1, 1024, file);
-        if (bytes_read < 0) {
-            PAL_ERR(LOG_TAG, "fread failed");
-            ret = -EINVAL;
-            goto freeParser;
-        }
-
-        if (XML_ParseBuffer(parser, bytes_read, bytes_read == 0) == XML_STATUS_ERROR) {
-            PAL_ERR(LOG_TAG, "XML ParseBuffer failed ");
-            ret = -EINVAL;
-            goto freeParser;
-        }
-        if (bytes_read == 0)
-            break;
     }
 
-freeParser:
-    XML_ParserFree(parser);
-closeFile:
-    fclose(file);
-done:
     return ret;
 }
 
@@ -74,6 +74,8 @@ int palStateEnqueue(Stream *s, pal_state_queue_state state, int32_t error)
 {
     int ret = 0;
     struct pal_state_queue que;
+
+    PalTrace::instant("pal_state", state);
     ret = palStateQueueBuilder(que, s, state, error);
     if (ret != 0)
     {
@@ -96,6 +98,8 @@ int palStateEnqueue(Stream *s, pal_state_queue_state state, int32_t error, pal_m
 {
     int ret = 0;
     struct pal_state_queue que;
+
+    PalTrace::instant("pal_state", state);
     ret = palStateQueueBuilder(que, s, state, error);
     if (ret != 0)
     {
@@ -118,6 +122,10 @@ void kpiEnqueue(const char name[], bool isEnter)
 {
     struct kpi_queue que;
 
+    if (isEnter)
+        PalTrace::begin(name);
+    else
+        PalTrace::end(name);
     strlcpy(que.func_name, name, sizeof(que.func_name));
     que.pid = ::android::hardware::IPCThreadState::self()->getCallingPid();
     que.timestamp = memLoggerFetchTimestamp();
@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#define LOG_TAG "PAL: PalDumpWriter"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include "PalDumpWriter.h"
+#include "PalCommon.h"
+
+#define DUMP_ALIGN(x) (((x) + 15) & ~((size_t)15))
+/* room for an open and a close record of every handle, data never uses it */
+#define DUMP_CTRL_RESERVE (2 * PAL_DUMP_MAX_OPEN * sizeof(struct record))
+
+std::mutex PalDumpWriter::dumpMutex;
+std::condition_variable PalDumpWriter::dumpCv;
+std::thread PalDumpWriter::writer;
+bool PalDumpWriter::exitWriter = false;
+uint8_t *PalDumpWriter::queue = nullptr;
+uint64_t PalDumpWriter::head = 0;
+uint64_t PalDumpWriter::tail = 0;
+struct PalDumpWriter::file PalDumpWriter::files[PAL_DUMP_MAX_OPEN];
+std::atomic<uint32_t> PalDumpWriter::maxFiles(PAL_DUMP_DEFAULT_MAX_FILES);
+
+void PalDumpWriter::setMaxFiles(uint32_t max)
+{
+    PAL_INFO(LOG_TAG, "keep %u dump files per name", max);
+    maxFiles.store(max);
+}
+
+/*
+ * A record never wraps: when it does not fit before the end of the queue
+ * the rest is skipped with a pad record. Sizes are multiples of 16, so
+ * whatever is left before the end always holds at least a header.
+ */
+int PalDumpWriter::enqueue_l(uint32_t op, int handle, const void *data, size_t size,
+                             size_t reserve)
+{
+    size_t need = sizeof(struct record) + DUMP_ALIGN(size);
+    size_t pos = head % PAL_DUMP_QUEUE_SIZE;
+    size_t toEnd = PAL_DUMP_QUEUE_SIZE - pos;
+    size_t pad = need > toEnd ? toEnd : 0;
+    struct record *rec = nullptr;
+
+    if (head - tail + pad + need + reserve > PAL_DUMP_QUEUE_SIZE)
+        return -ENOSPC;
+
+    if (pad) {
+        rec = (struct record *)(queue + pos);
+        rec->op = OP_PAD;
+        rec->handle = -1;
+        rec->size = pad - sizeof(struct record);
+        head += pad;
+        pos = 0;
+    }
+    rec = (struct record *)(queue + pos);
+    rec->op = op;
+    rec->handle = handle;
+    rec->size = size;
+    rec->reserved = 0;
+    if (size)
+        memcpy(rec + 1, data, size);
+    head += need;
+    return 0;
+}
+
+int PalDumpWriter::open(const char *dir, const char *name, const char *ext, int cnt)
+{
+    int handle = -ENOSPC;
+    uint32_t keep = maxFiles.load();
+    struct file *f = nullptr;
+
+    if (!dir || !name || !ext)
+        return -EINVAL;
+
+    std::unique_lock<std::mutex> lock(dumpMutex);
+    if (!queue) {
+        queue = (uint8_t *)calloc(1, PAL_DUMP_QUEUE_SIZE);
+        if (!queue) {
+            PAL_ERR(LOG_TAG, "failed to allocate dump queue");
+            return -ENOMEM;
+        }
+    }
+    if (!writer.joinable())
+        writer = std::thread(writerLoop);
+
+    for (int i = 0; i < PAL_DUMP_MAX_OPEN; i++) {
+        if (!files[i].used) {
+            handle = i;
+            break;
+        }
+    }
+    if (handle < 0) {
+        PAL_ERR(LOG_TAG, "no free dump handle for %s_%d.%s", name, cnt, ext);
+        return handle;
+    }
+
+    f = &files[handle];
+    f->used = true;
+    f->fp = nullptr;
+    f->written = 0;
+    f->dropped = 0;
+    snprintf(f->path, sizeof(f->path), "%s/%s_%d.%s", dir, name, cnt, ext);
+    f->stale[0] = '\0';
+    if (keep && cnt >= (int)keep)
+        snprintf(f->stale, sizeof(f->stale), "%s/%s_%d.%s", dir, name,
+                 cnt - (int)keep, ext);
+    enqueue_l(OP_OPEN, handle, nullptr, 0, 0);
+    lock.unlock();
+    dumpCv.notify_one();
+    return handle;
+}
+
+int PalDumpWriter::write(int handle, const void *data, size_t size)
+{
+    int ret = 0;
+
+    if (handle < 0 || handle >= PAL_DUMP_MAX_OPEN || !data || !size)
+        return -EINVAL;
+
+    {
+        std::lock_guard<std::mutex> lock(dumpMutex);
+        if (!files[handle].used)
+            return -EINVAL;
+        ret = enqueue_l(OP_WRITE, handle, data, size, DUMP_CTRL_RESERVE);
+        if (ret) {
+            files[handle].dropped += size;
+            return ret;
+        }
+    }
+    dumpCv.notify_one();
+    return ret;
+}
+
+void PalDumpWriter::close(int handle)
+{
+    if (handle < 0 || handle >= PAL_DUMP_MAX_OPEN)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(dumpMutex);
+        if (!files[handle].used)
+            return;
+        if (enqueue_l(OP_CLOSE, handle, nullptr, 0, 0)) {
+            PAL_ERR(LOG_TAG, "failed to queue close of %s", files[handle].path);
+            return;
+        }
+    }
+    dumpCv.notify_one();
+}
+
+/* runs on the writer thread without dumpMutex, only it touches fp and written */
+void PalDumpWriter::process(struct record *rec)
+{
+    struct file *f = nullptr;
+
+    if (rec->op == OP_PAD)
+        return;
+
+    f = &files[rec->handle];
+    switch (rec->op) {
+        case OP_OPEN:
+            if (f->stale[0])
+                unlink(f->stale);
+            f->fp = fopen(f->path, "wb");
+            if (!f->fp)
+                PAL_ERR(LOG_TAG, "failed to open %s, errno %d", f->path, errno);
+            break;
+        case OP_WRITE:
+            if (f->fp && fwrite(rec + 1, 1, rec->size, f->fp) == rec->size)
+                f->written += rec->size;
+            break;
+        case OP_CLOSE:
+            if (f->fp) {
+                fclose(f->fp);
+                f->fp = nullptr;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void PalDumpWriter::writerLoop()
+{
+    struct record *rec = nullptr;
+    struct file *f = nullptr;
+
+    /* on Linux this lowers the calling thread only */
+    setpriority(PRIO_PROCESS, 0, PAL_DUMP_WRITER_NICE);
+
+    std::unique_lock<std::mutex> lock(dumpMutex);
+    PAL_DBG(LOG_TAG, "writer started");
+    while (true) {
+        if (head == tail) {
+            if (exitWriter)
+                break;
+            dumpCv.wait(lock);
+            continue;
+        }
+
+        rec = (struct record *)(queue + tail % PAL_DUMP_QUEUE_SIZE);
+        lock.unlock();
+        process(rec);
+        lock.lock();
+
+        if (rec->op == OP_CLOSE) {
+            f = &files[rec->handle];
+            if (f->dropped)
+                PAL_ERR(LOG_TAG, "%s: wrote %llu bytes, dropped %llu bytes", f->path,
+                        (unsigned long long)f->written, (unsigned long long)f->dropped);
+            else
+                PAL_DBG(LOG_TAG, "%s: wrote %llu bytes", f->path,
+                        (unsigned long long)f->written);
+            f->used = false;
+        }
+        tail += sizeof(struct record) + DUMP_ALIGN(rec->size);
+    }
+
+    /* files the caller never closed */
+    for (int i = 0; i < PAL_DUMP_MAX_OPEN; i++) {
+        if (files[i].fp) {
+            fclose(files[i].fp);
+            files[i].fp = nullptr;
+        }
+        files[i].used = false;
+    }
+    PAL_DBG(LOG_TAG, "writer exited");
+}
+
+void PalDumpWriter::deinit()
+{
+    {
+        std::lock_guard<std::mutex> lock(dumpMutex);
+        exitWriter = true;
+    }
+    dumpCv.notify_all();
+    /* the writer drains the queue before it exits */
+    if (writer.joinable())
+        writer.join();
+
+    std::lock_guard<std::mutex> lock(dumpMutex);
+    exitWriter = false;
+    free(queue);
+    queue = nullptr;
+    head = 0;
+    tail = 0;
+}
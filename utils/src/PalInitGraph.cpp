@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#define LOG_TAG "PAL: PalInitGraph"
+
+#include <errno.h>
+#include <string.h>
+#include <thread>
+#include "PalInitGraph.h"
+#include "PalCommon.h"
+
+PalInitGraph::PalInitGraph()
+{
+    pendingBegin = 0;
+    t0 = std::chrono::steady_clock::now();
+}
+
+uint32_t PalInitGraph::elapsedUs()
+{
+    return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - t0).count();
+}
+
+int PalInitGraph::addStage(const std::string &name, stage_fn_t fn,
+                           const std::vector<std::string> &deps)
+{
+    struct init_stage stage = {};
+    std::lock_guard<std::mutex> lock(stageMutex);
+
+    for (auto &dep : deps) {
+        size_t i = 0;
+
+        /* deps must be registered first, which also rules out cycles */
+        for (i = pendingBegin; i < stages.size(); i++) {
+            if (stages[i].name == dep)
+                break;
+        }
+        if (i == stages.size()) {
+            PAL_ERR(LOG_TAG, "stage %s depends on unknown stage %s",
+                    name.c_str(), dep.c_str());
+            return -EINVAL;
+        }
+        stage.deps.push_back(i);
+    }
+    stage.name = name;
+    stage.fn = fn;
+    stage.done = false;
+    stage.status = 0;
+    stages.push_back(stage);
+    return 0;
+}
+
+void PalInitGraph::runStage(size_t idx)
+{
+    stage_fn_t fn;
+    uint32_t start = 0;
+    int status = 0;
+    std::unique_lock<std::mutex> lock(stageMutex);
+
+    for (size_t dep : stages[idx].deps) {
+        stageCv.wait(lock, [&] { return stages[dep].done; });
+        if (stages[dep].status) {
+            PAL_ERR(LOG_TAG, "skip stage %s, %s failed", stages[idx].name.c_str(),
+                    stages[dep].name.c_str());
+            status = -ECANCELED;
+            goto done;
+        }
+    }
+    fn = stages[idx].fn;
+    lock.unlock();
+
+    start = elapsedUs();
+    try {
+        status = fn();
+    } catch (const std::exception& e) {
+        PAL_ERR(LOG_TAG, "stage %s threw: %s", stages[idx].name.c_str(), e.what());
+        status = -EINVAL;
+    }
+
+    lock.lock();
+    stages[idx].start_us = start;
+    stages[idx].duration_us = elapsedUs() - start;
+    PAL_DBG(LOG_TAG, "stage %s took %u us, status %d", stages[idx].name.c_str(),
+            stages[idx].duration_us, status);
+done:
+    stages[idx].status = status;
+    stages[idx].done = true;
+    lock.unlock();
+    stageCv.notify_all();
+}
+
+int PalInitGraph::run()
+{
+    std::vector<std::thread> workers;
+    size_t begin = 0;
+    size_t end = 0;
+    int status = 0;
+
+    stageMutex.lock();
+    begin = pendingBegin;
+    end = stages.size();
+    stageMutex.unlock();
+
+    PAL_INFO(LOG_TAG, "Enter: running %zu init stages", end - begin);
+    for (size_t i = begin; i < end; i++)
+        workers.emplace_back(&PalInitGraph::runStage, this, i);
+    for (auto &worker : workers)
+        worker.join();
+
+    std::lock_guard<std::mutex> lock(stageMutex);
+    pendingBegin = end;
+    for (size_t i = begin; i < end; i++) {
+        if (stages[i].status && stages[i].status != -ECANCELED) {
+            status = stages[i].status;
+            break;
+        }
+    }
+    PAL_INFO(LOG_TAG, "Exit: %u us, status %d", elapsedUs(), status);
+    return status;
+}
+
+int PalInitGraph::runInline(const std::string &name, stage_fn_t fn)
+{
+    struct init_stage stage = {};
+    uint32_t start = elapsedUs();
+    int status = fn();
+
+    stage.name = name;
+    stage.done = true;
+    stage.status = status;
+    stage.start_us = start;
+    stage.duration_us = elapsedUs() - start;
+    PAL_DBG(LOG_TAG, "stage %s took %u us, status %d", name.c_str(),
+            stage.duration_us, status);
+
+    std::lock_guard<std::mutex> lock(stageMutex);
+    stages.push_back(stage);
+    pendingBegin = stages.size();
+    return status;
+}
+
+std::string PalInitGraph::getFailedStage()
+{
+    std::lock_guard<std::mutex> lock(stageMutex);
+
+    for (auto &stage : stages) {
+        if (stage.done && stage.status && stage.status != -ECANCELED)
+            return stage.name;
+    }
+    return "";
+}
+
+void PalInitGraph::getTiming(pal_param_init_stage_timing_t *timing)
+{
+    std::lock_guard<std::mutex> lock(stageMutex);
+    int dropped = 0;
+
+    memset(timing, 0, sizeof(*timing));
+    for (auto &stage : stages) {
+        struct pal_init_stage_timing *entry = NULL;
+
+        if (!stage.done)
+            continue;
+        if (timing->num_stages == PAL_MAX_INIT_STAGES) {
+            dropped++;
+            continue;
+        }
+        entry = &timing->stages[timing->num_stages++];
+        strlcpy(entry->name, stage.name.c_str(), sizeof(entry->name));
+        entry->status = stage.status;
+        entry->start_us = stage.start_us;
+        entry->duration_us = stage.duration_us;
+        if (stage.start_us + stage.duration_us > timing->total_us)
+            timing->total_us = stage.start_us + stage.duration_us;
+    }
+    if (dropped)
+        PAL_ERR(LOG_TAG, "timing report truncated to %d stages, %d dropped",
+                PAL_MAX_INIT_STAGES, dropped);
+}
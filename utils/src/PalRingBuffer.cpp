@@ -34,18 +34,29 @@
 
 #define LOG_TAG "PAL: PalRingBuffer"
 
-#ifdef LINUX_ENABLED
 #include <algorithm>
-#endif
+#include <thread>
 #include "PalRingBuffer.h"
 #include "PalCommon.h"
 #include "StreamSoundTrigger.h"
 
 int32_t PalRingBuffer::removeReader(PalRingBufferReader *reader)
 {
-    auto iter = std::find(readers_.begin(), readers_.end(), reader);
-    if (iter != readers_.end())
-        readers_.erase(iter);
+    std::lock_guard<std::mutex> lck(mutex_);
+    for (auto &slot : readers_) {
+        if (slot.load() == reader) {
+            slot.store(nullptr);
+            break;
+        }
+    }
+
+    /*
+     * The writer walks the reader slots without a lock, wait for any
+     * write pass which may still reference this reader before the caller
+     * is allowed to free it.
+     */
+    while (writeActive_.load())
+        std::this_thread::yield();
 
     return 0;
 }
@@ -56,31 +67,58 @@ size_t PalRingBuffer::read(std::shared_ptr<PalRingBufferReader>reader __unused,
     return 0;
 }
 
-size_t PalRingBuffer::getFreeSize()
+size_t PalRingBuffer::getUnreadSize(PalRingBufferReader *reader)
 {
+    uint64_t writeCount = writeCount_.load();
+    uint64_t readCount = reader->readCount_.load();
+
+    if (writeCount <= readCount)
+        return 0;
 
+    return std::min((size_t)(writeCount - readCount), bufferEnd_);
+}
+
+size_t PalRingBuffer::getFreeSize_l()
+{
     size_t freeSize = bufferEnd_;
-    std::vector<PalRingBufferReader*>::iterator it;
+    PalRingBufferReader *reader = nullptr;
 
-    for (it = readers_.begin(); it != readers_.end(); it++) {
-        if ((*(it))->state_ == READER_ENABLED)
-            freeSize = std::min(freeSize, bufferEnd_ - (*(it))->unreadSize_);
+    for (auto &slot : readers_) {
+        reader = slot.load();
+        if (reader && reader->state_.load() == READER_ENABLED)
+            freeSize = std::min(freeSize, bufferEnd_ - getUnreadSize(reader));
     }
     return freeSize;
 }
 
-void PalRingBuffer::updateUnReadSize(size_t writtenSize)
+size_t PalRingBuffer::getFreeSize()
 {
-    int32_t i = 0;
-    std::vector<PalRingBufferReader*>::iterator it;
+    size_t freeSize = 0;
 
-    for (it = readers_.begin(); it != readers_.end(); it++, i++) {
-        (*(it))->unreadSize_ += writtenSize;
-        PAL_VERBOSE(LOG_TAG, "Reader (%d), unreadSize(%zu)", i, (*(it))->unreadSize_);
+    writeActive_.store(true);
+    freeSize = getFreeSize_l();
+    writeActive_.store(false);
 
-        if ((*(it))->requestedSize_ > 0 &&
-            (*(it))->unreadSize_ >= (*(it))->requestedSize_) {
-             (*(it))->cv_.notify_one();
+    return freeSize;
+}
+
+void PalRingBuffer::notifyReaders()
+{
+    uint32_t requestedSize = 0;
+    PalRingBufferReader *reader = nullptr;
+
+    for (int32_t i = 0; i < readers_.size(); i++) {
+        reader = readers_[i].load();
+        if (!reader)
+            continue;
+
+        PAL_VERBOSE(LOG_TAG, "Reader (%d), unreadSize(%zu)", i,
+                    getUnreadSize(reader));
+        /* only readers blocked in waitForBuffers need a wakeup */
+        requestedSize = reader->requestedSize_.load();
+        if (requestedSize > 0 && getUnreadSize(reader) >= requestedSize) {
+            std::lock_guard<std::mutex> lck(reader->mutex_);
+            reader->cv_.notify_one();
         }
     }
 }
@@ -90,6 +128,9 @@ void PalRingBuffer::updateKwdConfig(Stream *s, uint32_t startIdx, uint32_t endId
 {
     uint32_t sz = 0;
     struct kwdConfig kc;
+    uint64_t writeCount = 0;
+    uint64_t readCount = 0;
+    size_t unreadSize = 0;
     std::vector<PalRingBufferReader *> readers = dynamic_cast<StreamSoundTrigger *>(s)->GetReaders();
 
     std::lock_guard<std::mutex> lck(mutex_);
@@ -98,18 +139,21 @@ void PalRingBuffer::updateKwdConfig(Stream *s, uint32_t startIdx, uint32_t endId
      * offset is almost equal or close (depends on the max pre-roll in shared scenario)
      * to the begining of the buffer. For the subsequent keyword, it can be
      * far from the begining of the buffer relative to start of the keyword within
-     * the buffer. Since the unreadSize_ of subsequent detections is linearly
+     * the buffer. Since the unread size of subsequent detections is linearly
      * increased from the first detection itself, adjust its starting from its
      * pre-roll position in the buffer.
      */
     sz = startIdx >= preRoll ? startIdx - preRoll : 0;
+    writeCount = writeCount_.load();
     for (auto reader : readers) {
-        if (reader->unreadSize_ > sz) {
-            reader->unreadSize_ -= sz;
-            PAL_DBG(LOG_TAG, "adjusted unread size %zu", reader->unreadSize_);
+        readCount = reader->readCount_.load();
+        unreadSize = writeCount > readCount ? writeCount - readCount : 0;
+        if (unreadSize > sz) {
+            unreadSize -= sz;
+            PAL_DBG(LOG_TAG, "adjusted unread size %zu", unreadSize);
         }
-        reader->unreadSize_ %= bufferEnd_;
-        reader->readOffset_ = sz % bufferEnd_;
+        unreadSize %= bufferEnd_;
+        reader->readCount_.store(writeCount - unreadSize);
     }
     kc.startIdx = startIdx - sz;
     kc.endIdx = endIdx - sz;
@@ -128,57 +172,57 @@ void PalRingBuffer::getIndices(Stream *s,
 
 size_t PalRingBuffer::write(void* writeBuffer, size_t writeSize)
 {
-    /* update the unread size for each reader*/
-    size_t freeSize = getFreeSize();
-    size_t writtenSize = 0;
-    size_t i = 0;
+    size_t freeSize = 0;
+    size_t writeOffset = 0;
     size_t sizeToCopy = 0;
+    size_t i = 0;
+    uint64_t writeCount = 0;
 
-    std::lock_guard<std::mutex> lck(mutex_);
-    PAL_DBG(LOG_TAG, "Enter. freeSize(%zu), writeOffset(%zu)", freeSize, writeOffset_);
-
-    if (writeSize <= freeSize)
-        sizeToCopy = writeSize;
-    else
-        sizeToCopy = freeSize;
+    writeActive_.store(true);
+    freeSize = getFreeSize_l();
+    /* only this thread advances the write count */
+    writeCount = writeCount_.load(std::memory_order_relaxed);
+    writeOffset = writeCount % bufferEnd_;
+    PAL_DBG(LOG_TAG, "Enter. freeSize(%zu), writeOffset(%zu)", freeSize, writeOffset);
 
+    sizeToCopy = std::min(writeSize, freeSize);
     if (sizeToCopy) {
         //buffer wrapped around
-        if (writeOffset_ + sizeToCopy > bufferEnd_) {
-            i = bufferEnd_ - writeOffset_;
-
-            ar_mem_cpy(buffer_ + writeOffset_, i, writeBuffer, i);
-            writtenSize += i;
-            sizeToCopy -= writtenSize;
-            ar_mem_cpy(buffer_, sizeToCopy, (char*)writeBuffer + writtenSize,
-                             sizeToCopy);
-            writtenSize += sizeToCopy;
-            writeOffset_ = sizeToCopy;
+        if (writeOffset + sizeToCopy > bufferEnd_) {
+            i = bufferEnd_ - writeOffset;
+            ar_mem_cpy(buffer_ + writeOffset, i, writeBuffer, i);
+            ar_mem_cpy(buffer_, sizeToCopy - i, (char*)writeBuffer + i,
+                             sizeToCopy - i);
         } else {
-            ar_mem_cpy(buffer_ + writeOffset_, sizeToCopy, writeBuffer,
+            ar_mem_cpy(buffer_ + writeOffset, sizeToCopy, writeBuffer,
                              sizeToCopy);
-            writeOffset_ += sizeToCopy;
-            writtenSize = sizeToCopy;
         }
+        /* publish the data to all readers at once */
+        writeCount_.store(writeCount + sizeToCopy);
+        notifyReaders();
     }
-    updateUnReadSize(writtenSize);
-    writeOffset_ = writeOffset_ % bufferEnd_;
-    PAL_DBG(LOG_TAG, "Exit. writeOffset(%zu)", writeOffset_);
-    return writtenSize;
+    writeActive_.store(false);
+
+    PAL_DBG(LOG_TAG, "Exit. writeOffset(%zu)",
+            (size_t)((writeCount + sizeToCopy) % bufferEnd_));
+    return sizeToCopy;
 }
 
 void PalRingBuffer::reset()
 {
-    std::vector<PalRingBufferReader*>::iterator it;
+    PalRingBufferReader *reader = nullptr;
 
     mutex_.lock();
     kwCfg_.clear();
-    writeOffset_ = 0;
+    writeCount_.store(0);
     mutex_.unlock();
 
     /* Reset all the associated readers */
-    for (it = readers_.begin(); it != readers_.end(); it++)
-        (*(it))->reset();
+    for (auto &slot : readers_) {
+        reader = slot.load();
+        if (reader)
+            reader->reset();
+    }
 }
 
 void PalRingBuffer::resizeRingBuffer(size_t bufferSize)
@@ -194,117 +238,145 @@ void PalRingBuffer::resizeRingBuffer(size_t bufferSize)
 bool PalRingBufferReader::waitForBuffers(uint32_t buffer_size)
 {
     std::unique_lock<std::mutex> lck(mutex_);
-    if (state_ == READER_ENABLED) {
-        if (unreadSize_ >= buffer_size)
+    if (state_.load() == READER_ENABLED) {
+        if (getUnreadSize() >= buffer_size)
             goto exit;
-        requestedSize_ = buffer_size;
-        cv_.wait_for(lck, std::chrono::milliseconds(3000));
+        /*
+         * requestedSize_ is published before the unread size is checked
+         * again under mutex_, so a write racing with this wait either is
+         * seen by the predicate or notifies the condition afterwards.
+         */
+        requestedSize_.store(buffer_size);
+        cv_.wait_for(lck, std::chrono::milliseconds(3000), [&] {
+            return getUnreadSize() >= buffer_size ||
+                   state_.load() != READER_ENABLED;
+        });
     }
 
 exit:
-    requestedSize_ = 0;
-    return unreadSize_ >= buffer_size;
+    requestedSize_.store(0);
+    return getUnreadSize() >= buffer_size;
 }
 
-int32_t PalRingBufferReader::read(void* readBuffer, size_t bufferSize)
+int32_t PalRingBufferReader::peek(PalRingBufferSpan spans[2], size_t maxSize)
 {
-    int32_t readSize = 0;
+    pal_ring_buffer_reader_state state = READER_PREPARED;
+    uint64_t writeCount = 0;
+    uint64_t readCount = 0;
+    size_t bufferEnd = ringBuffer_->bufferEnd_;
+    size_t size = 0;
+    size_t readOffset = 0;
 
-    if (state_ == READER_DISABLED) {
+    spans[0] = {nullptr, 0};
+    spans[1] = {nullptr, 0};
+
+    if (state_.load() == READER_DISABLED)
         return -EINVAL;
-    } else if (state_ == READER_PREPARED) {
-        state_ = READER_ENABLED;
+    /*
+     * A write pass which started while this reader was still prepared sized
+     * itself without it and may be overwriting the oldest unread bytes, let
+     * it finish before the spans are taken. Any later pass sees the reader
+     * enabled and leaves its data alone.
+     */
+    if (state_.compare_exchange_strong(state, READER_ENABLED)) {
+        while (ringBuffer_->writeActive_.load())
+            std::this_thread::yield();
     }
 
+    writeCount = ringBuffer_->writeCount_.load();
+    readCount = readCount_.load();
+
     // Return 0 when no data can be read for current reader
-    if (unreadSize_ == 0)
+    if (writeCount <= readCount)
         return 0;
 
-    std::lock_guard<std::mutex> lck(ringBuffer_->mutex_);
+    // Data older than one buffer length was overwritten, skip to oldest data
+    if (writeCount - readCount > bufferEnd) {
+        readCount = writeCount - bufferEnd;
+        readCount_.store(readCount);
+    }
 
-    // when writeOffset leads readOffset
-    if (ringBuffer_->writeOffset_ > readOffset_) {
-        unreadSize_ = ringBuffer_->writeOffset_ - readOffset_;
+    size = std::min((size_t)(writeCount - readCount), maxSize);
+    readOffset = readCount % bufferEnd;
+    spans[0].data = ringBuffer_->buffer_ + readOffset;
+    spans[0].size = std::min(size, bufferEnd - readOffset);
+    if (spans[0].size < size) {
+        spans[1].data = ringBuffer_->buffer_;
+        spans[1].size = size - spans[0].size;
+    }
 
-        if (bufferSize >= unreadSize_) {
-            ar_mem_cpy(readBuffer, unreadSize_, ringBuffer_->buffer_ +
-                             readOffset_, unreadSize_);
-            readOffset_ += unreadSize_;
-            readSize = unreadSize_;
-            unreadSize_ = 0;
-        } else {
-            ar_mem_cpy(readBuffer, unreadSize_, ringBuffer_->buffer_ +
-                             readOffset_, bufferSize);
-            readOffset_ += bufferSize;
-            readSize = bufferSize;
-            unreadSize_ = ringBuffer_->writeOffset_ - readOffset_;
-        }
-    } else {
-        //When readOffset leads WriteOffset
-        int32_t freeClientSize = bufferSize;
-        int32_t i = ringBuffer_->bufferEnd_ - readOffset_;
-
-        if (bufferSize >= i) {
-            ar_mem_cpy(readBuffer, i, (char*)(ringBuffer_->buffer_ +
-                             readOffset_), i);
-            readSize = i;
-            freeClientSize -= readSize;
-            unreadSize_ = ringBuffer_->writeOffset_;
-            readOffset_ = 0;
-            //copy remaining unread buffer
-            if (freeClientSize > unreadSize_) {
-                ar_mem_cpy((char *)readBuffer + readSize, unreadSize_,
-                                 ringBuffer_->buffer_, unreadSize_);
-                readSize += unreadSize_;
-                readOffset_ = unreadSize_;
-                unreadSize_ = 0;
-            } else {
-                //copy whatever we can
-                ar_mem_cpy((char *)readBuffer + readSize, freeClientSize,
-                                 ringBuffer_->buffer_, freeClientSize);
-                readSize += freeClientSize;
-                readOffset_ = freeClientSize;
-                unreadSize_ = ringBuffer_->writeOffset_ - readOffset_;
-            }
+    return size;
+}
 
-        } else {
-            ar_mem_cpy(readBuffer, bufferSize, ringBuffer_->buffer_ +
-                             readOffset_, bufferSize);
-            readSize = bufferSize;
-            readOffset_ += bufferSize;
-            unreadSize_ = ringBuffer_->bufferEnd_ - readOffset_ +
-                          ringBuffer_->writeOffset_;
-        }
+int32_t PalRingBufferReader::peekContiguous(void **data, size_t size,
+                                            void *scratch)
+{
+    PalRingBufferSpan spans[2];
+    int32_t readSize = 0;
+
+    readSize = peek(spans, size);
+    if (readSize <= 0)
+        return readSize;
+
+    if (spans[1].size == 0) {
+        *data = spans[0].data;
+    } else {
+        ar_mem_cpy(scratch, size, spans[0].data, spans[0].size);
+        ar_mem_cpy((char *)scratch + spans[0].size, size - spans[0].size,
+                   spans[1].data, spans[1].size);
+        *data = scratch;
     }
+
     return readSize;
 }
 
-size_t PalRingBufferReader::advanceReadOffset(size_t advanceSize)
+size_t PalRingBufferReader::commit(size_t size)
+{
+    readCount_.fetch_add(size);
+    return size;
+}
+
+int32_t PalRingBufferReader::read(void* readBuffer, size_t bufferSize)
 {
-    std::lock_guard<std::mutex> lock(ringBuffer_->mutex_);
+    PalRingBufferSpan spans[2];
+    int32_t readSize = 0;
+
+    readSize = peek(spans, bufferSize);
+    if (readSize <= 0)
+        return readSize;
 
-    readOffset_ = (readOffset_ + advanceSize) % ringBuffer_->bufferEnd_;
+    ar_mem_cpy(readBuffer, bufferSize, spans[0].data, spans[0].size);
+    if (spans[1].size)
+        ar_mem_cpy((char *)readBuffer + spans[0].size,
+                   bufferSize - spans[0].size, spans[1].data, spans[1].size);
+    commit(readSize);
 
+    return readSize;
+}
+
+size_t PalRingBufferReader::advanceReadOffset(size_t advanceSize)
+{
     /*
      * If the buffer is shared across concurrent detections, the second keyword
      * can start anywhere in the buffer and possibly wrap around to the begining.
      * For this case, advanceSize representing the start of keyword position in the
-     * buffer can be bigger than unReadSize_ which is aleady adjusted.
+     * buffer can be bigger than the unread size which is aleady adjusted, the
+     * reader then waits until the writer reaches the keyword position.
      */
-    if (unreadSize_ > advanceSize) {
-        unreadSize_ -= advanceSize;
-    } else {
+    if (getUnreadSize() < advanceSize)
         PAL_DBG(LOG_TAG, "Warning: trying to advance read offset over write offset");
-    }
-    PAL_INFO(LOG_TAG, "offset %zu, advanced %zu, unread %zu", readOffset_, advanceSize, unreadSize_);
+
+    readCount_.fetch_add(advanceSize);
+    PAL_INFO(LOG_TAG, "offset %zu, advanced %zu, unread %zu",
+             (size_t)(readCount_.load() % ringBuffer_->bufferEnd_), advanceSize,
+             getUnreadSize());
     return advanceSize;
 }
 
 void PalRingBufferReader::updateState(pal_ring_buffer_reader_state state)
 {
     PAL_DBG(LOG_TAG, "update reader state to %d", state);
-    std::lock_guard<std::mutex> lock(ringBuffer_->mutex_);
-    state_ = state;
+    state_.store(state);
 }
 
 void PalRingBufferReader::getIndices(Stream *s,
@@ -315,8 +387,10 @@ void PalRingBufferReader::getIndices(Stream *s,
 
 size_t PalRingBufferReader::getUnreadSize()
 {
-    PAL_VERBOSE(LOG_TAG, "unread size %zu", unreadSize_);
-    return unreadSize_;
+    size_t unreadSize = ringBuffer_->getUnreadSize(this);
+
+    PAL_VERBOSE(LOG_TAG, "unread size %zu", unreadSize);
+    return unreadSize;
 }
 
 size_t PalRingBufferReader::getBufferSize()
@@ -326,18 +400,32 @@ size_t PalRingBufferReader::getBufferSize()
 
 void PalRingBufferReader::reset()
 {
-    std::lock_guard<std::mutex> lock(ringBuffer_->mutex_);
-    readOffset_ = 0;
-    unreadSize_ = 0;
-    state_ = READER_DISABLED;
-    requestedSize_ = 0;
+    std::lock_guard<std::mutex> lock(mutex_);
+    readCount_.store(ringBuffer_->writeCount_.load());
+    state_.store(READER_DISABLED);
+    requestedSize_.store(0);
+    cv_.notify_all();
+}
+
+void PalRingBufferReader::cancelWait()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    state_.store(READER_DISABLED);
     cv_.notify_all();
 }
 
 PalRingBufferReader* PalRingBuffer::newReader()
 {
-    PalRingBufferReader* reader =
-                  new PalRingBufferReader(this);
-    readers_.push_back(reader);
-    return reader;
+    std::lock_guard<std::mutex> lck(mutex_);
+    for (auto &slot : readers_) {
+        if (!slot.load()) {
+            PalRingBufferReader* reader = new PalRingBufferReader(this);
+            slot.store(reader);
+            return reader;
+        }
+    }
+
+    PAL_ERR(LOG_TAG, "No free reader slot, max %d readers",
+            PAL_RING_BUFFER_MAX_READERS);
+    return nullptr;
 }
@@ -0,0 +1,221 @@
+/*
+ * Copyright (c) 2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#define LOG_TAG "PAL: PalTrace"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <new>
+#include <string>
+#include <vector>
+#include "PalTrace.h"
+#include "PalDefs.h"
+#include "PalCommon.h"
+
+std::atomic<bool> PalTrace::enabled(false);
+std::atomic<uint64_t> PalTrace::sessionStartNs(0);
+std::atomic<uint32_t> PalTrace::dropped(0);
+std::mutex PalTrace::ringMutex;
+struct PalTrace::ring *PalTrace::rings[PAL_TRACE_MAX_THREADS];
+size_t PalTrace::numRings = 0;
+
+static uint64_t traceNowNs()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+struct PalTrace::ring *PalTrace::threadRing()
+{
+    /* hands the ring back to the pool when the thread exits */
+    struct ringOwner {
+        struct ring *r = nullptr;
+        ~ringOwner()
+        {
+            if (r)
+                r->owned.store(false, std::memory_order_release);
+        }
+    };
+    static thread_local struct ringOwner owner;
+    struct ring *r = nullptr;
+    bool expected;
+
+    if (owner.r)
+        return owner.r;
+
+    std::lock_guard<std::mutex> lock(ringMutex);
+    for (size_t i = 0; i < numRings; i++) {
+        expected = false;
+        if (rings[i]->owned.compare_exchange_strong(expected, true)) {
+            owner.r = rings[i];
+            return owner.r;
+        }
+    }
+    if (numRings == PAL_TRACE_MAX_THREADS)
+        return nullptr;
+
+    r = new (std::nothrow) struct ring();
+    if (!r)
+        return nullptr;
+    r->owned.store(true);
+    r->head.store(0);
+    rings[numRings++] = r;
+    owner.r = r;
+    return r;
+}
+
+void PalTrace::record(const char *name, char phase, uint64_t arg)
+{
+    static thread_local int32_t tid = (int32_t)syscall(SYS_gettid);
+    struct ring *r = threadRing();
+    struct slot *sl = nullptr;
+    uint64_t idx, seq;
+
+    if (!r) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    /*
+     * single writer, the slot sequence goes odd while the event is written
+     * and ends at twice the number of times the slot was filled
+     */
+    idx = r->head.load(std::memory_order_relaxed);
+    sl = &r->slots[idx % PAL_TRACE_EVENTS_PER_THREAD];
+    seq = sl->seq.load(std::memory_order_relaxed);
+    sl->seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    sl->e.ts_ns = traceNowNs();
+    sl->e.name = name;
+    sl->e.arg = arg;
+    sl->e.tid = tid;
+    sl->e.phase = phase;
+    sl->seq.store(seq + 2, std::memory_order_release);
+    r->head.store(idx + 1, std::memory_order_release);
+}
+
+void PalTrace::enable(bool enable)
+{
+    if (enable) {
+        sessionStartNs.store(traceNowNs());
+        dropped.store(0);
+    }
+    enabled.store(enable);
+    PAL_INFO(LOG_TAG, "kpi tracing %s", enable ? "started" : "stopped");
+}
+
+int PalTrace::dump(const char *name)
+{
+    std::string path;
+    std::vector<struct event> snapshot;
+    uint64_t start = sessionStartNs.load();
+    uint64_t head, first, seq;
+    struct event e;
+    size_t threads = 0;
+    FILE *fp = nullptr;
+    int status = 0;
+    int fd = -1;
+
+    /* the name comes from a client, keep it inside PAL_TRACE_DIR */
+    if (!name || !name[0] || strchr(name, '/') || strstr(name, "..")) {
+        PAL_ERR(LOG_TAG, "invalid trace file name %s", name ? name : "(null)");
+        return -EINVAL;
+    }
+    path = std::string(PAL_TRACE_DIR) + "/" + name;
+
+    /*
+     * Only copy under the lock, the owners keep recording meanwhile. A slot
+     * is kept if its sequence is even and still the one of event idx after
+     * the copy, anything else is being written or was wrapped onto.
+     */
+    snapshot.reserve(PAL_TRACE_EVENTS_PER_THREAD);
+    {
+        std::lock_guard<std::mutex> lock(ringMutex);
+        threads = numRings;
+        for (size_t i = 0; i < numRings; i++) {
+            head = rings[i]->head.load(std::memory_order_acquire);
+            first = head > PAL_TRACE_EVENTS_PER_THREAD ? head - PAL_TRACE_EVENTS_PER_THREAD : 0;
+            for (uint64_t idx = first; idx < head; idx++) {
+                struct slot &sl = rings[i]->slots[idx % PAL_TRACE_EVENTS_PER_THREAD];
+
+                seq = 2 * (idx / PAL_TRACE_EVENTS_PER_THREAD + 1);
+                if (sl.seq.load(std::memory_order_acquire) != seq)
+                    continue;
+                e = sl.e;
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (sl.seq.load(std::memory_order_relaxed) != seq)
+                    continue;
+                if (e.ts_ns >= start)
+                    snapshot.push_back(e);
+            }
+        }
+    }
+
+    fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC, 0640);
+    if (fd >= 0)
+        fp = fdopen(fd, "w");
+    if (!fp) {
+        status = -errno;
+        if (fd >= 0)
+            close(fd);
+        PAL_ERR(LOG_TAG, "failed to open %s, status %d", path.c_str(), status);
+        return status;
+    }
+
+    fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for (size_t j = 0; j < snapshot.size(); j++) {
+        const struct event &ev = snapshot[j];
+
+        fprintf(fp, "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%d,\"tid\":%d,"
+                "%s\"args\":{\"arg\":%llu}}",
+                j ? ",\n" : "", ev.name, ev.phase, (ev.ts_ns - start) / 1000.0,
+                (int)getpid(), ev.tid, ev.phase == 'i' ? "\"s\":\"t\"," : "",
+                (unsigned long long)ev.arg);
+    }
+    fprintf(fp, "\n]}\n");
+    if (fclose(fp)) {
+        status = -errno;
+        PAL_ERR(LOG_TAG, "failed to write %s, status %d", path.c_str(), status);
+        return status;
+    }
+
+    PAL_INFO(LOG_TAG, "wrote %zu events from %zu threads to %s, %u dropped",
+             snapshot.size(), threads, path.c_str(), dropped.load());
+    return status;
+}
+
+int PalTrace::setParam(void *payload, size_t size)
+{
+    pal_param_kpi_trace_t *param = (pal_param_kpi_trace_t *)payload;
+    std::string name;
+
+    if (!param || size != sizeof(pal_param_kpi_trace_t)) {
+        PAL_ERR(LOG_TAG, "Incorrect size : expected (%zu), received(%zu)",
+                sizeof(pal_param_kpi_trace_t), size);
+        return -EINVAL;
+    }
+
+    switch (param->cmd) {
+    case PAL_KPI_TRACE_START:
+        enable(true);
+        break;
+    case PAL_KPI_TRACE_STOP:
+        enable(false);
+        break;
+    case PAL_KPI_TRACE_DUMP:
+        name.assign(param->file_name, strnlen(param->file_name, sizeof(param->file_name)));
+        return dump(name.empty() ? PAL_TRACE_DEFAULT_NAME : name.c_str());
+    default:
+        PAL_ERR(LOG_TAG, "invalid kpi trace cmd %u", param->cmd);
+        return -EINVAL;
+    }
+    return 0;
+}
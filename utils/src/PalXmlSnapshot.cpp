@@ -0,0 +1,477 @@
+/*
+ * Copyright (c) 2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#define LOG_TAG "PAL: PalXmlSnapshot"
+
+#include <algorithm>
+#include <array>
+#include <unordered_map>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "PalXmlSnapshot.h"
+#include "PalCommon.h"
+
+struct xml_snapshot_recorder {
+    struct xml_snapshot_handlers *handlers;
+    std::unordered_map<std::string, uint32_t> ids;
+    std::vector<uint8_t> strings;
+    std::vector<uint8_t> records;
+};
+
+uint32_t PalXmlSnapshot::crc32(const uint8_t *data, size_t size)
+{
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> t;
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++)
+                c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+            t[i] = c;
+        }
+        return t;
+    }();
+    uint32_t crc = 0xFFFFFFFF;
+
+    for (size_t i = 0; i < size; i++)
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFF;
+}
+
+std::string PalXmlSnapshot::getSnapshotPath(const std::string &xmlFile)
+{
+    size_t pos = xmlFile.find_last_of('/');
+    std::string name = (pos == std::string::npos) ? xmlFile : xmlFile.substr(pos + 1);
+
+    return std::string(PAL_XML_SNAPSHOT_DIR) + "/" + name + PAL_XML_SNAPSHOT_EXT;
+}
+
+std::string PalXmlSnapshot::getPrebuiltSnapshotPath(const std::string &xmlFile)
+{
+    return xmlFile + PAL_XML_SNAPSHOT_EXT;
+}
+
+static uint64_t toNs(const struct timespec &ts)
+{
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+int PalXmlSnapshot::statXml(const std::string &xmlFile, struct xml_snapshot_key *key,
+                            uint64_t *changed_ns)
+{
+    struct stat st;
+
+    if (stat(xmlFile.c_str(), &st)) {
+        PAL_ERR(LOG_TAG, "Failed to open xml file name %s ret %d", xmlFile.c_str(), -ENOENT);
+        return -ENOENT;
+    }
+    key->size = st.st_size;
+    key->mtime_ns = toNs(st.st_mtim);
+    key->ctime_ns = toNs(st.st_ctim);
+    key->ino = st.st_ino;
+    *changed_ns = std::max(key->mtime_ns, key->ctime_ns);
+    return 0;
+}
+
+int PalXmlSnapshot::mapXml(const std::string &xmlFile, const uint8_t **data, size_t *size)
+{
+    int fd = -1;
+    int ret = 0;
+    struct stat st;
+    void *map = NULL;
+
+    *data = NULL;
+    *size = 0;
+    fd = open(xmlFile.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        ret = -ENOENT;
+        PAL_ERR(LOG_TAG, "Failed to open xml file name %s ret %d", xmlFile.c_str(), ret);
+        return ret;
+    }
+
+    if (fstat(fd, &st)) {
+        ret = -errno;
+        goto closeFd;
+    }
+    /* an empty file maps to nothing, expat reports it as malformed */
+    if (st.st_size == 0)
+        goto closeFd;
+
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        ret = -errno;
+        PAL_ERR(LOG_TAG, "mmap of %s failed ret %d", xmlFile.c_str(), ret);
+        goto closeFd;
+    }
+    *data = (const uint8_t *)map;
+    *size = st.st_size;
+
+closeFd:
+    close(fd);
+    return ret;
+}
+
+void PalXmlSnapshot::unmapXml(const uint8_t *data, size_t size)
+{
+    if (data)
+        munmap((void *)data, size);
+}
+
+void PalXmlSnapshot::putVarint(std::vector<uint8_t> *out, uint32_t val)
+{
+    while (val >= 0x80) {
+        out->push_back((uint8_t)(val | 0x80));
+        val >>= 7;
+    }
+    out->push_back((uint8_t)val);
+}
+
+bool PalXmlSnapshot::getVarint(const uint8_t *data, size_t size, size_t *offs, uint32_t *val)
+{
+    uint32_t v = 0;
+
+    for (int shift = 0; shift < 32 && *offs < size; shift += 7) {
+        uint8_t b = data[(*offs)++];
+
+        v |= (uint32_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            *val = v;
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t PalXmlSnapshot::internString(struct xml_snapshot_recorder *rec,
+                                      const char *str, size_t len)
+{
+    auto it = rec->ids.emplace(std::string(str, len), rec->ids.size());
+
+    if (it.second) {
+        putVarint(&rec->strings, len);
+        rec->strings.insert(rec->strings.end(), (const uint8_t *)str,
+                            (const uint8_t *)str + len);
+        rec->strings.push_back('\0');
+    }
+    return it.first->second;
+}
+
+void PalXmlSnapshot::recordStartTag(void *userdata, const XML_Char *tag_name,
+                                    const XML_Char **attr)
+{
+    struct xml_snapshot_recorder *rec = (struct xml_snapshot_recorder *)userdata;
+    uint32_t attrCount = 0;
+
+    while (attr[attrCount])
+        attrCount++;
+    rec->records.push_back(XML_SNAPSHOT_START_TAG);
+    putVarint(&rec->records, attrCount);
+    putVarint(&rec->records, internString(rec, tag_name, strlen(tag_name)));
+    for (uint32_t i = 0; i < attrCount; i++)
+        putVarint(&rec->records, internString(rec, attr[i], strlen(attr[i])));
+    if (rec->handlers->start_tag)
+        rec->handlers->start_tag(rec->handlers->userdata, tag_name, attr);
+}
+
+void PalXmlSnapshot::recordEndTag(void *userdata, const XML_Char *tag_name)
+{
+    struct xml_snapshot_recorder *rec = (struct xml_snapshot_recorder *)userdata;
+
+    rec->records.push_back(XML_SNAPSHOT_END_TAG);
+    putVarint(&rec->records, internString(rec, tag_name, strlen(tag_name)));
+    if (rec->handlers->end_tag)
+        rec->handlers->end_tag(rec->handlers->userdata, tag_name);
+}
+
+void PalXmlSnapshot::recordCharData(void *userdata, const XML_Char *s, int len)
+{
+    struct xml_snapshot_recorder *rec = (struct xml_snapshot_recorder *)userdata;
+
+    rec->records.push_back(XML_SNAPSHOT_CHAR_DATA);
+    putVarint(&rec->records, internString(rec, s, len));
+    if (rec->handlers->char_data)
+        rec->handlers->char_data(rec->handlers->userdata, s, len);
+}
+
+int PalXmlSnapshot::parseXml(const std::string &xmlFile, const uint8_t *data, size_t size,
+                             struct xml_snapshot_handlers *handlers,
+                             struct xml_snapshot_recorder *rec)
+{
+    XML_Parser parser;
+    int ret = 0;
+
+    rec->handlers = handlers;
+
+    parser = XML_ParserCreate(NULL);
+    if (!parser) {
+        ret = -EINVAL;
+        PAL_ERR(LOG_TAG, "Failed to create XML ret %d", ret);
+        return ret;
+    }
+
+    XML_SetUserData(parser, rec);
+    XML_SetElementHandler(parser, recordStartTag, recordEndTag);
+    XML_SetCharacterDataHandler(parser, recordCharData);
+
+    /* the whole file is already mapped, hand it to expat in one pass */
+    if (XML_Parse(parser, (const char *)data, size, 1) == XML_STATUS_ERROR) {
+        ret = -EINVAL;
+        PAL_ERR(LOG_TAG, "XML ParseBuffer failed for %s file ret %d", xmlFile.c_str(), ret);
+    }
+
+    XML_ParserFree(parser);
+    return ret;
+}
+
+/*
+ * Walk the records without invoking any handler, a snapshot is either
+ * replayed completely or not at all so the XML fallback never sees
+ * tables which were already partially filled.
+ */
+int PalXmlSnapshot::validateRecords(const uint8_t *records, size_t size, uint32_t count)
+{
+    size_t offs = 0;
+    uint32_t attrCount = 0;
+    uint32_t idx = 0;
+
+    while (offs < size) {
+        switch (records[offs++]) {
+        case XML_SNAPSHOT_START_TAG:
+            if (!getVarint(records, size, &offs, &attrCount) || (attrCount & 1))
+                return -EINVAL;
+            for (uint32_t i = 0; i <= attrCount; i++) {
+                if (!getVarint(records, size, &offs, &idx) || idx >= count)
+                    return -EINVAL;
+            }
+            break;
+        case XML_SNAPSHOT_END_TAG:
+        case XML_SNAPSHOT_CHAR_DATA:
+            if (!getVarint(records, size, &offs, &idx) || idx >= count)
+                return -EINVAL;
+            break;
+        default:
+            return -EINVAL;
+        }
+    }
+    return 0;
+}
+
+int PalXmlSnapshot::replay(const std::string &snapshotFile, const std::string &xmlFile,
+                           const struct xml_snapshot_key &key, uint64_t changed_ns,
+                           bool prebuilt, struct xml_snapshot_handlers *handlers)
+{
+    int fd = -1;
+    int ret = 0;
+    struct stat st;
+    void *map = MAP_FAILED;
+    const struct xml_snapshot_header *hdr = NULL;
+    const uint8_t *strings = NULL;
+    const uint8_t *records = NULL;
+    std::vector<const XML_Char *> strs;
+    std::vector<uint32_t> lens;
+    std::vector<const XML_Char *> attr;
+    uint32_t attrCount = 0;
+    uint32_t attrIdx = 0;
+    uint32_t idx = 0;
+    uint32_t len = 0;
+    size_t offs = 0;
+    bool valid = false;
+
+    fd = open(snapshotFile.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return -ENOENT;
+
+    if (fstat(fd, &st) || (size_t)st.st_size < sizeof(*hdr)) {
+        ret = -EINVAL;
+        goto closeFd;
+    }
+
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        ret = -errno;
+        PAL_ERR(LOG_TAG, "mmap of %s failed ret %d", snapshotFile.c_str(), ret);
+        goto closeFd;
+    }
+
+    hdr = (const struct xml_snapshot_header *)map;
+    if (prebuilt)
+        valid = hdr->xml.size == key.size && changed_ns <= toNs(st.st_mtim);
+    else
+        valid = hdr->xml.size == key.size && hdr->xml.mtime_ns == key.mtime_ns &&
+                hdr->xml.ctime_ns == key.ctime_ns && hdr->xml.ino == key.ino;
+    if (hdr->magic != PAL_XML_SNAPSHOT_MAGIC || hdr->version != PAL_XML_SNAPSHOT_VERSION ||
+        !valid || (uint64_t)hdr->strings_size + hdr->records_size !=
+                  (uint64_t)st.st_size - sizeof(*hdr)) {
+        PAL_INFO(LOG_TAG, "stale snapshot %s for %s", snapshotFile.c_str(), xmlFile.c_str());
+        ret = -ESTALE;
+        goto unmap;
+    }
+
+    strings = (const uint8_t *)map + sizeof(*hdr);
+    records = strings + hdr->strings_size;
+    strs.reserve(hdr->string_count);
+    lens.reserve(hdr->string_count);
+    for (uint32_t i = 0; i < hdr->string_count; i++) {
+        if (!getVarint(strings, hdr->strings_size, &offs, &len) ||
+            hdr->strings_size - offs < (size_t)len + 1 || strings[offs + len] != '\0')
+            break;
+        strs.push_back((const XML_Char *)(strings + offs));
+        lens.push_back(len);
+        offs += len + 1;
+    }
+    if (strs.size() != hdr->string_count || offs != hdr->strings_size ||
+        validateRecords(records, hdr->records_size, hdr->string_count)) {
+        PAL_ERR(LOG_TAG, "corrupt snapshot %s", snapshotFile.c_str());
+        ret = -EINVAL;
+        goto unmap;
+    }
+
+    offs = 0;
+    while (offs < hdr->records_size) {
+        switch (records[offs++]) {
+        case XML_SNAPSHOT_START_TAG:
+            getVarint(records, hdr->records_size, &offs, &attrCount);
+            getVarint(records, hdr->records_size, &offs, &idx);
+            attr.clear();
+            for (uint32_t i = 0; i < attrCount; i++) {
+                getVarint(records, hdr->records_size, &offs, &attrIdx);
+                attr.push_back(strs[attrIdx]);
+            }
+            attr.push_back(NULL);
+            if (handlers->start_tag)
+                handlers->start_tag(handlers->userdata, strs[idx], attr.data());
+            break;
+        case XML_SNAPSHOT_END_TAG:
+            getVarint(records, hdr->records_size, &offs, &idx);
+            if (handlers->end_tag)
+                handlers->end_tag(handlers->userdata, strs[idx]);
+            break;
+        case XML_SNAPSHOT_CHAR_DATA:
+            getVarint(records, hdr->records_size, &offs, &idx);
+            if (handlers->char_data)
+                handlers->char_data(handlers->userdata, strs[idx], lens[idx]);
+            break;
+        }
+    }
+    PAL_INFO(LOG_TAG, "replayed %s from snapshot, %zu bytes", xmlFile.c_str(),
+             (size_t)st.st_size);
+
+unmap:
+    munmap(map, st.st_size);
+closeFd:
+    close(fd);
+    return ret;
+}
+
+int PalXmlSnapshot::writeSnapshot(const std::string &snapshotFile,
+                                  const struct xml_snapshot_key &key,
+                                  const struct xml_snapshot_recorder &rec)
+{
+    struct xml_snapshot_header hdr;
+    std::string tmpFile = snapshotFile + ".tmp";
+    FILE *file = NULL;
+    int ret = 0;
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = PAL_XML_SNAPSHOT_MAGIC;
+    hdr.version = PAL_XML_SNAPSHOT_VERSION;
+    hdr.xml = key;
+    hdr.string_count = rec.ids.size();
+    hdr.strings_size = rec.strings.size();
+    hdr.records_size = rec.records.size();
+
+    file = fopen(tmpFile.c_str(), "wb");
+    if (!file) {
+        ret = -errno;
+        PAL_DBG(LOG_TAG, "cannot create snapshot %s ret %d", tmpFile.c_str(), ret);
+        return ret;
+    }
+    if (fwrite(&hdr, sizeof(hdr), 1, file) != 1 ||
+        (rec.strings.size() &&
+         fwrite(rec.strings.data(), rec.strings.size(), 1, file) != 1) ||
+        (rec.records.size() &&
+         fwrite(rec.records.data(), rec.records.size(), 1, file) != 1)) {
+        ret = -EIO;
+        PAL_ERR(LOG_TAG, "failed to write snapshot %s", tmpFile.c_str());
+    }
+    if (fclose(file) && !ret)
+        ret = -EIO;
+
+    /* rename so a concurrent reader never maps a half written snapshot */
+    if (!ret && rename(tmpFile.c_str(), snapshotFile.c_str()))
+        ret = -errno;
+    if (ret)
+        unlink(tmpFile.c_str());
+    else
+        PAL_INFO(LOG_TAG, "wrote snapshot %s, %zu bytes", snapshotFile.c_str(),
+                 sizeof(hdr) + rec.strings.size() + rec.records.size());
+    return ret;
+}
+
+int PalXmlSnapshot::parse(const std::string &xmlFile, void *userdata,
+                          XML_StartElementHandler startTag,
+                          XML_EndElementHandler endTag,
+                          XML_CharacterDataHandler charData)
+{
+    struct xml_snapshot_handlers handlers;
+    struct xml_snapshot_recorder rec;
+    struct xml_snapshot_key key;
+    const uint8_t *data = NULL;
+    uint64_t changed_ns = 0;
+    size_t size = 0;
+    int ret = 0;
+
+    handlers.userdata = userdata;
+    handlers.start_tag = startTag;
+    handlers.end_tag = endTag;
+    handlers.char_data = charData;
+
+    ret = statXml(xmlFile, &key, &changed_ns);
+    if (ret)
+        return ret;
+
+    if (!replay(getPrebuiltSnapshotPath(xmlFile), xmlFile, key, changed_ns, true, &handlers) ||
+        !replay(getSnapshotPath(xmlFile), xmlFile, key, changed_ns, false, &handlers))
+        return 0;
+
+    ret = mapXml(xmlFile, &data, &size);
+    if (ret)
+        return ret;
+
+    ret = parseXml(xmlFile, data, size, &handlers, &rec);
+    if (!ret)
+        writeSnapshot(getSnapshotPath(xmlFile), key, rec);
+
+    unmapXml(data, size);
+    return ret;
+}
+
+int PalXmlSnapshot::generate(const std::string &xmlFile, const std::string &snapshotFile)
+{
+    struct xml_snapshot_handlers handlers;
+    struct xml_snapshot_recorder rec;
+    struct xml_snapshot_key key;
+    const uint8_t *data = NULL;
+    size_t size = 0;
+    int ret = 0;
+
+    memset(&handlers, 0, sizeof(handlers));
+    memset(&key, 0, sizeof(key));
+    ret = mapXml(xmlFile, &data, &size);
+    if (ret)
+        return ret;
+
+    ret = parseXml(xmlFile, data, size, &handlers, &rec);
+    key.size = size;
+    if (!ret)
+        ret = writeSnapshot(snapshotFile, key, rec);
+
+    unmapXml(data, size);
+    return ret;
+}
@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+/*
+ * palxmlsnapshot: generate PalXmlSnapshot files offline, e.g. at build
+ * time for the XMLs installed with the image. The snapshot is written next
+ * to the XML by default, which is where PalXmlSnapshot::parse looks for a
+ * prebuilt one before falling back to PAL_XML_SNAPSHOT_DIR.
+ *
+ * usage: palxmlsnapshot <xml> [<snapshot>]
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "PalXmlSnapshot.h"
+
+uint32_t pal_log_lvl = 0;
+
+int main(int argc, char *argv[])
+{
+    std::string xmlFile;
+    std::string snapshotFile;
+    int ret = 0;
+
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "usage: %s <xml> [<snapshot>]\n", argv[0]);
+        return 1;
+    }
+
+    xmlFile = argv[1];
+    snapshotFile = (argc == 3) ? argv[2] :
+        PalXmlSnapshot::getPrebuiltSnapshotPath(xmlFile);
+
+    ret = PalXmlSnapshot::generate(xmlFile, snapshotFile);
+    if (ret) {
+        fprintf(stderr, "%s: failed to generate %s from %s: %s\n", argv[0],
+                snapshotFile.c_str(), xmlFile.c_str(), strerror(-ret));
+        return 1;
+    }
+    printf("%s -> %s\n", xmlFile.c_str(), snapshotFile.c_str());
+    return 0;
+}